@@ -19,6 +19,7 @@ SOURCES += main.cpp \
     rbymoves.cpp \
     mechanicsbase.cpp \
     mechanics.cpp \
+    genmechanics.cpp \
     berries.cpp \
     battlerby.cpp \
     battlepluginstruct.cpp \
@@ -40,6 +41,7 @@ HEADERS += \
     miscabilities.h \
     mechanicsbase.h \
     mechanics.h \
+    genmechanics.h \
     berries.h \
     battlerby.h \
     battlepluginstruct.h \
@@ -48,6 +50,7 @@ HEADERS += \
     battlecounters.h \
     battlecounterindex.h \
     battlebase.h \
+    battlesnapshot.h \
     battle.h \
     abilities.h \
     battleserver.h \
@@ -4,6 +4,7 @@
 #include <PokemonInfo/pokemoninfo.h>
 #include "miscabilities.h"
 #include "../Shared/battlecommands.h"
+#include "genmechanics.h"
 
 QHash<int, AbilityMechanics> AbilityEffect::mechanics;
 QHash<int, QString> AbilityEffect::names;
@@ -11,26 +12,30 @@ QHash<QString, int> AbilityEffect::nums;
 
 void AbilityEffect::activate(const QString &effect, int num, int source, int target, BattleSituation &b)
 {
-    AbilityInfo::Effect e = AbilityInfo::Effects(num, b.gen());
+    const GenMechanics::Ability *a = b.mechanics().ability(num);
 
-    if (!mechanics.contains(e.num) || !mechanics[e.num].functions.contains(effect)) {
+    if (!a) {
         return;
     }
-    mechanics[e.num].functions[effect](source, target, b);
+
+    GenMechanics::function f = a->functions.value(effect);
+    if (f) {
+        f(source, target, b);
+    }
 }
 
 void AbilityEffect::setup(int num, int source, BattleSituation &b, bool firstAct)
 {
-    AbilityInfo::Effect effect = AbilityInfo::Effects(num, b.gen());
+    const GenMechanics::Ability *effect = b.mechanics().ability(num);
 
     AM::poke(b, source).remove("AbilityArg");
 
     /* if the effect is invalid or not yet implemented then no need to go further */
-    if (!mechanics.contains(effect.num)) {
+    if (!effect) {
         return;
     }
 
-    AM::poke(b, source)["AbilityArg"] = effect.arg;
+    AM::poke(b, source)["AbilityArg"] = effect->arg;
 
     if (b.gen() <= 3 && !firstAct) {
         /* In gen 3, intimidate/insomnia/... aren't triggered by Trace */
@@ -39,7 +44,7 @@ void AbilityEffect::setup(int num, int source, BattleSituation &b, bool firstAct
 
     if (b.gen() <= 5) {
         /* In gen 4, 5, Intimidate can't be activated twice on the same poke (Through Skill swap, ...) */
-        QString activationkey = QString("Ability%1SetUp").arg(effect.num);
+        QString activationkey = QString("Ability%1SetUp").arg(effect->effect);
 
         if (AM::poke(b, source).value(activationkey) == AM::poke(b, source)["SwitchCount"].toInt() && !firstAct) {
             return;
@@ -100,7 +105,7 @@ struct AMAnticipation : public AM {
     static void us (int s, int, BS &b) {
         static QList<int> cool_moves = QList<int> () << Move::Counter << Move::MetalBurst << Move::MirrorCoat;
 
-        QList<int> tars = b.revs(s);
+        BS::SlotList tars = b.revs(s);
         bool frightening_truth = false;
         foreach(int t, tars) {
             for (int i = 0; i < 4; i++) {
@@ -141,7 +146,7 @@ struct AMBadDreams : public AM {
     }
 
     static void et (int s, int, BS &b) {
-        QList<int> tars = b.revs(s);
+        BS::SlotList tars = b.revs(s);
         foreach(int t, tars) {
             if (b.poke(t).status() == Pokemon::Asleep && !b.hasWorkingAbility(t, Ability::MagicGuard)) {
                 b.sendAbMessage(6,0,s,t,Pokemon::Ghost);
@@ -309,8 +314,8 @@ struct AMDownload : public AM {
             return;
         }
 
-        QList<int> tars = b.allRevs(s);
-        if (tars.length() == 0) {
+        BS::SlotList tars = b.allRevs(s);
+        if (tars.size() == 0) {
             return;
         }
 
@@ -597,7 +602,7 @@ struct AMForeWarn : public AM {
     static special_moves SM;
 
     static void us(int s, int, BS &b) {
-        QList<int> tars = b.revs(s);
+        BS::SlotList tars = b.revs(s);
 
         if (tars.size() == 0) {
             return;
@@ -859,7 +864,7 @@ struct AMIntimidate : public AM {
     }
 
     static void us(int s, int , BS &b) {
-        QList<int> tars = b.revs(s);
+        BS::SlotList tars = b.revs(s);
 
         foreach(int t, tars) {
             if (!b.areAdjacent(s, t)) {
@@ -2223,7 +2228,7 @@ struct AMUnnerve : public AM {
 
     static void ol(int s, int, BS &b) {
         if (!b.hasWorkingTeamAbility(s, Ability::Unnerve, b.slot(s))) {
-            QList<int> tars = b.revs(s);
+            BS::SlotList tars = b.revs(s);
             foreach (int p, tars) {
                 int item = b.poke(p).item();
                 if (ItemInfo::isBerry(item)) {
@@ -36,13 +36,79 @@ BattleSituation::~BattleSituation()
     onDestroy();
 }
 
+struct BattleSituation::SnapshotData : public BattleSnapshot::Data
+{
+    context battlelong;
+    context teamzone[2];
+    QList<context> slotzone;
+    QList<PokeContext> contexts;
+    QVector<int> indexes;
+    bool megas[2];
+
+    /* The end of turn effects added and removed during the battle */
+    QVector<priorityBracket> endTurnEffects;
+    QHash<QString, priorityBracket> effectToBracket;
+    QHash<priorityBracket, int> bracketCount;
+    QHash<priorityBracket, int> bracketType;
+    QHash<priorityBracket, QString> bracketToEffect;
+    QHash<priorityBracket, IntFunction> ownSEndFunctions;
+};
+
+BattleSnapshot::Data *BattleSituation::saveState() const
+{
+    SnapshotData *d = new SnapshotData();
+
+    d->battlelong = battlelong;
+    d->slotzone = slotzone;
+    d->contexts = contexts;
+    d->indexes = indexes;
+    for (int i = 0; i < 2; i++) {
+        d->teamzone[i] = teamzone[i];
+        d->megas[i] = megas[i];
+    }
+    d->endTurnEffects = endTurnEffects;
+    d->effectToBracket = effectToBracket;
+    d->bracketCount = bracketCount;
+    d->bracketType = bracketType;
+    d->bracketToEffect = bracketToEffect;
+    d->ownSEndFunctions = ownSEndFunctions;
+
+    return d;
+}
+
+bool BattleSituation::restoreState(const BattleSnapshot::Data &data)
+{
+    const SnapshotData *d = dynamic_cast<const SnapshotData*>(&data);
+
+    if (!d) {
+        return false;
+    }
+
+    battlelong = d->battlelong;
+    slotzone = d->slotzone;
+    contexts = d->contexts;
+    indexes = d->indexes;
+    for (int i = 0; i < 2; i++) {
+        teamzone[i] = d->teamzone[i];
+        megas[i] = d->megas[i];
+    }
+    endTurnEffects = d->endTurnEffects;
+    effectToBracket = d->effectToBracket;
+    bracketCount = d->bracketCount;
+    bracketType = d->bracketType;
+    bracketToEffect = d->bracketToEffect;
+    ownSEndFunctions = d->ownSEndFunctions;
+
+    return true;
+}
+
 void BattleSituation::engageBattle()
 {
     BattleBase::engageBattle();
 
     /* For example, if two pokemons are brought out
        with a weather ability, the slower one acts last */
-    std::vector<int> pokes = sortedBySpeed();
+    SlotList pokes = sortedBySpeed();
 
     foreach(int p, pokes)
         callEntryEffects(p);
@@ -365,7 +431,7 @@ void BattleSituation::endTurn()
     if (gen() <= 3)
         requestSwitchIns();
 
-    speedsVector = sortedBySpeed();
+    orderBySpeed();
 
     /* Counters */
     if (gen() < 5) {
@@ -540,7 +606,7 @@ void BattleSituation::requestEndOfTurnSwitchIns()
         }
     }
 
-    speedsVector = sortedBySpeed();
+    orderBySpeed();
 }
 
 void BattleSituation::personalEndTurn(int player)
@@ -639,7 +705,7 @@ BattleChoices BattleSituation::createChoice(int slot)
             ret.switchAllowed = false;
         }
 
-        QList<int> opps = revs(slot);
+        SlotList opps = revs(slot);
         foreach(int opp, opps){
             callaeffects(opp, slot, "IsItTrapped");
             if (turnMemory(slot).value("Trapped").toBool()) {
@@ -760,13 +826,13 @@ void BattleSituation::shiftSpots(int spot1, int spot2, bool silent)
     }
 }
 
-std::vector<int> BattleSituation::sortedBySpeed() {
-    std::vector<int> ret = BattleBase::sortedBySpeed();
+BattleSituation::SlotList BattleSituation::sortedBySpeed() {
+    SlotList ret = BattleBase::sortedBySpeed();
 
     if (battleMemory().value("TrickRoomCount").toInt() > 0) {
         std::reverse(ret.begin(),ret.end());
         if (gen().num == 5) { // gen 5 ignores trick room for pokemon with speed>=1809
-            std::vector<int> temp;
+            SlotList temp = slotList();
             for (int it = ret.size()-1; it >= 0; it--) {
                 if (getStat(ret[it], Speed) >= 1809) {
                     temp.push_back(ret[it]);
@@ -784,11 +850,11 @@ void BattleSituation::analyzeChoices()
 {
     setupChoices();
 
-    std::map<int, std::vector<int>, std::greater<int> > priorities;
-    std::vector<int> items;
-    std::vector<int> switches;
+    PriorityList priorities(&turnArena);
+    SlotList items = slotList();
+    SlotList switches = slotList();
 
-    std::vector<int> playersByOrder = sortedBySpeed();
+    SlotList playersByOrder = sortedBySpeed();
 
     foreach(int i, playersByOrder) {
         if (choice(i).itemChoice()) {
@@ -800,32 +866,37 @@ void BattleSituation::analyzeChoices()
                 calleffects(i, i, "PriorityChoice"); //Me First. Needs to go above aeffects
                 callaeffects(i, i, "PriorityChoice");
             }
-            priorities[tmove(i).priority].push_back(i);
+            priorities.push_back(std::make_pair(int(tmove(i).priority), i));
         } else if (choice(i).moveToCenterChoice()){
             /* Shifting choice */
-            priorities[0].push_back(i);
+            priorities.push_back(std::make_pair(0, i));
         }
     }
 
-    std::map<int, std::vector<int>, std::greater<int> >::const_iterator it;
+    sortByPriority(priorities);
+
     std::vector<int> &players = speedsVector;
     players.clear();
 
     /* Needs to be before switches, otherwise analytic + pursuit on empty speed vector crashes the game */
-    for (it = priorities.begin(); it != priorities.end(); ++it) {
+    for (unsigned i = 0; i < priorities.size();) {
         /* There's another priority system: Ability stall, and Item lagging tail */
-        std::map<int, std::vector<int>, std::greater<int> > secondPriorities;
+        PriorityList secondPriorities(&turnArena);
 
-        foreach (int player, it->second) {
+        unsigned j;
+        for (j = i; j < priorities.size() && priorities[j].first == priorities[i].first; j++) {
+            int player = priorities[j].second;
             callaeffects(player,player, "TurnOrder"); //Stall
             callieffects(player,player, "TurnOrder"); //Lagging tail & ...
-            secondPriorities[turnMemory(player)["TurnOrder"].toInt()].push_back(player);
+            /* Lowest first */
+            secondPriorities.push_back(std::make_pair(-turnMemory(player)["TurnOrder"].toInt(), player));
         }
+        i = j;
 
-        for(std::map<int, std::vector<int> >::iterator it = secondPriorities.begin(); it != secondPriorities.end(); ++it) {
-            foreach(int p, it->second) {
-                players.push_back(p);
-            }
+        sortByPriority(secondPriorities);
+
+        for (unsigned k = 0; k < secondPriorities.size(); k++) {
+            players.push_back(secondPriorities[k].second);
         }
     }
 
@@ -1021,7 +1092,7 @@ void BattleSituation::calleffects(int source, int target, const QString &name)
     if (turn.contains("Effect_" + name)) {
         turn["TurnEffectCall"] = true;
         turn["TurnEffectCalled"] = name;
-        QSet<QString> &effects = *turn.value("Effect_" + name).value<QSharedPointer<QSet<QString> > >();
+        QSet<QString> effects = turn.value("Effect_" + name).value<QSet<QString> >();
 
         foreach(QString effect, effects) {
             MechanicsFunction f = turn.value("Effect_" + name + "_" + effect).value<MechanicsFunction>();
@@ -1037,7 +1108,7 @@ void BattleSituation::callpeffects(int source, int target, const QString &name)
 {
     if (pokeMemory(source).contains("Effect_" + name)) {
         turnMemory(source)["PokeEffectCall"] = true;
-        QSet<QString> &effects = *pokeMemory(source).value("Effect_" + name).value<QSharedPointer<QSet<QString> > >();
+        QSet<QString> effects = pokeMemory(source).value("Effect_" + name).value<QSet<QString> >();
 
         foreach(QString effect, effects) {
             MechanicsFunction f = pokeMemory(source).value("Effect_" + name + "_" + effect).value<MechanicsFunction>();
@@ -1054,7 +1125,7 @@ void BattleSituation::callpeffects(int source, int target, const QString &name)
 void BattleSituation::callbeffects(int source, int target, const QString &name, bool stopOnFail)
 {
     if (battleMemory().contains("Effect_" + name)) {
-        QSet<QString> &effects = *battleMemory().value("Effect_" + name).value<QSharedPointer<QSet<QString> > >();
+        QSet<QString> effects = battleMemory().value("Effect_" + name).value<QSet<QString> >();
 
         foreach(QString effect, effects) {
             MechanicsFunction f = battleMemory().value("Effect_" + name + "_" + effect).value<MechanicsFunction>();
@@ -1069,7 +1140,7 @@ void BattleSituation::callbeffects(int source, int target, const QString &name,
 void BattleSituation::callzeffects(int source, int target, const QString &name)
 {
     if (teamMemory(source).contains("Effect_" + name)) {
-        QSet<QString> &effects = *teamMemory(source).value("Effect_" + name).value<QSharedPointer<QSet<QString> > >();
+        QSet<QString> effects = teamMemory(source).value("Effect_" + name).value<QSet<QString> >();
 
         foreach(QString effect, effects) {
             MechanicsFunction f = teamMemory(source).value("Effect_" + name + "_" + effect).value<MechanicsFunction>();
@@ -1083,7 +1154,7 @@ void BattleSituation::callzeffects(int source, int target, const QString &name)
 void BattleSituation::callseffects(int source, int target, const QString &name)
 {
     if (slotMemory(source).contains("Effect_" + name)) {
-        QSet<QString> &effects = *slotMemory(source).value("Effect_" + name).value<QSharedPointer<QSet<QString> > >();
+        QSet<QString> effects = slotMemory(source).value("Effect_" + name).value<QSet<QString> >();
 
         foreach(QString effect, effects) {
             MechanicsFunction f = slotMemory(source).value("Effect_" + name + "_" + effect).value<MechanicsFunction>();
@@ -1112,7 +1183,7 @@ void BattleSituation::sendBack(int player, bool silent)
 {
     /* Just calling pursuit directly here, forgive me for this */
     if (!turnMemory(player).value("BatonPassed").toBool()) {
-        QList<int> opps = revs(player);
+        SlotList opps = revs(player);
         bool notified = false;
         foreach(int opp, opps) {
             //Pursuit does not deal additional effects to a teammate switching
@@ -2228,7 +2299,8 @@ void BattleSituation::makeTargetList(const QVector<int> &base)
         targetList = base.toStdVector();
         return;
     }
-    targetList = sortedBySpeed();
+    SlotList sorted = sortedBySpeed();
+    targetList.assign(sorted.begin(), sorted.end());
     for (unsigned i = 0; i < targetList.size(); i++) {
         if (!base.contains(targetList[i])) {
             targetList.erase(targetList.begin()+i, targetList.begin() + i + 1);
@@ -2317,7 +2389,7 @@ bool BattleSituation::hasWorkingItem(int player, int it)
 
 bool BattleSituation::opponentsHaveWorkingAbility(int play, int ability)
 {
-    QList<int> opponents = revs(play);
+    SlotList opponents = revs(play);
 
     foreach(int opponent, opponents) {
         if (hasWorkingAbility(opponent, ability))
@@ -4220,7 +4292,7 @@ void BattleSituation::requestSwitchIns()
         }
     }
 
-    std::vector<int> sorted = sortedBySpeed();
+    SlotList sorted = sortedBySpeed();
 
     /* Each wave calls the abilities in order , then next wave and so on. */
     foreach(int p, sorted) {
@@ -4339,26 +4411,26 @@ int BattleSituation::getBoostedStat(int player, int stat)
     }
 }
 
-void BattleSituation::notifySituation(int key)
+void BattleSituation::packSituation(QList<QByteArray> &commands)
 {
     for (int i = 0; i < 2; i++) {
         for (int j = 0; j < 6; j++) {
-            notify(key, AbsStatusChange, i, qint8(j), qint8(poke(i, j).status()));
+            commands.push_back(packCommand(AbsStatusChange, i, qint8(j), qint8(poke(i, j).status())));
         }
         for (int k = 0; k < numberOfSlots()/ 2; k++) {
             int s = slot(i,k);
             if (!koed(s) && !rearrangeTime()) {
-                notify(key, SendOut, s, true, quint8(k), opoke(s, i, k));
+                commands.push_back(packCommand(SendOut, s, true, quint8(k), opoke(s, i, k)));
                 /* Not clean. A pokemon with illusion could always have mimiced transform and then transformed... */
                 if (!pokeMemory(s).contains("IllusionTarget"))
-                    notify(key, ChangeTempPoke,s, quint8(TempSprite), pokenum(s));
+                    commands.push_back(packCommand(ChangeTempPoke, s, quint8(TempSprite), pokenum(s)));
                 if (hasSubstitute(s))
-                    notify(key, Substitute, s, hasSubstitute(s));
+                    commands.push_back(packCommand(Substitute, s, hasSubstitute(s)));
             }
         }
     }
 
-    notifyInfos(key);
+    packInfos(commands);
 }
 
 int BattleSituation::getStat(int player, int stat, int purityLevel)
@@ -4548,18 +4620,20 @@ BattleDynamicInfo BattleSituation::constructInfo(int slot)
 
 void BattleSituation::addUproarer(int player)
 {
-    if (!battleMemory().contains("Uproarer")) {
-        QVariant v;
-        v.setValue(QSharedPointer<QSet<int> > (new QSet<int>()));
-        battleMemory()["Uproarer"] = v;
-    }
-
-    battleMemory()["Uproarer"].value< QSharedPointer<QSet<int> > >()->insert(player);
+    QVariant &v = battleMemory()["Uproarer"];
+    QSet<int> uproarers = v.value<QSet<int> >();
+    v.clear();
+    uproarers.insert(player);
+    v.setValue(uproarers);
 }
 
 void BattleSituation::removeUproarer(int player)
 {
-    battleMemory()["Uproarer"].value<QSharedPointer<QSet<int> > >()->remove(player);
+    QVariant &v = battleMemory()["Uproarer"];
+    QSet<int> uproarers = v.value<QSet<int> >();
+    v.clear();
+    uproarers.remove(player);
+    v.setValue(uproarers);
 }
 
 bool BattleSituation::isThereUproar()
@@ -4568,7 +4642,7 @@ bool BattleSituation::isThereUproar()
         return false;
     }
 
-    foreach(int player, *battleMemory()["Uproarer"].value<QSharedPointer< QSet<int> > >()) {
+    foreach(int player, battleMemory().value("Uproarer").value<QSet<int> >()) {
         if (!koed(player) && pokeMemory(player).value("UproarUntil").toInt() >= turn()) {
             return true;
         }
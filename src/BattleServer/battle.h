@@ -12,9 +12,6 @@
 class BattlePlugin;
 class BattlePStorage;
 
-/* Fixme: needs some sort of cache to avoid revs() creating a list
-   each time */
-
 class BattleSituation : public BattleBase
 {
     Q_OBJECT
@@ -30,7 +27,7 @@ public:
     /* called just after requestChoice(s) */
     void analyzeChoice(int player);
     void analyzeChoices(); 
-    std::vector<int> sortedBySpeed();
+    SlotList sortedBySpeed();
 
     /* Commands for the battle situation */
     void engageBattle();
@@ -188,7 +185,7 @@ public:
     };
 
 private:
-    virtual void notifySituation(int dest);
+    virtual void packSituation(QList<QByteArray> &commands);
 
     virtual void storeChoice(const BattleChoice &b);
     void setupMove(int player, int move);
@@ -409,13 +406,18 @@ public:
     int fromInternalId(int id) const {
         return indexes.indexOf(id);
     }
+protected:
+    BattleSnapshot::Data *saveState() const;
+    bool restoreState(const BattleSnapshot::Data &data);
 private:
+    struct SnapshotData;
+
     /* Used when pokemon shift slots */
     QVector<int> indexes;
     bool megas[2];
 };
 
 Q_DECLARE_METATYPE(BattleSituation::MechanicsFunction)
-Q_DECLARE_METATYPE(QSharedPointer<QSet<int> >)
+Q_DECLARE_METATYPE(QSet<int>)
 
 #endif // BATTLE_H
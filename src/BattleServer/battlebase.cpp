@@ -1,8 +1,10 @@
 #include <cassert>
 #include "../Shared/battlecommands.h"
+#include "../Shared/battlestream.h"
 #include "battlebase.h"
 #include "pluginmanager.h"
 #include "battlefunctions.h"
+#include "genmechanics.h"
 
 using namespace BattleCommands;
 
@@ -12,6 +14,9 @@ typedef BattleBase::TurnMemory TM;
 BattleBase::BattleBase()
 {
     timer = NULL;
+    choosingTurn = false;
+    situationVersion = 0;
+    situationCacheVersion = -1;
 }
 
 void BattleBase::init(const BattlePlayer &p1, const BattlePlayer &p2, const ChallengeInfo &c, int id, const TeamBattle &t1, const TeamBattle &t2, BattleServerPluginManager *pluginManager)
@@ -28,6 +33,7 @@ void BattleBase::init(const BattlePlayer &p1, const BattlePlayer &p2, const Chal
     conf.teamOwnership = true;
     conf.gen = team(0).gen;
     conf.clauses = c.clauses;
+    genMechanics = GenMechanics::forGen(gen());
     conf.mode = c.mode;
 
     restrictedCount = p1.restrictedCount;
@@ -254,9 +260,84 @@ void BattleBase::run()
         beginTurn();
 
         endTurn();
+
+        turnArena.reset();
     }
 }
 
+BattleSnapshot BattleBase::snapshot() const
+{
+    if (!blocked() || !choosingTurn) {
+        return BattleSnapshot();
+    }
+
+    BattleSnapshot::Data *d = saveState();
+
+    d->numberOfSlots = numberOfSlots();
+    d->turn = turn();
+    d->attacker = attacker();
+    d->attacked = attacked();
+    d->attackCount = attackCount();
+    d->selfKoer = selfKoer();
+    d->repeatCount = repeatCount();
+    d->drawer = drawer();
+    d->forfeiter = forfeiter();
+    d->heatOfAttack = heatOfAttack();
+    d->weather = weather;
+    d->weatherCount = weatherCount;
+    d->terrain = terrain;
+    d->terrainCount = terrainCount;
+    for (int i = 0; i < 2; i++) {
+        d->currentForcedSleepPoke[i] = currentForcedSleepPoke[i];
+        d->teams[i] = team(i);
+    }
+    d->random.copyState(rand_generator);
+    d->options = options;
+    d->hasChoice = hasChoice;
+    d->couldMove = couldMove;
+
+    return BattleSnapshot(d);
+}
+
+bool BattleBase::restore(const BattleSnapshot &snapshot)
+{
+    if (snapshot.isNull() || !blocked() || !choosingTurn || finished()) {
+        return false;
+    }
+
+    const BattleSnapshot::Data &d = *snapshot.data();
+
+    if (d.numberOfSlots != numberOfSlots() || d.teams[0].gen != gen() || !restoreState(d)) {
+        return false;
+    }
+
+    turn() = d.turn;
+    attacker() = d.attacker;
+    attacked() = d.attacked;
+    attackCount() = d.attackCount;
+    selfKoer() = d.selfKoer;
+    repeatCount() = d.repeatCount;
+    drawer() = d.drawer;
+    forfeiter() = d.forfeiter;
+    heatOfAttack() = d.heatOfAttack;
+    weather = d.weather;
+    weatherCount = d.weatherCount;
+    terrain = d.terrain;
+    terrainCount = d.terrainCount;
+    for (int i = 0; i < 2; i++) {
+        currentForcedSleepPoke[i] = d.currentForcedSleepPoke[i];
+        team(i) = d.teams[i];
+    }
+    rand_generator.copyState(d.random);
+    options = d.options;
+    hasChoice = d.hasChoice;
+    couldMove = d.couldMove;
+
+    situationVersion += 1;
+
+    return true;
+}
+
 void BattleBase::onDestroy()
 {
     terminate();
@@ -340,11 +421,11 @@ const TeamBattle& BattleBase::pubteam(int id) const
     return team(spot(id));
 }
 
-QList<int> BattleBase::revs(int p) const
+BattleBase::SlotList BattleBase::revs(int p) const
 {
     int player = this->player(p);
     int opp = opponent(player);
-    QList<int> ret;
+    SlotList ret = slotList();
     for (int i = 0; i < numberPerSide(); i++) {
         if (!koed(slot(opp, i))) {
             ret.push_back(slot(opp, i));
@@ -355,11 +436,11 @@ QList<int> BattleBase::revs(int p) const
 }
 
 
-QList<int> BattleBase::allRevs(int p) const
+BattleBase::SlotList BattleBase::allRevs(int p) const
 {
     int player = this->player(p);
     int opp = opponent(player);
-    QList<int> ret;
+    SlotList ret = slotList();
     for (int i = 0; i < numberPerSide(); i++) {
         ret.push_back(slot(opp, i));
     }
@@ -433,7 +514,7 @@ int BattleBase::player(int slot) const
 
 int BattleBase::randomOpponent(int slot) const
 {
-    QList<int> opps = revs(slot);
+    SlotList opps = revs(slot);
     if (opps.empty()) return -1;
 
     return opps[randint(opps.size())];
@@ -441,7 +522,7 @@ int BattleBase::randomOpponent(int slot) const
 
 int BattleBase::randomValidOpponent(int slot) const
 {
-    QList<int> opps = revs(slot);
+    SlotList opps = revs(slot);
     if (opps.empty())
         return allRevs(slot).front();
 
@@ -720,30 +801,29 @@ void BattleBase::notifyMiss(bool multiTar, int player, int target)
     }
 }
 
-void BattleBase::emitCommand(int slot, int players, const QByteArray &toSend)
+/* Commands sent to everyone that don't change what the situation shows */
+static bool keepsSituation(const QByteArray &command)
 {
-    if (players == All) {
-        emit battleInfo(publicId(), qint32(id(Player1)), toSend);
-        emit battleInfo(publicId(), qint32(id(Player2)), toSend);
+    switch (command.length() > 0 ? command[0] : -1) {
+    case Spectating: case BattleChat: case SpectatorChat: case ClockStart: case ClockStop:
+        return true;
+    default:
+        return false;
+    }
+}
 
-        spectatorMutex.lock();
+void BattleBase::emitCommand(int slot, int players, const QByteArray &toSend)
+{
+    if ((players == All || players == AllButPlayer) && !keepsSituation(toSend)) {
+        situationVersion += 1;
+    }
 
-        QHashIterator<int, QPair<int, QString> > it(spectators);
-        while(it.hasNext()) {
-            emit battleInfo(publicId(), qint32(it.next().value().first), toSend);
-        }
-        spectatorMutex.unlock();
+    if (players == All) {
+        emit battleStream(publicId(), StreamAudience::All, 0, toSend);
     } else if (players == AllButPlayer) {
-        emit battleInfo(publicId(), qint32(id(opponent(player(slot)))), toSend);
-
-        spectatorMutex.lock();
-        QHashIterator<int, QPair<int, QString> >  it(spectators);
-        while(it.hasNext()) {
-            emit battleInfo(publicId(), qint32(it.next().value().first), toSend);
-        }
-        spectatorMutex.unlock();
+        emit battleStream(publicId(), StreamAudience::AllButPlayer, qint32(id(player(slot))), toSend);
     } else {
-        emit battleInfo(publicId(), qint32(id(players)), toSend);
+        emit battleStream(publicId(), StreamAudience::Player, qint32(id(players)), toSend);
     }
     callp(BP::emitCommand, slot, players, toSend);
 }
@@ -792,52 +872,88 @@ void BattleBase::addSpectator(QPair<int, QString> p)
 {
     /* Simple guard to avoid multithreading problems -- would need to be improved :s */
     if (!blocked() && !finished()) {
+        /* One timer for the whole queue, it is cleared all at once */
+        if (pendingSpectators.empty()) {
+            QTimer::singleShot(100, this, SLOT(clearSpectatorQueue()));
+        }
         pendingSpectators.append(p);
-        QTimer::singleShot(100, this, SLOT(clearSpectatorQueue()));
 
         return;
     }
 
-    int id = p.first;
+    addSpectators(QList<QPair<int, QString> >() << p);
+}
 
-    int key;
+/* Everyone joining at the same time gets the same commands, packed once and
+   sent in one message: the server unpacks it in one write to the client. */
+void BattleBase::addSpectators(const QList<QPair<int, QString> > &batch)
+{
+    typedef QPair<int, QString> pair;
 
-    if (configuration().isInBattle(id)) {
-        /* Player was likely dced */
-        emit sendBattleInfos(id, publicId(), this->id(opponent(spot(id))), team(spot(id)), configuration(), tier());
-        key = spot(id);
+    QList<pair> joining;
 
-        notifyChoices(key);
-    } else {
-        /* Assumption: each id is a different player, so key is unique */
-        key = spectatorKey(id);
+    foreach(pair p, batch) {
+        int id = p.first;
 
-        if (spectators.contains(key)) {
-            // Then a guy was put on waitlist and tried again, w/e don't accept him
-            return;
-        }
+        if (configuration().isInBattle(id)) {
+            /* Player was likely dced */
+            emit sendBattleInfos(id, publicId(), this->id(opponent(spot(id))), team(spot(id)), configuration(), tier());
+            int key = spot(id);
 
-        spectators[key] = p;
+            notifyChoices(key);
+            notify(All, Spectating, 0, true, qint32(id), p.second);
+            notifySituation(key, QList<QByteArray>() << packCommand(BlankMessage, 0));
+        } else {
+            /* Assumption: each id is a different player, so key is unique */
+            int key = spectatorKey(id);
 
-        if (tier().length() > 0)
-            notify(key, TierSection, Player1, tier());
-        else
-            notify(key, TierSection, Player1, QString("Mixed %1").arg(GenInfo::Version(gen())));
+            bool twice = false;
+            foreach(pair other, joining) {
+                twice |= other.first == id;
+            }
 
-        notify(key, Rated, Player1, rated());
+            if (spectators.contains(key) || twice) {
+                // Then a guy was put on waitlist and tried again, w/e don't accept him
+                continue;
+            }
 
-        typedef QPair<int, QString> pair;
-        foreach (pair spec, spectators) {
-            if (spec.first != id)
-                notify(key, Spectating, 0, true, qint32(spec.first), spec.second);
+            joining.push_back(p);
         }
     }
 
-    notify(All, Spectating, 0, true, qint32(id), p.second);
+    if (joining.empty()) {
+        return;
+    }
 
-    notify(key, BlankMessage, 0);
+    QList<QByteArray> commands;
+
+    if (tier().length() > 0)
+        commands.push_back(packCommand(TierSection, Player1, tier()));
+    else
+        commands.push_back(packCommand(TierSection, Player1, QString("Mixed %1").arg(GenInfo::Version(gen()))));
+
+    commands.push_back(packCommand(Rated, Player1, rated()));
+
+    foreach (pair spec, spectators) {
+        commands.push_back(packCommand(Spectating, 0, true, qint32(spec.first), spec.second));
+    }
 
-    notifySituation(key);
+    commands.push_back(packCommand(BlankMessage, 0));
+
+    spectatorMutex.lock();
+    foreach(pair p, joining) {
+        spectators[spectatorKey(p.first)] = p;
+    }
+    spectatorMutex.unlock();
+
+    foreach(pair p, joining) {
+        notifySituation(spectatorKey(p.first), commands);
+    }
+
+    /* The ones joining together learn about each other there */
+    foreach(pair p, joining) {
+        notify(All, Spectating, 0, true, qint32(p.first), p.second);
+    }
 }
 
 void BattleBase::removeSpectator(int id)
@@ -1132,19 +1248,19 @@ bool BattleBase::allChoicesSet()
 
 void BattleBase::clearSpectatorQueue()
 {
+    if (pendingSpectators.empty()) {
+        return;
+    }
     if (!blocked() && !finished()) {
         QTimer::singleShot(100, this, SLOT(clearSpectatorQueue()));
         return;
     }
-    if (pendingSpectators.size() > 0) {
-        auto copy = pendingSpectators;
 
-        pendingSpectators.clear();
+    auto copy = pendingSpectators;
 
-        foreach (auto p, copy) {
-            addSpectator(p);
-        }
-    }
+    pendingSpectators.clear();
+
+    addSpectators(copy);
 }
 
 void BattleBase::battleChoiceReceived(int id, const BattleChoice &b)
@@ -1313,11 +1429,11 @@ inline bool comparePair(const std::pair<int,int> & x, const std::pair<int,int> &
     return x.second>y.second;
 }
 
-std::vector<int> BattleBase::sortedBySpeed()
+BattleBase::SlotList BattleBase::sortedBySpeed()
 {
-    std::vector<int> ret;
+    SlotList ret = slotList();
 
-    std::vector<std::pair<int, int> > speeds;
+    std::vector<std::pair<int, int>, ArenaAllocator<std::pair<int, int> > > speeds(&turnArena);
 
     for (int i =0; i < numberOfSlots(); i++) {
         if (!koed(i)) {
@@ -1353,6 +1469,21 @@ std::vector<int> BattleBase::sortedBySpeed()
     return std::move(ret);
 }
 
+static bool higherPriority(const std::pair<int,int> &x, const std::pair<int,int> &y) {
+    return x.first > y.first;
+}
+
+void BattleBase::sortByPriority(PriorityList &list)
+{
+    std::stable_sort(list.begin(), list.end(), &higherPriority);
+}
+
+void BattleBase::orderBySpeed()
+{
+    SlotList sorted = sortedBySpeed();
+    speedsVector.assign(sorted.begin(), sorted.end());
+}
+
 bool BattleBase::attacking()
 {
     return attacker() != -1;
@@ -1369,24 +1500,62 @@ void BattleBase::setupItems(int player, const QHash<quint16, quint16> &items)
     this->items(player) = items;
 }
 
-void BattleBase::notifySituation(int key)
+/* Sends the situation after the given commands, in one message. A player also
+   gets the stats of their pokemon, which spectators don't see */
+void BattleBase::notifySituation(int key, QList<QByteArray> commands)
+{
+    commands += situation();
+
+    emitCommand(0, key, packCommand(SituationSnapshot, 0, commands));
+
+    if (key == Player1 || key == Player2) {
+        for (int i = 0; i < numberPerSide(); i++) {
+            int s = slot(key, i);
+            if (!koed(s)) {
+                notify(key, DynamicStats, s, constructStats(s));
+            }
+        }
+    }
+}
+
+const QList<QByteArray> &BattleBase::situation()
+{
+    if (situationCacheVersion != situationVersion) {
+        situationCache.clear();
+        packSituation(situationCache);
+        situationCacheVersion = situationVersion;
+    }
+
+    return situationCache;
+}
+
+void BattleBase::packSituation(QList<QByteArray> &commands)
 {
     for (int i = 0; i < 2; i++) {
         for (int j = 0; j < 6; j++) {
-            notify(key, AbsStatusChange, i, qint8(j), qint8(poke(i, j).status()));
+            commands.push_back(packCommand(AbsStatusChange, i, qint8(j), qint8(poke(i, j).status())));
         }
         for (int k = 0; k < numberOfSlots()/ 2; k++) {
             int s = slot(i,k);
             if (!koed(s) && !rearrangeTime()) {
-                notify(key, SendOut, s, true, quint8(k), opoke(s, i, k));
+                commands.push_back(packCommand(SendOut, s, true, quint8(k), opoke(s, i, k)));
 
                 if (hasSubstitute(s))
-                    notify(key, Substitute, s, hasSubstitute(s));
+                    commands.push_back(packCommand(Substitute, s, hasSubstitute(s)));
             }
         }
     }
 
-    notifyInfos(key);
+    packInfos(commands);
+}
+
+void BattleBase::packInfos(QList<QByteArray> &commands)
+{
+    for (int p = 0; p < numberOfSlots(); p++) {
+        if (!koed(p)) {
+            commands.push_back(packCommand(DynamicInfo, p, constructInfo(p)));
+        }
+    }
 }
 
 void BattleBase::notifyInfos(int tosend)
@@ -1504,7 +1673,9 @@ void BattleBase::requestChoices()
         /* Send a brief update on the status */
         notifyInfos();
         /* Lock until ALL choices are received */
+        choosingTurn = true;
         yield();
+        choosingTurn = false;
     }
 
     notify(All, BeginTurn, All, turn());
@@ -1757,7 +1928,7 @@ void BattleBase::requestSwitchIns()
 void BattleBase::requestEndOfTurnSwitchIns()
 {
     requestSwitchIns();
-    speedsVector = sortedBySpeed();
+    orderBySpeed();
 }
 
 
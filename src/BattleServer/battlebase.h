@@ -6,12 +6,16 @@
 #include <PokemonInfo/battlestructs.h>
 #include <Utilities/mtrand.h>
 #include <Utilities/contextswitch.h>
+#include <Utilities/packetbuilder.h>
+#include <Utilities/arena.h>
 #include "battlepluginstruct.h"
+#include "battlesnapshot.h"
 
 #include <algorithm>
 
 class BattlePlayer;
 class BattleServerPluginManager;
+class GenMechanics;
 
 class BattleBase : public ContextCallee, public BattleInterface
 {
@@ -37,6 +41,8 @@ public:
     ~BattleBase();
 
     typedef QVariantHash context;
+    /* Lists of slots that don't outlive the turn, see turnArena */
+    typedef std::vector<int, ArenaAllocator<int> > SlotList;
 
     void init(const BattlePlayer &p1, const BattlePlayer &p2, const ChallengeInfo &additionnalData, int id, const TeamBattle &t1, const TeamBattle &t2, BattleServerPluginManager *p);
 
@@ -45,9 +51,23 @@ public:
 
     /* Starts the battle -- use the time before to connect signals / slots */
     void start(ContextSwitcher &ctx);
+
+    /* Like battleChoiceReceived, only while the battle is blocked.
+
+       A snapshot can only be taken while the battle waits for the choices of a
+       turn, otherwise it's null. It can be restored in any battle of the same
+       generation and mode waiting for the choices of a turn, which then
+       waits for the choices the snapshot was waiting for. */
+    BattleSnapshot snapshot() const;
+    bool restore(const BattleSnapshot &snapshot);
 protected:
     void onDestroy(); //call in the sub class destructor
 
+    /* The state of the kind of battle, the common part is filled by snapshot() */
+    virtual BattleSnapshot::Data *saveState() const = 0;
+    /* Returns false if the snapshot is from another kind of battle */
+    virtual bool restoreState(const BattleSnapshot::Data &data) = 0;
+
     virtual void engageBattle();
     virtual void beginTurn();
     virtual void endTurn() = 0;
@@ -59,8 +79,15 @@ public:
     /* The other player */
     int opponent(int player) const;
     int partner(int spot) const;
-    QList<int> revs(int slot) const;
-    QList<int> allRevs(int slot) const; //returns even koed opponents
+    SlotList revs(int slot) const;
+    SlotList allRevs(int slot) const; //returns even koed opponents
+    SlotList slotList() const {
+        return SlotList(&turnArena);
+    }
+    /* Memory for data of the turn, given back after each turn */
+    const Arena &arena() const {
+        return turnArena;
+    }
     /* returns the id corresponding to that spot (spot is 0 or 1) */
     int id(int spot) const;
     /* Return the configuration of the players (1 refer to that player, 0 to that one... */
@@ -72,6 +99,8 @@ public:
     Pokemon::gen gen() const {return conf.gen;}
     int mode() const {return conf.mode;}
     quint32 clauses() const {return conf.clauses;}
+    /* Moves, abilities and items of the generation, bound when the battle starts */
+    const GenMechanics &mechanics() const {return *genMechanics;}
     /*
     Below Player is either 1 or 0, aka the spot of the id.
     Use the functions above to make conversions
@@ -122,7 +151,12 @@ public:
         return clauses() & ChallengeInfo::SleepClause;
     }
 
-    virtual std::vector<int> sortedBySpeed();
+    virtual SlotList sortedBySpeed();
+    /* speedsVector = sortedBySpeed() */
+    void orderBySpeed();
+    /* (priority, slot), sorted by highest priority with the order kept for the same priority */
+    typedef std::vector<std::pair<int, int>, ArenaAllocator<std::pair<int, int> > > PriorityList;
+    static void sortByPriority(PriorityList &list);
 
     void notifyClause(int clause);
     void notifyMiss(bool multitar, int player, int target);
@@ -138,12 +172,12 @@ public:
     /* Sends data to players */
     template <typename ...Params>
     void notify(int player, int command, int who, Params&&... params) {
-        QByteArray tosend;
-        DataStream out(&tosend, QIODevice::WriteOnly);
-
-        out.pack(uchar(command), qint8(who), std::forward<Params>(params)...);
+        emitCommand(who, player, packCommand(command, who, std::forward<Params>(params)...));
+    }
 
-        emitCommand(who, player, tosend);
+    template <typename ...Params>
+    static QByteArray packCommand(int command, int who, Params&&... params) {
+        return PacketBuilder::pack(0, uchar(command), qint8(who), std::forward<Params>(params)...);
     }
 
     void emitCommand(int player, int players, const QByteArray &data);
@@ -163,8 +197,11 @@ signals:
        The battle might already be deleted when the signal is received.
 
        So the parameter "publicId" is for the server to not to have to use
-       sender(); */
-    void battleInfo(int publicId, int id, const QByteArray &info);
+       sender();
+
+       Each command is sent once with its audience (see Shared/battlestream.h),
+       the server knows the spectators and copies it to them. */
+    void battleStream(int publicId, int audience, int id, const QByteArray &info);
     void battleFinished(int battleid, int result, int winner, int loser);
     void sendBattleInfos(int,int,int,const TeamBattle&,const BattleConfiguration&, const QString&);
 protected:
@@ -176,7 +213,17 @@ protected:
         return 10000 + id;
     }
 
-    virtual void notifySituation(int dest);
+    /* The commands that show the battle as it is to someone joining it. Made
+       once and sent to all those joining until the battle changes */
+    const QList<QByteArray> &situation();
+    virtual void packSituation(QList<QByteArray> &commands);
+    void packInfos(QList<QByteArray> &commands);
+    void notifySituation(int dest, QList<QByteArray> commands = QList<QByteArray>());
+
+    QList<QByteArray> situationCache;
+    /* Bumped by every command that changes what the situation shows */
+    int situationVersion;
+    int situationCacheVersion;
 
     int ratings[2];
     int restricted[2];
@@ -196,6 +243,9 @@ protected:
     bool timeStopped[2];
     QBasicTimer *timer;
 
+    /* Set while waiting for the choices of a turn, when snapshots are possible */
+    bool choosingTurn;
+
     /* What choice we allow the players to have */
     QList<BattleChoices> options;
     /* Is set to false once a player choses it move */
@@ -246,6 +296,7 @@ public:
     bool acceptSpectator(int id, bool authed=false) const;
     /* In case it's one of the battler, resends the current info to the battler */
     void addSpectator(QPair<int, QString>);
+    void addSpectators(const QList<QPair<int, QString> > &batch);
     void removeSpectator(int id);
 
     /* Server tells a player forfeited */
@@ -289,6 +340,8 @@ protected:
     mutable MTRand_int32 rand_generator;
 
     BattleConfiguration conf;
+    QSharedPointer<const GenMechanics> genMechanics;
+    mutable Arena turnArena;
 
     void requestChoices();
     /* requests choice of action from the player */
@@ -18,6 +18,58 @@ BattleRBY::~BattleRBY()
     onDestroy();
 }
 
+struct BattleRBY::SnapshotData : public BattleSnapshot::Data
+{
+    BattleChoice choices[2];
+    BasicPokeInfo pokes[2];
+    SlotMemory slotzones[2];
+    TurnMemory turnzones[2];
+    BasicMoveInfo moves[2];
+    context pokeMems[2];
+    context turnMems[2];
+    context battlelongs;
+};
+
+BattleSnapshot::Data *BattleRBY::saveState() const
+{
+    SnapshotData *d = new SnapshotData();
+
+    for (int i = 0; i < 2; i++) {
+        d->choices[i] = choices[i];
+        d->pokes[i] = pokes[i];
+        d->slotzones[i] = slotzones[i];
+        d->turnzones[i] = turnzones[i];
+        d->moves[i] = moves[i];
+        d->pokeMems[i] = pokeMems[i];
+        d->turnMems[i] = turnMems[i];
+    }
+    d->battlelongs = battlelongs;
+
+    return d;
+}
+
+bool BattleRBY::restoreState(const BattleSnapshot::Data &data)
+{
+    const SnapshotData *d = dynamic_cast<const SnapshotData*>(&data);
+
+    if (!d) {
+        return false;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        choices[i] = d->choices[i];
+        pokes[i] = d->pokes[i];
+        slotzones[i] = d->slotzones[i];
+        turnzones[i] = d->turnzones[i];
+        moves[i] = d->moves[i];
+        pokeMems[i] = d->pokeMems[i];
+        turnMems[i] = d->turnMems[i];
+    }
+    battlelongs = d->battlelongs;
+
+    return true;
+}
+
 void BattleRBY::debug(const QString &message)
 {
     battleChat(conf.ids[0], message);
@@ -28,7 +80,7 @@ void BattleRBY::endTurn()
     testWin();
     requestSwitchIns();
 
-    speedsVector = sortedBySpeed();
+    orderBySpeed();
 
     for (unsigned i = 0; i < speedsVector.size(); i++) {
         /* Disable counter here ? */
@@ -161,11 +213,11 @@ void BattleRBY::analyzeChoices()
 {
     setupChoices();
 
-    std::map<int, std::vector<int>, std::greater<int> > priorities;
-    std::vector<int> switches;
-    std::vector<int> items;
+    PriorityList priorities(&turnArena);
+    SlotList switches = slotList();
+    SlotList items = slotList();
 
-    std::vector<int> playersByOrder = sortedBySpeed();
+    SlotList playersByOrder = sortedBySpeed();
 
     foreach(int i, playersByOrder) {
         if (choice(i).itemChoice()) {
@@ -173,10 +225,10 @@ void BattleRBY::analyzeChoices()
         } else if (choice(i).switchChoice())
             switches.push_back(i);
         else if (choice(i).attackingChoice()){
-            priorities[tmove(i).priority].push_back(i);
+            priorities.push_back(std::make_pair(int(tmove(i).priority), i));
         } else {
             /* Shifting choice */
-            priorities[0].push_back(i);
+            priorities.push_back(std::make_pair(0, i));
         }
     }
 
@@ -195,14 +247,13 @@ void BattleRBY::analyzeChoices()
         notify(All, BlankMessage, Player1);
     }
 
-    std::map<int, std::vector<int>, std::greater<int> >::const_iterator it;
+    sortByPriority(priorities);
+
     std::vector<int> &players = speedsVector;
     players.clear();
 
-    for (it = priorities.begin(); it != priorities.end(); ++it) {
-        foreach (int player, it->second) {
-            players.push_back(player);
-        }
+    for (unsigned i = 0; i < priorities.size(); i++) {
+        players.push_back(priorities[i].second);
     }
 
     for(unsigned i = 0; i < players.size(); i++) {
@@ -726,7 +777,7 @@ void BattleRBY::callpeffects(int source, int target, const QString &name)
 {
     if (pokeMemory(source).contains("Effect_" + name)) {
         turnMemory(source)["PokeEffectCall"] = true;
-        QSet<QString> &effects = *pokeMemory(source).value("Effect_" + name).value<QSharedPointer<QSet<QString> > >();
+        QSet<QString> effects = pokeMemory(source).value("Effect_" + name).value<QSet<QString> >();
 
         foreach(QString effect, effects) {
             MechanicsFunction f = pokeMemory(source).value("Effect_" + name + "_" + effect).value<MechanicsFunction>();
@@ -746,7 +797,7 @@ void BattleRBY::calleffects(int source, int target, const QString &name)
     if (turn.contains("Effect_" + name)) {
         turn["TurnEffectCall"] = true;
         turn["TurnEffectCalled"] = name;
-        QSet<QString> &effects = *turn.value("Effect_" + name).value<QSharedPointer<QSet<QString> > >();
+        QSet<QString> effects = turn.value("Effect_" + name).value<QSet<QString> >();
 
         foreach(QString effect, effects) {
             MechanicsFunction f = turn.value("Effect_" + name + "_" + effect).value<MechanicsFunction>();
@@ -39,7 +39,12 @@ protected:
 
     void personalEndTurn(int player);
     void setupMove(int i, int move);
+
+    BattleSnapshot::Data *saveState() const;
+    bool restoreState(const BattleSnapshot::Data &data);
 private:
+    struct SnapshotData;
+
     BattleChoice choices[2];
 
     BasicPokeInfo pokes[2];
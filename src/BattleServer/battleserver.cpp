@@ -13,6 +13,7 @@
 #include "serverconnection.h"
 #include "battleserver.h"
 #include "pluginmanager.h"
+#include "genmechanics.h"
 
 BattleServer::BattleServer(QObject *parent) :
     QObject(parent), servercounter(0), closeOnDc(false)
@@ -33,6 +34,7 @@ void BattleServer::start(int port, bool closeOnDc)
     RBYMoveEffect::init();
     ItemEffect::init();
     AbilityEffect::init();
+    GenMechanics::build();
 
     print("...Done!");
 
@@ -144,6 +146,7 @@ void BattleServer::modChanged(const QString &mod)
 
     print(QString("Database mod changed: %1").arg(mod));
     changeDbMod(mod);
+    GenMechanics::build();
 }
 
 void BattleServer::newBattle(int sid, int battleid, const BattlePlayer &pb1, const BattlePlayer &pb2, const ChallengeInfo &c, const TeamBattle &t1, const TeamBattle &t2)
@@ -160,7 +163,7 @@ void BattleServer::newBattle(int sid, int battleid, const BattlePlayer &pb1, con
 
     conn->battles.insert(battleid, battle);
     connect(battle, SIGNAL(sendBattleInfos(int,int,int,TeamBattle,BattleConfiguration,QString)), conn, SLOT(notifyBattle(int,int,int,TeamBattle,BattleConfiguration,QString)));
-    connect(battle, SIGNAL(battleInfo(int,int,QByteArray)), conn, SLOT(notifyInfo(int,int,QByteArray)));
+    connect(battle, SIGNAL(battleStream(int,int,int,QByteArray)), conn, SLOT(notifyStream(int,int,int,QByteArray)));
     connect(battle, SIGNAL(battleFinished(int,int,int,int)), conn, SLOT(notifyFinished(int,int,int,int)));
     connect(conn, SIGNAL(destroyed()), battle, SLOT(deleteLater()));
 
@@ -0,0 +1,60 @@
+#ifndef BATTLESNAPSHOT_H
+#define BATTLESNAPSHOT_H
+
+#include <QSharedPointer>
+#include <PokemonInfo/battlestructs.h>
+#include <Utilities/mtrand.h>
+
+/* State of a battle waiting for the choices of a turn, from which the battle
+   can be played again as many times as needed (with other choices, or to check
+   a replay): see BattleBase::snapshot() and BattleBase::restore().
+
+   A snapshot never changes once taken, so copies share it. The memories of the
+   battle are implicitly shared Qt containers, a restored battle shares them with
+   the snapshot and only copies the ones it changes. */
+class BattleSnapshot
+{
+public:
+    /* The parts common to all generations, each kind of battle adds its own */
+    struct Data {
+        Data() {}
+        virtual ~Data() {}
+
+        int numberOfSlots;
+        int turn;
+        int attacker, attacked, attackCount, selfKoer, repeatCount, drawer, forfeiter;
+        bool heatOfAttack;
+        int currentForcedSleepPoke[2];
+        int weather, weatherCount;
+        int terrain, terrainCount;
+
+        TeamBattle teams[2];
+        MTRand_int32 random;
+
+        QList<BattleChoices> options;
+        QList<int> hasChoice;
+        QList<bool> couldMove;
+    private:
+        Data(const Data&);
+        Data &operator = (const Data&);
+    };
+
+    BattleSnapshot() {}
+    explicit BattleSnapshot(Data *d) : d(d) {}
+
+    bool isNull() const {
+        return !d;
+    }
+
+    int turn() const {
+        return d ? d->turn : 0;
+    }
+
+    const Data *data() const {
+        return d.data();
+    }
+private:
+    QSharedPointer<const Data> d;
+};
+
+#endif // BATTLESNAPSHOT_H
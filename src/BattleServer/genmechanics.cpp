@@ -0,0 +1,111 @@
+#include <PokemonInfo/pokemoninfo.h>
+#include "moves.h"
+#include "abilities.h"
+#include "items.h"
+#include "genmechanics.h"
+
+QMutex GenMechanics::mutex;
+QHash<Pokemon::gen, QSharedPointer<const GenMechanics> > GenMechanics::tables;
+
+GenMechanics::GenMechanics(Pokemon::gen gen) : gen(gen)
+{
+    int moveCount = MoveInfo::NumberOfMoves();
+    moveInfos.resize(moveCount);
+    for (int num = 0; num < moveCount; num++) {
+        PureMechanicsBase::initMove(num, gen, moveInfos[num]);
+    }
+
+    /* The kind of battle is chosen from the challenge, not the teams, so both are there */
+    m_moveEffects.build(gen, MoveEffect::mechanics, MoveEffect::names);
+    m_rbyMoveEffects.build(gen, RBYMoveEffect::mechanics, RBYMoveEffect::names);
+
+    int abilityCount = AbilityInfo::NumberOfAbilities(GenInfo::GenMax());
+    for (int num = 0; num < abilityCount; num++) {
+        AbilityInfo::Effect e = AbilityInfo::Effects(num, gen);
+
+        if (!AbilityEffect::mechanics.contains(e.num)) {
+            continue;
+        }
+
+        Ability &a = abilities[num];
+        a.effect = e.num;
+        a.arg = e.arg;
+        a.functions = AbilityEffect::mechanics[e.num].functions;
+    }
+
+    foreach(const QString &name, ItemInfo::SortedNames(gen)) {
+        int num = ItemInfo::Number(name);
+
+        Item item;
+        bool found = false;
+
+        /* In the order of the effects, like ItemEffect::activate did */
+        foreach(ItemInfo::Effect e, ItemInfo::Effects(num, gen)) {
+            if (!ItemEffect::mechanics.contains(e.num)) {
+                continue;
+            }
+            found = true;
+
+            if (e.args.size() > 0) {
+                item.arg = e.args;
+            }
+
+            const QHash<QString, function> &functions = ItemEffect::mechanics[e.num].functions;
+            for (QHash<QString, function>::const_iterator it = functions.constBegin(); it != functions.constEnd(); ++it) {
+                item.events[it.key()].push_back(it.value());
+            }
+        }
+
+        if (found) {
+            items.insert(num, item);
+        }
+    }
+}
+
+void GenMechanics::initMove(int num, BattleBase::BasicMoveInfo &bmi) const
+{
+    if (num < 0 || num >= moveInfos.size()) {
+        PureMechanicsBase::initMove(num, gen, bmi);
+        return;
+    }
+    bmi = moveInfos[num];
+}
+
+const GenMechanics::Ability *GenMechanics::ability(int num) const
+{
+    QHash<int, Ability>::const_iterator it = abilities.constFind(num);
+    return it == abilities.constEnd() ? NULL : &*it;
+}
+
+const GenMechanics::Item *GenMechanics::item(int num) const
+{
+    QHash<int, Item>::const_iterator it = items.constFind(num);
+    return it == items.constEnd() ? NULL : &*it;
+}
+
+QSharedPointer<const GenMechanics> GenMechanics::forGen(Pokemon::gen gen)
+{
+    QMutexLocker l(&mutex);
+
+    QSharedPointer<const GenMechanics> &table = tables[gen];
+    /* A generation build() didn't know about, when it wasn't called at all */
+    if (!table) {
+        table = QSharedPointer<const GenMechanics>(new GenMechanics(gen));
+    }
+    return table;
+}
+
+void GenMechanics::build()
+{
+    QHash<Pokemon::gen, QSharedPointer<const GenMechanics> > built;
+
+    for (int g = GenInfo::GenMin(); g <= GenInfo::GenMax(); g++) {
+        for (int sub = 0; sub < GenInfo::NumberOfSubgens(g); sub++) {
+            Pokemon::gen gen(g, sub);
+            built.insert(gen, QSharedPointer<const GenMechanics>(new GenMechanics(gen)));
+        }
+    }
+
+    QMutexLocker l(&mutex);
+    tables.swap(built);
+}
@@ -0,0 +1,191 @@
+#ifndef GENMECHANICS_H
+#define GENMECHANICS_H
+
+#include <cstdlib>
+#include <QMutex>
+#include <QSharedPointer>
+#include "mechanics.h"
+#include "rbymoves.h"
+
+/* The move effects registered by MoveEffect::init (or RBYMoveEffect::init),
+   resolved for each move of a generation: the special effects of the database
+   are parsed once, and the keys under which the functions go in the turn memory
+   are made once */
+template <class M>
+struct MoveEffectTable
+{
+    typedef typename M::function function;
+
+    struct Function {
+        /* "Effect_" + event, "Effect_" + event + "_" + name */
+        QString effectKey, functionKey;
+        function f;
+        bool onSetup;
+    };
+
+    struct Effect {
+        QString name;
+        /* Stored as name + "_Arg" in the turn memory when the effect has one */
+        QString argKey, arg;
+        QVector<Function> functions;
+    };
+
+    QHash<int, QVector<Effect> > moves;
+
+    void build(Pokemon::gen gen, const QHash<int, M> &mechanics, const QHash<int, QString> &names);
+
+    void setup(int num, int source, int target, BattleBase &b) const;
+    void unsetup(int num, int source, BattleBase &b) const;
+};
+
+/* Everything a battle needs to know about the moves, abilities and items of its
+   generation, taken from the database and the registered mechanics once instead
+   of each time a move is used or an effect is called. A battle binds to the table
+   of its generation when it starts: see BattleBase::mechanics().
+
+   The tables are built for all generations by build(), at startup and whenever
+   the database changes. Battles going on keep the table they started with. */
+class GenMechanics
+{
+public:
+    typedef Mechanics::function function;
+
+    struct Ability {
+        int effect;
+        QString arg;
+        QHash<QString, function> functions;
+    };
+
+    struct Item {
+        /* The argument of the last effect with one, stored as ItemArg */
+        QString arg;
+        QHash<QString, QVector<function> > events;
+    };
+
+    explicit GenMechanics(Pokemon::gen gen);
+
+    /* Same as PureMechanicsBase::initMove, from the table */
+    void initMove(int num, BattleBase::BasicMoveInfo &bmi) const;
+
+    const MoveEffectTable<Mechanics> &moveEffects() const {
+        return m_moveEffects;
+    }
+    const MoveEffectTable<RBYMechanics> &rbyMoveEffects() const {
+        return m_rbyMoveEffects;
+    }
+
+    /* NULL if the ability / item has no effect in that generation */
+    const Ability *ability(int num) const;
+    const Item *item(int num) const;
+
+    static QSharedPointer<const GenMechanics> forGen(Pokemon::gen gen);
+    /* Call after the databases and the effects are loaded */
+    static void build();
+private:
+    Pokemon::gen gen;
+
+    QVector<BattleBase::BasicMoveInfo> moveInfos;
+    MoveEffectTable<Mechanics> m_moveEffects;
+    MoveEffectTable<RBYMechanics> m_rbyMoveEffects;
+    QHash<int, Ability> abilities;
+    QHash<int, Item> items;
+
+    static QMutex mutex;
+    static QHash<Pokemon::gen, QSharedPointer<const GenMechanics> > tables;
+};
+
+template <class M>
+void MoveEffectTable<M>::build(Pokemon::gen gen, const QHash<int, M> &mechanics, const QHash<int, QString> &names)
+{
+    int count = MoveInfo::NumberOfMoves();
+
+    for (int num = 0; num < count; num++) {
+        QString specialEffects = MoveInfo::SpecialEffect(num, gen);
+        if (specialEffects.isEmpty()) {
+            continue;
+        }
+
+        QVector<Effect> effects;
+
+        foreach (QString specialEffectS, specialEffects.split('|')) {
+            int specialEffect = atoi(specialEffectS.toStdString().c_str());
+
+            /* Like before, the effects after one not implemented are ignored */
+            if (!mechanics.contains(specialEffect)) {
+                break;
+            }
+
+            Effect e;
+            e.name = names.value(specialEffect);
+
+            int pos = specialEffectS.indexOf('-');
+            if (pos != -1) {
+                e.argKey = e.name + "_Arg";
+                e.arg = specialEffectS.mid(pos+1);
+            }
+
+            /* Same order as the hash, OnSetup included */
+            QHash<QString, function> functions = mechanics.value(specialEffect).functions;
+            for (typename QHash<QString, function>::const_iterator i = functions.constBegin(); i != functions.constEnd(); ++i) {
+                Function f;
+                f.onSetup = i.key() == "OnSetup";
+                if (!f.onSetup) {
+                    f.effectKey = "Effect_" + i.key();
+                    f.functionKey = f.effectKey + "_" + e.name;
+                }
+                f.f = i.value();
+                e.functions.push_back(f);
+            }
+
+            effects.push_back(e);
+        }
+
+        if (!effects.empty()) {
+            moves.insert(num, effects);
+        }
+    }
+}
+
+template <class M>
+void MoveEffectTable<M>::setup(int num, int source, int target, BattleBase &b) const
+{
+    typename QHash<int, QVector<Effect> >::const_iterator it = moves.constFind(num);
+    if (it == moves.constEnd()) {
+        return;
+    }
+
+    typename M::battle &battle = static_cast<typename M::battle&>(b);
+
+    foreach (const Effect &e, *it) {
+        if (!e.argKey.isNull()) {
+            M::turn(b, source)[e.argKey] = e.arg;
+        }
+
+        foreach (const Function &f, e.functions) {
+            if (f.onSetup) {
+                f.f(source, target, battle);
+            } else {
+                M::insertFunction(M::turn(b, source), f.effectKey, f.functionKey, e.name, f.f);
+            }
+        }
+    }
+}
+
+template <class M>
+void MoveEffectTable<M>::unsetup(int num, int source, BattleBase &b) const
+{
+    typename QHash<int, QVector<Effect> >::const_iterator it = moves.constFind(num);
+    if (it == moves.constEnd()) {
+        return;
+    }
+
+    foreach (const Effect &e, *it) {
+        foreach (const Function &f, e.functions) {
+            if (!f.onSetup) {
+                M::eraseFunction(M::turn(b, source), f.effectKey, f.functionKey, e.name);
+            }
+        }
+    }
+}
+
+#endif // GENMECHANICS_H
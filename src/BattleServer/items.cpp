@@ -2,6 +2,7 @@
 #include "berries.h"
 #include <PokemonInfo/pokemoninfo.h>
 #include "battlecounterindex.h"
+#include "genmechanics.h"
 
 typedef ItemMechanics IM;
 typedef BattleSituation BS;
@@ -14,30 +15,34 @@ QHash<QString, int> ItemEffect::nums;
 
 void ItemEffect::activate(const QString &effect, int num, int source, int target, BattleSituation &b)
 {
-    QList<ItemInfo::Effect> l = ItemInfo::Effects(num, b.gen());
+    const GenMechanics::Item *item = b.mechanics().item(num);
 
-    foreach(ItemInfo::Effect e, l) {
-        if (!mechanics.contains(e.num) || !mechanics[e.num].functions.contains(effect)) {
-            continue;
-        }
-        mechanics[e.num].functions[effect](source, target, b);
+    if (!item) {
+        return;
+    }
+
+    QHash<QString, QVector<GenMechanics::function> >::const_iterator it = item->events.constFind(effect);
+    if (it == item->events.constEnd()) {
+        return;
+    }
+
+    foreach(GenMechanics::function f, *it) {
+        f(source, target, b);
     }
 }
 
 void ItemEffect::setup(int num, int source, BattleSituation &b)
 {
-    QList<ItemInfo::Effect> effects = ItemInfo::Effects(num, b.gen());
+    const GenMechanics::Item *item = b.mechanics().item(num);
 
-    foreach(ItemInfo::Effect effect, effects) {
-        /* if the effect is invalid or not yet implemented then no need to go further */
-        if (!mechanics.contains(effect.num)) {
-            continue;
-        }
+    /* if the effect is invalid or not yet implemented then no need to go further */
+    if (!item) {
+        return;
+    }
 
-        //dun remove the test
-        if (effect.args.size() > 0) {
-            IM::poke(b,source)["ItemArg"] = effect.args;
-        }
+    //dun remove the test
+    if (item->arg.size() > 0) {
+        IM::poke(b,source)["ItemArg"] = item->arg;
     }
 }
 
@@ -824,7 +829,7 @@ struct IMEscapeButton : public IM
     }
 
     static void aaf(int, int, BS &b) {
-        std::vector<int> speeds = b.sortedBySpeed();
+        BS::SlotList speeds = b.sortedBySpeed();
 
         for (unsigned i = 0; i < speeds.size(); i++) {
             int p = speeds[i];
@@ -1,6 +1,7 @@
 #include <QtCore/QCoreApplication>
 #include <QDir>
 
+#include <Utilities/asynclog.h>
 #include "battleserver.h"
 #include "consolereader.h"
 
@@ -55,6 +56,15 @@ int main(int argc, char *argv[])
     (QDir()).mkpath(homeDir);
     QDir::setCurrent(homeDir);
 
+    /* Its own files, it can run in the same folder as the server, and as the
+       other battle servers when there are several shards: they differ by port */
+    QString shard = QString::number(port);
+    AsyncLog::Options logOptions;
+    logOptions.pattern = "battlelogs_" + shard + "_%1.txt";
+    logOptions.lastFile = "last_battle_log_file_" + shard + ".txt";
+    AsyncLog::obj()->start(logOptions);
+    AsyncLog::install();
+
     QCoreApplication a(argc, argv);
     
     BattleServer server;
@@ -64,5 +74,9 @@ int main(int argc, char *argv[])
 //    QSocketNotifier notifier(fileno(stdin), QSocketNotifier::Read);
 //    QObject::connect(&notifier, SIGNAL(activated(int)), &reader, SLOT(read(int)));
 
-    return a.exec();
+    int ret = a.exec();
+
+    AsyncLog::obj()->stop();
+
+    return ret;
 }
@@ -12,6 +12,7 @@ struct Mechanics : public MechanicsBase<BattleSituation::MechanicsFunction>
     static BattleSituation::priorityBracket makeBracket(int b, int p);
 
     typedef BattleSituation::MechanicsFunction function;
+    typedef BattleSituation battle;
 };
 
 #endif // MECHANICS_H
@@ -22,35 +22,57 @@ struct MechanicsBase : public PureMechanicsBase
 
     static void addFunction(BattleBase::context &c, const QString &effect, const QString &name, function f);
     static void removeFunction(BattleBase::context &c, const QString &effect, const QString &name);
+
+    /* Same, with the keys already made: "Effect_" + effect and "Effect_" + effect + "_" + name */
+    static void insertFunction(BattleBase::context &c, const QString &effectKey, const QString &functionKey, const QString &name, function f);
+    static void eraseFunction(BattleBase::context &c, const QString &effectKey, const QString &functionKey, const QString &name);
 };
 
 template <class function>
 void MechanicsBase<function>::addFunction(BattleBase::context &c, const QString &effect, const QString &name, function f)
 {
-    if (!c.contains("Effect_" + effect)) {
-        QVariant v = QVariant::fromValue(QSharedPointer<QSet<QString> >(new QSet<QString>()));
-        c.insert("Effect_" + effect, v);
-    }
-    c["Effect_"+effect].value<QSharedPointer<QSet<QString> > >()->insert(name);
+    insertFunction(c, "Effect_" + effect, "Effect_" + effect + "_" + name, name, f);
+}
+
+template <class function>
+void MechanicsBase<function>::removeFunction(BattleBase::context &c, const QString &effect, const QString &name)
+{
+    eraseFunction(c, "Effect_" + effect, "Effect_" + effect + "_" + name, name);
+}
+
+template <class function>
+void MechanicsBase<function>::insertFunction(BattleBase::context &c, const QString &effectKey, const QString &functionKey, const QString &name, function f)
+{
+    QVariant &names = c[effectKey];
+    QSet<QString> set = names.value<QSet<QString> >();
+    /* Released first so the set isn't copied, unless a snapshot shares it */
+    names.clear();
+    set.insert(name);
+    names.setValue(set);
 
     QVariant v;
     v.setValue(f);
-    c.insert("Effect_" + effect + "_" + name,v);
+    c.insert(functionKey, v);
 }
 
 template <class function>
-void MechanicsBase<function>::removeFunction(BattleBase::context &c, const QString &effect, const QString &name)
+void MechanicsBase<function>::eraseFunction(BattleBase::context &c, const QString &effectKey, const QString &functionKey, const QString &name)
 {
-    if (!c.contains("Effect_" + effect)) {
+    if (!c.contains(effectKey)) {
     return;
     }
-    c["Effect_" + effect].value<QSharedPointer<QSet<QString> > >()->remove(name);
-    c.remove("Effect_" + effect + "_" + name);
+    QVariant &names = c[effectKey];
+    QSet<QString> set = names.value<QSet<QString> >();
+    names.clear();
+    set.remove(name);
+    names.setValue(set);
+    c.remove(functionKey);
 }
 
 
-/* For use with QVariants */
-Q_DECLARE_METATYPE(QSharedPointer<QSet<QString> >)
+/* For use with QVariants. The sets are stored by value so the memories can
+   be shared by battle snapshots */
+Q_DECLARE_METATYPE(QSet<QString>)
 
 
 #endif // MECHANICSBASE_H
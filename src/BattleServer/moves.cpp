@@ -5,6 +5,7 @@
 #include "items.h"
 #include "battlecounterindex.h"
 #include "miscmoves.h"
+#include "genmechanics.h"
 
 QHash<int, MoveMechanics> MoveEffect::mechanics;
 QHash<int, QString> MoveEffect::names;
@@ -25,43 +26,11 @@ typedef BattleSituation BS;
 void MoveEffect::setup(int num, int source, int target, BattleBase &b)
 {
     /* first the basic info */
-    MM::initMove(num, b.gen(), MM::tmove(b,source));
+    b.mechanics().initMove(num, MM::tmove(b,source));
 
-    BS *_b = dynamic_cast<BS*>(&b);
-
-    if (_b) {
-        BS &b = *_b;
-        /* then the hard info */
-        QStringList specialEffects = MoveInfo::SpecialEffect(num, b.gen()).split('|');
-
-        foreach (QString specialEffectS, specialEffects) {
-            std::string s = specialEffectS.toStdString();
-
-            int specialEffect = atoi(s.c_str());
-
-            /* if the effect is invalid or not yet implemented then no need to go further */
-            if (!mechanics.contains(specialEffect)) {
-                break;
-            }
-
-            MoveMechanics &m = mechanics[specialEffect];
-            QString &n = names[specialEffect];
-
-            QHash<QString, MoveMechanics::function>::iterator i;
-
-            size_t pos = s.find('-');
-            if (pos != std::string::npos) {
-                MM::turn(b,source)[n+"_Arg"] = specialEffectS.mid(pos+1);
-            }
-
-            for(i = m.functions.begin(); i != m.functions.end(); ++i) {
-                if (i.key() == "OnSetup") {
-                    i.value()(source,target,b);
-                } else {
-                    Mechanics::addFunction(MM::turn(b,source), i.key(), n, i.value());
-                }
-            }
-        }
+    /* then the hard info, from the effects of the generation */
+    if (dynamic_cast<BS*>(&b)) {
+        b.mechanics().moveEffects().setup(num, source, target, b);
     }
 }
 
@@ -69,37 +38,8 @@ void MoveEffect::setup(int num, int source, int target, BattleBase &b)
     not be nice because U-Turning twice :s*/
 void MoveEffect::unsetup(int num, int source, BattleBase &b)
 {
-    BS *_b = dynamic_cast<BS*>(&b);
-
-    if (_b) {
-        BS &b = *_b;
-
-        /* then the hard info */
-        QStringList specialEffects = MoveInfo::SpecialEffect(num, b.gen()).split('|');
-
-        foreach (QString specialEffectS, specialEffects) {
-            std::string s = specialEffectS.toStdString();
-
-            int specialEffect = atoi(s.c_str());
-
-            /* if the effect is invalid or not yet implemented then no need to go further */
-            if (!mechanics.contains(specialEffect)) {
-                break;
-            }
-
-            MoveMechanics &m = mechanics[specialEffect];
-            QString &n = names[specialEffect];
-
-            QHash<QString, MoveMechanics::function>::iterator i;
-
-            for(i = m.functions.begin(); i != m.functions.end(); ++i) {
-                if (i.key() == "OnSetup") {
-                    ;
-                } else {
-                    Mechanics::removeFunction(MM::turn(b,source), i.key(), n);
-                }
-            }
-        }
+    if (dynamic_cast<BS*>(&b)) {
+        b.mechanics().moveEffects().unsetup(num, source, b);
     }
 
     MM::tmove(b,source).classification = Move::StandardMove;
@@ -1446,7 +1386,7 @@ struct MMBounce : public MM
 
             int move = poke(b,s)["2TurnMove"].toInt();
 
-            initMove(move, b.gen(),tmove(b,s));
+            b.mechanics().initMove(move, tmove(b,s));
             addFunction(turn(b,s), "EvenWhenCantMove", "Bounce", &ewc);
 
             if (move == ShadowForce || move == PhantomForce) {
@@ -1707,7 +1647,7 @@ struct MMDoomDesire : public MM
                 if (b.gen() <= 4) {
                     b.inflictDamage(s,slot(b,s)["DoomDesireDamage"].toInt(), s, true, true);
                 } else {
-                    initMove(move, b.gen(), tmove(b,s));
+                    b.mechanics().initMove(move, tmove(b,s));
 
                     b.calculateTypeModStab(s, s);
 
@@ -2337,7 +2277,7 @@ struct MMGravity : public MM
         b.battleMemory()["GravityCount"] = 5;
         b.sendMoveMessage(53,0,s,type(b,s));
 
-        std::vector<int> list = b.sortedBySpeed();
+        BS::SlotList list = b.sortedBySpeed();
 
         foreach(int p, list) {
             if (b.koed(p))
@@ -3942,7 +3882,7 @@ struct MMImprison : public MM
             return;
 
         /* let's just see if there are moves to imprison */
-        QList<int> foes = b.revs(s);
+        BS::SlotList foes = b.revs(s);
 
         bool success = false;
 
@@ -3970,7 +3910,7 @@ struct MMImprison : public MM
         if (b.battleMemory().value("CoatingAttackNow").toBool() || b.pokeMemory(s).value("SleepTalking").toBool()) {
             return;
         }
-        QList<int> foes = b.revs(s);
+        BS::SlotList foes = b.revs(s);
 
         int attack = move(b,s);
 
@@ -3992,7 +3932,7 @@ struct MMImprison : public MM
 
     static void msp(int s, int, BS &b) {
         /* let's just see if there are moves to imprison */
-        QList<int> foes = b.revs(s);
+        BS::SlotList foes = b.revs(s);
 
         foreach(int foe, foes) {
             if (!poke(b,foe).value("Imprisoner").toBool()) {
@@ -1,5 +1,6 @@
 #include "rbymoves.h"
 #include "battlefunctions.h"
+#include "genmechanics.h"
 
 typedef RBYMoveMechanics MoveMechanics;
 
@@ -20,43 +21,11 @@ BS::SlotMemory & MoveMechanics::slot(BattleRBY &battle, int s) {
 void RBYMoveEffect::setup(int num, int source, int target, BattleBase &b)
 {
     /* first the basic info */
-    MoveMechanics::initMove(num, b.gen(), MM::tmove(b,source));
+    b.mechanics().initMove(num, MM::tmove(b,source));
 
-    BS *_b = dynamic_cast<BS*>(&b);
-
-    if (_b) {
-        BS &b = *_b;
-        /* then the hard info */
-        QStringList specialEffects = MoveInfo::SpecialEffect(num, b.gen()).split('|');
-
-        foreach (QString specialEffectS, specialEffects) {
-            std::string s = specialEffectS.toStdString();
-
-            int specialEffect = atoi(s.c_str());
-
-            /* if the effect is invalid or not yet implemented then no need to go further */
-            if (!mechanics.contains(specialEffect)) {
-                break;
-            }
-
-            MoveMechanics &m = mechanics[specialEffect];
-            QString &n = names[specialEffect];
-
-            QHash<QString, MoveMechanics::function>::iterator i;
-
-            size_t pos = s.find('-');
-            if (pos != std::string::npos) {
-                MM::turn(b,source)[n+"_Arg"] = specialEffectS.mid(pos+1);
-            }
-
-            for(i = m.functions.begin(); i != m.functions.end(); ++i) {
-                if (i.key() == "OnSetup") {
-                    i.value()(source,target,b);
-                } else {
-                    MM::addFunction(MM::turn(b,source), i.key(), n, i.value());
-                }
-            }
-        }
+    /* then the hard info, from the effects of the generation */
+    if (dynamic_cast<BS*>(&b)) {
+        b.mechanics().rbyMoveEffects().setup(num, source, target, b);
     }
 }
 
@@ -65,37 +34,8 @@ void RBYMoveEffect::setup(int num, int source, int target, BattleBase &b)
     not be nice because U-Turning twice :s*/
 void RBYMoveEffect::unsetup(int num, int source, BattleBase &b)
 {
-    BS *_b = dynamic_cast<BS*>(&b);
-
-    if (_b) {
-        BS &b = *_b;
-
-        /* then the hard info */
-        QStringList specialEffects = MoveInfo::SpecialEffect(num, b.gen()).split('|');
-
-        foreach (QString specialEffectS, specialEffects) {
-            std::string s = specialEffectS.toStdString();
-
-            int specialEffect = atoi(s.c_str());
-
-            /* if the effect is invalid or not yet implemented then no need to go further */
-            if (!mechanics.contains(specialEffect)) {
-                break;
-            }
-
-            MoveMechanics &m = mechanics[specialEffect];
-            QString &n = names[specialEffect];
-
-            QHash<QString, MoveMechanics::function>::iterator i;
-
-            for(i = m.functions.begin(); i != m.functions.end(); ++i) {
-                if (i.key() == "OnSetup") {
-                    ;
-                } else {
-                    MM::removeFunction(MM::turn(b,source), i.key(), n);
-                }
-            }
-        }
+    if (dynamic_cast<BS*>(&b)) {
+        b.mechanics().rbyMoveEffects().unsetup(num, source, b);
     }
 
     MM::tmove(b,source).classification = Move::StandardMove;
@@ -198,7 +138,7 @@ struct RBYBind : public MM
             if (!b.isStadium()) {
                 turn(b,t) ["ForceBind"] = true;
             }
-            initMove(fpoke(b,s).lastMoveUsed, b.gen(), tmove(b,s));
+            b.mechanics().initMove(fpoke(b,s).lastMoveUsed, tmove(b,s));
             turn(b,s)["TellPlayers"] = false;
         }
     }
@@ -351,7 +291,7 @@ struct RBYDig : public MM
         addFunction(turn(b,s), "TrueEnd", "Dig", &asf);
         //addFunction(turn(b,s), "UponAttackSuccessful", "Dig", &asf);
         turn(b,s)["AutomaticMove"] = poke(b,s).value("ChargeMove");
-        initMove(poke(b,s).value("ChargeMove").toInt(), b.gen(), tmove(b,s));
+        b.mechanics().initMove(poke(b,s).value("ChargeMove").toInt(), tmove(b,s));
     }
 
     static void asf(int s, int, BS &b) {
@@ -824,7 +764,7 @@ struct RBYPetalDance : public MM
         if (!poke(b,s).contains("PetalDanceCount")) {
             return;
         }
-        RBYMoveMechanics::initMove(fpoke(b,s).lastMoveUsed, b.gen(), tmove(b,s));
+        b.mechanics().initMove(fpoke(b,s).lastMoveUsed, tmove(b,s));
         addFunction(turn(b,s), "UponAttackSuccessful", "PetalDance", &uas);
         addFunction(turn(b,s), "AttackSomehowFailed", "PetalDance", &uas);
         fturn(b,s).add(TM::NoChoice);
@@ -858,7 +798,7 @@ struct RBYRage : public MM
         /*Rage Bug is a lie!*/
         //addFunction(turn(b,s), "AttackSomehowFailed", "Rage", &asf);
 
-        initMove(fpoke(b,s).lastMoveUsed, b.gen(), tmove(b,s));
+        b.mechanics().initMove(fpoke(b,s).lastMoveUsed, tmove(b,s));
         /*if (poke(b,s).contains("RageFailed")) {
             tmove(b,s).accuracy = 1;
         }*/
@@ -931,7 +871,7 @@ struct RBYRazorWind : public MM
         fturn(b,s).add(TM::NoChoice);
         fturn(b,s).add(TM::UsePP);
         int mv = poke(b,s)["ChargingMove"].toInt();
-        initMove(mv, b.gen(), tmove(b, s));
+        b.mechanics().initMove(mv, tmove(b, s));
         turn(b,s)["AutomaticMove"] = mv;
     }
 };
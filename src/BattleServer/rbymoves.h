@@ -11,6 +11,7 @@
 
 struct RBYMechanics : public MechanicsBase<BattleRBY::MechanicsFunction> {
     typedef BattleRBY::MechanicsFunction function;
+    typedef BattleRBY battle;
 
     static BattleRBY::SlotMemory & slot(BattleRBY &battle, int s);
 };
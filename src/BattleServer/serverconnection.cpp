@@ -104,6 +104,11 @@ void ServerConnection::notifyInfo(int battle, int player, const QByteArray &info
     relay->notify(BattleMessage, qint32(battle), qint32(player), info);
 }
 
+void ServerConnection::notifyStream(int battle, int audience, int player, const QByteArray &info)
+{
+    relay->notify(BattleStream, qint32(battle), qint8(audience), qint32(player), info);
+}
+
 void ServerConnection::notifyFinished(int battle, int result, int winner, int loser)
 {
     relay->notify(BattleFinished, qint32(battle), qint32(result), qint32(winner), qint32(loser));
@@ -42,6 +42,7 @@ public slots:
 
     void notifyBattle(int id, int publicId, int opponent, const TeamBattle &team, const BattleConfiguration &config, const QString &tier);
     void notifyInfo(int bid, int player, const QByteArray &info);
+    void notifyStream(int bid, int audience, int player, const QByteArray &info);
     void notifyFinished(int battle,int result, int winner, int loser);
 private:
     Analyzer *relay;
@@ -13,7 +13,8 @@ SOURCES += main.cpp \
     player.cpp \
     analyze.cpp \
     network.cpp \
-    antidos.cpp
+    antidos.cpp \
+    serverlist.cpp
 HEADERS += mainwindow.h \
     registry.h \
     server.h \
@@ -21,7 +22,8 @@ HEADERS += mainwindow.h \
     analyze.h \
     network.h \
     antidos.h \
-    macro.h
+    macro.h \
+    serverlist.h
 DEFINES = REGISTRY_SIDE
 
 # Build-in web server depends on pillow, you can download
@@ -88,12 +88,22 @@ void Analyzer::commandReceived(const QByteArray &commandline)
             quint16 max;
             in >> max;
             emit maxChange(max);
+            break;
         }
     case ServerPass:
         {
             bool toggle;
             in >> toggle;
             emit passToggleChanged(toggle);
+            break;
+        }
+    case ServerListVersion:
+        {
+            quint32 version;
+            bool compressed;
+            in >> version >> compressed;
+            emit serverListRequested(version, compressed);
+            break;
         }
     default:
         emit protocolError(UnknownCommand, tr("Protocol error: unknown command received"));
@@ -116,6 +126,11 @@ void Analyzer::sendServerListEnd()
     notify(ServerListEnd);
 }
 
+void Analyzer::sendPacket(const QByteArray &packets)
+{
+    socket().sendPacket(packets);
+}
+
 void Analyzer::sendInvalidName()
 {
     notify(ServNameChange);
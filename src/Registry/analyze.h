@@ -22,6 +22,7 @@ public:
     void sendRegistryAnnouncement(const QString &announcement);
     void sendServer(const QString &name, const QString &desc, quint16 numplayers, const QString &ip,quint16 max, quint16 port, bool passwordProtected);
     void sendServerListEnd(void);
+    void sendPacket(const QByteArray &packets);
     void sendInvalidName();
     void sendNameTaken();
     void sendAccept();
@@ -59,6 +60,7 @@ signals:
     void descChange(const QString &desc);
     void maxChange(quint16);
     void passToggleChanged(bool);
+    void serverListRequested(quint32 version, bool compressed);
 
     void disconnected();
 public slots:
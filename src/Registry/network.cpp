@@ -118,6 +118,11 @@ void Network::send(const QByteArray &message)
     socket()->write(message);
 }
 
+void Network::sendPacket(const QByteArray &packets)
+{
+    socket()->write(packets);
+}
+
 QTcpSocket * Network::socket()
 {
     return mysocket;
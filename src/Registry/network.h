@@ -27,6 +27,8 @@ public slots:
     void onDisconnect();
     void manageError(QAbstractSocket::SocketError);
     void send(const QByteArray &message);
+    /* Packets already with their lengths in front */
+    void sendPacket(const QByteArray &packets);
 signals:
     void isFull(QByteArray command);
     void connected();
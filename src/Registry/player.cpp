@@ -11,6 +11,7 @@ Player::Player(int _id, QTcpSocket *s)
     m_relay->setParent(this);
 
     connect(m_relay, SIGNAL(disconnected()), SLOT(disconnected()));
+    connect(m_relay, SIGNAL(serverListRequested(quint32,bool)), SLOT(serverListRequested(quint32,bool)));
 }
 
 void Player::disconnected()
@@ -18,6 +19,11 @@ void Player::disconnected()
     emit disconnection(id());
 }
 
+void Player::serverListRequested(quint32 version, bool compressed)
+{
+    emit serverListRequested(id(), version, compressed);
+}
+
 void Player::kick()
 {
     m_relay->close();
@@ -27,15 +33,7 @@ void Player::sendRegistryAnnouncement(const QString &announcement) {
     m_relay->sendRegistryAnnouncement(announcement);
 }
 
-void Player::sendServer(const Server &s)
-{
-    if(s.port() == 0)
-        m_relay->sendServer(s.name(), s.desc(), s.players(), s.ip(),s.maxPlayers(),5080, s.passwordProtected());
-    else
-        m_relay->sendServer(s.name(), s.desc(), s.players(), s.ip(),s.maxPlayers(),s.port(), s.passwordProtected());
-}
-
-void Player::sendServerListEnd()
+void Player::sendServerList(const QByteArray &packets)
 {
-  m_relay->sendServerListEnd();
+    m_relay->sendPacket(packets);
 }
@@ -18,13 +18,15 @@ public:
     Player(int id, QTcpSocket *s);
 
     void sendRegistryAnnouncement(const QString &announcement);
-    void sendServer(const Server &s);
-    void sendServerListEnd(void);
+    /* Packets from the ServerList */
+    void sendServerList(const QByteArray &packets);
     void kick();
 public slots:
     void disconnected();
+    void serverListRequested(quint32 version, bool compressed);
 signals:
     void disconnection(int id);
+    void serverListRequested(int id, quint32 version, bool compressed);
 private:
     Analyzer *m_relay;
 };
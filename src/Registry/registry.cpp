@@ -8,6 +8,8 @@
 
 Registry::Registry() {
     linecount = 0;
+    skippedLines = 0;
+    logWindow.start();
 
     QTextCodec::setCodecForLocale(QTextCodec::codecForName("UTF-8"));
     //QTextCodec::setCodecForTr(QTextCodec::codecForName("UTF-8"));
@@ -57,8 +59,26 @@ Registry::Registry() {
     updateRegistryAnnouncement();
 }
 
+/* A burst of connections mustn't make the registry spend its time printing */
+static const int maxLinesPerSecond = 50;
+
 void Registry::printLine(const QString &line)
 {
+    if (logWindow.elapsed() >= 1000) {
+        if (skippedLines > 0) {
+            qDebug() << QString("(%1 lines not shown)").arg(skippedLines);
+        }
+        logWindow.restart();
+        linecount = 0;
+        skippedLines = 0;
+    }
+
+    if (linecount >= maxLinesPerSecond) {
+        skippedLines += 1;
+        return;
+    }
+
+    linecount += 1;
     qDebug() << line;
 }
 
@@ -148,6 +168,7 @@ void Registry::incomingServer()
     connect(servers[id], SIGNAL(nameChangedReq(int,QString)), SLOT(nameChangedAcc(int,const QString&)));
     connect(servers[id], SIGNAL(portSet(int, int, int)), SLOT(portSet(int,int,int)));
     connect(servers[id], SIGNAL(disconnection(int)), SLOT(disconnection(int)));
+    connect(servers[id], SIGNAL(changed(int)), SLOT(serverChanged(int)));
 }
 
 void Registry::incomingPlayer()
@@ -176,6 +197,7 @@ void Registry::incomingPlayer()
     Player *p = players[id] = new Player(id, newconnection);
 
     connect(players[id], SIGNAL(disconnection(int)), SLOT(disconnection(int)));
+    connect(players[id], SIGNAL(serverListRequested(int,quint32,bool)), SLOT(serverListRequested(int,quint32,bool)));
 
     printLine("Sending the registry announcement");
 
@@ -184,13 +206,22 @@ void Registry::incomingPlayer()
     }
 
     printLine("Sending the server list");
-    foreach(Server *s, servers) {
-        if (s->listed()) {
-            p->sendServer(*s);
-        }
+    /* Ends with ServerListEnd */
+    p->sendServerList(serverList.full());
+}
+
+void Registry::serverListRequested(int id, quint32 version, bool compressed)
+{
+    if (players.contains(id)) {
+        players[id]->sendServerList(serverList.since(version, compressed));
+    }
+}
+
+void Registry::serverChanged(int id)
+{
+    if (servers.contains(id) && servers[id]->listed()) {
+        serverList.update(*servers[id]);
     }
-    // Tell client that the server list has ended.
-    p->sendServerListEnd();
 }
 
 void Registry::nameChangedAcc(int id, const QString &name)
@@ -204,6 +235,7 @@ void Registry::nameChangedAcc(int id, const QString &name)
         names.remove(servers[id]->name());
         names.insert(name);
         servers[id]->name() = name;
+        serverChanged(id);
     }
 }
 
@@ -231,6 +263,7 @@ void Registry::disconnection(int id)
         if (ipCounter[s->ip()] == 0)
             ipCounter.remove(s->ip());
         serverAddresses.remove(s->getAddress(s->port()));
+        serverList.remove(id);
         servers.remove(id);
         delete s;
     } else if (players.contains(id)) {
@@ -3,10 +3,10 @@
 
 #include <QtCore>
 #include <QtNetwork>
+#include "serverlist.h"
 
 class Player;
 class Server;
-class QScrollDownTextBrowser;
 #ifdef USE_WEBCONF
 class RegistryWebInterface;
 #endif
@@ -25,6 +25,8 @@ private slots:
     void nameChangedAcc(int id, const QString &name);
     void portSet(int id, int port, int oldport);
     void disconnection(int id);
+    void serverChanged(int id);
+    void serverListRequested(int id, quint32 version, bool compressed);
 
     /* Called by the anti DoS */
     void kick(int id);
@@ -53,8 +55,14 @@ private:
 
     QNetworkAccessManager manager;
 
-    QScrollDownTextBrowser *mainChat;
+    /* What players get, kept ready to send */
+    ServerList serverList;
+
+    /* Lines printed in the current second, and the ones that weren't because
+       there were too many already */
+    QElapsedTimer logWindow;
     int linecount;
+    int skippedLines;
 
     int freeid() const;
 #ifdef USE_WEBCONF
@@ -6,6 +6,10 @@ Server::Server(int _id, QTcpSocket *s)
     id() = _id;
     ip() = s->peerAddress().toString();
     listed() = false;
+    players() = 0;
+    maxPlayers() = 0;
+    port() = 0;
+    passwordProtected() = false;
 
     m_relay = new Analyzer(s, id());
     m_relay->setParent(this);
@@ -30,6 +34,16 @@ void Server::login(const QString &name, const QString &desc, quint16 num, quint1
     port() = nport;
 
     emit portSet(id(), nport, oldport);
+    if (oldport != nport) {
+        notifyChange();
+    }
+}
+
+void Server::notifyChange()
+{
+    if (listed()) {
+        emit changed(id());
+    }
 }
 
 QString Server::getAddress(int port) const
@@ -39,12 +53,21 @@ QString Server::getAddress(int port) const
 
 void Server::descChanged(const QString &desc)
 {
-    this->desc() = desc.left(500).trimmed();
+    QString newDesc = desc.left(500).trimmed();
+    if (newDesc == this->desc()) {
+        return;
+    }
+    this->desc() = newDesc;
+    notifyChange();
 }
 
 void Server::numChanged(quint16 num)
 {
+    if (num == players()) {
+        return;
+    }
     players() = num;
+    notifyChange();
 }
 
 void Server::nameChanged(const QString &name)
@@ -62,11 +85,19 @@ void Server::nameChanged(const QString &name)
 
 void Server::maxChanged(const quint16 max)
 {
+    if (max == maxPlayers()) {
+        return;
+    }
     this->maxPlayers() = max;
+    notifyChange();
 }
 
 void Server::passToggled(bool toggle) {
+    if (toggle == passwordProtected()) {
+        return;
+    }
     this->passwordProtected() = toggle;
+    notifyChange();
 }
 
 void Server::refuseIP()
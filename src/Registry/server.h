@@ -39,9 +39,13 @@ public slots:
 signals:
     void nameChangedReq(int id, const QString &name);
     void portSet(int id, int port, int oldport);
+    /* Something players see in the server list changed */
+    void changed(int id);
     void disconnection(int id);
 private:
     Analyzer *m_relay;
+
+    void notifyChange();
 };
 
 #endif // SERVER_H
@@ -0,0 +1,148 @@
+#include <Utilities/packetbuilder.h>
+#include "analyze.h"
+#include "server.h"
+#include "serverlist.h"
+
+using namespace NetworkReg;
+
+/* Past that, players with an older version get the whole list */
+static const int maxRemovals = 512;
+
+/* Versions start at the time the registry started, so that a player still
+   having the list of a registry that restarted gets the whole list again
+   rather than a delta that doesn't apply */
+ServerList::ServerList() : fullDirty(true), m_rebuilds(0)
+{
+    m_version = quint32(QDateTime::currentMSecsSinceEpoch() / 1000);
+    oldest = m_version;
+}
+
+void ServerList::update(const Server &s)
+{
+    quint16 port = s.port() == 0 ? 5080 : s.port();
+    QByteArray packet = PacketBuilder::packFramed(0, uchar(PlayersList), s.name(), s.desc(), s.players(), s.ip(),
+                                                  s.maxPlayers(), port, s.passwordProtected());
+
+    Entry &e = entries[s.id()];
+    if (e.packet == packet) {
+        return;
+    }
+
+    changed();
+
+    /* For the players, servers are known by their names */
+    if (!e.name.isEmpty() && e.name != s.name()) {
+        addRemoval(e.name);
+    }
+
+    e.name = s.name();
+    e.packet = packet;
+    e.version = m_version;
+}
+
+void ServerList::remove(int id)
+{
+    if (!entries.contains(id)) {
+        return;
+    }
+
+    changed();
+    addRemoval(entries.take(id).name);
+}
+
+void ServerList::changed()
+{
+    m_version += 1;
+    fullDirty = true;
+    answers.clear();
+}
+
+void ServerList::addRemoval(const QString &name)
+{
+    Removal r;
+    r.name = name;
+    r.version = m_version;
+    removals.push_back(r);
+
+    if (removals.size() > maxRemovals) {
+        oldest = removals.takeFirst().version;
+    }
+}
+
+QByteArray ServerList::end(bool full) const
+{
+    return PacketBuilder::packFramed(0, uchar(ServerListEnd), m_version, full);
+}
+
+const QByteArray &ServerList::full()
+{
+    if (fullDirty) {
+        fullList.clear();
+        foreach(const Entry &e, entries) {
+            fullList += e.packet;
+        }
+        fullList += end(true);
+
+        fullDirty = false;
+        m_rebuilds += 1;
+    }
+
+    return fullList;
+}
+
+QByteArray ServerList::since(quint32 version, bool compressed)
+{
+    quint64 key = quint64(version) * 2 + compressed;
+
+    if (answers.contains(key)) {
+        return answers.value(key);
+    }
+
+    QByteArray ret;
+
+    /* Any other version is made up by the player, those answers aren't kept or
+       there would be no end to them */
+    bool known = version >= oldest && version <= m_version;
+
+    if (version == 0 || !known) {
+        ret = full();
+    } else if (version < m_version) {
+        /* Removals first, a server renamed is removed under its old name
+           and comes back under the new one */
+        foreach(const Removal &r, removals) {
+            if (r.version > version) {
+                ret += PacketBuilder::packFramed(0, uchar(ServerRemoved), r.name);
+            }
+        }
+        foreach(const Entry &e, entries) {
+            if (e.version > version) {
+                ret += e.packet;
+            }
+        }
+        ret += end(false);
+    } else {
+        /* Not modified */
+        ret = end(false);
+    }
+
+    /* The packets with their lengths are also a stream of QByteArrays, what
+       ZipCommand with content type 1 holds */
+    if (compressed) {
+        QByteArray zipped = PacketBuilder::packFramed(0, uchar(ZipCommand), quint8(1));
+        zipped += qCompress(ret);
+
+        int length = zipped.length() - 4;
+        zipped[0] = char(length >> 24);
+        zipped[1] = char(length >> 16);
+        zipped[2] = char(length >> 8);
+        zipped[3] = char(length);
+
+        ret = zipped;
+    }
+
+    if (known) {
+        answers.insert(key, ret);
+    }
+
+    return ret;
+}
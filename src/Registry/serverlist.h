@@ -0,0 +1,73 @@
+#ifndef SERVERLIST_H
+#define SERVERLIST_H
+
+#include <QtCore>
+
+class Server;
+
+/* The server list as players receive it, already serialized. Each listed
+   server keeps its PlayersList packet, made again only when the server
+   changes, and the whole list is put together once and sent as is to every
+   player connecting until something changes.
+
+   Each change gets a new version. A player that already has the list at some
+   version can ask for what changed since (see since()): it gets the servers
+   that changed, the ones that left and the new version, or only the version
+   when nothing changed.
+
+   Everything sent ends with ServerListEnd(version, full), full being true when
+   the whole list was sent (the player then drops the servers it didn't get). */
+class ServerList
+{
+public:
+    ServerList();
+
+    /* Called when a listed server changes, or gets listed */
+    void update(const Server &s);
+    void remove(int id);
+
+    quint32 version() const {
+        return m_version;
+    }
+
+    /* Packets ready to write on the socket, with their length in front */
+    const QByteArray &full();
+    QByteArray since(quint32 version, bool compressed);
+
+    /* Counters, since the start */
+    int rebuilds() const {
+        return m_rebuilds;
+    }
+private:
+    struct Entry {
+        QString name;
+        QByteArray packet;
+        quint32 version;
+    };
+
+    struct Removal {
+        QString name;
+        quint32 version;
+    };
+
+    QHash<int, Entry> entries;
+    /* The last removals, the oldest first */
+    QList<Removal> removals;
+    /* Versions before that are too old to know what was removed since */
+    quint32 oldest;
+    quint32 m_version;
+
+    QByteArray fullList;
+    bool fullDirty;
+    /* Answers of since() for the current version, by version asked
+       (times 2, + 1 when compressed). Only for the versions from oldest on */
+    QHash<quint64, QByteArray> answers;
+
+    int m_rebuilds;
+
+    void changed();
+    void addRemoval(const QString &name);
+    QByteArray end(bool full) const;
+};
+
+#endif // SERVERLIST_H
@@ -41,7 +41,7 @@ void DualWielder::init(QWsSocket *sock, const QString &host, QHash<QString,QStri
 
     sock->write("defaultserver|"+ host);
 
-    connect(sock, SIGNAL(frameReceived(QString)), SLOT(readWebSocket(QString)));
+    connect(sock, SIGNAL(textFrameReceived(QByteArray)), SLOT(readWebSocket(QByteArray)));
     connect(sock, SIGNAL(disconnected()), SLOT(webSocketDisconnected()));
     connect(sock, SIGNAL(disconnected()), sock, SLOT(deleteLater()));
 }
@@ -69,7 +69,7 @@ void DualWielder::readSocket(const QByteArray &commandline)
 
         in >> contentType;
 
-        if (contentType > 1) {
+        if (contentType > 2) {
             return;
         }
 
@@ -78,6 +78,26 @@ void DualWielder::readSocket(const QByteArray &commandline)
         if (length <= 0) {
             return;
         }
+
+        if (contentType == 2) {
+            bool ok;
+            QByteArray info = inflater.decompress(commandline.mid(2), &ok);
+
+            if (!ok) {
+                if (network) {
+                    network->close();
+                }
+                return;
+            }
+
+            DataStream in2(info);
+            QByteArray packet;
+            while (!in2.atEnd()) {
+                in2 >> packet;
+                readSocket(packet);
+            }
+            break;
+        }
         char data[length];
 
         in.readRawData(data, length);
@@ -736,15 +756,18 @@ void DualWielder::readSocket(const QByteArray &commandline)
     }
 }
 
-void DualWielder::readWebSocket(const QString &frame)
+void DualWielder::readWebSocket(const QByteArray &frame)
 {
     /* Shouldn't happen, but idk how websockets work */
     if (!web) {
         return;
     }
 
-    QString command = frame.section("|",0,0);
-    QString data = frame.section("|", 1);
+    /* The frame is kept in UTF-8, the json is parsed from it directly */
+    int separator = frame.indexOf('|');
+    QByteArray command = separator == -1 ? frame : frame.left(separator);
+    QByteArray rawData = separator == -1 ? QByteArray() : frame.mid(separator + 1);
+    QString data = QString::fromUtf8(rawData);
 
     if (!network) {
         if (command == "connect") {
@@ -775,7 +798,7 @@ void DualWielder::readWebSocket(const QString &frame)
         }
     } else {
         if (command == "login") {
-            QVariantMap params = jparser.parse(data.toUtf8()).toMap();
+            QVariantMap params = jparser.parse(rawData).toMap();
 
             QByteArray tosend;
             DataStream out(&tosend, QIODevice::WriteOnly);
@@ -817,6 +840,7 @@ void DualWielder::readWebSocket(const QString &frame)
             data.setFlag(PlayerFlags::SupportsZipCompression, true);
             data.setFlag(PlayerFlags::LadderEnabled, params.value("ladder", true).toBool());
             data.setFlag(PlayerFlags::Idle, params.value("idle", false).toBool());
+            data.setFlag(PlayerFlags::SupportsStreamCompression, true);
             //                  SupportsZipCompression,
             //                  ShowTeam,
             //                  LadderEnabled,
@@ -858,7 +882,7 @@ void DualWielder::readWebSocket(const QString &frame)
 
             emit sendCommand(tosend);
         } else if (command == "chat") {
-            QVariantMap params = jparser.parse(data.toUtf8()).toMap();
+            QVariantMap params = jparser.parse(rawData).toMap();
 
             if (params.count() == 0) {
                 notify(Nw::SendChatMessage, Flags(1), Flags(0), qint32(0), data);
@@ -872,11 +896,11 @@ void DualWielder::readWebSocket(const QString &frame)
         } else if (command == "leave") {
             notify(Nw::LeaveChannel, qint32(data.toInt()));
         } else if (command == "pm") {
-            QVariantMap params = jparser.parse(data.toUtf8()).toMap();
+            QVariantMap params = jparser.parse(rawData).toMap();
             notify(Nw::SendPM, qint32(params.value("to").toInt()), params.value("message").toString());
         } else if (command == "teamchange") {
             qDebug() << "teamChange event";
-            QVariantMap params = jparser.parse(data.toUtf8()).toMap();
+            QVariantMap params = jparser.parse(rawData).toMap();
             Flags network(params.contains("name") | (params.contains("color") << 1) | (params.contains("info") << 2) | ((params.contains("teams") || params.contains("team")) << 3));
 
             QByteArray tosend;
@@ -916,7 +940,7 @@ void DualWielder::readWebSocket(const QString &frame)
 
             out << uchar(Nw::TierSelection);
 
-            QVariantMap params = jparser.parse(data.toUtf8()).toMap();
+            QVariantMap params = jparser.parse(rawData).toMap();
             for (auto key : params.keys()) {
                 out << quint8(key.toInt()) << params[key].toString();
             }
@@ -945,7 +969,7 @@ void DualWielder::readWebSocket(const QString &frame)
             QString chat = data.section("|", 1);
             notify(Nw::SpectatingBattleChat, qint32(battle), chat);
         } else if (command == "findbattle") {
-            QVariantMap params = jparser.parse(data.toUtf8()).toMap();
+            QVariantMap params = jparser.parse(rawData).toMap();
             FindBattleData fdata;
             fdata.rated = params.value("rated", false).toBool();
             fdata.sameTier = params.value("sameTier", true).toBool();
@@ -971,7 +995,7 @@ void DualWielder::readWebSocket(const QString &frame)
             static QStringList descs = QStringList() << "sent" << "accepted" << "cancelled" << "busy"
                 << "refused" << "invalidteam" << "invalidgen" << "invalidtier";
 
-            QVariantMap params = jparser.parse(data.toUtf8()).toMap();
+            QVariantMap params = jparser.parse(rawData).toMap();
             ChallengeInfo c;
             c.clauses = params.value("clauses").toInt();
             c.opp = params.value("id").toInt();
@@ -1079,6 +1103,8 @@ void DualWielder::readReplay(const QString &data)
 
 void DualWielder::socketConnected()
 {
+    inflater.reset();
+
     if (web) {
         notify(Nw::SetIP, web->ip());
         web->write(QString("connected|"));
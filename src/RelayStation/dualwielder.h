@@ -6,6 +6,7 @@
 #include "battletojson.h"
 #include <QJson/qjson.h>
 #include <Utilities/coreclasses.h>
+#include <Utilities/compressionstream.h>
 #include <PokemonInfo/networkstructs.h>
 
 class QWsSocket;
@@ -26,7 +27,7 @@ public:
     void readReplay(const QString &data);
 public slots:
     void readSocket(const QByteArray&);
-    void readWebSocket(const QString&);
+    void readWebSocket(const QByteArray&);
     void socketConnected();
     void socketDisconnected();
     void webSocketDisconnected();
@@ -56,6 +57,9 @@ private:
     /* Ids for which to get full information when they are relayed */
     QVector<int> importantPlayers;
 
+    /* For ZipCommand with content type 2 */
+    InflateStream inflater;
+
     int myid;
     ProtocolVersion version;
     bool away;
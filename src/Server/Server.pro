@@ -28,10 +28,13 @@ SOURCES += main.cpp \
     server.tpp \
     scriptengineagent.cpp \
     battlecommunicator.cpp \
+    battleshard.cpp \
     registrycommunicator.cpp \
     battleanalyzer.cpp \
     sql.cpp \
-    sqlconfig.cpp
+    sqlconfig.cpp \
+    asyncsql.cpp \
+    bulktransfer.cpp
 !CONFIG(nogui):SOURCES += mainwindow.cpp \
     playerswindow.cpp \
     serverwidget.cpp \
@@ -65,10 +68,13 @@ HEADERS += player.h \
     relaymanager.h \
     scriptengineagent.h \
     battlecommunicator.h \
+    battleshard.h \
     registrycommunicator.h \
     battleanalyzer.h \
     sql.h \
-    sqlconfig.h
+    sqlconfig.h \
+    asyncsql.h \
+    bulktransfer.h
 !CONFIG(nogui):HEADERS += mainwindow.h \
     battlingoptions.h \
     playerswindow.h \
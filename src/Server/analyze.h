@@ -35,6 +35,11 @@ class Analyzer : public BaseAnalyzer
 
     Q_OBJECT
 public:
+    /* Ids read in a request for players' info, the rest is ignored */
+    enum {
+        MaxPlayerDataRequest = 200
+    };
+
     template<class SocketClass>
     Analyzer(const SocketClass &sock, int id, bool dummy=false);
 
@@ -73,7 +78,7 @@ signals:
     void loggedIn(LoginInfo *info);
     void serverPasswordSent(const QByteArray &hash);
     void messageReceived(int chanid, const QString &mess);
-    void playerDataRequested(int playerid);
+    void playerDataRequested(const QVector<qint32> &ids);
     void teamChanged(const ChangeTeamInfo&);
     void forfeitBattle(int id);
     void challengeStuff(const ChallengeInfo &c);
@@ -0,0 +1,109 @@
+#include "asyncsql.h"
+#include "sql.h"
+
+AsyncSql *AsyncSql::inst = nullptr;
+
+AsyncSql::AsyncSql() : finished(false), nextId(0)
+{
+    connect(this, SIGNAL(jobDone(int,QVariant)), SLOT(callBack(int,QVariant)), Qt::QueuedConnection);
+}
+
+void AsyncSql::init()
+{
+    if (!isSql() || inst) {
+        return;
+    }
+
+    inst = new AsyncSql();
+    inst->start();
+}
+
+void AsyncSql::destroy()
+{
+    if (inst) {
+        inst->finish();
+        inst->wait();
+        delete inst, inst = nullptr;
+    }
+}
+
+void AsyncSql::query(const Job &job, const Callback &callback)
+{
+    if (!inst) {
+        /* Not started, can't do better than running it right away */
+        QVariant result = job();
+        if (callback) {
+            callback(result);
+        }
+        return;
+    }
+
+    inst->push(job, callback);
+}
+
+void AsyncSql::push(const Job &job, const Callback &callback)
+{
+    int id = nextId++;
+
+    if (callback) {
+        callbacks.insert(id, callback);
+    }
+
+    QMutexLocker l(&jobMutex);
+    jobs.enqueue(QPair<int, Job>(id, job));
+    jobAdded.wakeOne();
+}
+
+void AsyncSql::finish()
+{
+    QMutexLocker l(&jobMutex);
+    finished = true;
+    jobAdded.wakeOne();
+}
+
+void AsyncSql::run()
+{
+    QString dbname = "async-" + QString::number(intptr_t(QThread::currentThreadId()));
+
+    SQLCreator::createSQLConnection(dbname);
+    SQLCreator::setThreadConnection(dbname);
+
+    forever {
+        QPair<int, Job> job;
+
+        {
+            QMutexLocker l(&jobMutex);
+
+            while (jobs.empty() && !finished) {
+                jobAdded.wait(&jobMutex);
+            }
+
+            /* The jobs queued before finishing are still run */
+            if (jobs.empty()) {
+                break;
+            }
+
+            job = jobs.dequeue();
+        }
+
+        emit jobDone(job.first, job.second());
+    }
+
+    /* Statements must go before the connection */
+    SQLCreator::setThreadConnection(QString());
+    QSqlDatabase::database(dbname).close();
+}
+
+void AsyncSql::callBack(int id, const QVariant &result)
+{
+    auto it = callbacks.find(id);
+
+    if (it == callbacks.end()) {
+        return;
+    }
+
+    Callback callback = it.value();
+    callbacks.erase(it);
+
+    callback(result);
+}
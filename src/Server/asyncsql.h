@@ -0,0 +1,48 @@
+#ifndef ASYNCSQL_H
+#define ASYNCSQL_H
+
+#include <functional>
+#include <QtCore>
+
+/* Runs SQL jobs on a thread with its own connection, and gives their result
+   back to the main thread, so a slow database doesn't stall chat and battles.
+
+   Jobs should use SQLCreator::statement() to get their queries. */
+class AsyncSql : public QThread
+{
+    Q_OBJECT
+public:
+    typedef std::function<QVariant()> Job;
+    typedef std::function<void(const QVariant &)> Callback;
+
+    static void init();
+    static void destroy();
+
+    /* Should only be called from the main thread. The callback is called in the
+       main thread with what the job returned */
+    static void query(const Job &job, const Callback &callback = Callback());
+
+    void run();
+signals:
+    void jobDone(int id, const QVariant &result);
+private slots:
+    void callBack(int id, const QVariant &result);
+private:
+    AsyncSql();
+
+    void push(const Job &job, const Callback &callback);
+    void finish();
+
+    static AsyncSql *inst;
+
+    QQueue<QPair<int, Job> > jobs;
+    QMutex jobMutex;
+    QWaitCondition jobAdded;
+    bool finished;
+
+    /* Only used in the main thread */
+    QHash<int, Callback> callbacks;
+    int nextId;
+};
+
+#endif // ASYNCSQL_H
@@ -46,6 +46,16 @@ void BattleAnalyzer::dealWithCommand(const QByteArray &commandline)
         emit battleMessage(bid, p, message);
         break;
     }
+    case BattleStream: {
+        qint32 bid, p;
+        qint8 audience;
+        QByteArray message;
+
+        in >> bid >> audience >> p >> message;
+
+        emit battleStream(bid, audience, p, message);
+        break;
+    }
     case BattleFinished: {
         qint32 bid, result, winner, loser;
 
@@ -1,7 +1,10 @@
+#include <algorithm>
 #include <QTimer>
+#include <QSettings>
 
 #include "../Shared/networkcommands.h"
 #include "../Shared/battlecommands.h"
+#include "../Shared/battlestream.h"
 
 #include <Utilities/exesuffix.h>
 #include <PokemonInfo/battlestructs.h>
@@ -9,26 +12,30 @@
 #include "tiermachine.h"
 #include "tier.h"
 #include "battleanalyzer.h"
+#include "battleshard.h"
 #include "player.h"
 #include "battlecommunicator.h"
 
-static const QString processErrorMessages[] = {
-    "The process failed to start. Either the invoked program is missing, or you may have insufficient permissions to invoke the program.",
-    "The process crashed some time after starting successfully.",
-    "The last waitFor...() function timed out. The state of QProcess is unchanged, and you can try calling waitFor...() again.",
-    "An error occurred when attempting to write to the process. For example, the process may not be running, or it may have closed its input channel.",
-    "An error occurred when attempting to read from the process. For example, the process may not be running.",
-    "An unknown error occurred. This is the default return value of error()."
-};
-
 BattleCommunicator::BattleCommunicator(QObject *parent) :
-    QObject(parent), relay(nullptr)
+    QObject(parent)
 {
-    QTimer::singleShot(3000, this, SLOT(connectToBattleServer()));
-    battleServer = new QProcess(this);
-
-    wasConnected = false;
-    silent = false;
+    QSettings settings("config", QSettings::IniFormat);
+    int count = std::max(1, std::min(settings.value("Battles/Shards", 1).toInt(), 64));
+
+    for (int i = 0; i < count; i++) {
+        BattleShard *shard = new BattleShard(i, 5096 + i, this);
+
+        connect(shard, SIGNAL(info(QString)), SIGNAL(info(QString)));
+        connect(shard, SIGNAL(connected()), SLOT(shardConnected()));
+        connect(shard, SIGNAL(error()), SLOT(shardError()));
+        connect(shard, SIGNAL(connectionLost()), SIGNAL(battleConnectionLost()));
+        connect(shard, SIGNAL(sendBattleInfos(int,int,int,TeamBattle,BattleConfiguration,QString)), SLOT(filterBattleInfos(int,int,int,TeamBattle,BattleConfiguration,QString)));
+        connect(shard, SIGNAL(battleMessage(int,int,QByteArray)), SLOT(filterBattleInfo(int,int,QByteArray)));
+        connect(shard, SIGNAL(battleStream(int,int,int,QByteArray)), SLOT(filterBattleStream(int,int,int,QByteArray)));
+        connect(shard, SIGNAL(battleResult(int,int,int,int)), SLOT(filterBattleResult(int,int,int,int)));
+
+        shards.push_back(shard);
+    }
 }
 
 int BattleCommunicator::count() const
@@ -43,14 +50,73 @@ bool BattleCommunicator::contains(int battleid) const
 
 bool BattleCommunicator::valid() const
 {
-    return relay && relay->isConnected();
+    foreach(BattleShard *shard, shards) {
+        if (shard->valid()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int BattleCommunicator::shardCount() const
+{
+    return shards.size();
+}
+
+QString BattleCommunicator::shardReport() const
+{
+    QString ret;
+    foreach(BattleShard *shard, shards) {
+        ret += QString("\tShard %1> %2 battles, %3 ms, %4\n").arg(shard->index()).arg(shard->battleCount()).arg(shard->latency())
+                .arg(shard->valid() ? "up" : "down");
+    }
+    return ret;
+}
+
+BattleShard *BattleCommunicator::shardOf(int battleid) const
+{
+    BattleShard *shard = battleShards.value(battleid);
+    return shard && shard->valid() ? shard : nullptr;
+}
+
+BattleShard *BattleCommunicator::leastLoadedShard() const
+{
+    QVector<int> latencies;
+    foreach(BattleShard *shard, shards) {
+        if (shard->valid()) {
+            latencies.push_back(shard->latency());
+        }
+    }
+
+    if (latencies.empty()) {
+        return nullptr;
+    }
+
+    std::nth_element(latencies.begin(), latencies.begin() + latencies.size() / 2, latencies.end());
+    int median = latencies[latencies.size() / 2];
+
+    BattleShard *best = nullptr;
+    int bestLoad = 0;
+    foreach(BattleShard *shard, shards) {
+        if (!shard->valid()) {
+            continue;
+        }
+        int load = shard->load(median);
+        if (!best || load < bestLoad) {
+            best = shard;
+            bestLoad = load;
+        }
+    }
+    return best;
 }
 
 void BattleCommunicator::startBattle(Player *p1, Player *p2, const ChallengeInfo &c, int id, TeamBattle &team1, TeamBattle &team2)
 {
-    if (!valid()) {
+    BattleShard *shard = leastLoadedShard();
+    if (!shard) {
         qFatal("Starting a battle when no valid connections");
     }
+    BattleAnalyzer *relay = shard->relay();
 
     QString tier = team1.tier == team2.tier ? team1.tier : QString("Mixed %1").arg(GenInfo::Version(team1.gen));
 
@@ -75,27 +141,36 @@ void BattleCommunicator::startBattle(Player *p1, Player *p2, const ChallengeInfo
         relay->startBattle(id, pb1, pb2, c, team1, team2);
     }
 
+    battleShards.insert(id, shard);
+    shard->addBattle();
+
     p1->addBattle(id);
     p2->addBattle(id);
 }
 
 void BattleCommunicator::loadPlugin(const QString &path)
 {
-    if (relay) {
-        relay->notify(LoadPlugin, true, path);
+    foreach(BattleShard *shard, shards) {
+        if (shard->relay()) {
+            shard->relay()->notify(LoadPlugin, true, path);
+        }
     }
 }
 
 void BattleCommunicator::unloadPlugin(const QString &name)
 {
-    if (relay) {
-        relay->notify(LoadPlugin, false, name);
+    foreach(BattleShard *shard, shards) {
+        if (shard->relay()) {
+            shard->relay()->notify(LoadPlugin, false, name);
+        }
     }
 }
 
 void BattleCommunicator::playerForfeit(int battleid, int forfeiter)
 {
-    relay->notify(BattleFinished, qint32(battleid), uchar(Forfeit), qint32(forfeiter));
+    if (BattleShard *shard = shardOf(battleid)) {
+        shard->relay()->notify(BattleFinished, qint32(battleid), uchar(Forfeit), qint32(forfeiter));
+    }
 
     /* Manually send the forfeit to everyone since we're going to remove the battle soon and so not forward anymore of its messages */
     if (contains(battleid)) {
@@ -111,26 +186,33 @@ void BattleCommunicator::showResult(int battleid, int result, int loser)
 
     stream << uchar(BattleCommands::BattleEnd) << qint8(mybattles[battleid]->opponent(mybattles[battleid]->spot(loser))) << uchar(result);
 
-    emit battleInfo(battleid, mybattles[battleid]->id(0), command);
-    emit battleInfo(battleid, mybattles[battleid]->id(1), command);
+    FullBattleConfiguration *battle = mybattles[battleid];
 
-    foreach(int spectator, mybattles[battleid]->spectators) {
-        emit battleInfo(battleid, spectator, command);
-    }
+    emit battleStream(battleid, QVector<qint32>() << battle->id(0) << battle->id(1), battle->spectators.toList().toVector(), command);
 }
 
 void BattleCommunicator::removeBattle(int battleid)
 {
     delete mybattles.take(battleid);
+    joiningSpectators.remove(battleid);
 
-    relay->notify(BattleFinished, qint32(battleid), uchar(Close));
+    BattleShard *shard = battleShards.take(battleid);
+    if (shard) {
+        shard->removeBattle(battleid);
+        if (shard->valid()) {
+            shard->relay()->notify(BattleFinished, qint32(battleid), uchar(Close));
+        }
+    }
 }
 
 void BattleCommunicator::addSpectator(int battle, int id, const QString &name)
 {
     mybattles[battle]->spectators.insert(id);
+    joiningSpectators[battle].insert(id);
 
-    relay->notify(SpectateBattle, qint32(battle), true, qint32(id), name);
+    if (BattleShard *shard = shardOf(battle)) {
+        shard->relay()->notify(SpectateBattle, qint32(battle), true, qint32(id), name);
+    }
 }
 
 void BattleCommunicator::removeSpectator(int idOfBattle, int id)
@@ -139,8 +221,13 @@ void BattleCommunicator::removeSpectator(int idOfBattle, int id)
         qFatal("Critical bug needing to be solved: BattleCommunicator::removeSpectator, player %d and non-existent battle %d", id, idOfBattle);
     } else {
         mybattles[idOfBattle]->spectators.remove(id);
+        if (joiningSpectators.contains(idOfBattle)) {
+            joiningSpectators[idOfBattle].remove(id);
+        }
 
-        relay->notify(SpectateBattle, qint32(idOfBattle), false, qint32(id));
+        if (BattleShard *shard = shardOf(idOfBattle)) {
+            shard->relay()->notify(SpectateBattle, qint32(idOfBattle), false, qint32(id));
+        }
     }
 }
 
@@ -154,88 +241,34 @@ FullBattleConfiguration *BattleCommunicator::battle(int battleid)
 
 void BattleCommunicator::killServer()
 {
-    if (battleServer->state() == QProcess::Running) {
-        battleServer->kill();
+    foreach(BattleShard *shard, shards) {
+        shard->killServer();
     }
 }
 
 bool BattleCommunicator::startServer()
 {
-    if (battleServer->state() == QProcess::Starting || battleServer->state() == QProcess::Running) {
-        return false;
+    bool started = false;
+    foreach(BattleShard *shard, shards) {
+        started |= shard->startServer();
     }
-
-    emit info("Starting battle server.");
-    battleServer->start("./BattleServer" SUFFIX " -p 5096 -c");
-    connect(battleServer, SIGNAL(started()), this, SLOT(battleServerStarted()));
-    connect(battleServer, SIGNAL(error(QProcess::ProcessError)), this, SLOT(battleServerError(QProcess::ProcessError)));
-    return true;
+    return started;
 }
 
-void BattleCommunicator::battleServerStarted()
+void BattleCommunicator::shardConnected()
 {
-    emit info("Battle server started.");
-}
-
-void BattleCommunicator::battleServerError(QProcess::ProcessError error)
-{
-    emit info(QString("Battle server error: %1").arg(processErrorMessages[error]));
-}
-
-void BattleCommunicator::connectToBattleServer()
-{
-    if (relay) {
-        if (relay->isConnected()) {
-            return;
-        }
-        else
-            relay->deleteLater();
-    }
-
-    relay = nullptr;
+    BattleShard *shard = (BattleShard*) sender();
 
-    if (!silent) {
-        emit info("Connecting to battle server on port 5096...");
-    } else {
-        silent = false;
+    if (shard->relay()) {
+        shard->relay()->notify(DatabaseMod, mod);
     }
-
-    QTcpSocket * s = new QTcpSocket(nullptr);
-    s->connectToHost("localhost", 5096);
-
-    connect(s, SIGNAL(connected()), this, SLOT(battleConnected()));
-    connect(s, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(battleConnectionError()));
-
-    relay = new BattleAnalyzer(s);
-
-    connect(relay, SIGNAL(sendBattleInfos(int,int,int,TeamBattle,BattleConfiguration,QString)), SLOT(filterBattleInfos(int,int,int,TeamBattle,BattleConfiguration,QString)));
-    connect(relay, SIGNAL(battleMessage(int,int,QByteArray)), SLOT(filterBattleInfo(int,int,QByteArray)));
-    connect(relay, SIGNAL(battleResult(int,int,int,int)), SLOT(filterBattleResult(int,int,int,int)));
 }
 
-void BattleCommunicator::battleConnected()
+void BattleCommunicator::shardError()
 {
-    emit info("Connected to battle server!");
-    wasConnected = true;
-    changeMod(mod);
-}
-
-void BattleCommunicator::battleConnectionError()
-{
-    removeBattles();
-    // Only send messages if there was previously a connection
-    // or a server is already running (which means it should've connected).
-    if (wasConnected) {
-        emit info("Error when connecting to the battle server. Will try again in 10 seconds");
-
-        wasConnected = false;
-        emit battleConnectionLost();
-    } else {
-        silent = true;
-    }
+    removeBattles((BattleShard*) sender());
 
     emit error();
-    QTimer::singleShot(10000, this, SLOT(connectToBattleServer()));
 }
 
 
@@ -245,34 +278,31 @@ void BattleCommunicator::battleMessage(int player, int battle, const BattleChoic
         return;
     }
 
-    relay->notifyChoice(battle, player, choice);
+    if (BattleShard *shard = shardOf(battle)) {
+        shard->choiceSent(battle);
+        shard->relay()->notifyChoice(battle, player, choice);
+    }
 }
 
 void BattleCommunicator::resendBattleInfos(int player, int battle)
 {
-    if (!contains(battle)) {
-        return;
+    if (BattleShard *shard = shardOf(battle)) {
+        shard->relay()->notify(SpectateBattle, qint32(battle), true, qint32(player));
     }
-
-    relay->notify(SpectateBattle, qint32(battle), true, qint32(player));
 }
 
 void BattleCommunicator::battleChat(int player, int battle, const QString &chat)
 {
-    if (!contains(battle)) {
-        return;
+    if (BattleShard *shard = shardOf(battle)) {
+        shard->relay()->notify(BattleChat, qint32(battle), qint32(player), chat);
     }
-
-    relay->notify(BattleChat, qint32(battle), qint32(player), chat);
 }
 
 void BattleCommunicator::spectatingChat(int player, int battle, const QString &chat)
 {
-    if (!contains(battle)) {
-        return;
+    if (BattleShard *shard = shardOf(battle)) {
+        shard->relay()->notify(SpectatingBattleChat, qint32(battle), qint32(player), chat);
     }
-
-    relay->notify(SpectatingBattleChat, qint32(battle), qint32(player), chat);
 }
 
 void BattleCommunicator::filterBattleInfos(int b, int p1, int p2, const TeamBattle &t, const BattleConfiguration &c, const QString &s)
@@ -294,15 +324,65 @@ void BattleCommunicator::filterBattleInfo(int battleid, int player, const QByteA
 
         /* Show variation here */
         if (battle->rated() && info.length() > 0 && (battle->id(0) == player || battle->id(1) == player) && info[0] == BattleCommands::Rated) {
-            QPair<int,int> firstChange = TierMachine::obj()->pointChangeEstimate(battle->name[battle->spot(player)], battle->name[battle->opponent(battle->spot(player))], battle->tier());
+            sendPointEstimate(battleid, player);
+        }
 
-            emit battleInfo(battleid, player, pack(BattleCommands::PointEstimate, battle->spot(player), qint8(firstChange.first), qint8(firstChange.second)));
+        /* The battle server addresses a joining spectator before anything else,
+           from then on the spectator is in the battle's audience */
+        if (joiningSpectators.contains(battleid) && joiningSpectators[battleid].remove(player) && joiningSpectators[battleid].empty()) {
+            joiningSpectators.remove(battleid);
         }
     }
 
     emit battleInfo(battleid, player, info);
 }
 
+void BattleCommunicator::filterBattleStream(int battleid, int audience, int player, const QByteArray &info)
+{
+    if (audience == StreamAudience::Player) {
+        filterBattleInfo(battleid, player, info);
+        return;
+    }
+
+    if (!contains(battleid)) {
+        return;
+    }
+
+    FullBattleConfiguration *battle = mybattles[battleid];
+
+    QVector<qint32> players;
+    for (int i = 0; i < 2; i++) {
+        if (audience == StreamAudience::AllButPlayer && battle->id(i) == player) {
+            continue;
+        }
+        players.push_back(battle->id(i));
+
+        if (battle->rated() && info.length() > 0 && info[0] == BattleCommands::Rated) {
+            sendPointEstimate(battleid, battle->id(i));
+        }
+    }
+
+    QVector<qint32> spectators;
+    spectators.reserve(battle->spectators.size());
+
+    const QSet<int> &joining = joiningSpectators.value(battleid);
+    foreach(int spectator, battle->spectators) {
+        if (!joining.contains(spectator)) {
+            spectators.push_back(spectator);
+        }
+    }
+
+    emit battleStream(battleid, players, spectators, info);
+}
+
+void BattleCommunicator::sendPointEstimate(int battleid, int player)
+{
+    FullBattleConfiguration *battle = mybattles[battleid];
+    QPair<int,int> firstChange = TierMachine::obj()->pointChangeEstimate(battle->name[battle->spot(player)], battle->name[battle->opponent(battle->spot(player))], battle->tier());
+
+    emit battleInfo(battleid, player, pack(BattleCommands::PointEstimate, battle->spot(player), qint8(firstChange.first), qint8(firstChange.second)));
+}
+
 void BattleCommunicator::filterBattleResult(int b, int r, int w, int l)
 {
     //qDebug() << "battle result " << b;
@@ -319,15 +399,28 @@ void BattleCommunicator::changeMod(const QString &mod)
 {
     this->mod = mod;
 
-    if (relay) {
-        relay->notify(DatabaseMod, mod);
+    foreach(BattleShard *shard, shards) {
+        if (shard->relay()) {
+            shard->relay()->notify(DatabaseMod, mod);
+        }
     }
 }
 
 void BattleCommunicator::removeBattles()
 {
-    /* Removing all battles */
-    foreach(int battle, mybattles.keys()) {
+    foreach(BattleShard *shard, shards) {
+        removeBattles(shard);
+    }
+}
+
+void BattleCommunicator::removeBattles(BattleShard *shard)
+{
+    /* Removing all battles of the shard */
+    foreach(int battle, battleShards.keys(shard)) {
+        if (!mybattles.contains(battle) || mybattles[battle]->finished()) {
+            continue;
+        }
+
         mybattles[battle]->finished() = true;
         showResult(battle, Tie, mybattles[battle]->id(0));
 
@@ -4,11 +4,13 @@
 #include <QObject>
 #include <QString>
 #include <QHash>
-#include <QProcess>
+#include <QSet>
+#include <QVector>
 
 #include <Utilities/coreclasses.h>
+#include <Utilities/packetbuilder.h>
 
-class BattleAnalyzer;
+class BattleShard;
 class BattleChoice;
 class Player;
 class ChallengeInfo;
@@ -16,6 +18,9 @@ class FullBattleConfiguration;
 class BattleConfiguration;
 class TeamBattle;
 
+/* Runs the battles on a pool of BattleServer processes (Battles/Shards in the
+   config), placing each new battle on the least loaded one. A battle stays on
+   its shard, and if a shard goes down only its battles are lost. */
 class BattleCommunicator : public QObject
 {
     Q_OBJECT
@@ -28,6 +33,9 @@ public:
 
     /* Can we have battles? */
     bool valid() const;
+    int shardCount() const;
+    /* Battles and average turn latency of each shard, for debugging */
+    QString shardReport() const;
 
     void startBattle(Player *p1, Player *p2, const ChallengeInfo &c, int id, TeamBattle &team1, TeamBattle &team2);
     void loadPlugin(const QString &path);
@@ -46,14 +54,14 @@ signals:
     void error();
     void battleConnectionLost();
     void battleInfo(int,int,const QByteArray&);
+    /* A battle command for several players and spectators, to pack once */
+    void battleStream(int battle, const QVector<qint32> &players, const QVector<qint32> &spectators, const QByteArray &info);
     void battleFinished(int,int,int,int);
     void sendBattleInfos(int,int,int,const TeamBattle&,const BattleConfiguration&,const QString&);
 public slots:
     void killServer();
+    /* Starts the battle servers not running */
     bool startServer();
-    void connectToBattleServer();
-    void battleConnected();
-    void battleConnectionError();
 
     /* Player -> battle server */
     void battleMessage(int player, int battle, const BattleChoice &choice);
@@ -63,32 +71,35 @@ public slots:
     /* Battle server -> player */
     void filterBattleInfos(int,int,int,const TeamBattle&,const BattleConfiguration&,const QString&);
     void filterBattleInfo(int battle, int player, const QByteArray &info);
+    void filterBattleStream(int battle, int audience, int player, const QByteArray &info);
     void filterBattleResult(int, int, int, int);
     void removeBattles();
     /* Server -> Battle server */
     void changeMod(const QString &mod);
 private slots:
-    void battleServerStarted();
-    void battleServerError(QProcess::ProcessError error);
+    void shardConnected();
+    void shardError();
 private:
-    BattleAnalyzer* relay;
-    QProcess* battleServer;
-    bool silent;
-    bool wasConnected;
+    QVector<BattleShard*> shards;
+    /* Shard of each battle */
+    QHash<int, BattleShard*> battleShards;
 
     QHash<int, FullBattleConfiguration*> mybattles;
+    /* Spectators the battle server hasn't sent the battle to yet. They are
+       left out of the battle's audience until it addresses them directly. */
+    QHash<int, QSet<int> > joiningSpectators;
     QString mod;
 
     void showResult(int battle, int result, int loser);
+    void sendPointEstimate(int battle, int player);
+    /* The shard of the battle, if it's connected */
+    BattleShard *shardOf(int battle) const;
+    BattleShard *leastLoadedShard() const;
+    void removeBattles(BattleShard *shard);
 
     template <typename ...Params>
     QByteArray pack(int command, int who, Params&&... params) {
-        QByteArray tosend;
-        DataStream out(&tosend, QIODevice::WriteOnly);
-
-        out.pack(uchar(command), qint8(who), std::forward<Params>(params)...);
-
-        return tosend;
+        return PacketBuilder::pack(0, uchar(command), qint8(who), std::forward<Params>(params)...);
     }
 
 };
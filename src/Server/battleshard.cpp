@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <QTimer>
+#include <QTcpSocket>
+
+#include <Utilities/exesuffix.h>
+#include <PokemonInfo/battlestructs.h>
+
+#include "../Shared/battlecommands.h"
+#include "battleanalyzer.h"
+#include "battleshard.h"
+
+static const QString processErrorMessages[] = {
+    "The process failed to start. Either the invoked program is missing, or you may have insufficient permissions to invoke the program.",
+    "The process crashed some time after starting successfully.",
+    "The last waitFor...() function timed out. The state of QProcess is unchanged, and you can try calling waitFor...() again.",
+    "An error occurred when attempting to write to the process. For example, the process may not be running, or it may have closed its input channel.",
+    "An error occurred when attempting to read from the process. For example, the process may not be running.",
+    "An unknown error occurred. This is the default return value of error()."
+};
+
+/* Answers slower than that count as that, so a clock running out after a
+   single choice doesn't make the shard look dead */
+static const int maxLatencySample = 2000;
+/* Latency only counts past twice the median of the shards plus latencySlack,
+   so that jitter doesn't decide where battles go. Past that, each
+   latencyPerBattle ms weigh as much as one battle */
+static const int latencySlack = 50;
+static const int latencyPerBattle = 10;
+
+BattleShard::BattleShard(int index, int port, QObject *parent) :
+    QObject(parent), m_index(index), port(port), m_relay(nullptr), silent(false), wasConnected(false),
+    battles(0), averageLatency(0)
+{
+    battleServer = new QProcess(this);
+    connect(battleServer, SIGNAL(started()), this, SLOT(battleServerStarted()));
+    connect(battleServer, SIGNAL(error(QProcess::ProcessError)), this, SLOT(battleServerError(QProcess::ProcessError)));
+
+    clock.start();
+
+    QTimer::singleShot(3000, this, SLOT(connectToBattleServer()));
+}
+
+bool BattleShard::valid() const
+{
+    return m_relay && m_relay->isConnected();
+}
+
+void BattleShard::addBattle()
+{
+    battles += 1;
+}
+
+void BattleShard::removeBattle(int battleid)
+{
+    battles -= 1;
+    pendingChoices.remove(battleid);
+}
+
+int BattleShard::load(int medianLatency) const
+{
+    int threshold = 2 * medianLatency + latencySlack;
+
+    if (averageLatency <= threshold) {
+        return battles;
+    }
+
+    return battles + (averageLatency - threshold) / latencyPerBattle;
+}
+
+void BattleShard::choiceSent(int battleid)
+{
+    /* Only the last choice of a turn gets an answer right away, so
+       keep the time of the latest one */
+    pendingChoices[battleid] = clock.elapsed();
+}
+
+void BattleShard::answerReceived(int battleid)
+{
+    auto it = pendingChoices.find(battleid);
+    if (it == pendingChoices.end()) {
+        return;
+    }
+
+    int sample = std::min(clock.elapsed() - it.value(), qint64(maxLatencySample));
+    pendingChoices.erase(it);
+
+    averageLatency += (sample - averageLatency) / 8;
+}
+
+QString BattleShard::name() const
+{
+    return QString("battle server on port %1").arg(port);
+}
+
+void BattleShard::killServer()
+{
+    if (battleServer->state() == QProcess::Running) {
+        battleServer->kill();
+    }
+}
+
+bool BattleShard::startServer()
+{
+    if (battleServer->state() == QProcess::Starting || battleServer->state() == QProcess::Running) {
+        return false;
+    }
+
+    emit info(QString("Starting %1.").arg(name()));
+    battleServer->start(QString("./BattleServer" SUFFIX " -p %1 -c").arg(port));
+    return true;
+}
+
+void BattleShard::battleServerStarted()
+{
+    emit info(QString("Started %1.").arg(name()));
+}
+
+void BattleShard::battleServerError(QProcess::ProcessError error)
+{
+    emit info(QString("Error with %1: %2").arg(name(), processErrorMessages[error]));
+}
+
+void BattleShard::connectToBattleServer()
+{
+    if (m_relay) {
+        if (m_relay->isConnected()) {
+            return;
+        }
+        else
+            m_relay->deleteLater();
+    }
+
+    m_relay = nullptr;
+
+    if (!silent) {
+        emit info(QString("Connecting to %1...").arg(name()));
+    } else {
+        silent = false;
+    }
+
+    QTcpSocket * s = new QTcpSocket(nullptr);
+    s->connectToHost("localhost", port);
+
+    connect(s, SIGNAL(connected()), this, SLOT(battleConnected()));
+    connect(s, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(battleConnectionError()));
+
+    m_relay = new BattleAnalyzer(s);
+
+    connect(m_relay, SIGNAL(sendBattleInfos(int,int,int,TeamBattle,BattleConfiguration,QString)), SIGNAL(sendBattleInfos(int,int,int,TeamBattle,BattleConfiguration,QString)));
+    connect(m_relay, SIGNAL(battleMessage(int,int,QByteArray)), SLOT(onBattleMessage(int,int,QByteArray)));
+    connect(m_relay, SIGNAL(battleStream(int,int,int,QByteArray)), SLOT(onBattleStream(int,int,int,QByteArray)));
+    connect(m_relay, SIGNAL(battleResult(int,int,int,int)), SIGNAL(battleResult(int,int,int,int)));
+}
+
+void BattleShard::battleConnected()
+{
+    emit info(QString("Connected to %1!").arg(name()));
+    wasConnected = true;
+    emit connected();
+}
+
+void BattleShard::battleConnectionError()
+{
+    pendingChoices.clear();
+
+    // Only send messages if there was previously a connection
+    // or a server is already running (which means it should've connected).
+    if (wasConnected) {
+        emit info(QString("Error when connecting to %1. Will try again in 10 seconds").arg(name()));
+
+        wasConnected = false;
+        emit connectionLost();
+    } else {
+        silent = true;
+    }
+
+    emit error();
+    QTimer::singleShot(10000, this, SLOT(connectToBattleServer()));
+}
+
+void BattleShard::onBattleMessage(int bid, int p, const QByteArray &info)
+{
+    emit battleMessage(bid, p, info);
+}
+
+void BattleShard::onBattleStream(int bid, int audience, int p, const QByteArray &info)
+{
+    /* The turn is done when the battle asks for the next choices, chat and
+       spectators don't say anything about it */
+    if (info.length() > 0 && info[0] == char(BattleCommands::OfferChoice)) {
+        answerReceived(bid);
+    }
+    emit battleStream(bid, audience, p, info);
+}
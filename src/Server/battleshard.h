@@ -0,0 +1,90 @@
+#ifndef BATTLESHARD_H
+#define BATTLESHARD_H
+
+#include <QObject>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QProcess>
+
+class BattleAnalyzer;
+class TeamBattle;
+class BattleConfiguration;
+
+/* One BattleServer process and the connection to it. The BattleCommunicator
+   spreads the battles over several of them. */
+class BattleShard : public QObject
+{
+    Q_OBJECT
+public:
+    BattleShard(int index, int port, QObject *parent = 0);
+
+    int index() const {
+        return m_index;
+    }
+
+    bool valid() const;
+    BattleAnalyzer *relay() const {
+        return m_relay;
+    }
+
+    /* Number of battles placed on the shard */
+    int battleCount() const {
+        return battles;
+    }
+    void addBattle();
+    void removeBattle(int battleid);
+
+    /* Average time between the last choice of a turn and the battle server
+       asking for the next ones, in ms */
+    int latency() const {
+        return averageLatency;
+    }
+    /* Lower is better, used to place new battles. The number of battles, plus
+       a penalty when the latency is well above the median of the shards */
+    int load(int medianLatency) const;
+
+    /* Called when a choice is sent for the battle, to measure the latency */
+    void choiceSent(int battleid);
+signals:
+    void info(const QString &message);
+    void error();
+    void connectionLost();
+
+    void sendBattleInfos(int,int,int,const TeamBattle&,const BattleConfiguration&,const QString&);
+    void battleMessage(int bid, int p, const QByteArray &info);
+    void battleStream(int bid, int audience, int p, const QByteArray &info);
+    void battleResult(int bid, int result, int winner, int loser);
+    void connected();
+public slots:
+    void killServer();
+    bool startServer();
+    void connectToBattleServer();
+private slots:
+    void battleConnected();
+    void battleConnectionError();
+    void battleServerStarted();
+    void battleServerError(QProcess::ProcessError error);
+
+    void onBattleMessage(int bid, int p, const QByteArray &info);
+    void onBattleStream(int bid, int audience, int p, const QByteArray &info);
+private:
+    int m_index;
+    int port;
+
+    BattleAnalyzer *m_relay;
+    QProcess *battleServer;
+    bool silent;
+    bool wasConnected;
+
+    int battles;
+
+    QElapsedTimer clock;
+    /* Time of the last choice sent for each battle waiting for an answer */
+    QHash<int, qint64> pendingChoices;
+    int averageLatency;
+
+    void answerReceived(int battleid);
+    QString name() const;
+};
+
+#endif // BATTLESHARD_H
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cstring>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include "bulktransfer.h"
+#include "server.h"
+#include "sql.h"
+
+namespace {
+
+/* SQLite doesn't accept more than 999 parameters in a query */
+const int maxParameters = 900;
+/* Size of the piece of file each parsing task gets */
+const int parseChunkSize = 1 << 20;
+/* Rows each formatting task gets */
+const int exportBlockSize = 10000;
+
+int tasksInFlight()
+{
+    return std::max(2, 2 * QThreadPool::globalInstance()->maxThreadCount());
+}
+
+class ParseTask : public QRunnable
+{
+public:
+    ParseTask(const char *begin, const char *end, const BulkTransfer::LineParser &parser)
+        : begin(begin), end(end), parser(parser) {
+        setAutoDelete(false);
+    }
+
+    void run() {
+        BulkTransfer::Row row;
+
+        for (const char *line = begin; line < end; ) {
+            const char *eol = (const char*) memchr(line, '\n', end - line);
+            if (!eol) {
+                eol = end;
+            }
+            int length = eol - line;
+            if (length > 0 && line[length-1] == '\r') {
+                length--;
+            }
+            if (length > 0) {
+                row.clear();
+                if (parser(QByteArray::fromRawData(line, length), row)) {
+                    rows.push_back(row);
+                }
+            }
+            line = eol + 1;
+        }
+
+        /* Nothing must be touched after that, the task may be deleted right away */
+        done.release();
+    }
+
+    const char *begin, *end;
+    QVector<BulkTransfer::Row> rows;
+    QSemaphore done;
+private:
+    const BulkTransfer::LineParser &parser;
+};
+
+class FormatTask : public QRunnable
+{
+public:
+    FormatTask(const BulkTransfer::RowFormatter &formatter) : formatter(formatter) {
+        setAutoDelete(false);
+    }
+
+    void run() {
+        foreach(const BulkTransfer::Row &row, rows) {
+            out += formatter(row);
+        }
+        rows.clear();
+
+        done.release();
+    }
+
+    QVector<BulkTransfer::Row> rows;
+    QByteArray out;
+    QSemaphore done;
+private:
+    const BulkTransfer::RowFormatter &formatter;
+};
+
+/* Inserts the rows many at a time. If a multi-row insert fails (a duplicate
+   name, for example), its rows are inserted one by one so the others still
+   make it.
+
+   The caller has a transaction open. Each insert is done in a savepoint rolled
+   back when it fails: PostgreSQL refuses anything else in a transaction after
+   an error. */
+int insertRows(const QString &table, const QStringList &columns, const QVector<BulkTransfer::Row> &rows)
+{
+    int perInsert = std::max(1, maxParameters / columns.size());
+
+    QStringList marks;
+    for (int i = 0; i < columns.size(); i++) {
+        marks.push_back("?");
+    }
+    QString head = QString("insert into %1(%2) values ").arg(table, columns.join(", "));
+    QString tuple = "(" + marks.join(", ") + ")";
+
+    auto sql = [&](int count) {
+        QString ret = head + tuple;
+        ret.reserve(head.length() + count * (tuple.length() + 2));
+        for (int i = 1; i < count; i++) {
+            ret += ", ";
+            ret += tuple;
+        }
+        return ret;
+    };
+
+    QString fullInsert = sql(perInsert);
+    int inserted = 0;
+
+    QSqlQuery savepoint;
+    auto endSavepoint = [&](bool ok) {
+        savepoint.exec(ok ? "release savepoint bulk_insert" : "rollback to savepoint bulk_insert");
+        savepoint.finish();
+    };
+
+    for (int i = 0; i < rows.size(); i += perInsert) {
+        int count = std::min(perInsert, rows.size() - i);
+
+        QSqlQuery &query = SQLCreator::statement(count == perInsert ? fullInsert : sql(count));
+        int param = 0;
+        for (int j = i; j < i + count; j++) {
+            foreach(const QVariant &value, rows[j]) {
+                query.bindValue(param++, value);
+            }
+        }
+
+        savepoint.exec("savepoint bulk_insert");
+        savepoint.finish();
+
+        bool ok = query.exec();
+        query.finish();
+        endSavepoint(ok);
+
+        if (ok) {
+            inserted += count;
+            continue;
+        }
+
+        QSqlQuery &single = SQLCreator::statement(sql(1));
+        for (int j = i; j < i + count; j++) {
+            for (int k = 0; k < rows[j].size(); k++) {
+                single.bindValue(k, rows[j][k]);
+            }
+
+            savepoint.exec("savepoint bulk_insert");
+            savepoint.finish();
+
+            ok = single.exec();
+            if (ok) {
+                inserted++;
+            } else {
+                Server::print(QString("Error importing into %1: %2").arg(table, single.lastError().text()));
+            }
+            single.finish();
+            endSavepoint(ok);
+        }
+    }
+
+    return inserted;
+}
+
+}
+
+int BulkTransfer::importFile(const QString &path, const QString &table, const QStringList &columns,
+                             const LineParser &parser, const Progress &progress)
+{
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    Progress report = progress ? progress : printer(QString("Importing %1 into %2").arg(path, table));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 size = in.size();
+    QByteArray contents;
+    const char *data = (const char*) in.map(0, size);
+    if (!data) {
+        contents = in.readAll();
+        data = contents.constData();
+        size = contents.size();
+    }
+
+    /* Cuts the file in chunks ending at the end of a line */
+    QList<ParseTask*> tasks;
+    const char *end = data + size;
+    for (const char *begin = data; begin < end; ) {
+        const char *cut = begin + std::min<qint64>(parseChunkSize, end - begin);
+        if (cut < end) {
+            const char *eol = (const char*) memchr(cut, '\n', end - cut);
+            cut = eol ? eol + 1 : end;
+        }
+        tasks.push_back(new ParseTask(begin, cut, parser));
+        begin = cut;
+    }
+
+    /* Chunks are inserted in order while the following ones are parsed. Only
+       a few are started ahead, so a slow database doesn't leave the whole file
+       parsed in memory. */
+    QThreadPool *pool = QThreadPool::globalInstance();
+    int window = tasksInFlight();
+    int started = 0;
+    int count = 0;
+
+    for (int i = 0; i < tasks.size(); i++) {
+        while (started < tasks.size() && started < i + window) {
+            pool->start(tasks[started++]);
+        }
+
+        ParseTask *task = tasks[i];
+        task->done.acquire();
+
+        QSqlDatabase::database().transaction();
+        count += insertRows(table, columns, task->rows);
+        QSqlDatabase::database().commit();
+
+        report(task->end - data, size);
+        delete task;
+    }
+
+    Server::print(QString("%1 rows imported into %2 in %3 secs").arg(count).arg(table).arg(timer.elapsed() / 1000.0));
+
+    return count;
+}
+
+int BulkTransfer::exportTable(const QString &table, const QStringList &columns, const QString &order,
+                              const QString &path, const RowFormatter &formatter, const Progress &progress)
+{
+    Progress report = progress ? progress : printer(QString("Exporting %1 to %2").arg(table, path));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlQuery q;
+    q.setForwardOnly(true);
+
+    qint64 total = 0;
+    if (q.exec(QString("select count(*) from %1").arg(table)) && q.next()) {
+        total = q.value(0).toLongLong();
+    }
+    q.finish();
+
+    QFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        Server::print(QString("Error exporting %1: can't open %2").arg(table, path));
+        return 0;
+    }
+
+    q.exec(QString("select %1 from %2 order by %3").arg(columns.join(", "), table, order));
+
+    /* Blocks are fetched by this thread, formatted in the thread pool and
+       written in order */
+    QThreadPool *pool = QThreadPool::globalInstance();
+    QQueue<FormatTask*> pending;
+    int window = tasksInFlight();
+    int count = 0;
+
+    auto writeNext = [&]() {
+        FormatTask *task = pending.dequeue();
+        task->done.acquire();
+        out.write(task->out);
+        delete task;
+    };
+
+    bool more = q.next();
+    while (more) {
+        FormatTask *task = new FormatTask(formatter);
+        task->rows.reserve(exportBlockSize);
+
+        for (; more && task->rows.size() < exportBlockSize; more = q.next()) {
+            Row row(columns.size());
+            for (int i = 0; i < columns.size(); i++) {
+                row[i] = q.value(i);
+            }
+            task->rows.push_back(row);
+        }
+        count += task->rows.size();
+
+        pending.enqueue(task);
+        pool->start(task);
+
+        while (pending.size() >= window) {
+            writeNext();
+        }
+
+        report(count, total);
+    }
+
+    while (!pending.empty()) {
+        writeNext();
+    }
+
+    Server::print(QString("%1 rows exported from %2 in %3 secs").arg(count).arg(table).arg(timer.elapsed() / 1000.0));
+
+    return count;
+}
+
+BulkTransfer::Progress BulkTransfer::printer(const QString &what)
+{
+    QSharedPointer<QElapsedTimer> timer(new QElapsedTimer());
+    timer->start();
+
+    return [what, timer](qint64 done, qint64 total) {
+        if (done < total && timer->elapsed() < 3000) {
+            return;
+        }
+        timer->restart();
+        Server::print(QString("%1: %2%").arg(what).arg(total > 0 ? done * 100 / total : 100));
+    };
+}
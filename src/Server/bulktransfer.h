@@ -0,0 +1,40 @@
+#ifndef BULKTRANSFER_H
+#define BULKTRANSFER_H
+
+#include <functional>
+#include <QtCore>
+
+/* Moves whole tables between the text databases of serverdb/ and SQL, used
+   when migrating a server from one backend to the other.
+
+   Imports map the file and cut it in line-aligned chunks, parsed in parallel by
+   the global thread pool while the calling thread inserts the chunks already
+   parsed, many rows per insert. Exports fetch rows by blocks and format them
+   in the thread pool, writing the blocks in order. */
+class BulkTransfer
+{
+public:
+    typedef QVector<QVariant> Row;
+    /* Fills the (empty) row from a line without its '\n', returns false if the
+       line should be skipped. Called from several threads at once. */
+    typedef std::function<bool(const QByteArray &line, Row &row)> LineParser;
+    /* Gives the line (with the '\n') for a row. Called from several threads at once. */
+    typedef std::function<QByteArray(const Row &row)> RowFormatter;
+    typedef std::function<void(qint64 done, qint64 total)> Progress;
+
+    /* Inserts the parsed lines of the file in the table, and returns the number
+       of rows inserted. The progress is in bytes of the file, by default it's
+       printed every few seconds. */
+    static int importFile(const QString &path, const QString &table, const QStringList &columns,
+                          const LineParser &parser, const Progress &progress = Progress());
+
+    /* Writes a line per row of the table in the file, and returns the number of
+       rows written. The progress is in rows. */
+    static int exportTable(const QString &table, const QStringList &columns, const QString &order,
+                           const QString &path, const RowFormatter &formatter, const Progress &progress = Progress());
+
+    /* Progress which prints what's being done, at most every few seconds */
+    static Progress printer(const QString &what);
+};
+
+#endif // BULKTRANSFER_H
@@ -61,6 +61,8 @@ validCheckOk:
         throw Exception();
 
     if (!source->isInSameChannel(dest)) {
+        s->flushPlayerUpdates(source->id());
+        s->flushPlayerUpdates(dest->id());
         source->relay().sendPlayer(dest->bundle());
         dest->relay().sendPlayer(source->bundle());
     }
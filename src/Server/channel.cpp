@@ -9,7 +9,8 @@
 
 QNickValidator *Channel::checker = new QNickValidator(nullptr);
 
-Channel::Channel(const QString &name, int id) : m_prop_id(id), m_prop_name(name){
+Channel::Channel(const QString &name, int id) : m_prop_id(id), m_prop_name(name),
+    chatSecond(0), chatLines(0), suppressedLines(0){
     server = Server::serverIns;
 }
 
@@ -103,7 +104,9 @@ void Channel::onReconnect(int playerid)
         ids.push_back(pid);
 
         Player *p = server->player(pid);
-        if (!p->isInSameChannel(player)) {
+        /* In lazy mode, only the info the client already had is updated */
+        if (!p->isInSameChannel(player) && player->hasInfoOf(pid)) {
+            server->flushPlayerUpdates(pid);
             bundles.push_back(&p->bundle());
         }
     }
@@ -157,7 +160,12 @@ Channel::~Channel()
 
 void Channel::notifyJoin(int pid)
 {
+    /* What was said before the player joined isn't for them, and arrives
+       before the join for the others */
+    server->flushChat(id());
+
     Player *player = server->player(pid);
+    server->flushPlayerUpdates(pid);
 
     QVector<qint32> ids;
     ids.reserve(players.size());
@@ -167,24 +175,39 @@ void Channel::notifyJoin(int pid)
     /* The info of those players, to be sent to the player to join */
     QVector<reference<PlayerInfo> > bundles;
 
+    /* The clients in lazy mode only get the ids, and ask for the info they
+       need. They still get the info they had, it may have changed since. */
     Analyzer &relay = player->relay();
     foreach(int pid2, players) {
         Player *p = server->player(pid2);
         if (!p->isInSameChannel(player)) {
-            unknown.insert(p);
-            bundles.push_back(&p->bundle());
+            if (p->hasInfoOf(pid)) {
+                unknown.insert(p);
+            }
+            if (player->hasInfoOf(pid2)) {
+                server->flushPlayerUpdates(pid2);
+                bundles.push_back(&p->bundle());
+            }
         }
         ids.push_back(p->id());
     }
 
     server->notifyGroup(unknown, NetworkServ::PlayersList, player->bundle());
 
+    /* First time the player is sent, what changes later can be sent as deltas */
+    if (player->sentBundle().id != player->id()) {
+        player->sentBundle() = player->bundle();
+    }
+
     player->sendPlayers(bundles);
     relay.sendChannelPlayers(id(), ids);
 }
 
 void Channel::notifyLeave(int pid)
 {
+    /* What was said before leaving arrives before the leave */
+    server->flushChat(id());
+
     foreach(int pid2, players) {
         server->player(pid2)->relay().notify(NetworkServ::LeaveChannel, qint32(id()), qint32(pid));
     }
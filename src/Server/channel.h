@@ -53,6 +53,14 @@ public:
     QSet<int> disconnectedPlayers;
     QHash<int, Battle> battleList;
     Server *server;
+
+    /* Chat lines waiting for Server::flushChat(), as packets ready to be written:
+       one version for the players getting ids with the messages, one for the others */
+    QByteArray pendingChat, pendingChatOpp;
+    /* For the cap of chat lines per second */
+    qint64 chatSecond;
+    int chatLines;
+    int suppressedLines;
 };
 
 #endif // CHANNEL_H
@@ -63,6 +63,7 @@ void LoadInsertThread<T>::run()
     QString dbname = QString::number(intptr_t(QThread::currentThreadId()));
 
     SQLCreator::createSQLConnection(dbname);
+    SQLCreator::setThreadConnection(dbname);
     QSqlDatabase db = QSqlDatabase::database(dbname);
     QSqlQuery sql(db);
     sql.setForwardOnly(true);
@@ -71,6 +72,7 @@ void LoadInsertThread<T>::run()
 
     forever {
         if (finished) {
+            SQLCreator::setThreadConnection(QString());
             db.close();
             return;
         }
@@ -93,8 +95,12 @@ void LoadInsertThread<T>::run()
             emit processLoad(isSql() ? &sql : 0, q.data, q.query_type, q.w);
             q.w->emitSignal();
         } else {
-            if (dailyRunToProcess) {
-                dailyRunToProcess = false;
+            memberMutex.lock();
+            bool dailyRun = dailyRunToProcess;
+            dailyRunToProcess = false;
+            memberMutex.unlock();
+
+            if (dailyRun) {
                 emit processDailyRun(isSql() ? &sql : 0);
             } else {
                 memberMutex.lock();
@@ -125,9 +131,18 @@ void LoadInsertThread<T>::pushMember(const T &member, int desc)
 template <class T>
 void LoadInsertThread<T>::addDailyRun()
 {
+    memberMutex.lock();
+
+    /* Merged with the one already waiting: each release of the semaphore
+       must match something to process */
+    bool queued = !dailyRunToProcess;
     dailyRunToProcess = true;
 
-    sem.release(1);
+    memberMutex.unlock();
+
+    if (queued) {
+        sem.release(1);
+    }
 }
 
 template<class T>
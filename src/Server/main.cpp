@@ -16,6 +16,7 @@
 #ifndef _WIN32
 #include <execinfo.h>
 #endif
+#include <Utilities/asynclog.h>
 #include "server.h"
 #include "consolereader.h"
 
@@ -25,146 +26,24 @@ QString Server::dataRepo = QDir().absoluteFilePath(PO_DATA_REPO);
 
 #define SERVER_LOGGING
 
-#ifdef _WIN32
-# ifdef QT5
-void myMessageOutput(QtMsgType type, const QMessageLogContext&, const QString &msg)
-{
-    switch (type) {
-    case QtDebugMsg:
-        fprintf(stderr, "%s\n", msg.toLocal8Bit().data());
-        fflush(stderr);
-        break;
-    case QtWarningMsg:
-        fprintf(stderr, "Warning: %s\n", msg.toLocal8Bit().data());
-        break;
-    case QtCriticalMsg:
-        fprintf(stderr, "Critical: %s\n", msg.toLocal8Bit().data());
-        break;
-    case QtFatalMsg:
-        fprintf(stderr, "Fatal: %s\n", msg.toLocal8Bit().data());
-        abort();
-    }
-}
-# else
-void myMessageOutput(QtMsgType type, const char *msg)
-{
-    switch (type) {
-    case QtDebugMsg:
-        fprintf(stderr, "%s\n", msg);
-        fflush(stderr);
-        break;
-    case QtWarningMsg:
-        fprintf(stderr, "Warning: %s\n", msg);
-        break;
-    case QtCriticalMsg:
-        fprintf(stderr, "Critical: %s\n", msg);
-        break;
-    case QtFatalMsg:
-        fprintf(stderr, "Fatal: %s\n", msg);
-        abort();
-    }
-}
-# endif
-#else
-
-#ifdef SERVER_LOGGING
-int logcount = 0;
-int msgcount = 0;
-
-# ifdef QT5
-void myMessageOutput(QtMsgType type, const QMessageLogContext&, const QString &msg)
-{
-    msgcount += 1;
-    switch (type) {
-    case QtDebugMsg:
-        fprintf(stdout, "%s\n", msg.toLocal8Bit().data());
-        fprintf(stderr, "%s\n", msg.toLocal8Bit().data());
-        fflush(stderr);
-        break;
-    case QtWarningMsg:
-        fprintf(stdout, "Warning: %s\n", msg.toLocal8Bit().data());
-        fprintf(stderr, "Warning: %s\n", msg.toLocal8Bit().data());
-        break;
-    case QtCriticalMsg:
-        fprintf(stdout, "Warning: %s\n", msg.toLocal8Bit().data());
-        fprintf(stderr, "Critical: %s\n", msg.toLocal8Bit().data());
-        break;
-    case QtFatalMsg:
-        fprintf(stdout, "Warning: %s\n", msg.toLocal8Bit().data());
-        fprintf(stderr, "Fatal: %s\n", msg.toLocal8Bit().data());
-        abort();
-    }
-
-    /* Rotating log files */
-    if (msgcount > 20000) {
-        msgcount = 0;
-        logcount = (logcount + 1) % 25;
-
-        freopen(QString("logs%1.txt").arg(logcount).toUtf8().constData(), "w", stderr);
-        system(QString("echo " + QString("logs%1.txt").arg(logcount) + " > last_log_file.txt").toUtf8().constData());
-    }
-}
-# else
-void myMessageOutput(QtMsgType type, const char *msg)
-{
-    msgcount += 1;
-    switch (type) {
-    case QtDebugMsg:
-        fprintf(stdout, "%s\n", msg);
-        fprintf(stderr, "%s\n", msg);
-        fflush(stderr);
-        break;
-    case QtWarningMsg:
-        fprintf(stdout, "Warning: %s\n", msg);
-        fprintf(stderr, "Warning: %s\n", msg);
-        break;
-    case QtCriticalMsg:
-        fprintf(stdout, "Critical: %s\n", msg);
-        fprintf(stderr, "Critical: %s\n", msg);
-        break;
-    case QtFatalMsg:
-        fprintf(stdout, "Fatal: %s\n", msg);
-        fprintf(stderr, "Fatal: %s\n", msg);
-        abort();
-    }
-
-    if (msgcount > 20000) {
-        msgcount = 0;
-        logcount = (logcount + 1) % 25;
-
-        freopen(QString("logs%1.txt").arg(logcount).toUtf8().constData(), "w", stderr);
-        system(QString("echo " + QString("logs%1.txt").arg(logcount) + " > last_log_file.txt").toUtf8().constData());
-    }
-}
-# endif
-
-#endif
-#endif
-
 bool skipChecksOnStartUp = false;
 
 int main(int argc, char *argv[])
 {
     srand(time(NULL));
-#ifdef _WIN32
-    freopen("logs.txt", "a", stderr);
-
-# ifdef QT5
-    qInstallMessageHandler(myMessageOutput);
-# else
-    qInstallMsgHandler(myMessageOutput);
-# endif
-#else
-    //set_terminate( stacktrace );
 #ifdef SERVER_LOGGING
-    freopen("logs0.txt", "w", stderr);
-    system(QString("echo " + QString("logs%1.txt").arg(0) + " > last_log_file.txt").toUtf8().constData());
-# ifdef QT5
-    qInstallMessageHandler(myMessageOutput);
-# else
-    qInstallMsgHandler(myMessageOutput);
+    /* Written by another thread, see AsyncLog */
+    AsyncLog::Options logOptions;
+# ifdef _WIN32
+    logOptions.pattern = "logs.txt";
+    logOptions.files = 1;
+    logOptions.maxSize = 0;
+    logOptions.append = true;
+    logOptions.console = false;
+    logOptions.lastFile = QString();
 # endif
-#endif
+    AsyncLog::obj()->start(logOptions);
+    AsyncLog::install();
 #endif
 
     /* Names to use later for QSettings */
@@ -252,7 +131,7 @@ int main(int argc, char *argv[])
         }
     }
 
-    fprintf(stderr, "\n-----------------------\nNew Server, starting logs\n-----------------------\n\n");
+    qDebug() << "New Server, starting logs";
 
     if (ports.isEmpty()) {
         if (s.value("Network/Ports").isNull())
@@ -323,6 +202,8 @@ int main(int argc, char *argv[])
         qDebug() << "Caught Exception.";
     }*/
 
+    AsyncLog::obj()->stop();
+
     return 0;
 }
 
@@ -1,14 +1,41 @@
 #ifndef MEMORYHOLDER_H
 #define MEMORYHOLDER_H
 
+#include <list>
 #include <QtCore>
 #include "sql.h"
 
+/* Key compared without case. The folded hash is computed once on construction,
+   so that lookups neither lowercase the name nor allocate */
+struct FoldedKey
+{
+    FoldedKey(const QString &name) : name(name), hash(0) {
+        const QChar *c = name.constData();
+        for (int i = 0; i < name.length(); i++) {
+            hash = 31*hash + c[i].toCaseFolded().unicode();
+        }
+    }
+
+    bool operator == (const FoldedKey &other) const {
+        return hash == other.hash && name.compare(other.name, Qt::CaseInsensitive) == 0;
+    }
+
+    QString name;
+    uint hash;
+};
+
+inline uint qHash(const FoldedKey &key) {
+    return key.hash;
+}
+
+/* Cache of members loaded from the database, shared between the main thread
+   and the LoadInsertThread. It's split in shards with their own lock, each
+   shard evicting its least recently used members. */
 template <class Member>
 class MemoryHolder
 {
 public:
-    MemoryHolder(int cacheSize=10000) : cacheSize(cacheSize) {
+    MemoryHolder(int cacheSize=10000, int nonExistentTTL=10*60) : cacheSize(cacheSize), nonExistentTTL(nonExistentTTL) {
 
     }
 
@@ -19,10 +46,28 @@ public:
     bool isInMemory(const QString &name) const
     {
         if (isSql()) {
-            QString n2 = name.toLower();
+            FoldedKey key(name);
+            Shard &s = shard(key);
+
+            QMutexLocker lock(&s.mutex);
+            auto it = s.members.find(key);
+            if (it != s.members.end()) {
+                s.touch(it);
+                hits.ref();
+                return true;
+            }
 
-            QMutexLocker lock(&memberMutex);
-            return members.contains(n2) || nonExistentMembers.contains(n2);
+            auto it2 = s.nonExistentMembers.find(key);
+            if (it2 != s.nonExistentMembers.end()) {
+                if (it2.value() > QDateTime::currentMSecsSinceEpoch()) {
+                    hits.ref();
+                    return true;
+                }
+                s.nonExistentMembers.erase(it2);
+            }
+
+            misses.ref();
+            return false;
         } else {
             /* Always in memory now */
             return true;
@@ -32,15 +77,21 @@ public:
     void addMemberInMemory(const Member &m)
     {
         if (isSql()) {
-            memberMutex.lock();
+            FoldedKey key(m.name);
+            Shard &s = shard(key);
 
-            nonExistentMembers.remove(m.name);
-            if (!members.contains(m.name))
-                cachedMembersOrder.push_front(m.name);
+            QMutexLocker lock(&s.mutex);
 
-            members[m.name] = m;
+            s.nonExistentMembers.remove(key);
 
-            memberMutex.unlock();
+            auto it = s.members.find(key);
+            if (it != s.members.end()) {
+                it->member = m;
+                s.touch(it);
+            } else {
+                s.order.push_front(m.name);
+                s.members.insert(key, Entry(m, s.order.begin()));
+            }
         } else {
             return;
         }
@@ -49,95 +100,166 @@ public:
     /* Should only be called from the main thread */
     void cleanCache()
     {
-        cachedMembersMutex.lock();
+        int max = std::max(cacheSize / ShardCount, 1);
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
 
-        while(cachedMembersOrder.size() > cacheSize) {
-            removeMemberInMemory(cachedMembersOrder.takeLast());
-        }
+        for (int i = 0; i < ShardCount; i++) {
+            Shard &s = shards[i];
+            QMutexLocker lock(&s.mutex);
 
-        cachedMembersMutex.unlock();
+            while (s.members.size() > max) {
+                s.members.remove(s.order.back());
+                s.order.pop_back();
+                evictions.ref();
+            }
+
+            for (auto it = s.nonExistentMembers.begin(); it != s.nonExistentMembers.end(); ) {
+                if (it.value() <= now) {
+                    it = s.nonExistentMembers.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
     }
 
     /* Should only be called from the main thread */
     void clearCache()
     {
-        cachedMembersMutex.lock();
-        members.clear();
-        cachedMembersMutex.unlock();
+        for (int i = 0; i < ShardCount; i++) {
+            Shard &s = shards[i];
+            QMutexLocker lock(&s.mutex);
+
+            s.members.clear();
+            s.order.clear();
+            s.nonExistentMembers.clear();
+        }
     }
 
     /* Used for debugging purposes */
     int cachedMembersCount()
     {
-        QMutexLocker m(&cachedMembersMutex);
-
-        return cachedMembersOrder.size();
+        int count = 0;
+        for (int i = 0; i < ShardCount; i++) {
+            QMutexLocker lock(&shards[i].mutex);
+            count += shards[i].members.size();
+        }
+        return count;
     }
 
     int cachedNonExistingCount()
     {
-        QMutexLocker m(&memberMutex);
+        int count = 0;
+        for (int i = 0; i < ShardCount; i++) {
+            QMutexLocker lock(&shards[i].mutex);
+            count += shards[i].nonExistentMembers.size();
+        }
+        return count;
+    }
+
+    int cacheHits() const {
+        return hits.load();
+    }
+
+    int cacheMisses() const {
+        return misses.load();
+    }
 
-        return nonExistentMembers.size();
+    int cacheEvictions() const {
+        return evictions.load();
     }
 
     void removeMemberInMemory(const QString &name)
     {
-        memberMutex.lock();
+        FoldedKey key(name);
+        Shard &s = shard(key);
 
-        members.remove(name);
+        QMutexLocker lock(&s.mutex);
 
-        memberMutex.unlock();
+        auto it = s.members.find(key);
+        if (it != s.members.end()) {
+            s.order.erase(it->pos);
+            s.members.erase(it);
+        }
     }
 
     void addNonExistant(const QString &name)
     {
-        memberMutex.lock();
+        FoldedKey key(name);
+        Shard &s = shard(key);
 
-        nonExistentMembers.insert(name.toLower());
+        QMutexLocker lock(&s.mutex);
 
-        memberMutex.unlock();
+        s.nonExistentMembers.insert(key, QDateTime::currentMSecsSinceEpoch() + nonExistentTTL*1000);
     }
 
     /* Precondition: the member must be in memory, otherwise returns false in all cases. */
     bool exists(const QString &name) const
     {
-        QString n2 = name.toLower();
+        FoldedKey key(name);
+        Shard &s = shard(key);
 
-        {
-            QMutexLocker m(&memberMutex);
+        QMutexLocker lock(&s.mutex);
+        return s.members.contains(key);
+    }
 
-            if (members.contains(n2)) {
-                return true;
-            }
-            else {
-                return false;
-            }
+    Member member (const QString &name) const {
+        FoldedKey key(name);
+        Shard &s = shard(key);
 
-            //            if (nonExistentMembers.contains(n2))
-            //                return false;
+        {
+            QMutexLocker lock(&s.mutex);
+            auto it = s.members.find(key);
+            if (it != s.members.end()) {
+                s.touch(it);
+                return it->member;
+            }
         }
+
+        qDebug() << "Critical! Unreachable code reached! Name " << name << " doesn't exist.";
+        return Member(name.toLower());
     }
 
-    Member member (const QString &name2) const {
-        QString name = name2.toLower();
+protected:
+    enum {
+        ShardCount = 16 /* Must be a power of 2 */
+    };
+
+    struct Entry {
+        Entry(const Member &m = Member(), typename std::list<QString>::iterator pos = typename std::list<QString>::iterator())
+            : member(m), pos(pos) {
 
-        if (exists(name)) {
-            QMutexLocker m(&memberMutex);
-            return members.value(name);
         }
 
-        qDebug() << "Critical! Unreachable code reached! Name " << name << " doesn't exist.";
-        return Member(name);
+        Member member;
+        /* Position in the recently used list */
+        typename std::list<QString>::iterator pos;
+    };
+
+    struct Shard {
+        QHash<FoldedKey, Entry> members;
+        /* Value is the expiry time of the entry, in msecs since epoch */
+        QHash<FoldedKey, qint64> nonExistentMembers;
+        /* Most recently used first */
+        std::list<QString> order;
+        QMutex mutex;
+
+        /* Precondition: mutex is locked */
+        void touch(typename QHash<FoldedKey, Entry>::iterator it) {
+            order.splice(order.begin(), order, it->pos);
+        }
+    };
+
+    Shard &shard(const FoldedKey &key) const {
+        return shards[key.hash & (ShardCount-1)];
     }
 
-protected:
-    QHash<QString, Member> members;
-    QSet<QString> nonExistentMembers;
-    mutable QMutex memberMutex;
-    QLinkedList<QString> cachedMembersOrder;
-    mutable QMutex cachedMembersMutex;
+    mutable Shard shards[ShardCount];
     int cacheSize;
+    /* In seconds */
+    int nonExistentTTL;
+
+    mutable QAtomicInt hits, misses, evictions;
 };
 
 #endif // MEMORYHOLDER_H
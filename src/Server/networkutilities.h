@@ -2,6 +2,7 @@
 #define NETWORKUTILITIES_H
 
 #include <Utilities/coreclasses.h>
+#include <Utilities/packetbuilder.h>
 
 template <typename ...Params>
 QByteArray makeZipPacket(int command, Params&&... params) {
@@ -28,18 +29,7 @@ QByteArray makeZipPacket(int command, Params&&... params) {
 
 template <typename ...Params>
 QByteArray makePacket(int command, Params&&... params) {
-    QByteArray ret(4, Qt::Uninitialized);
-    DataStream out(&ret, QIODevice::Append);
-
-    out.pack(uchar(command), std::forward<Params>(params)...);
-
-    const int l = ret.length()-4;
-    ret[0] = l >> (3*8);
-    ret[1] = l >> (2*8);
-    ret[2] = l >> 8;
-    ret[3] = l;
-
-    return ret;
+    return PacketBuilder::packFramed(0, uchar(command), std::forward<Params>(params)...);
 }
 
 
@@ -1,6 +1,7 @@
 #include "../Shared/config.h"
 #include <PokemonInfo/battlestructs.h>
 #include <PokemonInfo/pokemoninfo.h>
+#include <Utilities/connectiontable.h>
 
 #include "relaymanager.h"
 #include "player.h"
@@ -59,45 +60,50 @@ void Player::doConnections()
       a script sends a message to the client.
 
       If that happens we want the disconnect signal to happen after the script function*/
-    connect(&relay(), SIGNAL(disconnected()), SLOT(disconnected()), Qt::QueuedConnection);
-    connect(&relay(), SIGNAL(loggedIn(LoginInfo*)), SLOT(loggedIn(LoginInfo*)));
-    connect(&relay(), SIGNAL(logout()), SLOT(logout()));
-    connect(&relay(), SIGNAL(serverPasswordSent(const QByteArray&)), SLOT(serverPasswordSent(const QByteArray&)));
-    connect(&relay(), SIGNAL(messageReceived(int, QString)), SLOT(recvMessage(int, QString)));
-    connect(&relay(), SIGNAL(playerDataRequested(int)), SLOT(recvPlayerDataRequest(int)));
-    connect(&relay(), SIGNAL(teamChanged(const ChangeTeamInfo&)), SLOT(recvTeam(const ChangeTeamInfo&)));
-    connect(&relay(), SIGNAL(challengeStuff(ChallengeInfo)), SLOT(challengeStuff(ChallengeInfo)));
-    connect(&relay(), SIGNAL(forfeitBattle(int)), SLOT(battleForfeited(int)));
-    connect(&relay(), SIGNAL(battleMessage(int,BattleChoice)), SLOT(battleMessage(int,BattleChoice)));
-    connect(&relay(), SIGNAL(battleChat(int,QString)), SLOT(battleChat(int,QString)));
-    connect(&relay(), SIGNAL(sentHash(QByteArray)), SLOT(hashReceived(QByteArray)));
-    connect(&relay(), SIGNAL(wannaRegister()), SLOT(registerRequest()));
-    connect(&relay(), SIGNAL(kick(int)), SLOT(playerKick(int)));
-    connect(&relay(), SIGNAL(ban(int)), SLOT(playerBan(int)));
-    connect(&relay(), SIGNAL(tempBan(int,int)), SLOT(playerTempBan(int,int)));
-    connect(&relay(), SIGNAL(banRequested(QString,int)), SLOT(CPBan(QString,int)));
-    connect(&relay(), SIGNAL(unbanRequested(QString)), SLOT(CPUnban(QString)));
-    connect(&relay(), SIGNAL(PMsent(int,QString)), SLOT(receivePM(int,QString)));
-    connect(&relay(), SIGNAL(getUserInfo(QString)), SLOT(userInfoAsked(QString)));
-    connect(&relay(), SIGNAL(banListRequested()), SLOT(giveBanList()));
-    connect(&relay(), SIGNAL(awayChange(bool)), SLOT(awayChange(bool)));
-    connect(&relay(), SIGNAL(battleSpectateRequested(int)), SLOT(spectatingRequested(int)));
-    connect(&relay(), SIGNAL(battleSpectateEnded(int)), SLOT(quitSpectating(int)));
-    connect(&relay(), SIGNAL(battleSpectateChat(int,QString)), SLOT(spectatingChat(int,QString)));
-    connect(&relay(), SIGNAL(ladderChange(bool)), SLOT(ladderChange(bool)));
-    connect(&relay(), SIGNAL(tierChanged(quint8,QString)), SLOT(changeTier(quint8,QString)));
-    connect(&relay(), SIGNAL(findBattle(FindBattleData)), SLOT(findBattle(FindBattleData)));
-    connect(&relay(), SIGNAL(showRankings(QString,int)), SLOT(getRankingsByPage(QString, int)));
-    connect(&relay(), SIGNAL(showRankings(QString,QString)), SLOT(getRankingsByName(QString, QString)));
-    connect(&relay(), SIGNAL(showRankings(int)), SLOT(getRankingsForPlayer(int)));
-    connect(&relay(), SIGNAL(joinRequested(QString)), SLOT(joinRequested(QString)));
-    connect(&relay(), SIGNAL(leaveChannel(int)), SLOT(leaveRequested(int)));
-    connect(&relay(), SIGNAL(ipChangeRequested(QString)), SLOT(ipChangeRequested(QString)));
-    connect(&relay(), SIGNAL(endCommand()), SLOT(sendUpdatedIfNeeded()));
-    connect(&relay(), SIGNAL(reconnect(int,QByteArray)), SLOT(onReconnect(int,QByteArray)));
+    static const ConnectionTable fromRelay = ConnectionTable(&Analyzer::staticMetaObject, &Player::staticMetaObject)
+        .add(SIGNAL(disconnected()), SLOT(disconnected()), Qt::QueuedConnection)
+        .add(SIGNAL(loggedIn(LoginInfo*)), SLOT(loggedIn(LoginInfo*)))
+        .add(SIGNAL(logout()), SLOT(logout()))
+        .add(SIGNAL(serverPasswordSent(const QByteArray&)), SLOT(serverPasswordSent(const QByteArray&)))
+        .add(SIGNAL(messageReceived(int, QString)), SLOT(recvMessage(int, QString)))
+        .add(SIGNAL(playerDataRequested(QVector<qint32>)), SLOT(recvPlayerDataRequest(QVector<qint32>)))
+        .add(SIGNAL(teamChanged(const ChangeTeamInfo&)), SLOT(recvTeam(const ChangeTeamInfo&)))
+        .add(SIGNAL(challengeStuff(ChallengeInfo)), SLOT(challengeStuff(ChallengeInfo)))
+        .add(SIGNAL(forfeitBattle(int)), SLOT(battleForfeited(int)))
+        .add(SIGNAL(battleMessage(int,BattleChoice)), SLOT(battleMessage(int,BattleChoice)))
+        .add(SIGNAL(battleChat(int,QString)), SLOT(battleChat(int,QString)))
+        .add(SIGNAL(sentHash(QByteArray)), SLOT(hashReceived(QByteArray)))
+        .add(SIGNAL(wannaRegister()), SLOT(registerRequest()))
+        .add(SIGNAL(kick(int)), SLOT(playerKick(int)))
+        .add(SIGNAL(ban(int)), SLOT(playerBan(int)))
+        .add(SIGNAL(tempBan(int,int)), SLOT(playerTempBan(int,int)))
+        .add(SIGNAL(banRequested(QString,int)), SLOT(CPBan(QString,int)))
+        .add(SIGNAL(unbanRequested(QString)), SLOT(CPUnban(QString)))
+        .add(SIGNAL(PMsent(int,QString)), SLOT(receivePM(int,QString)))
+        .add(SIGNAL(getUserInfo(QString)), SLOT(userInfoAsked(QString)))
+        .add(SIGNAL(banListRequested()), SLOT(giveBanList()))
+        .add(SIGNAL(awayChange(bool)), SLOT(awayChange(bool)))
+        .add(SIGNAL(battleSpectateRequested(int)), SLOT(spectatingRequested(int)))
+        .add(SIGNAL(battleSpectateEnded(int)), SLOT(quitSpectating(int)))
+        .add(SIGNAL(battleSpectateChat(int,QString)), SLOT(spectatingChat(int,QString)))
+        .add(SIGNAL(ladderChange(bool)), SLOT(ladderChange(bool)))
+        .add(SIGNAL(tierChanged(quint8,QString)), SLOT(changeTier(quint8,QString)))
+        .add(SIGNAL(findBattle(FindBattleData)), SLOT(findBattle(FindBattleData)))
+        .add(SIGNAL(showRankings(QString,int)), SLOT(getRankingsByPage(QString, int)))
+        .add(SIGNAL(showRankings(QString,QString)), SLOT(getRankingsByName(QString, QString)))
+        .add(SIGNAL(showRankings(int)), SLOT(getRankingsForPlayer(int)))
+        .add(SIGNAL(joinRequested(QString)), SLOT(joinRequested(QString)))
+        .add(SIGNAL(leaveChannel(int)), SLOT(leaveRequested(int)))
+        .add(SIGNAL(ipChangeRequested(QString)), SLOT(ipChangeRequested(QString)))
+        .add(SIGNAL(endCommand()), SLOT(sendUpdatedIfNeeded()))
+        .add(SIGNAL(reconnect(int,QByteArray)), SLOT(onReconnect(int,QByteArray)));
 
     /* To avoid threading / simulateneous calls problems, it's queued */
-    connect(this, SIGNAL(unlocked()), &relay(), SLOT(undelay()),Qt::QueuedConnection);
+    static const ConnectionTable toRelay = ConnectionTable(&Player::staticMetaObject, &Analyzer::staticMetaObject)
+        .add(SIGNAL(unlocked()), SLOT(undelay()), Qt::QueuedConnection);
+
+    fromRelay.connect(&relay(), this);
+    toRelay.connect(this, &relay());
 }
 
 void Player::autoKick()
@@ -311,12 +317,17 @@ void Player::doWhenRC(bool wasLoggedIn)
     if (!wasLoggedIn)
     {
         /* make acquaintances again! */
+        Server::serverIns->flushPlayerUpdates(id());
+        QVector<reference<PlayerInfo> > bundles;
         foreach(Player *p, knowledge) {
             if (p->isLoggedIn()) {
+                Server::serverIns->flushPlayerUpdates(p->id());
                 p->relay().notify(NetworkServ::PlayersList, bundle());
-                relay().notify(NetworkServ::PlayersList, p->bundle());
+                bundles.push_back(&p->bundle());
             }
         }
+        /* All in one packet */
+        sendPlayers(bundles);
 
         QSet<int> channelsCopy = channels;
         channels.clear();
@@ -372,6 +383,16 @@ void Player::doWhenDQ()
     }
     knowledge.clear();
 
+    foreach(Player *p, infoHolders) {
+        p->forgetInfoOf(this);
+    }
+    foreach(int pid, infoSent) {
+        if (Server::serverIns->playerExist(pid)) {
+            forgetInfoOf(Server::serverIns->player(pid));
+        }
+    }
+    infoSent.clear();
+
     foreach(int channel, channels) {
         emit leaveRequested(this->id(), channel);
     }
@@ -597,15 +618,25 @@ void Player::recvMessage(int chan, const QString &mess)
 }
 
 /**
-  Sends the player info of the requested id to the player
+  Sends the player info of the requested ids to the player, in one packet
   */
-void Player::recvPlayerDataRequest(int pid)
+void Player::recvPlayerDataRequest(const QVector<qint32> &ids)
 {
     if (!isLoggedIn()) {
         return;
     }
-    if (Server::serverIns->playerLoggedIn(pid)) {
-        relay().sendPlayer(Server::serverIns->player(pid)->bundle());
+
+    QVector<reference<PlayerInfo> > bundles;
+    foreach(qint32 pid, ids) {
+        if (Server::serverIns->playerLoggedIn(pid)) {
+            Server::serverIns->flushPlayerUpdates(pid);
+            bundles.push_back(&Server::serverIns->player(pid)->bundle());
+            gotInfoOf(Server::serverIns->player(pid));
+        }
+    }
+
+    if (!bundles.empty()) {
+        sendPlayers(bundles);
     }
 }
 
@@ -966,6 +997,11 @@ bool Player::supportsZip() const
     return spec()[SupportsZipCompression];
 }
 
+Analyzer *Player::bundlingRelay()
+{
+    return supportsZip() ? &relay() : NULL;
+}
+
 bool Player::hasTier(const QString &tier) const
 {
     return tiers.contains(tier);
@@ -1079,6 +1115,8 @@ void Player::associateWith(Player *other)
     if (loginInfo()) {
         relay().setVersion(loginInfo()->version);
     }
+    /* The client starts a new stream with the new connection */
+    relay().setStreamCompression(spec()[StreamCompression]);
     relay().setId(id());
     relay().disconnect(other);
     other->disconnect(&relay());
@@ -1131,6 +1169,10 @@ void Player::loggedIn(LoginInfo *info)
     spec().setFlag(ReconnectEnabled, info->network[NetworkServ::LoginCommand::HasReconnect]);
     spec().setFlag(HasRegisterCheck, info->data[PlayerFlags::HasRegisterCheck]);
     spec().setFlag(WantsHTML, info->data[PlayerFlags::WantsHTML]);
+    spec().setFlag(StreamCompression, info->data[PlayerFlags::SupportsStreamCompression]);
+    relay().setStreamCompression(spec()[StreamCompression]);
+    spec().setFlag(SupportsPlayerDelta, info->data[PlayerFlags::SupportsPlayerDelta]);
+    spec().setFlag(LazyPlayerInfo, info->data[PlayerFlags::LazyPlayerInfo]);
     state().setFlag(LadderEnabled, info->data[PlayerFlags::LadderEnabled]);
     state().setFlag(Away, info->data[PlayerFlags::Idle]);
     reconnectBits() = info->reconnectBits;
@@ -1267,10 +1309,36 @@ bool Player::hasKnowledgeOf(Player *other) const
     return knowledge.contains(other);
 }
 
+bool Player::hasInfoOf(int pid) const
+{
+    return !spec()[LazyPlayerInfo] || pid == id() || infoSent.contains(pid);
+}
+
+void Player::gotInfoOf(Player *other)
+{
+    if (spec()[LazyPlayerInfo] && other != this) {
+        infoSent.insert(other->id());
+        other->infoHolders.insert(this);
+    }
+}
+
+void Player::forgetInfoOf(Player *other)
+{
+    infoSent.remove(other->id());
+    other->infoHolders.remove(this);
+}
+
 void Player::acquireKnowledgeOf(Player *other) {
-    if (!isInSameChannel(other)) {
+    bool sameChannel = isInSameChannel(other);
+    Server::serverIns->flushPlayerUpdates(id());
+    Server::serverIns->flushPlayerUpdates(other->id());
+    if (!sameChannel || !hasInfoOf(other->id())) {
         relay().sendPlayer(other->bundle());
+        gotInfoOf(other);
+    }
+    if (!sameChannel || !other->hasInfoOf(id())) {
         other->relay().sendPlayer(bundle());
+        other->gotInfoOf(this);
     }
     knowledge.insert(other);
     other->knowledge.insert(this);
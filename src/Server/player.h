@@ -40,6 +40,8 @@ class Player : public QObject, public PlayerInterface
     PROPERTY(QString, os)
     PROPERTY(LoginInfo*, loginInfo)
     PROPERTY(int, lastBattle)
+    /* The info as the players in the same channels last got it */
+    PROPERTY(PlayerInfo, sentBundle)
 public:
     enum State
     {
@@ -59,7 +61,10 @@ public:
         IdsWithMessage,
         ReconnectEnabled,
         HasRegisterCheck,
-        WantsHTML
+        WantsHTML,
+        StreamCompression,
+        SupportsPlayerDelta,
+        LazyPlayerInfo
     };
 
     QSet<int> battlesSpectated;
@@ -105,7 +110,15 @@ public:
     bool isLoggedIn() const;
     bool battling() const;
     bool supportsZip() const;
+    /* The relay, if what is sent to the player can be bundled (see BundleGuard) */
+    Analyzer *bundlingRelay();
     bool hasKnowledgeOf(Player *other) const;
+    /* Whether the client has the info of that player. Always true for the
+       clients that aren't in lazy mode (LazyPlayerInfo), they get the info of
+       everyone in their channels */
+    bool hasInfoOf(int pid) const;
+    void gotInfoOf(Player *other);
+    void forgetInfoOf(Player *other);
     void acquireKnowledgeOf(Player *other);
     void acquireRoughKnowledgeOf(Player *other);
     void addChannel(int chanid);
@@ -217,7 +230,7 @@ public slots:
     void loggedIn(LoginInfo *info);
     void serverPasswordSent(const QByteArray &hash);
     void recvMessage(int chan, const QString &mess);
-    void recvPlayerDataRequest(int pid);
+    void recvPlayerDataRequest(const QVector<qint32> &ids);
     void recvTeam(const ChangeTeamInfo &info);
     void disconnected();
     void challengeStuff(const ChallengeInfo &c);
@@ -314,6 +327,11 @@ private:
        could save bandwidth.
     */
     QSet<Player*> knowledge;
+    /* In lazy mode, the players whose info was sent, see hasInfoOf() */
+    QSet<int> infoSent;
+    /* The other way: the lazy players that have the info of this one, whatever
+       their channels, so that all of them forget it when this one leaves */
+    QSet<Player*> infoHolders;
 
     /* The channels a player is on */
     QSet<int> channels;
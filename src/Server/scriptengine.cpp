@@ -1110,14 +1110,17 @@ QScriptValue ScriptEngine::memoryDump()
     QString ret;
 
     ret += QString("Members\n\tCached in memory> %1\n\tCached as non-existing> %2\n").arg(SecurityManager::holder.cachedMembersCount()).arg(SecurityManager::holder.cachedNonExistingCount());
+    ret += QString("\tCache hits> %1\n\tCache misses> %2\n\tCache evictions> %3\n").arg(SecurityManager::holder.cacheHits()).arg(SecurityManager::holder.cacheMisses()).arg(SecurityManager::holder.cacheEvictions());
     ret += QString("Waiting Objects\n\tFree Objects> %1\n\tTotal Objects> %2\n").arg(WaitingObjects::freeObjects.count()).arg(WaitingObjects::objectCount);
     ret += QString("Battles\n\tActive> %1\n\tRated Battles History> %2\n").arg(myserver->battles->count()).arg(myserver->lastRatedIps.count());
+    ret += myserver->battles->shardReport();
     ret += AntiDos::obj()->dump();
     ret += QString("-------------------------\n-------------------------\n");
 
     foreach (QString tier, TierMachine::obj()->tierList().split('\n')) {
         const Tier &t = TierMachine::obj()->tier(tier);
         ret += QString("Tier %1\n\tCached in memory> %2\n\tCached as non-existing> %3\n").arg(tier).arg(t.holder.cachedMembersCount()).arg(t.holder.cachedNonExistingCount());
+        ret += QString("\tCache hits> %1\n\tCache misses> %2\n\tCache evictions> %3\n").arg(t.holder.cacheHits()).arg(t.holder.cacheMisses()).arg(t.holder.cacheEvictions());
     }
 
     return ret;
@@ -2812,6 +2815,11 @@ void ScriptEngine::removeTrustedIp(const QString &ip)
     myserver->trustedIpsChanged(trustedIps.join(","));
 }
 
+void ScriptEngine::setMaxChatLines(int linesPerSecond)
+{
+    myserver->setMaxChatLines(std::max(linesPerSecond, 0));
+}
+
 void ScriptEngine::makeServerPublic(bool isPublic)
 {
     int privacy = (isPublic ? 0 : 1);
@@ -188,6 +188,9 @@ public:
     Q_INVOKABLE void removeTrustedIp(const QString &ip);
 
     Q_INVOKABLE void makeServerPublic(bool isPublic);
+    /* Lines per second in a channel past which the lines of players without auth are
+       dropped, 0 for no limit. Only until the restart, the config isn't changed */
+    Q_INVOKABLE void setMaxChatLines(int linesPerSecond);
 
     /* Prevents the event from happening.
        For exemple, if called in 'beforeChatMessage', the message won't appear.
@@ -11,12 +11,17 @@
 #include "server.h"
 #include "waitingobject.h"
 #include "loadinsertthread.h"
+#include "bulktransfer.h"
 
 MemoryHolder<SecurityManager::Member>  SecurityManager::holder;
 QNickValidator SecurityManager::val(nullptr);
 QHash<QString, unsigned int> SecurityManager::bannedIPs;
 QHash<QString, std::pair<QString, int> > SecurityManager::bannedMembers;
 int SecurityManager::dailyRunDays = 182;
+bool SecurityManager::dailyRunning = false;
+QString SecurityManager::dailyRunLimit;
+int SecurityManager::dailyRunPos = 0;
+int SecurityManager::dailyRunEnd = 0;
 
 LoadInsertThread<SecurityManager::Member> * SecurityManager::thread = nullptr;
 
@@ -118,60 +123,32 @@ void SecurityManager::loadSqlMembers() {
                 throw QObject::tr("Error: cannot open the file that contains the members ");
             }
 
-            clock_t t = clock();
+            memberFile.close();
 
-            query.prepare("insert into trainers(name, laston, auth,  banned, salt, hash, ip, ban_expire_time) values (:name, :laston, :auth,"
-                          ":banned, :salt, :hash, :ip, :banexpire)");
+            BulkTransfer::importFile(memberFile.fileName(), "trainers", memberColumns(), [](const QByteArray &line, BulkTransfer::Row &row) {
+                QList<QByteArray> ls = line.split('%');
 
-            QSqlDatabase::database().transaction();
-            int counter = 0;
-            while (!memberFile.atEnd()) {
-                if (query.lastError().isValid() && counter > 0) {
-                    Server::print(QString("Error in last query (number %1): %2").arg(counter).arg(query.lastError().text()));
-                    break;
+                if (ls.size() < 6 || ls[2].size() < 2) {
+                    return false;
                 }
 
-                ++counter;
-
-                if (counter % 1000 == 0) {
-                    Server::print(QString("Loaded %1 members so far...").arg(counter));
+                QString name = QString::fromUtf8(ls[0]);
+                if (!isValid(name)) {
+                    return false;
                 }
 
-                QByteArray arr = memberFile.readLine();
-                QString s = QString::fromUtf8(arr.constData(), std::max(0,arr.length()-1)); //-1 to remove the \n
-
-                QStringList ls = s.split('%');
-
-                if (ls.size() >= 6 && isValid(ls[0])) {
-                    query.bindValue(":name", ls[0].toLower());
-                    query.bindValue(":laston",ls[1]);
-                    query.bindValue(":auth", ls[2][0].toLatin1()-'0');
-                    query.bindValue(":banned", ls[2][1] == '1');
-                    /* Weirdly, i seem to have problems when updating something that has a salt containing \, probably postgresql driver,
-                       so i remove them. */
-                    if (!ls[3].contains('\\')) {
-                        query.bindValue(":salt", ls[3].trimmed().toLatin1());
-                        query.bindValue(":hash", ls[4].trimmed().toLatin1());
-                    } else {
-                        query.bindValue(":salt", "");
-                        query.bindValue(":hash", "");
-                    }
-                    query.bindValue(":ip", ls[5].trimmed());
-                    if (ls.size() >= 7) {
-                        query.bindValue(":banexpire", ls[6]);
-                    } else {
-                        query.bindValue(":banexpire", 0);
-                    }
-                    query.exec();
+                row << name.toLower() << QString::fromUtf8(ls[1]) << ls[2][0] - '0' << (ls[2][1] == '1');
+                /* Weirdly, i seem to have problems when updating something that has a salt containing \, probably postgresql driver,
+                   so i remove them. */
+                if (!ls[3].contains('\\')) {
+                    row << ls[3].trimmed() << ls[4].trimmed();
+                } else {
+                    row << QByteArray() << QByteArray();
                 }
-            }
-
-            QSqlDatabase::database().commit();
+                row << QString::fromUtf8(ls[5].trimmed()) << (ls.size() >= 7 ? ls[6].toInt() : 0);
 
-            t = clock() - t;
-
-            Server::print(QString::number(float(t)/CLOCKS_PER_SEC) + " secs");
-            Server::print(query.lastError().text());
+                return true;
+            });
         }
     }
 
@@ -290,7 +267,7 @@ void SecurityManager::init()
 
     connect(thread, SIGNAL(processLoad(QSqlQuery*, QVariant, int, WaitingObject*)), instance, SLOT(loadMember(QSqlQuery*, QVariant,int)), Qt::DirectConnection);
     connect(thread, SIGNAL(processWrite(QSqlQuery*, void*,int)), instance, SLOT(insertMember(QSqlQuery*, void*,int)), Qt::DirectConnection);
-    connect(thread, SIGNAL(processDailyRun(QSqlQuery*)), instance, SLOT(dailyRunEx(QSqlQuery*)));
+    connect(thread, SIGNAL(processDailyRun(QSqlQuery*)), instance, SLOT(dailyRunEx(QSqlQuery*)), Qt::DirectConnection);
 
     thread->start();
 
@@ -337,16 +314,10 @@ SecurityManager::Member SecurityManager::member(const QString &name)
 QStringList SecurityManager::membersForIp(const QString &ip)
 {
     if (isSql()) {
-        QSqlQuery q;
-        q.setForwardOnly(true);
-
-        if (SQLCreator::databaseType == SQLCreator::SQLite) {
-            /* On SQLite, there's some bug with the qt driver probably,
-                but here it oftens return nothing if i use '=' instead of 'like', so... */
-            q.prepare("select name from trainers where ip like ?");
-        } else {
-            q.prepare("select name from trainers where ip=?");
-        }
+        /* On SQLite, there's some bug with the qt driver probably,
+            but here it oftens return nothing if i use '=' instead of 'like', so... */
+        QSqlQuery &q = SQLCreator::statement(SQLCreator::databaseType == SQLCreator::SQLite ?
+                                                 "select name from trainers where ip like ?" : "select name from trainers where ip=?");
         q.addBindValue(ip);
         q.exec();
 
@@ -355,6 +326,7 @@ QStringList SecurityManager::membersForIp(const QString &ip)
         while (q.next()) {
             ret.push_back(q.value(0).toString());
         }
+        q.finish();
 
         return ret;
     }
@@ -369,15 +341,14 @@ QHash<QString, std::pair<QString, int> > SecurityManager::banList()
 QStringList SecurityManager::authList()
 {
     if (isSql()) {
-        QSqlQuery q;
-        q.setForwardOnly(true);
-
-        q.exec("select name from trainers where auth>0");
+        QSqlQuery &q = SQLCreator::statement("select name from trainers where auth>0");
+        q.exec();
 
         QStringList ret;
         while (q.next()) {
             ret.push_back(q.value(0).toString());
         }
+        q.finish();
 
         return ret;
     }
@@ -389,14 +360,13 @@ QStringList SecurityManager::userList()
     QStringList ret;
 
     if (isSql()) {
-        QSqlQuery q;
-        q.setForwardOnly(true);
-
-        q.exec("select name from trainers");
+        QSqlQuery &q = SQLCreator::statement("select name from trainers");
+        q.exec();
 
         while (q.next()) {
             ret.push_back(q.value(0).toString());
         }
+        q.finish();
     } else {
         for(auto it = members.begin(); it != members.end(); ++it) {
             ret.push_back(it->first);
@@ -409,11 +379,13 @@ QStringList SecurityManager::userList()
 void SecurityManager::deleteUser(const QString &name)
 {
     if (isSql()) {
-        QSqlQuery q;
-        q.setForwardOnly(true);
-        q.prepare("delete from trainers where name=:name");
-        q.bindValue(":name", name.toLower());
-        q.exec();
+        QString lower = name.toLower();
+
+        /* In the same queue as the inserts, so that a name registered again
+           right after isn't deleted */
+        thread->pushMember(Member(lower), DeleteMember);
+        holder.removeMemberInMemory(lower);
+        holder.addNonExistant(lower);
         return;
     }
 
@@ -447,7 +419,7 @@ void SecurityManager::updateMemberInDatabase(const Member &m, bool add)
     bool update = !add;
 
     if (isSql()) {
-        thread->pushMember(m, update);
+        thread->pushMember(m, update ? UpdateMember : InsertMember);
     } else {
         /* Can't write in a threaded manner, because can't update memory in a threaded manner and update filepos in a threaded
          * manner. Could with mutexes */
@@ -534,22 +506,19 @@ int SecurityManager::auth(const QString &name)
 int SecurityManager::numRegistered(const QString &ip)
 {
     if (isSql()) {
-        QSqlQuery q;
-        q.setForwardOnly(true);
-
-        if (SQLCreator::databaseType == SQLCreator::SQLite) {
-            /* On SQLite, there's some bug with the qt driver probably,
-                    but here it oftens return nothing if i use '=' instead of 'like', so... */
-            q.prepare("select count(*) from trainers where length(hash) > 0 and ip like ?");
-        } else {
-            q.prepare("select count(*) from trainers where length(hash) > 0 and ip=?");
-        }
+        /* On SQLite, there's some bug with the qt driver probably,
+                but here it oftens return nothing if i use '=' instead of 'like', so... */
+        QSqlQuery &q = SQLCreator::statement(SQLCreator::databaseType == SQLCreator::SQLite ?
+                                                 "select count(*) from trainers where length(hash) > 0 and ip like ?" :
+                                                 "select count(*) from trainers where length(hash) > 0 and ip=?");
 
         q.addBindValue(ip);
         q.exec();
 
-        q.next();
-        return q.value(0).toInt();
+        int ret = q.next() ? q.value(0).toInt() : 0;
+        q.finish();
+
+        return ret;
     }
 
     int ret = 0;
@@ -665,22 +634,30 @@ void SecurityManager::insertMember(QSqlQuery *q, void *m2, int update)
     SecurityManager::Member &m = * (SecurityManager::Member*) m2;
 
     if (isSql()) {
-        if (update)
-            q->prepare("update trainers set laston=:laston, auth=:auth, banned=:banned, salt=:salt, hash=:hash, ip=:ip, ban_expire_time=:banexpire where name=:name");
-        else
-            q->prepare("insert into trainers(name, laston, auth, banned, salt, hash, ip, ban_expire_time) values(:name, :laston, :auth, :banned, :salt, :hash, :ip, :banexpire)");
-
-        q->bindValue(":name", m.name.toLower());
-        q->bindValue(":laston", m.date);
-        q->bindValue(":auth", m.auth);
-        q->bindValue(":banned", m.banned);
-        q->bindValue(":hash", m.hash);
-        q->bindValue(":salt", m.salt);
-        q->bindValue(":ip", m.ip);
-        q->bindValue(":banexpire", m.ban_expire_time);
-
-        q->exec();
-        q->finish();
+        if (update == DeleteMember) {
+            QSqlQuery &query = SQLCreator::statement("delete from trainers where name=:name");
+            query.bindValue(":name", m.name);
+            query.exec();
+            query.finish();
+
+            return;
+        }
+
+        QSqlQuery &query = SQLCreator::statement(update ?
+            "update trainers set laston=:laston, auth=:auth, banned=:banned, salt=:salt, hash=:hash, ip=:ip, ban_expire_time=:banexpire where name=:name" :
+            "insert into trainers(name, laston, auth, banned, salt, hash, ip, ban_expire_time) values(:name, :laston, :auth, :banned, :salt, :hash, :ip, :banexpire)");
+
+        query.bindValue(":name", m.name.toLower());
+        query.bindValue(":laston", m.date);
+        query.bindValue(":auth", m.auth);
+        query.bindValue(":banned", m.banned);
+        query.bindValue(":hash", m.hash);
+        query.bindValue(":salt", m.salt);
+        query.bindValue(":ip", m.ip);
+        query.bindValue(":banexpire", m.ban_expire_time);
+
+        query.exec();
+        query.finish();
 
         return;
     }
@@ -722,17 +699,17 @@ void SecurityManager::loadMember(QSqlQuery *q, const QVariant &name, int query_t
     }
 
     if (query_type == SecurityManager::GetInfoOnUser) {
-        q->prepare("select laston, auth, banned, salt, hash, ip, ban_expire_time from trainers where name=:name limit 1");
-        q->bindValue(":name", name.toString().toLower());
-        q->exec();
-        if (!q->next()) {
+        QSqlQuery &query = SQLCreator::statement("select laston, auth, banned, salt, hash, ip, ban_expire_time from trainers where name=:name limit 1");
+        query.bindValue(":name", name.toString().toLower());
+        query.exec();
+        if (!query.next()) {
             holder.addNonExistant(name.toString().toLower());
         } else {
-            Member m(name.toString().toLower(), q->value(0).toString(), q->value(1).toInt(), q->value(2).toBool(), q->value(3).toByteArray(),
-                     q->value(4).toByteArray(), q->value(5).toString(), q->value(6).toInt());
+            Member m(name.toString().toLower(), query.value(0).toString(), query.value(1).toInt(), query.value(2).toBool(), query.value(3).toByteArray(),
+                     query.value(4).toByteArray(), query.value(5).toString(), query.value(6).toInt());
             holder.addMemberInMemory(m);
         }
-        q->finish();
+        query.finish();
     }
 }
 
@@ -747,53 +724,75 @@ void SecurityManager::exportDatabase()
         d.mkdir("serverdb");
     }
 
-    QFile out("serverdb/members.txt");
-
-    out.open(QIODevice::WriteOnly);
-
-    QSqlQuery q;
-    q.setForwardOnly(true);
-
-    q.exec("select name, laston, auth, banned, salt, hash, ip, ban_expire_time from trainers order by name asc");
-
-    while (q.next()) {
-        Member m(q.value(0).toString(), q.value(1).toString(), q.value(2).toInt(), q.value(3).toBool(), q.value(4).toByteArray(), q.value(5).toByteArray()
-                 , q.value(6).toString(), q.value(7).toInt());
-        out.write(m.toString().toUtf8());
-    }
+    BulkTransfer::exportTable("trainers", memberColumns(), "name asc", "serverdb/members.txt", [](const BulkTransfer::Row &r) {
+        Member m(r[0].toString(), r[1].toString(), r[2].toInt(), r[3].toBool(), r[4].toByteArray(), r[5].toByteArray(), r[6].toString(), r[7].toInt());
+        return m.toString().toUtf8();
+    });
 
     Server::print("Member database exported!");
 }
 
+/* In the order of Member's constructor */
+QStringList SecurityManager::memberColumns()
+{
+    return QStringList() << "name" << "laston" << "auth" << "banned" << "salt" << "hash" << "ip" << "ban_expire_time";
+}
+
 void SecurityManager::processDailyRun(int maxdays, bool async)
 {
     qDebug() << "Set daily run days to " << maxdays;
     dailyRunDays = maxdays;
     if (async) {
+        /* Ignored by the load/insert thread if a daily run is still going on */
         thread->addDailyRun();
-    } else {
-        if (isSql()) {
-            QSqlQuery q;
-            dailyRunEx(&q);
-        } else {
-            dailyRunEx();
+    } else if (isSql()) {
+        QString limit = QDateTime::currentDateTime().addDays(-maxdays).toString(Qt::ISODate);
+
+        QSqlQuery q;
+        q.exec("select max(id) from trainers");
+        int end = q.next() ? q.value(0).toInt() : 0;
+        q.finish();
+
+        qDebug() << "Processing daily run for members with limit " << limit;
+
+        for (int pos = 0; pos < end; pos += dailyRunChunkSize) {
+            deleteInactives(&q, limit, pos);
         }
+    } else {
+        dailyRunEx();
+    }
+}
+
+/* One range of ids at a time, so the table is never locked as a whole
+   and queued member loads get processed in between */
+void SecurityManager::deleteInactives(QSqlQuery *q, const QString &limit, int from)
+{
+    if (SQLCreator::databaseType == SQLCreator::MySQL) {
+        q->prepare("delete from trainers where id>? and id<=? and laston<? and auth=0 and banned=0");
+    } else {
+        q->prepare("delete from trainers where id>? and id<=? and laston<? and auth=0 and banned='false'");
     }
+    q->addBindValue(from);
+    q->addBindValue(from + dailyRunChunkSize);
+    q->addBindValue(limit);
+
+    q->exec();
+    q->finish();
 }
 
 const istringmap<SecurityManager::Member> & SecurityManager::getMembers() {
     if (isSql()) {
         members.clear();
 
-        QSqlQuery q;
-        q.setForwardOnly(true);
-        q.exec("select name, auth, banned, hash, ip, laston, ban_expire_time from trainers order by name asc");
+        QSqlQuery &q = SQLCreator::statement("select name, auth, banned, hash, ip, laston, ban_expire_time from trainers order by name asc");
+        q.exec();
 
         while(q.next()) {
             Member m(q.value(0).toString(), q.value(5).toString(), q.value(1).toInt(), q.value(2).toBool(), q.value(3).toByteArray(), q.value(3).toByteArray(), q.value(4).toString(), q.value(6).toInt());
 
             members[m.name] = m;
         }
+        q.finish();
     }
 
     return members;
@@ -802,20 +801,36 @@ const istringmap<SecurityManager::Member> & SecurityManager::getMembers() {
 void SecurityManager::dailyRunEx(QSqlQuery *q)
 {
     if (q) {
-        QString limit = QDateTime::currentDateTime().addDays(-dailyRunDays).toString(Qt::ISODate);
+        /* In the load/insert thread. A daily run asked while one is going on
+           just continues it */
+        if (!dailyRunning) {
+            dailyRunning = true;
+            dailyRunLimit = QDateTime::currentDateTime().addDays(-dailyRunDays).toString(Qt::ISODate);
+            dailyRunPos = 0;
+
+            q->exec("select max(id) from trainers");
+            dailyRunEnd = q->next() ? q->value(0).toInt() : 0;
+            q->finish();
+
+            qDebug() << "Processing daily run for members with limit " << dailyRunLimit;
+        }
 
-        qDebug() << "Processing daily run for members with limit " << limit;
-        if (SQLCreator::databaseType == SQLCreator::MySQL) {
-            q->prepare("delete from trainers where laston<? and auth=0 and banned=0");
+        deleteInactives(q, dailyRunLimit, dailyRunPos);
+        dailyRunPos += dailyRunChunkSize;
+
+        if (dailyRunPos < dailyRunEnd) {
+            thread->addDailyRun();
         } else {
-            q->prepare("delete from trainers where laston<? and auth=0 and banned='false'");
+            dailyRunning = false;
+            qDebug() << "Daily run for members finished";
         }
-        q->addBindValue(limit);
 
-        q->exec();
-        q->finish();
-        qDebug() << "Daily run for members finished";
+        return;
+    }
 
+    /* The in-memory members can only be touched in the main thread */
+    if (QThread::currentThread() != instance->thread()) {
+        QMetaObject::invokeMethod(instance, "dailyRunEx", Qt::QueuedConnection);
         return;
     }
 
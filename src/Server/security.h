@@ -25,6 +25,13 @@ public:
         GetInfoOnUser,
     };
 
+    /* What insertMember does with the member, in the load/insert thread */
+    enum WriteType {
+        InsertMember,
+        UpdateMember,
+        DeleteMember
+    };
+
     static void init();
     static void destroy();
 
@@ -143,6 +150,7 @@ private slots:
 private:
     static void loadMembers();
     static void loadSqlMembers();
+    static QStringList memberColumns();
 
     static MemoryHolder<Member> holder;
 
@@ -164,6 +172,13 @@ private:
     static QNickValidator val;
 
     static int dailyRunDays;
+    /* State of the daily run in SQL mode, only touched in the load/insert thread:
+       whether one is going on, its date limit, last id processed and max id */
+    static bool dailyRunning;
+    static QString dailyRunLimit;
+    static int dailyRunPos, dailyRunEnd;
+    static const int dailyRunChunkSize = 1000;
+    static void deleteInactives(QSqlQuery *q, const QString &limit, int from);
     static int lastPlace;
     static QFile memberFile;
     static istringmap<Member> members;
@@ -7,6 +7,8 @@
 #include <Utilities/exesuffix.h>
 #include <Utilities/otherwidgets.h>
 #include <Utilities/backtrace.h>
+#include <Utilities/asynclog.h>
+#include <Utilities/connectiontable.h>
 #include "server.h"
 #include "player.h"
 #include "challenge.h"
@@ -15,6 +17,7 @@
 #include "serverconfig.h"
 #include "scriptengine.h"
 #include "sql.h"
+#include "asyncsql.h"
 #include "tiermachine.h"
 #include "tier.h"
 #include "battlingoptions.h"
@@ -24,6 +27,7 @@
 #include "relaymanager.h"
 #include "registrycommunicator.h"
 #include "battlecommunicator.h"
+#include "../Shared/battlecommands.h"
 
 Server *Server::serverIns = NULL;
 
@@ -39,15 +43,15 @@ static void updateZippedChannelCache(QByteArray&val) {
 //channelCache([&](QByteArray &val) {val = makePacket(NetworkServ::ChannelsList, channelNames);}),
 //zchannelCache([&](QByteArray &val) {val = makeZipPacket(NetworkServ::ChannelsList, channelNames);}),
 
-Server::Server(quint16 port) : registry(nullptr), battles(nullptr), serverPorts(), showLogMessages(true),
-    lastDataId(0), playercounter(0), battlecounter(0), channelcounter(0),
+Server::Server(quint16 port) : registry(nullptr), battles(nullptr), serverPorts(), showLogMessages(true), asyncLogHooks(false),
+    lastDataId(0), battlecounter(0), channelcounter(0),
     channelCache(&updateChannelCache), zchannelCache(updateZippedChannelCache), numberOfPlayersLoggedIn(0), myengine(nullptr)
 {
     serverPorts << port;
 }
 
-Server::Server(QList<quint16> ports) : registry(nullptr), battles(nullptr), serverPorts(), showLogMessages(true),
-    lastDataId(0), playercounter(0), battlecounter(0), channelcounter(0), channelCache(&updateChannelCache),
+Server::Server(QList<quint16> ports) : registry(nullptr), battles(nullptr), serverPorts(), showLogMessages(true), asyncLogHooks(false),
+    lastDataId(0), battlecounter(0), channelcounter(0), channelCache(&updateChannelCache),
     zchannelCache(updateZippedChannelCache), numberOfPlayersLoggedIn(0), myengine(nullptr)
 {
     foreach(quint16 port, ports)
@@ -109,6 +113,7 @@ void Server::start(){
     };
 
     setDefaultValue("Scripts/SafeMode", false);
+    setDefaultValue("Scripts/AsyncLogHooks", false);
     setDefaultValue("Server/Password", "pikachu");
     setDefaultValue("Server/RequirePassword", false);
     setDefaultValue("Server/Private", false);
@@ -119,6 +124,8 @@ void Server::start(){
     setDefaultValue("Server/MinimumHTML", -1); // -1 is disabled
     setDefaultValue("Channels/LoggingEnabled", false);
     setDefaultValue("Channels/MainChannel", QString());
+    setDefaultValue("Channels/ChatDelay", 0);
+    setDefaultValue("Channels/MaxLinesPerSecond", 0);
     setDefaultValue("Ladder/MonthsExpiration", 3);
     setDefaultValue("Ladder/PeriodDuration", 24);
     setDefaultValue("Ladder/DecayPerPeriod", 5);
@@ -128,6 +135,7 @@ void Server::start(){
     setDefaultValue("Battles/ForceUnratedForSameIP", true);
     setDefaultValue("Battles/ConsecutiveFindBattlesWithDifferentIPs", 5);
     setDefaultValue("Battles/RatedThroughChallenge", false);
+    setDefaultValue("Battles/Shards", 1);
     setDefaultValue("Network/ProxyServers",QString("127.0.0.1,::1%0,localhost"));
     setDefaultValue("Network/LowTCPDelay", false);
     setDefaultValue("AntiDOS/ShowOveractiveMessages", true);
@@ -161,6 +169,7 @@ void Server::start(){
         } catch (const QString &ex) {
             forcePrint(ex);
         }
+        AsyncSql::init();
     }
 
     forcePrint(tr("Starting loading pokemon database..."));
@@ -229,6 +238,8 @@ void Server::start(){
     loadRatedBattlesSettings();
 
     useChannelFileLog = s.value("Channels/LoggingEnabled").toBool();
+    chatDelay = s.value("Channels/ChatDelay").toInt();
+    maxChatLines = s.value("Channels/MaxLinesPerSecond").toInt();
 
     /*
       The timer for clearing the last rated battles memory, set to 3 hours
@@ -246,6 +257,7 @@ void Server::start(){
     amountOfInactiveDays = s.value("Players/InactiveThresholdInDays").toInt();
     lowTCPDelay = quint16(s.value("Network/LowTCPDelay").toBool());
     safeScripts = s.value("Scripts/SafeMode").toBool();
+    asyncLogHooks = s.value("Scripts/AsyncLogHooks").toBool();
     overactiveShow = s.value("AntiDOS/ShowOveractiveMessages").toBool();
     proxyServers = s.value("Network/ProxyServers").toString().split(",");
     trustedIps = s.value("AntiDOS/TrustedIps").toString().split(",");
@@ -291,6 +303,7 @@ void Server::initBattles()
     connect(battles, SIGNAL(error()), battles, SLOT(startServer()));
     connect(battles, SIGNAL(battleFinished(int,int,int,int)), SLOT(battleResult(int,int,int,int)));
     connect(battles, SIGNAL(battleInfo(int,int,QByteArray)), SLOT(sendBattleCommand(int,int,QByteArray)));
+    connect(battles, SIGNAL(battleStream(int,QVector<qint32>,QVector<qint32>,QByteArray)), SLOT(sendBattleStream(int,QVector<qint32>,QVector<qint32>,QByteArray)));
     connect(battles, SIGNAL(sendBattleInfos(int,int,int,TeamBattle,BattleConfiguration,QString)), SLOT(sendBattleInfos(int,int,int,TeamBattle,BattleConfiguration,QString)));
 }
 
@@ -319,12 +332,9 @@ GenericSocket Server::server(int i)
 #endif
 void Server::processDailyRun()
 {
-    broadCast("The server is updating the database and clearing inactive members, as it does daily. It may take a bit of time depending on database size.");
-    broadCast("The server is updating all the ratings, as it does daily. It may take a bit of time.");
-
-    /* Running delayed as otherwise the message would be sent after the lag, not before */
-    QTimer::singleShot(1000, this, SLOT(updateDatabase()));
-    QTimer::singleShot(1000, this, SLOT(updateRatings()));
+    /* Both are processed in the background, chunk by chunk */
+    updateDatabase();
+    updateRatings();
 }
 
 void Server::changeDbMod(const QString &mod)
@@ -351,16 +361,12 @@ void Server::changeDbMod(const QString &mod)
 void Server::updateDatabase()
 {
     SecurityManager::processDailyRun(amountOfInactiveDays);
-
-    broadCast("Database cleaning launched!");
 }
 
 void Server::updateRatings()
 {
     TierMachine::obj()->processDailyRun();
 
-    broadCast("All ratings updated!");
-
     /* Updating ratings of the players online */
     foreach(Player *p, myplayers) {
         if (p->isLoggedIn()) {
@@ -435,6 +441,8 @@ bool Server::joinChannel(int playerid, int channelid) {
         return false;
     }
 
+    BundleGuard bundle(player(playerid)->bundlingRelay());
+
     Channel &channel = this->channel(channelid);
     channel.playerJoin(playerid);
 
@@ -445,6 +453,8 @@ bool Server::joinChannel(int playerid, int channelid) {
 
 void Server::needChannelData(int playerid, int channelid)
 {
+    BundleGuard bundle(player(playerid)->bundlingRelay());
+
     Channel &channel = this->channel(channelid);
 
     channel.onReconnect(playerid);
@@ -636,23 +646,32 @@ void Server::clearRatedBattlesHistory()
 }
 
 /* Returns false if the event "newMessage" was stopped (nothing to do with "chatMessage") */
-bool Server::printLine(const QString &line, bool chatMessage, bool forcedLog)
+bool Server::printLine(const QString &line, bool chatMessage, bool forcedLog, int channel, int player)
 {
     if (!chatMessage && !showLogMessages && !forcedLog)
         return false;
 
     if (myengine == NULL) {
-        qDebug() << line;
+        AsyncLog::obj()->write(LogRecord::Info, line, channel, player);
         emit serverMessage(line);
         return true;
     }
+    if (!chatMessage && asyncLogHooks) {
+        AsyncLog::obj()->write(LogRecord::Info, line, channel, player);
+        emit serverMessage(line);
+
+        if (pendingLogHooks.empty()) {
+            QTimer::singleShot(0, this, SLOT(runLogHooks()));
+        }
+        pendingLogHooks.push_back(line);
+        return true;
+    }
     if (chatMessage || myengine->beforeNewMessage(line)) {
+        AsyncLog::obj()->write(LogRecord::Info, line, channel, player);
         //notify possible views (if any)
         if(chatMessage){
-            qDebug() << line;
             emit this->chatMessage(line);
         } else {
-            qDebug() << line;
             emit serverMessage(line);
         }
         if (!chatMessage)
@@ -662,6 +681,22 @@ bool Server::printLine(const QString &line, bool chatMessage, bool forcedLog)
     return false;
 }
 
+void Server::runLogHooks()
+{
+    /* Lines printed by the scripts meanwhile go to the next batch */
+    QStringList lines = pendingLogHooks;
+    pendingLogHooks.clear();
+
+    if (myengine == NULL) {
+        return;
+    }
+
+    foreach(const QString &line, lines) {
+        myengine->beforeNewMessage(line);
+        myengine->afterNewMessage(line);
+    }
+}
+
 void Server::forcePrint(const QString &line)
 {
     printLine(line, false, true);
@@ -888,6 +923,9 @@ void Server::processLoginDetails(Player *p)
 
     int id = p->id();
 
+    /* Announcement, tiers, channels, players and battles in one packet */
+    BundleGuard bundle(p->bundlingRelay());
+
     QString channel;
     if (p->loginInfo() && p->loginInfo()->channel) {
         channel = *p->loginInfo()->channel;
@@ -991,6 +1029,11 @@ void Server::sendBattleCommand(int publicId, int id, const QByteArray &comm)
     if (!playerExist(id))
         return;
 
+    if (comm.length() > 0 && comm[0] == BattleCommands::SituationSnapshot) {
+        sendBattleSituation(publicId, id, comm);
+        return;
+    }
+
     if (player(id)->hasBattle(publicId) || player(id)->lastBattle() == publicId) {
 //        if (player(id)->lastBattle() == publicId) {
 //            qDebug() << "Sending post battle command";
@@ -1002,6 +1045,60 @@ void Server::sendBattleCommand(int publicId, int id, const QByteArray &comm)
     }
 }
 
+/* The commands of the situation are sent as usual, but all in one write */
+void Server::sendBattleSituation(int publicId, int id, const QByteArray &comm)
+{
+    int command;
+    if (player(id)->hasBattle(publicId) || player(id)->lastBattle() == publicId) {
+        command = NetworkServ::BattleMessage;
+    } else if (player(id)->battlesSpectated.contains(publicId)) {
+        command = NetworkServ::SpectatingBattleMessage;
+    } else {
+        return;
+    }
+
+    DataStream in(comm);
+    uchar bundle;
+    qint8 who;
+    QList<QByteArray> commands;
+    in >> bundle >> who >> commands;
+
+    QByteArray packets;
+    foreach(const QByteArray &c, commands) {
+        packets += makePacket(command, qint32(publicId), c);
+    }
+
+    player(id)->sendPacket(packets);
+}
+
+void Server::sendBattleStream(int publicId, const QVector<qint32> &players, const QVector<qint32> &spectators, const QByteArray &comm)
+{
+    /* The packets are made once and shared by all the recipients */
+    if (!players.empty()) {
+        QByteArray packet = makePacket(NetworkServ::BattleMessage, qint32(publicId), comm);
+
+        foreach(qint32 id, players) {
+            /* Same checks as sendBattleCommand, the player may have logged off
+               and the id been given to someone else */
+            if (playerExist(id) && (player(id)->hasBattle(publicId) || player(id)->lastBattle() == publicId)) {
+                player(id)->sendPacket(packet);
+            }
+        }
+    }
+
+    if (!spectators.empty()) {
+        QByteArray packet = makePacket(NetworkServ::SpectatingBattleMessage, qint32(publicId), comm);
+
+        /* The battle communicator keeps the spectators up to date, so no need
+           to look at battlesSpectated */
+        foreach(qint32 id, spectators) {
+            if (playerExist(id)) {
+                player(id)->sendPacket(packet);
+            }
+        }
+    }
+}
+
 void Server::sendServerMessage(const QString &message)
 {
     if (myengine->beforeServerMessage(message))
@@ -1040,7 +1137,7 @@ bool Server::joinRequest(int player, const QString &channel)
 void Server::recvMessage(int id, int channel, const QString &mess)
 {
     QString re = mess.trimmed();
-    if (re.length() > 0) {
+    if (re.length() > 0 && allowChatLine(id, channel)) {
         if (myengine->beforeChatMessage(id, mess, channel)) {
             broadCast(mess, channel, id);
             myengine->afterChatMessage(id, mess, channel);
@@ -1084,7 +1181,6 @@ void Server::incomingConnection(int i)
     if (!newconnection)
         return;
 
-    int id = freeid();
 #ifndef BOOST_SOCKETS
     QString ip = newconnection->peerAddress().toString();
 #else
@@ -1117,7 +1213,11 @@ void Server::incomingConnection(int i)
         return;
     }
 
-    printLine(QString("Received pending connection on slot %1 from %2").arg(id).arg(ip));
+    int id = freeid();
+
+    if (showLogMessages) {
+        printLine(QString("Received pending connection on slot %1 from %2").arg(id).arg(ip));
+    }
 
 #ifndef BOOST_SOCKETS
     newconnection->setSocketOption(QAbstractSocket::LowDelayOption, lowTCPDelay);
@@ -1130,34 +1230,39 @@ void Server::incomingConnection(int i)
 
     Player *p = player(id);
 
-    connect(p, SIGNAL(loggedIn(int, QString)), SLOT(loggedIn(int, QString)));
-    connect(p, SIGNAL(logout(int)), SLOT(logout(int)));
-    connect(p, SIGNAL(recvTeam(int, QString)), SLOT(recvTeam(int, QString)));
-    connect(p, SIGNAL(recvMessage(int, int, QString)), SLOT(recvMessage(int, int, QString)));
-    connect(p, SIGNAL(disconnected(int)), SLOT(disconnected(int)));
-    connect(p, SIGNAL(sendChallenge(int,int,ChallengeInfo)), SLOT(dealWithChallenge(int,int,ChallengeInfo)));
-    connect(p, SIGNAL(battleFinished(int,int,int,int)), SLOT(battleResult(int,int,int,int)));
-    connect(p, SIGNAL(info(int,QString)), SLOT(info(int,QString)));
-    connect(p, SIGNAL(playerKick(int,int)), SLOT(playerKick(int, int)));
-    connect(p, SIGNAL(playerBan(int,int)), SLOT(playerBan(int, int)));
-    connect(p, SIGNAL(playerTempBan(int,int,int)), SLOT(playerTempBan(int, int, int)));
-    connect(p, SIGNAL(PMReceived(int,int,QString)), SLOT(recvPM(int,int,QString)));
-    connect(p, SIGNAL(awayChange(int,bool)), this, SLOT(awayChanged(int, bool)));
-    connect(p, SIGNAL(spectatingRequested(int,int)), SLOT(spectatingRequested(int,int)));
-    connect(p, SIGNAL(spectatingStopped(int,int)), SLOT(spectatingStopped(int,int)));
-    connect(p, SIGNAL(battleChat(int,int,QString)), battles, SLOT(battleChat(int,int,QString)));
-    connect(p, SIGNAL(battleMessage(int,int,BattleChoice)), battles, SLOT(battleMessage(int,int,BattleChoice)));
-    connect(p, SIGNAL(spectatingChat(int,int, QString)), battles, SLOT(spectatingChat(int,int, QString)));
-    connect(p, SIGNAL(updated(int)), SLOT(sendPlayer(int)));
-    connect(p, SIGNAL(findBattle(int,FindBattleData)), SLOT(findBattle(int, FindBattleData)));
-    connect(p, SIGNAL(battleSearchCancelled(int)), SLOT(cancelSearch(int)));
-    connect(p, SIGNAL(joinRequested(int,QString)), SLOT(joinRequest(int,QString)));
-    connect(p, SIGNAL(joinRequested(int,int)), SLOT(joinChannel(int,int)));
-    connect(p, SIGNAL(leaveRequested(int,int)), SLOT(leaveRequest(int,int)));
-    connect(p, SIGNAL(ipChangeRequested(int,QString)), SLOT(ipChangeRequested(int,QString)));
-    connect(p, SIGNAL(reconnect(int,int,QByteArray)), SLOT(onReconnect(int,int,QByteArray)));
-    connect(p, SIGNAL(resendBattleInfos(int,int)), battles, SLOT(resendBattleInfos(int,int)));
-    connect(p, SIGNAL(needChannelData(int,int)), SLOT(needChannelData(int,int)));
+    static const ConnectionTable toServer = ConnectionTable(&Player::staticMetaObject, &Server::staticMetaObject)
+        .add(SIGNAL(loggedIn(int, QString)), SLOT(loggedIn(int, QString)))
+        .add(SIGNAL(logout(int)), SLOT(logout(int)))
+        .add(SIGNAL(recvTeam(int, QString)), SLOT(recvTeam(int, QString)))
+        .add(SIGNAL(recvMessage(int, int, QString)), SLOT(recvMessage(int, int, QString)))
+        .add(SIGNAL(disconnected(int)), SLOT(disconnected(int)))
+        .add(SIGNAL(sendChallenge(int,int,ChallengeInfo)), SLOT(dealWithChallenge(int,int,ChallengeInfo)))
+        .add(SIGNAL(battleFinished(int,int,int,int)), SLOT(battleResult(int,int,int,int)))
+        .add(SIGNAL(info(int,QString)), SLOT(info(int,QString)))
+        .add(SIGNAL(playerKick(int,int)), SLOT(playerKick(int, int)))
+        .add(SIGNAL(playerBan(int,int)), SLOT(playerBan(int, int)))
+        .add(SIGNAL(playerTempBan(int,int,int)), SLOT(playerTempBan(int, int, int)))
+        .add(SIGNAL(PMReceived(int,int,QString)), SLOT(recvPM(int,int,QString)))
+        .add(SIGNAL(awayChange(int,bool)), SLOT(awayChanged(int, bool)))
+        .add(SIGNAL(spectatingRequested(int,int)), SLOT(spectatingRequested(int,int)))
+        .add(SIGNAL(spectatingStopped(int,int)), SLOT(spectatingStopped(int,int)))
+        .add(SIGNAL(updated(int)), SLOT(sendPlayer(int)))
+        .add(SIGNAL(findBattle(int,FindBattleData)), SLOT(findBattle(int, FindBattleData)))
+        .add(SIGNAL(battleSearchCancelled(int)), SLOT(cancelSearch(int)))
+        .add(SIGNAL(joinRequested(int,QString)), SLOT(joinRequest(int,QString)))
+        .add(SIGNAL(joinRequested(int,int)), SLOT(joinChannel(int,int)))
+        .add(SIGNAL(leaveRequested(int,int)), SLOT(leaveRequest(int,int)))
+        .add(SIGNAL(ipChangeRequested(int,QString)), SLOT(ipChangeRequested(int,QString)))
+        .add(SIGNAL(reconnect(int,int,QByteArray)), SLOT(onReconnect(int,int,QByteArray)))
+        .add(SIGNAL(needChannelData(int,int)), SLOT(needChannelData(int,int)));
+    static const ConnectionTable toBattles = ConnectionTable(&Player::staticMetaObject, &BattleCommunicator::staticMetaObject)
+        .add(SIGNAL(battleChat(int,int,QString)), SLOT(battleChat(int,int,QString)))
+        .add(SIGNAL(battleMessage(int,int,BattleChoice)), SLOT(battleMessage(int,int,BattleChoice)))
+        .add(SIGNAL(spectatingChat(int,int, QString)), SLOT(spectatingChat(int,int, QString)))
+        .add(SIGNAL(resendBattleInfos(int,int)), SLOT(resendBattleInfos(int,int)));
+
+    toServer.connect(p, this);
+    toBattles.connect(p, battles);
 }
 
 void Server::awayChanged(int src, bool away)
@@ -1165,12 +1270,11 @@ void Server::awayChanged(int src, bool away)
     if (!playerLoggedIn(src))
         return;
 
-    bool ladder = player(src)->state()[Player::LadderEnabled];
+    (void) away;
 
-    ++lastDataId;
-    foreach(int chanid, player(src)->getChannels()) {
-        notifyChannelLastId(chanid, NetworkServ::OptionsChange, qint32(src), Flags(ladder + (away << 1)));
-    }
+    /* The away flag is in the player's info, old clients get it with an
+       OptionsChange like before */
+    sendPlayer(src);
 }
 
 void Server::onReconnect(int sender, int id, const QByteArray &hash)
@@ -1556,6 +1660,8 @@ void Server::startBattle(int id1, int id2, const ChallengeInfo &c, int team1, in
 
     /* Send each other's info if they don't have it */
     if (!p1->isInSameChannel(p2)) {
+        flushPlayerUpdates(id1);
+        flushPlayerUpdates(id2);
         p1->relay().sendPlayer(p2->bundle());
         p2->relay().sendPlayer(p1->bundle());
     }
@@ -1721,11 +1827,114 @@ void Server::sendPlayer(int id)
         return;
     }
 
-    PlayerInfo bundle = source->bundle();
+    if (changedPlayers.empty()) {
+        QTimer::singleShot(0, this, SLOT(sendPlayerUpdates()));
+    }
+    changedPlayers.insert(id);
+}
 
-    ++lastDataId;
-    foreach(int chanid, source->getChannels()) {
-        notifyChannelLastId(chanid, NetworkServ::PlayersList, bundle);
+/* Each player changed is compared to the info the others last got (sentBundle()).
+   Clients supporting it get one PlayerDelta with all the players that changed,
+   holding only the fields that changed. The others get an OptionsChange when
+   only the flags changed, and the whole PlayersList otherwise.
+
+   A player never sent since logging in is sent whole to everyone. */
+void Server::sendPlayerUpdates()
+{
+    QSet<int> changed = changedPlayers;
+    changedPlayers.clear();
+
+    sendPlayerUpdates(changed);
+}
+
+void Server::setMaxChatLines(int linesPerSecond)
+{
+    maxChatLines = linesPerSecond;
+}
+
+void Server::flushPlayerUpdates(int id)
+{
+    if (changedPlayers.remove(id)) {
+        QSet<int> changed;
+        changed.insert(id);
+        sendPlayerUpdates(changed);
+    }
+}
+
+void Server::sendPlayerUpdates(const QSet<int> &changed)
+{
+    QHash<Player*, QByteArray> packets;
+    QHash<Player*, QByteArray> deltas;
+
+    foreach(int id, changed) {
+        if (!playerExist(id) || !player(id)->isLoggedIn()) {
+            continue;
+        }
+
+        Player *source = player(id);
+        const PlayerInfo &bundle = source->bundle();
+        PlayerInfo &sent = source->sentBundle();
+
+        bool full = sent.id != bundle.id;
+        QByteArray packet, delta;
+
+        if (full) {
+            packet = makePacket(NetworkServ::PlayersList, bundle);
+        } else {
+            PlayerInfoDelta d(sent, bundle);
+
+            if (d.empty()) {
+                continue;
+            }
+
+            delta = PacketBuilder::pack(0, d);
+
+            if (d.fields.data == (1 << PlayerInfoDelta::FlagsField)) {
+                packet = makePacket(NetworkServ::OptionsChange, qint32(id), Flags(bundle.ladder() + (bundle.away() << 1)));
+            } else {
+                packet = makePacket(NetworkServ::PlayersList, bundle);
+            }
+        }
+
+        sent = bundle;
+
+        ++lastDataId;
+        foreach(int chanid, source->getChannels()) {
+            foreach(int pid, channel(chanid).players) {
+                Player *p = player(pid);
+                /* Clients in lazy mode ask for the info when they need it */
+                if (p->hasSentCommand(lastDataId) || !p->hasInfoOf(id)) {
+                    continue;
+                }
+                if (full || !p->spec()[Player::SupportsPlayerDelta]) {
+                    packets[p] += packet;
+                } else {
+                    deltas[p] += delta;
+                }
+            }
+        }
+    }
+
+    QHashIterator<Player*, QByteArray> it(packets);
+    while (it.hasNext()) {
+        it.next();
+        it.key()->sendPacket(it.value());
+    }
+
+    QHashIterator<Player*, QByteArray> it2(deltas);
+    while (it2.hasNext()) {
+        it2.next();
+
+        QByteArray packet = makePacket(NetworkServ::PlayerDelta);
+        packet += it2.value();
+
+        int length = packet.length() - 4;
+        packet[0] = char(length >> 24);
+        packet[1] = char(length >> 16);
+        packet[2] = char(length >> 8);
+        packet[3] = char(length);
+
+        it2.key()->sendPacket(packet);
     }
 }
 
@@ -1737,7 +1946,12 @@ void Server::sendLogout(int id)
 
     ++lastDataId;
     foreach(int chanid, source->getChannels()) {
+        flushChat(chanid);
         notifyChannelLastId(chanid, NetworkServ::Logout, qint32(id));
+
+        foreach(int pid, channel(chanid).players) {
+            player(pid)->forgetInfoOf(source);
+        }
     }
 }
 
@@ -1904,6 +2118,7 @@ void Server::removePlayer(int id)
         }
 
         myplayers.take(id)->deleteLater();
+        playerIds.release(id);
 
         if ((loggedIn || p->state()[Player::WaitingReconnect]) && mynames.value(playerName.toLower()) == p->id())
             mynames.remove(playerName.toLower());
@@ -1937,6 +2152,12 @@ void Server::broadCast(const QString &message, int channel, int sender, bool htm
     }
 
     if (target != NoTarget) {
+        /* Chat waiting in the channel arrives first, a script answering a line
+           answers after it */
+        if (channel != NoChannel) {
+            flushChat(channel);
+        }
+
         Player *p = player(target);
         if (p->spec()[Player::IdsWithMessage] && sender != NoSender) {
             if (channel != NoChannel) {
@@ -1956,15 +2177,21 @@ void Server::broadCast(const QString &message, int channel, int sender, bool htm
             if(useChannelFileLog) {
                 this->channel(channel).log(fullMessage);
             }
-            printLine(QString("[#%1] %2").arg(this->channel(channel).name(), fullMessage), chatMessage, true);
+            printLine(QString("[#%1] %2").arg(this->channel(channel).name(), fullMessage), chatMessage, true, channel, sender);
+
+            Channel &chan = this->channel(channel);
             if (sender == NoSender) {
-                notifyChannel(channel, All, NetworkServ::SendChatMessage, Flags(1), Flags(html), channel, message);
+                QByteArray packet = makePacket(NetworkServ::SendChatMessage, Flags(1), Flags(html), channel, message);
+                chan.pendingChat += packet;
+                chan.pendingChatOpp += packet;
             } else {
-                notifyChannel(channel, IdsWithMessage, NetworkServ::SendChatMessage, Flags(3), Flags(html), channel, sender, message);
-                notifyChannelOpp(channel, IdsWithMessage, NetworkServ::SendChatMessage, Flags(1), Flags(html), channel, fullMessage);
+                chan.pendingChat += makePacket(NetworkServ::SendChatMessage, Flags(3), Flags(html), channel, sender, message);
+                chan.pendingChatOpp += makePacket(NetworkServ::SendChatMessage, Flags(1), Flags(html), channel, fullMessage);
             }
+            queueChat(channel);
         } else {
-            printLine(fullMessage, chatMessage, true);
+            flushChat();
+            printLine(fullMessage, chatMessage, true, NoChannel, sender);
 
             if (sender == NoSender) {
                 notifyGroup(All, NetworkServ::SendChatMessage, Flags(0), Flags(html), message);
@@ -1976,13 +2203,105 @@ void Server::broadCast(const QString &message, int channel, int sender, bool htm
     }
 }
 
-int Server::freeid() const
+void Server::queueChat(int channel)
 {
-    do {
-        ++playercounter;
-    } while (myplayers.contains(playercounter) || playercounter == 0 || playercounter == -1); /* 0, -1 are reserved */
+    if (chattyChannels.empty()) {
+        QTimer::singleShot(chatDelay, this, SLOT(flushChat()));
+    }
+    chattyChannels.insert(channel);
+}
+
+void Server::flushChat()
+{
+    QSet<int> chatty = chattyChannels;
+    chattyChannels.clear();
+
+    foreach(int chanid, chatty) {
+        flushChat(chanid);
+    }
+}
+
+/* The packets of the lines are written one after the other, so that during a raid
+   each player gets a write per flush instead of one per line */
+void Server::flushChat(int chanid)
+{
+    /* The channel may have been removed since */
+    if (!channels.contains(chanid)) {
+        return;
+    }
+
+    Channel &chan = channel(chanid);
+
+    if (chan.pendingChat.isEmpty()) {
+        return;
+    }
+
+    QByteArray withIds = chan.pendingChat;
+    QByteArray withoutIds = chan.pendingChatOpp;
+    chan.pendingChat.clear();
+    chan.pendingChatOpp.clear();
+
+    foreach(int pid, chan.players) {
+        Player *p = player(pid);
+        p->sendPacket(p->spec()[Player::IdsWithMessage] ? withIds : withoutIds);
+    }
+}
+
+/* Past maxChatLines lines in the same second in a channel, the lines of players
+   without auth are dropped before the scripts see them. How many were is told
+   to the channel a second after the first one */
+bool Server::allowChatLine(int id, int chanid)
+{
+    if (maxChatLines <= 0 || !channels.contains(chanid) || auth(id) > 0) {
+        return true;
+    }
+
+    Channel &chan = channel(chanid);
+    qint64 second = QDateTime::currentMSecsSinceEpoch() / 1000;
+
+    if (second != chan.chatSecond) {
+        chan.chatSecond = second;
+        chan.chatLines = 0;
+    }
+
+    if (chan.chatLines < maxChatLines) {
+        chan.chatLines += 1;
+        return true;
+    }
+
+    if (chan.suppressedLines == 0) {
+        if (floodedChannels.empty()) {
+            QTimer::singleShot(1000, this, SLOT(reportSuppressedChat()));
+        }
+        floodedChannels.insert(chanid);
+    }
+    chan.suppressedLines += 1;
+
+    return false;
+}
+
+void Server::reportSuppressedChat()
+{
+    QSet<int> flooded = floodedChannels;
+    floodedChannels.clear();
 
-    return playercounter;
+    foreach(int chanid, flooded) {
+        if (!channels.contains(chanid)) {
+            continue;
+        }
+
+        Channel &chan = channel(chanid);
+        int count = chan.suppressedLines;
+        chan.suppressedLines = 0;
+
+        broadCast(QString("%1 messages suppressed").arg(count), chanid);
+    }
+}
+
+int Server::freeid()
+{
+    /* 0, -1 are reserved, the allocator starts from 1 */
+    return playerIds.take();
 }
 
 int Server::freebattleid() const
@@ -2016,6 +2335,7 @@ void Server::atServerShutDown() {
     // On linux, threads need to be cleared or the server may be left hanging...
     TierMachine::destroy();
     SecurityManager::destroy();
+    AsyncSql::destroy();
     RelayManager::destroy();
 }
 
@@ -3,6 +3,7 @@
 
 #include <Utilities/contextswitch.h>
 #include <Utilities/asiosocket.h>
+#include <Utilities/idallocator.h>
 #include <PokemonInfo/networkstructs.h>
 #include "serverinterface.h"
 #include "channel.h"
@@ -63,6 +64,14 @@ public:
     QString authedName(int id) const;
     void broadCast(const QString &message, int channel = NoChannel, int sender = NoSender, bool html = false, int target=NoTarget);
     void sendMessage(int id, const QString &message);
+    /* Sends the chat of the channel that is waiting, now */
+    void flushChat(int channel);
+    /* Sends the info changes of the player that are waiting, now. To call before
+       sending the whole info of the player to anyone, so that the changes sent
+       after are from what they got */
+    void flushPlayerUpdates(int id);
+    /* Until the restart, Channels/MaxLinesPerSecond stays as it is */
+    void setMaxChatLines(int linesPerSecond);
 
     void sendBattlesList(int id, int chanid);
     /* Sends the login of the player to everybody but the player */
@@ -125,7 +134,8 @@ signals:
     void player_authchange(int id, const QString &name);
 
 public slots:
-    bool printLine(const QString &line, bool chatMessage = false, bool forcedLog = false);
+    /* channel and player are what the line is about, for the log */
+    bool printLine(const QString &line, bool chatMessage = false, bool forcedLog = false, int channel = NoChannel, int player = NoSender);
     void forcePrint(const QString &line);
 
     /* Registry slots */
@@ -167,6 +177,8 @@ public slots:
     void startBattle(int id1, int id2, const ChallengeInfo &c, int team1=0,int team2=0);
     void battleResult(int battleid, int desc, int winner, int loser);
     void sendBattleCommand(int battleId, int id, const QByteArray &command);
+    void sendBattleStream(int battleId, const QVector<qint32> &players, const QVector<qint32> &spectators, const QByteArray &command);
+    void sendBattleSituation(int battleId, int id, const QByteArray &command);
     void spectatingRequested(int id, int ongoingBattle);
     void spectatingStopped(int id, int ongoingBattle);
     bool joinRequest(int player, const QString &chn);
@@ -194,7 +206,15 @@ public slots:
     void playerBan(int src, int dest);
     void playerTempBan(int src, int dest, int time);
     void awayChanged(int src, bool away);
+    /* The info of the player changed, those who know the player are told at the end
+       of the event loop iteration, with all the other changes */
     void sendPlayer(int id);
+    void sendPlayerUpdates();
+    /* Chat in channels is sent Channels/ChatDelay ms after the first line (by default 0,
+       at the end of the event loop iteration), all the lines in one write per player.
+       Sent before anything else going to the channel right away */
+    void flushChat();
+    void reportSuppressedChat();
     void tiersChanged();
     void findBattle(int id,const FindBattleData &f);
     void cancelSearch(int id);
@@ -208,6 +228,8 @@ public slots:
 
     void atServerShutDown();
     void battleConnectionLost();
+    /* Calls the script events for the lines logged since the last time */
+    void runLogHooks();
 private:
     void kick(int dest, int src);
     void ban(int dest, int src);
@@ -226,9 +248,17 @@ private:
     QStringList trustedIps;
     bool showLogMessages;
     bool useChannelFileLog;
+    int chatDelay;
+    /* Lines per second in a channel past which the lines of players without auth
+       are dropped, 0 for no limit */
+    int maxChatLines;
     int amountOfInactiveDays;
     bool lowTCPDelay;
     bool safeScripts;
+    /* When set, beforeNewMessage / afterNewMessage are called after the line
+       is logged, from the event loop, and can't stop it */
+    bool asyncLogHooks;
+    QStringList pendingLogHooks;
     bool overactiveShow;
     bool passwordProtected;
     QByteArray serverPassword;
@@ -244,6 +274,14 @@ private:
         but that would be doing too many allocations. Instead we use a commandId for this kind of commands,
         and check that the last command sent to the player wasn't that particular command. */
     int lastDataId;
+    /* Players whose info changed since the last sendPlayerUpdates() */
+    QSet<int> changedPlayers;
+    void sendPlayerUpdates(const QSet<int> &changed);
+    /* Channels with chat waiting, and with lines dropped since the last report */
+    QSet<int> chattyChannels;
+    QSet<int> floodedChannels;
+    bool allowChatLine(int id, int channel);
+    void queueChat(int channel);
     /* Counters for ids.
 
         They have two advantages: you can get a non used id fast, there's astronomically low chances that
@@ -252,7 +290,8 @@ private:
         players go by... lol ^^)
 
         The disavandtage is that you don't have clean ids, that are close to 0. */
-    mutable int playercounter, battlecounter, channelcounter;
+    IdAllocator playerIds;
+    mutable int battlecounter, channelcounter;
 
 #ifndef BOOST_SOCKETS
     QList<QTcpServer *> myservers;
@@ -286,7 +325,7 @@ public:
     PlayerInterface * playeri(int i) const;
 private:
     /* gets an id that's not used */
-    int freeid() const;
+    int freeid();
     int freebattleid() const;
     int freechannelid() const;
     /* removes a player */
@@ -4,3 +4,54 @@ int SQLCreator::databaseType = SQLCreator::SQLite;
 QMutex SQLCreator::mutex;
 QString SQLCreator::databaseSchema;
 bool SQLCreator::doVacuum;
+
+namespace {
+struct StatementCache {
+    QString connection;
+    QHash<QString, QSqlQuery*> queries;
+
+    ~StatementCache() {
+        qDeleteAll(queries);
+    }
+};
+
+QThreadStorage<StatementCache*> statements;
+
+StatementCache *statementCache() {
+    if (!statements.hasLocalData()) {
+        statements.setLocalData(new StatementCache());
+    }
+    return statements.localData();
+}
+}
+
+QSqlQuery &SQLCreator::statement(const QString &sql)
+{
+    StatementCache *cache = statementCache();
+
+    QSqlQuery *q = cache->queries.value(sql);
+
+    if (!q) {
+        QSqlDatabase db = cache->connection.isNull() ? QSqlDatabase::database() : QSqlDatabase::database(cache->connection);
+        q = new QSqlQuery(db);
+        q->setForwardOnly(true);
+        q->prepare(sql);
+        cache->queries.insert(sql, q);
+    } else if (q->lastError().isValid()) {
+        /* Table created in the meantime, connection lost, ... */
+        q->prepare(sql);
+    }
+
+    return *q;
+}
+
+void SQLCreator::setThreadConnection(const QString &name)
+{
+    StatementCache *cache = statementCache();
+
+    if (cache->connection != name) {
+        qDeleteAll(cache->queries);
+        cache->queries.clear();
+        cache->connection = name;
+    }
+}
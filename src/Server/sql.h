@@ -90,6 +90,14 @@ public:
         }
     }
 
+    /* Returns a query already prepared with the given SQL for the current thread,
+       so the database doesn't have to parse it again. Bind the values, exec(), and
+       finish() it when done as it will be reused. */
+    static QSqlQuery &statement(const QString &sql);
+    /* The connection statements of the current thread are prepared on. The default
+       connection is used if none is set. */
+    static void setThreadConnection(const QString &name);
+
     enum DataBaseType  {
         NoSql=-1,
         SQLite=0,
@@ -19,6 +19,8 @@ unsigned int qHash (const Pokemon::uniqueId &key);
 #include "server.h"
 #include "waitingobject.h"
 #include "loadinsertthread.h"
+#include "asyncsql.h"
+#include "bulktransfer.h"
 
 QString MemberRating::toString() const
 {
@@ -85,6 +87,24 @@ void MemberRating::calculateDisplayedRating()
     }
 }
 
+bool MemberRating::applyDecay()
+{
+    int old_displayed = displayed_rating;
+    int old_check = last_check_time;
+    int old_bonus = bonus_time;
+
+    calculateDisplayedRating();
+
+    if (displayed_rating != old_displayed) {
+        return true;
+    }
+
+    /* Nothing visible changed, no need to write anything back */
+    last_check_time = old_check;
+    bonus_time = old_bonus;
+    return false;
+}
+
 QPair<int, int> MemberRating::pointChangeEstimate(int opponent_rating)
 {
     int n = matches;
@@ -172,70 +192,30 @@ void Tier::loadSqlFromFile()
         query.exec(QString("create index %1_tiername_index on %1 (name)").arg(sql_table));
         query.exec(QString("create index %1_tierrating_index on %1 (displayed_rating)").arg(sql_table));
 
-        QFile in("serverdb/tier_" + name() + ".txt");
+        QString path = "serverdb/tier_" + name() + ".txt";
 
-        if (!in.exists()) {
+        if (!QFile::exists(path)) {
             return;
         }
 
         Server::print(QString("Importing old database for tier %1 to table %2").arg(name(), sql_table));
 
-        in.open(QIODevice::ReadOnly);
-
-        QStringList members = QString::fromUtf8(in.readAll()).split('\n');
-
-        clock_t t = clock();
         int current_time = time(NULL);
 
-        if (members.size() > 0) {
-            int count = members[0].split('%').size();
-
-            QSqlDatabase::database().transaction();
-            query.prepare(QString("insert into %1(name, rating, displayed_rating, last_check_time, bonus_time, matches, winCount) "
-                                  "values (:name, :rating, :displayed_rating, :last_check_time, :bonus_time, :matches, :winCount)").arg(sql_table));
-            if (count == 3) {
-                foreach(QString member, members) {
-                    QString m2 = member.toLower();
-                    QStringList mmr = m2.split('%');
-                    if (mmr.size() != 3)
-                        continue;
-
-                    query.bindValue(":name", mmr[0].toLower());
-                    query.bindValue(":matches", mmr[1].toInt());
-                    query.bindValue(":rating", mmr[2].toInt());
-                    query.bindValue(":displayed_rating", mmr[2].toInt());
-                    query.bindValue(":last_check_time", current_time);
-                    query.bindValue(":bonus_time", 0);
-
-                    query.exec();
-                }
-            } else if (count == 6 || count == 7) {
-                foreach(QString member, members) {
-                    QString m2 = member.toLower();
-                    QStringList mmr = m2.split('%');
-                    if (mmr.size() != 6 && mmr.size() != 7)
-                        continue;
-
-                    query.bindValue(":name", mmr[0].toLower());
-                    query.bindValue(":matches", mmr[1].toInt());
-                    query.bindValue(":rating", mmr[2].toInt());
-                    query.bindValue(":displayed_rating", mmr[3].toInt());
-                    query.bindValue(":last_check_time", mmr[4].toInt());
-                    query.bindValue(":bonus_time", mmr[5].toInt());
-                    if (mmr.size() == 7)
-                        query.bindValue(":winCount", mmr[6].toInt());
-
-                    query.exec();
-                }
-            }
-
-            QSqlDatabase::database().commit();
-        }
+        BulkTransfer::importFile(path, sql_table, ladderColumns(), [current_time](const QByteArray &line, BulkTransfer::Row &row) {
+            QList<QByteArray> mmr = line.split('%');
 
-        t = clock() - t;
+            if (mmr.size() == 3) {
+                row << QString::fromUtf8(mmr[0]).toLower() << mmr[1].toInt() << mmr[2].toInt() << mmr[2].toInt() << current_time << 0 << 0;
+            } else if (mmr.size() == 6 || mmr.size() == 7) {
+                row << QString::fromUtf8(mmr[0]).toLower() << mmr[1].toInt() << mmr[2].toInt() << mmr[3].toInt() << mmr[4].toInt()
+                    << mmr[5].trimmed().toInt() << (mmr.size() == 7 ? mmr[6].toInt() : 0);
+            } else {
+                return false;
+            }
 
-        Server::print(QString::number(float(t)/CLOCKS_PER_SEC) + " secs");
-        Server::print(query.lastError().text());
+            return true;
+        });
     }
 }
 
@@ -243,11 +223,21 @@ void Tier::loadFromFile()
 {
     if (isSql()) {
         loadSqlFromFile();
+
+        /* Counted once right away, so that the tier doesn't look empty until the
+           first refresh is done. Only the refreshes are in the background */
+        QSqlQuery q;
+        q.setForwardOnly(true);
+        q.exec(QString("select count(*) from %1").arg(sql_table));
+        m_count = q.next() ? q.value(0).toInt() : 0;
+        last_count_time = time(NULL);
+        q.finish();
         return;
     }
 
     ratings.clear();
-    rankings = decltype(rankings)();
+    rankings.clear();
+    rankedNames.clear();
 
     delete in;
     in = new QFile("serverdb/tier_" + name() + ".txt");
@@ -278,7 +268,6 @@ void Tier::loadFromFile()
             m.winCount = mmr[6].toInt();
         }
 
-        m.node = rankings.insert(m.displayed_rating, m.name);
         ratings[m.name] = m;
     }
 
@@ -289,6 +278,9 @@ void Tier::loadFromFile()
 
     for (auto it = ratings.begin(); it != ratings.end(); ++it) {
         it->second.filePos = pos;
+        it->second.rankId = rankedNames.size();
+        rankedNames.push_back(it->second.name);
+        rankings.insert(it->second.displayed_rating, it->second.rankId);
         in->write(it->second.toString().toUtf8());
         pos = in->pos();
     }
@@ -303,19 +295,47 @@ int Tier::count()
         if (m_count != -1 && time(NULL) - last_count_time < 3600) {
             return m_count;
         } else {
-            QSqlQuery q;
-            q.setForwardOnly(true);
-
-            q.exec(QString("select count(*) from %1").arg(sql_table));
-
-            q.next();
-            last_count_time = time(NULL);
-            return (m_count = q.value(0).toInt());
+            refreshCount();
+            return std::max(m_count, 0);
         }
     }
     return ratings.size();
 }
 
+void Tier::refreshCount()
+{
+    if (countPending) {
+        return;
+    }
+    countPending = true;
+
+    QString table = sql_table;
+    QString tier = name();
+    int version = boss->version;
+
+    AsyncSql::query([table]() {
+        QSqlQuery &q = SQLCreator::statement(QString("select count(*) from %1").arg(table));
+        q.exec();
+        QVariant ret = q.next() ? q.value(0) : QVariant();
+        q.finish();
+        return ret;
+    }, [tier, version](const QVariant &count) {
+        TierMachine *boss = TierMachine::obj();
+
+        /* The tier may have been reloaded in the meantime */
+        if (boss->version != version || !boss->exists(tier)) {
+            return;
+        }
+
+        Tier &t = boss->tier(tier);
+        t.countPending = false;
+        if (count.isValid()) {
+            t.m_count = count.toInt();
+            t.last_count_time = time(NULL);
+        }
+    });
+}
+
 void Tier::addBanParent(Tier *t)
 {
     if (!t) {
@@ -493,21 +513,20 @@ int Tier::ranking(const QString &name)
 
     if (isSql()) {
         int r = rating(name);
-        QSqlQuery q;
-        q.setForwardOnly(true);
-        q.prepare(QString("select count(*) from %1 where (displayed_rating>:r1 or (displayed_rating=:r2 and name<=:name))").arg(sql_table));
+        QSqlQuery &q = SQLCreator::statement(QString("select count(*) from %1 where (displayed_rating>:r1 or (displayed_rating=:r2 and name<=:name))").arg(sql_table));
         q.bindValue(":r1", r);
         q.bindValue(":r2", r);
         q.bindValue(":name", name.toLower());
         q.exec();
 
-        if (q.next())
-            return q.value(0).toInt();
-        else
-            return -1;
+        int ret = q.next() ? q.value(0).toInt() : -1;
+        q.finish();
+
+        return ret;
     }
 
-    return ratings.at(name).node->ranking();
+    const MemberRating &m = ratings.at(name);
+    return rankings.ranking(m.displayed_rating, m.rankId);
 }
 
 bool Tier::isValid(const TeamBattle &t)  const
@@ -596,11 +615,14 @@ MemberRating Tier::member(const QString &name)
     if (!holder.isInMemory(name))
         loadMemberInMemory(name);
 
-    if (isSql()) {
-        return holder.member(name);
-    } else {
-        return ratings[name];
+    MemberRating m = isSql() ? holder.member(name) : ratings[name];
+
+    /* Decay is computed lazily, the daily run only catches up on members nobody looked at */
+    if (m.applyDecay()) {
+        updateMember(m);
     }
+
+    return m;
 }
 
 int Tier::rating(const QString &name)
@@ -608,11 +630,7 @@ int Tier::rating(const QString &name)
     if (!holder.isInMemory(name))
         loadMemberInMemory(name);
     if (exists(name)) {
-        if (isSql()) {
-            return holder.member(name).displayed_rating;
-        } else {
-            return ratings[name].displayed_rating;
-        }
+        return member(name).displayed_rating;
     } else {
         return 1000;
     }
@@ -745,23 +763,25 @@ void Tier::exportDatabase() const
         return;
     }
 
-    QFile out(QString("tier_%1.txt").arg(name()));
-
-    out.open(QIODevice::WriteOnly);
-
-    QSqlQuery q;
-    q.setForwardOnly(true);
-
-    q.exec(QString("select name, matches, rating, displayed_rating, last_check_time, bonus_time, winCount from %1 order by name asc").arg(sql_table));
-
-    while (q.next()) {
-        MemberRating m(q.value(0).toString(), q.value(1).toInt(), q.value(2).toInt(), q.value(3).toInt(), q.value(4).toInt(), q.value(5).toInt());
-        out.write(m.toString().toUtf8());
+    {
+        QDir d;
+        d.mkdir("serverdb");
     }
 
+    BulkTransfer::exportTable(sql_table, ladderColumns(), "name asc", "serverdb/tier_" + name() + ".txt", [](const BulkTransfer::Row &r) {
+        MemberRating m(r[0].toString(), r[1].toInt(), r[2].toInt(), r[3].toInt(), r[4].toInt(), r[5].toInt(), r[6].toInt());
+        return m.toString().toUtf8();
+    });
+
     Server::print(QString("Database of tier %1 exported!").arg(name()));
 }
 
+/* In the order of MemberRating's constructor */
+QStringList Tier::ladderColumns()
+{
+    return QStringList() << "name" << "matches" << "rating" << "displayed_rating" << "last_check_time" << "bonus_time" << "winCount";
+}
+
 /* Precondition: name is in lowercase */
 void Tier::processQuery(QSqlQuery *q, const QVariant &name, int type, WaitingObject *w)
 {
@@ -771,16 +791,16 @@ void Tier::processQuery(QSqlQuery *q, const QVariant &name, int type, WaitingObj
     if (type == GetInfoOnUser) {
         assert(isSql());//Should never reach here otherwise
 
-        q->prepare(QString("select matches, rating, displayed_rating, last_check_time, bonus_time, winCount from %1 where name=? limit 1").arg(sql_table));
-        q->addBindValue(name);
-        q->exec();
-        if (!q->next()) {
+        QSqlQuery &query = SQLCreator::statement(QString("select matches, rating, displayed_rating, last_check_time, bonus_time, winCount from %1 where name=? limit 1").arg(sql_table));
+        query.addBindValue(name);
+        query.exec();
+        if (!query.next()) {
             holder.addNonExistant(name.toString());
         } else {
-            MemberRating m(name.toString(), q->value(0).toInt(), q->value(1).toInt(), q->value(2).toInt(), q->value(3).toInt(), q->value(4).toInt());
+            MemberRating m(name.toString(), query.value(0).toInt(), query.value(1).toInt(), query.value(2).toInt(), query.value(3).toInt(), query.value(4).toInt());
             holder.addMemberInMemory(m);
         }
-        q->finish();
+        query.finish();
     } else if (type == GetRankings) {
         int page;
 
@@ -802,34 +822,36 @@ void Tier::processQuery(QSqlQuery *q, const QVariant &name, int type, WaitingObj
         int startingRank = (page-1) * TierMachine::playersByPage + 1;
 
         if (isSql()) {
+            QString sql;
             if (SQLCreator::databaseType == SQLCreator::PostGreSQL)
-                q->prepare(QString("select name, displayed_rating from %1 order by displayed_rating desc, name asc offset :offset limit :limit").arg(sql_table));
+                sql = QString("select name, displayed_rating from %1 order by displayed_rating desc, name asc offset :offset limit :limit").arg(sql_table);
             else
-                q->prepare(QString("select name, displayed_rating from %1 order by displayed_rating desc, name asc limit :offset, :limit").arg(sql_table));
+                sql = QString("select name, displayed_rating from %1 order by displayed_rating desc, name asc limit :offset, :limit").arg(sql_table);
 
-            q->bindValue(":offset", startingRank-1);
-            q->bindValue(":limit", TierMachine::playersByPage);
+            QSqlQuery &query = SQLCreator::statement(sql);
+            query.bindValue(":offset", startingRank-1);
+            query.bindValue(":limit", TierMachine::playersByPage);
 
-            q->exec();
-            while (q->next()) {
-                results.push_back(QPair<QString, int>(q->value(0).toString(), q->value(1).toInt()));
+            query.exec();
+            while (query.next()) {
+                results.push_back(QPair<QString, int>(query.value(0).toString(), query.value(1).toInt()));
             }
 
-            q->finish();
+            query.finish();
 
             w->data["rankingdata"] = QVariant::fromValue(results);
 
             return;
         }
 
-        RankingTree<QString>::iterator it = rankings.getByRanking(startingRank);
+        auto it = rankings.getByRanking(startingRank);
 
         int i = 0;
-        while (i < TierMachine::playersByPage && it.p != NULL)
+        while (i < TierMachine::playersByPage && it.valid())
         {
             i++;
-            results.push_back(QPair<QString, int> (it->data, it->key));
-            --it;
+            results.push_back(QPair<QString, int> (rankedNames[it.data()], it.key()));
+            ++it;
         }
 
         w->data["rankingdata"] = QVariant::fromValue(results);
@@ -843,23 +865,25 @@ void Tier::insertMember(QSqlQuery *q, void *data, int update)
     MemberRating &m = *(MemberRating*) data;
 
     if (isSql()) {
+        QString sql;
         if (update)
-            q->prepare(QString("update %1 set matches=:matches, rating=:rating, displayed_rating=:displayed_rating, last_check_time=:last_check_time,"
-                               "bonus_time=:bonus_time, winCount=:winCount where name=:name").arg(sql_table));
+            sql = QString("update %1 set matches=:matches, rating=:rating, displayed_rating=:displayed_rating, last_check_time=:last_check_time,"
+                          "bonus_time=:bonus_time, winCount=:winCount where name=:name").arg(sql_table);
         else
-            q->prepare(QString("insert into %1(name, matches, rating, displayed_rating, last_check_time, bonus_time, winCount)"
-                               "values(:name, :matches, :rating, :displayed_rating, :last_check_time, :bonus_time, :winCount)").arg(sql_table));
-
-        q->bindValue(":name", m.name.toLower());
-        q->bindValue(":matches", m.matches);
-        q->bindValue(":rating", m.rating);
-        q->bindValue(":displayed_rating", m.displayed_rating);
-        q->bindValue(":last_check_time", m.last_check_time);
-        q->bindValue(":bonus_time", m.bonus_time);
-        q->bindValue(":winCount", m.winCount);
+            sql = QString("insert into %1(name, matches, rating, displayed_rating, last_check_time, bonus_time, winCount)"
+                          "values(:name, :matches, :rating, :displayed_rating, :last_check_time, :bonus_time, :winCount)").arg(sql_table);
+
+        QSqlQuery &query = SQLCreator::statement(sql);
+        query.bindValue(":name", m.name.toLower());
+        query.bindValue(":matches", m.matches);
+        query.bindValue(":rating", m.rating);
+        query.bindValue(":displayed_rating", m.displayed_rating);
+        query.bindValue(":last_check_time", m.last_check_time);
+        query.bindValue(":bonus_time", m.bonus_time);
+        query.bindValue(":winCount", m.winCount);
 
-        q->exec();
-        q->finish();
+        query.exec();
+        query.finish();
 
         return;
     }
@@ -867,16 +891,19 @@ void Tier::insertMember(QSqlQuery *q, void *data, int update)
     if (update) {
         MemberRating oldm = ratings.at(m.name);
         m.filePos = oldm.filePos;
-        m.node = oldm.node;
+        m.rankId = oldm.rankId;
+        rankedNames[m.rankId] = m.name;
 
         in->seek(m.filePos);
         in->write(m.toString().toUtf8());
 
         ratings[m.name] = m;
-        ratings[m.name].node = rankings.changeKey(m.node.node(), m.rating);
+        rankings.changeKey(m.rankId, oldm.displayed_rating, m.displayed_rating);
     } else {
         m.filePos = lastFilePos;
-        m.node = rankings.insert(m.rating, m.name);
+        m.rankId = rankedNames.size();
+        rankedNames.push_back(m.name);
+        rankings.insert(m.displayed_rating, m.rankId);
         in->seek(lastFilePos);
         in->write(m.toString().toUtf8());
         lastFilePos = in->pos();
@@ -995,7 +1022,8 @@ void Tier::resetLadder()
         return;
     }
     ratings.clear();
-    rankings = decltype(rankings)();
+    rankings.clear();
+    rankedNames.clear();
 
     in->remove();
     in->open(QIODevice::ReadWrite);
@@ -1270,7 +1298,10 @@ void Tier::importRestrictedPokes(const QString &s)
 Tier::Tier(TierMachine *boss, TierCategory *cat) : boss(boss), node(cat), holder(1000) {
     m_count = -1;
     last_count_time = 0;
+    countPending = false;
     in = nullptr;
+    sweepPos = 0;
+    sweepEnd = -1;
     banPokes = true;
     parent = nullptr;
     m_gen = Pokemon::gen(GenInfo::GenMax(), GenInfo::NumberOfSubgens(GenInfo::GenMax())-1);
@@ -1359,107 +1390,159 @@ Tier *Tier::dataClone() const
     return ret;
 }
 
-void Tier::processDailyRun()
+void Tier::startDailyRun()
 {
-    if (isSql()) {
-        QSqlQuery query;
-
-        query.setForwardOnly(true);
+    sweepPos = 0;
+    sweepEnd = -1;
+    sweepName.clear();
+}
 
-        Server::print(QString("Running Daily Run for tier %1").arg(name()));
+bool Tier::processDailyRunChunk(QSqlQuery *q)
+{
+    const int hpp = TierMachine::obj()->hours_per_period;
+    const int msp = TierMachine::obj()->max_saved_periods;
+    const int ppp = TierMachine::obj()->percent_per_period;
+    const int mpd = TierMachine::obj()->max_percent_decay;
+    const int min_bonus_time = -TierMachine::obj()->alt_expiration * 3600 * 24 * 30;
 
-        clock_t t = clock();
+    if (isSql()) {
+        /* Called from the load/insert thread, so no Server::print here */
+        if (sweepEnd == -1) {
+            q->exec(QString("select max(id) from %1").arg(sql_table));
+            sweepEnd = q->next() ? q->value(0).toInt() : 0;
+            q->finish();
 
-        QSqlDatabase::database().transaction();
+            qDebug() << "Running Daily Run for tier" << name();
+        }
 
-        query.prepare(QString("select name, matches, rating, displayed_rating, last_check_time, bonus_time, winCount from %1").arg(sql_table));
-        query.exec();
+        if (sweepPos >= sweepEnd) {
+            return false;
+        }
 
-        QStringList names;
+        int from = sweepPos;
+        int to = sweepPos + dailyRunChunkSize;
+        sweepPos = to;
 
-        while (query.next()) {
-            QString name = query.value(0).toString();
-            names.push_back(name);
-            if (!holder.isInMemory(name)) {
-                MemberRating m(query.value(0).toString(), query.value(1).toInt(), query.value(2).toInt(), query.value(3).toInt(),
-                               query.value(4).toInt(), query.value(5).toInt());
-                m.calculateDisplayedRating();
-                holder.addMemberInMemory(m);
-            } else {
-                MemberRating m = holder.member(name);
-                m.calculateDisplayedRating();
-                holder.addMemberInMemory(m);
+        /* Same computation as MemberRating::calculateDisplayedRating, done by the database
+           on a range of ids. MySQL's / is not an integer division. */
+        auto div = [](const QString &a, const QString &b) {
+            if (SQLCreator::databaseType == SQLCreator::MySQL) {
+                return QString("((%1) div (%2))").arg(a, b);
             }
-        }
-
-        query.finish();
+            return QString("((%1) / (%2))").arg(a, b);
+        };
+        QString now = QString::number(time(NULL));
+        QString maxBonus = QString::number(msp * hpp * 3600);
+        QString bonus = QString("bonus_time + last_check_time - %1").arg(now);
+        QString percent = QString("%1 * %2").arg(div("-bonus_time", QString::number(hpp*3600))).arg(ppp);
+
+        q->prepare(QString("update %1 set bonus_time = case when %2 > %3 then %3 else %2 end, last_check_time = %4 "
+                           "where id > ? and id <= ?").arg(sql_table, bonus, maxBonus, now));
+        q->addBindValue(from);
+        q->addBindValue(to);
+        q->exec();
 
-        foreach(QString name, names) {
-            MemberRating m = holder.member(name);
-            insertMember(&query, &m, true);
-        }
+        q->prepare(QString("update %1 set displayed_rating = case when bonus_time > 0 then rating "
+                           "else 1000 + %2 end where id > ? and id <= ?").arg(sql_table,
+                    div(QString("(rating-1000) * (100 - case when %1 > %2 then %2 else %1 end)").arg(percent).arg(mpd), "100")));
+        q->addBindValue(from);
+        q->addBindValue(to);
+        q->exec();
 
-        /* After updating all, deleting the old members */
-        int min_bonus_time = -TierMachine::obj()->alt_expiration * 3600 * 24 * 30;
-        query.prepare(QString("select name from %1 where bonus_time<%2").arg(sql_table).arg(min_bonus_time));
-        query.exec();
+        /* After updating, deleting the old members */
+        q->prepare(QString("select name from %1 where id > ? and id <= ? and bonus_time < ?").arg(sql_table));
+        q->addBindValue(from);
+        q->addBindValue(to);
+        q->addBindValue(min_bonus_time);
+        q->exec();
 
         int count = 0;
-
-        while (query.next()) {
-            holder.removeMemberInMemory(query.value(0).toString());
+        while (q->next()) {
+            holder.removeMemberInMemory(q->value(0).toString());
             count ++;
         }
-        Server::print(QString("%1 alts removed from the ladder.").arg(count));
-
-        query.prepare(QString("delete from %1 where bonus_time<%2").arg(sql_table).arg(min_bonus_time));
-        query.exec();
-
-        holder.cleanCache();
+        q->finish();
 
-        QSqlDatabase::database().commit();
+        if (count > 0) {
+            q->prepare(QString("delete from %1 where id > ? and id <= ? and bonus_time < ?").arg(sql_table));
+            q->addBindValue(from);
+            q->addBindValue(to);
+            q->addBindValue(min_bonus_time);
+            q->exec();
+            q->finish();
 
-        t = clock() - t;
+            qDebug() << count << "alts removed from the ladder of tier" << name();
+        }
 
-        Server::print(QString::number(float(t)/CLOCKS_PER_SEC) + " secs");
-        Server::print(query.lastError().text());
+        if (q->lastError().isValid()) {
+            qDebug() << q->lastError().text();
+        }
 
-        return;
+        return sweepPos < sweepEnd;
     }
 
-    Server::print(QString("Running Daily Run for tier %1").arg(name()));
+    auto it = sweepName.isNull() ? ratings.begin() : ratings.upper_bound(sweepName);
 
-    clock_t t = clock();
+    if (sweepName.isNull()) {
+        Server::print(QString("Running Daily Run for tier %1").arg(name()));
+    }
 
     int count = 0;
-    int min_bonus_time = -TierMachine::obj()->alt_expiration * 3600 * 24 * 30;
 
-    for (auto it = ratings.begin(); it != ratings.end(); ) {
+    for (int i = 0; i < dailyRunChunkSize && it != ratings.end(); i++) {
         auto &m = it->second;
+        int oldKey = m.displayed_rating;
+
+        m.calculateDisplayedRating();
 
         if (m.bonus_time < min_bonus_time) {
+            rankings.remove(oldKey, m.rankId);
+
             m.name[0] = ':';
 
             in->seek(m.filePos);
             in->write(m.toString().toUtf8());
 
             it = ratings.erase(it);
+            count++;
         } else {
-            m.calculateDisplayedRating();
-
             in->seek(m.filePos);
             in->write(m.toString().toUtf8());
 
+            rankings.changeKey(m.rankId, oldKey, m.displayed_rating);
+            sweepName = it->first;
             ++it;
         }
     }
 
-    Server::print(QString("%1 alts removed from the ladder.").arg(count));
+    if (count > 0) {
+        Server::print(QString("%1 alts removed from the ladder of tier %2.").arg(count).arg(name()));
+    }
 
-    /* Regenerate rankings & all */
-    loadFromFile();
+    if (it == ratings.end()) {
+        in->flush();
+        compactRankIds();
+        return false;
+    }
 
-    t = clock() - t;
+    return true;
+}
 
-    Server::print(QString::number(float(t)/CLOCKS_PER_SEC) + " secs");
+/* The rank ids of the members removed by the sweep are only given back here,
+   once it's done, by numbering the members again */
+void Tier::compactRankIds()
+{
+    if (rankedNames.size() == int(ratings.size())) {
+        return;
+    }
+
+    rankings.clear();
+    rankedNames.clear();
+    rankedNames.reserve(ratings.size());
+
+    for (auto it = ratings.begin(); it != ratings.end(); ++it) {
+        it->second.rankId = rankedNames.size();
+        rankedNames.push_back(it->second.name);
+        rankings.insert(it->second.displayed_rating, it->second.rankId);
+    }
 }
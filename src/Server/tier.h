@@ -5,7 +5,7 @@
 #include <ctime>
 
 #include <Utilities/coreclasses.h>
-#include <Utilities/rankingtree.h>
+#include <Utilities/ladderindex.h>
 
 #include <PokemonInfo/pokemon.h>
 #include <PokemonInfo/geninfo.h>
@@ -36,11 +36,12 @@ struct MemberRating
     int winCount;
 
     int filePos;
-    RankingTree<QString>::iterator node;
+    /* Index in Tier::rankedNames, for flat file ladders */
+    int rankId;
 
     MemberRating(const QString &name="", int matches=0, int rating=1000, int displayed_rating = 1000,
                  int last_check_time = -1, int bonus_time = 0, int winCount = 0) : name(name), matches(matches), rating(rating),
-                   displayed_rating(displayed_rating), bonus_time(bonus_time), winCount(winCount) {
+                   displayed_rating(displayed_rating), bonus_time(bonus_time), winCount(winCount), filePos(0), rankId(-1) {
         if (last_check_time == -1) {
             this->last_check_time = time(nullptr);
         } else {
@@ -51,6 +52,9 @@ struct MemberRating
     QString toString() const;
     void changeRating(int other, bool win);
     void calculateDisplayedRating();
+    /* Brings the decay up to date, returns true if the displayed rating changed.
+       Leaves the member untouched otherwise */
+    bool applyDecay();
     QPair<int, int> pointChangeEstimate(int otherRating);
 };
 
@@ -137,7 +141,11 @@ public:
     void importBannedAbilities(const QString &);
 
     void exportDatabase() const;
-    void processDailyRun();
+    /* Resets the daily run cursor, the ladder is then swept one chunk at a time */
+    void startDailyRun();
+    /* Processes the next chunk of the daily run. Returns false once the whole ladder
+       has been swept. In SQL mode it's called from the load/insert thread */
+    bool processDailyRunChunk(QSqlQuery *q);
     /* Removes all ranking */
     void resetLadder();
     /* Clears the cache, forces synchronization with SQL database */
@@ -183,6 +191,8 @@ protected:
     void loadSqlFromFile();
 
 private:
+    static QStringList ladderColumns();
+
     TierMachine *boss;
     TierCategory *node;
 
@@ -205,6 +215,9 @@ private:
     /* Used for table name in SQL database */
     QString sql_table;
     int m_count, last_count_time;
+    bool countPending;
+    /* Updates m_count in the background */
+    void refreshCount();
 
     int m_id;
 
@@ -217,8 +230,18 @@ private:
     LoadInsertThread<MemberRating> *getThread();
 
     istringmap<MemberRating> ratings;
-    RankingTree<QString> rankings;
+    /* Members are stored by rank id in the index, so that moving them
+       around in a rating bucket doesn't copy strings */
+    LadderIndex<int> rankings;
+    QVector<QString> rankedNames;
+    void compactRankIds();
     int lastFilePos;
+
+    /* Daily run cursor: last id swept and max id for SQL, last name swept for files */
+    int sweepPos, sweepEnd;
+    QString sweepName;
+
+    static const int dailyRunChunkSize = 500;
 };
 
 #endif // TIER_H
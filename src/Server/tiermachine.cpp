@@ -4,6 +4,8 @@
 #include "loadinsertthread.h"
 #include "tiermachine.h"
 #include "tier.h"
+#include "server.h"
+#include "sql.h"
 
 TierMachine* TierMachine::inst;
 
@@ -30,6 +32,12 @@ TierMachine::TierMachine()
 
     connect(thread , SIGNAL(processLoad (QSqlQuery*, QVariant, int, WaitingObject*)), this, SLOT(processQuery(QSqlQuery*, QVariant, int, WaitingObject *)), Qt::DirectConnection);
     connect(thread, SIGNAL(processWrite(QSqlQuery*, void*,int)), this, SLOT(insertMember(QSqlQuery*, void*,int)), Qt::DirectConnection);
+    connect(thread, SIGNAL(processDailyRun(QSqlQuery*)), this, SLOT(dailyRunChunk(QSqlQuery*)), Qt::DirectConnection);
+
+    dailyRunTier = 0;
+    dailyRunBusy = false;
+    dailyRunTimer = new QTimer(this);
+    connect(dailyRunTimer, SIGNAL(timeout()), SLOT(dailyRunStep()));
 
     thread->start();
 
@@ -180,6 +188,11 @@ void TierMachine::fromString(const QString &s)
 
     semaphore.release(semaphoreMaxLoad);
 
+    /* The tiers the daily run was working on are gone, start over with the new ones */
+    if (dailyRunTimer->isActive()) {
+        processDailyRun();
+    }
+
     emit tiersChanged();
 }
 
@@ -326,6 +339,59 @@ TierTree *TierMachine::getDataTree() const
 void TierMachine::processDailyRun()
 {
     for(int i = 0; i < m_tiers.size(); i++) {
-        m_tiers[i]->processDailyRun();
+        m_tiers[i]->startDailyRun();
+    }
+
+    dailyRunTier = 0;
+    dailyRunTimer->start(dailyRunInterval);
+}
+
+void TierMachine::dailyRunStep()
+{
+    if (dailyRunBusy) {
+        return;
+    }
+
+    if (dailyRunTier >= m_tiers.size()) {
+        dailyRunTimer->stop();
+        Server::print("Daily run for ladders finished.");
+        return;
+    }
+
+    if (isSql()) {
+        /* The chunk is run in the load/insert thread, in between member queries */
+        dailyRunBusy = true;
+        thread->addDailyRun();
+    } else {
+        dailyRunChunkDone(m_tiers[dailyRunTier]->processDailyRunChunk(nullptr), version);
+    }
+}
+
+void TierMachine::dailyRunChunk(QSqlQuery *q)
+{
+    semaphore.acquire();
+
+    /* Safe, dailyRunTier only changes when no chunk is being processed */
+    bool more = false;
+    if (dailyRunTier < m_tiers.size()) {
+        more = m_tiers[dailyRunTier]->processDailyRunChunk(q);
+    }
+
+    QMetaObject::invokeMethod(this, "dailyRunChunkDone", Qt::QueuedConnection, Q_ARG(bool, more), Q_ARG(int, version));
+
+    semaphore.release();
+}
+
+void TierMachine::dailyRunChunkDone(bool more, int version)
+{
+    dailyRunBusy = false;
+
+    /* Tiers were reloaded in the meantime */
+    if (version != this->version) {
+        return;
+    }
+
+    if (!more) {
+        dailyRunTier += 1;
     }
 }
@@ -76,9 +76,13 @@ signals:
 public slots:
     void processQuery(QSqlQuery *q, const QVariant &,int,WaitingObject*);
     void insertMember(QSqlQuery *q,void *,int);
-    /* Processes the daily run in which ratings are updated.
-       Be aware that it may take long. I may thread it in the future. */
+    /* Starts the daily run in which ratings are updated. Ladders are swept
+       a chunk at a time in the background, ratings also decay lazily on access */
     void processDailyRun();
+private slots:
+    void dailyRunStep();
+    void dailyRunChunk(QSqlQuery *q);
+    void dailyRunChunkDone(bool more, int version);
 private:
     QList<Tier*> m_tiers;
     QHash<QString, Tier*> m_tierByNames;
@@ -94,6 +98,13 @@ private:
 
     LoadInsertThread<MemberRating> * getThread();
 
+    /* Daily run state, only touched in the main thread */
+    QTimer *dailyRunTimer;
+    int dailyRunTier;
+    bool dailyRunBusy;
+    /* Delay between two chunks of the daily run */
+    static const int dailyRunInterval = 2000;
+
     /* Number gets increased by one every time tiers are reloaded.
 
         So that if tiers are reloaded while a threaded query was already thrown,
@@ -59,7 +59,9 @@ namespace BattleCommands {
         CappedStat,
         UsePP,
         Notice, /* Two strings: type & content */
-        HtmlMessage /* Full html message */
+        HtmlMessage, /* Full html message */
+        SituationSnapshot /* List of commands showing the battle to someone joining it. Only between
+                             the battle server and the server, which sends the commands one by one */
     };
 
     enum ChangeTempPoke {
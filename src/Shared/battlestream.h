@@ -0,0 +1,15 @@
+#ifndef BATTLESTREAM_H
+#define BATTLESTREAM_H
+
+/* Who a BattleStream message from the battle server is for. The battle server
+   sends each battle command once, and the server copies it to the players and
+   spectators of the battle. */
+namespace StreamAudience {
+    enum Audience {
+        All = 0, /* Players and spectators */
+        AllButPlayer, /* Everyone except the given player */
+        Player /* Only the given player or spectator */
+    };
+}
+
+#endif // BATTLESTREAM_H
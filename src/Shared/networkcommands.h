@@ -74,7 +74,11 @@ enum Command {
     SpecialPass,
     ServerListEnd,              // Indicates end of transmission for registry.
     SetIP,                      // Indicates that a proxy server sends the real ip of client
-    ServerPass                 // Prompts for the server password
+    ServerPass,                // Prompts for the server password
+    BattleStream,              // Battle server -> server only, a battle command and its audience (see battlestream.h)
+    ServerListVersion,         // Client -> registry, asks what changed in the server list since a version
+    ServerRemoved,             // Registry -> client, a server left the list
+    PlayerDelta                // What changed in players already known, PlayerInfoDelta repeated
 };
 
 enum ProtocolError {
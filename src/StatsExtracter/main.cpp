@@ -2,6 +2,7 @@
 #include <PokemonInfo/pokemoninfo.h>
 
 #include <QtCore>
+#include <cstring>
 #include <ctime>
 #include <Utilities/coreclasses.h>
 
@@ -412,17 +413,6 @@ static QString getIconLink(const Pokemon::uniqueId& pokemon)
     return QString("%1.png").arg(pokemon.toString());
 }
 
-struct Bcc {
-    QByteArray buffer;
-    int usage;
-    int leadUsage;
-
-    Bcc(const QByteArray &a, int usage, int leadUsage):
-        buffer(a), usage(usage), leadUsage(leadUsage) {
-
-    }
-};
-
 struct GlobalThings {
     QHash<int, int> moves;
     QHash<int, int> items;
@@ -440,6 +430,16 @@ struct GlobalThings {
     }
 };
 
+/* The sets of a pokemon, added up as the records are read rather than kept
+   until the end: the memory used depends on how many different sets there
+   are, not on how many battles were played */
+struct PokemonStats {
+    QMap<RawSet, MoveSet> movesets;
+    QMap<RawSet, MoveSet> leadsets;
+    GlobalThings globals;
+    AbilityGroup defAb;
+};
+
 void addMoveset(QMap<RawSet, MoveSet> &container, char *buffer, int usage, AbilityGroup defAb, GlobalThings &globals) {
     if (usage == 0)
         return;
@@ -566,6 +566,259 @@ bool loadRanks(QList<QPair<Pokemon::uniqueId, qint32> > &ranks, QString filename
     return true;
 }
 
+/* Each record: 32 bytes of set, then the usage and the lead usage */
+static const int recordSize = 32 + 2*sizeof(qint32);
+
+struct Tier {
+    QString name;
+
+    QHash<int, int> usage;
+    QHash<int, int> leadUsage;
+    qint32 totalusage;
+    QHash<int, PokemonStats> pokemons;
+    QList<QPair<Pokemon::uniqueId, qint32> > ranks;
+
+    /* Results */
+    int mostUsed;
+    qint64 records;
+    qint64 readTime, writeTime;
+
+    Tier() : totalusage(0), mostUsed(0), records(0), readTime(0), writeTime(0) {}
+
+    void addRecord(char buffer[32], qint32 iusage, qint32 ileadusage);
+};
+
+void Tier::addRecord(char buffer[32], qint32 iusage, qint32 ileadusage)
+{
+    records += 1;
+
+    int pokenum = *((qint32*) buffer);
+
+    if (pokenum != 0 && PokemonInfo::Exists(pokenum)) {
+        usage[pokenum] += iusage;
+        if (ileadusage > 0) {
+            leadUsage[pokenum] += ileadusage;
+        }
+
+        if (!pokemons.contains(pokenum)) {
+            pokemons[pokenum].defAb = PokemonInfo::Abilities(pokenum, GenInfo::GenMax());
+        }
+        PokemonStats &p = pokemons[pokenum];
+
+        addMoveset(p.movesets, buffer, iusage-ileadusage, p.defAb, p.globals);
+        addMoveset(p.leadsets, buffer, ileadusage, p.defAb, p.globals);
+    }
+    /* Avoid corrupted data , partially */
+    if (PokemonInfo::Exists(pokenum)) {
+        totalusage += iusage;
+    }
+}
+
+/* The file is mapped rather than read, and each record is added up as soon
+   as it's seen */
+static void readStatFile(const QString &path, Tier &tier)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly) || f.size() < 32) {
+        return;
+    }
+
+    QByteArray content;
+    const char *data = (const char*) f.map(0, f.size());
+    if (!data) {
+        content = f.readAll();
+        data = content.constData();
+    }
+
+    qint64 size = f.size();
+    char buffer[32];
+
+    for (qint64 pos = 0; pos + 32 <= size; pos += recordSize) {
+        memcpy(buffer, data + pos, 32);
+
+        /* A record cut at the end of the file has no usage */
+        qint32 iusage(0), ileadusage(0);
+        if (pos + 32 + qint64(sizeof(qint32)) <= size) {
+            memcpy(&iusage, data + pos + 32, sizeof(qint32));
+        }
+        if (pos + recordSize <= size) {
+            memcpy(&ileadusage, data + pos + 32 + sizeof(qint32), sizeof(qint32));
+        }
+
+        tier.addRecord(buffer, iusage, ileadusage);
+    }
+}
+
+/* Reads the raw stats of the tier and writes its pages. Several tiers are
+   done at the same time, each by one thread. */
+static void processTier(Tier &tier, const QString &rawDir, const QString &output, const QString &templates, QTextStream &log)
+{
+    QString dir = tier.name;
+    QDir d(rawDir + "/" + dir);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList files = d.entryList(QDir::Files);
+
+    log << "\nDoing Tier " << dir << "\n";
+
+    foreach(QString file, files) {
+        if (! (file.length() == 3 || file.indexOf(".stat") != -1)){
+            if (file == "ranks.rnk") {
+                loadRanks(tier.ranks, d.absoluteFilePath(file));
+            }
+            continue;
+        }
+
+        readStatFile(d.absoluteFilePath(file), tier);
+    }
+
+    tier.readTime = timer.restart();
+
+    QHash<int, int> &usage = tier.usage;
+    QHash<int, int> &leadUsage = tier.leadUsage;
+    QList<QPair<Pokemon::uniqueId, qint32> > &ranks = tier.ranks;
+
+    QDir outDir;
+    outDir.mkpath(output + "/" + dir);
+    outDir.cd(output + "/" + dir);
+
+    int totalBattles = tier.totalusage/6;
+
+    Skeleton tierSk(templates + "/tier_page.template");
+    tierSk.addDefaultValue("tier", dir);
+    tierSk.addDefaultValue("battles", totalBattles/2);
+
+    QHashIterator<int, int> hit(usage);
+    QMultiMap<int, int> reverseUsage;
+
+    while (hit.hasNext()) {
+        hit.next();
+        reverseUsage.insert(hit.value(), hit.key());
+    }
+
+    int i = 0;
+
+    QMapIterator<int, int> it(reverseUsage);
+    it.toBack();
+
+    while (it.hasPrevious()) {
+        i += 1;
+        it.previous();
+        Skeleton &childSk = tierSk.appendChild(i <= 5 ? "toppokemon" : "lowpokemon");
+        childSk.addDefaultValue("rank", i);
+        childSk.addDefaultValue("imagelink", getImageLink(it.value()));
+        childSk.addDefaultValue("iconlink", getIconLink(it.value()));
+        childSk.addDefaultValue("pokemonlink", QString("%1.html").arg(it.value()));
+        childSk.addDefaultValue("percentage", QString::number(double(100*it.key())/totalBattles,'f',2));
+        childSk.addDefaultValue("pokemon", PokemonInfo::Name(it.value()));
+    }
+
+    if (ranks.size() > 0) {
+        int total = 0;
+
+        for(int i = 0; i < ranks.size(); i++) {
+            total += ranks[i].second;
+        }
+
+        QFile out(outDir.absoluteFilePath("ranked_stats.txt"));
+        out.open(QIODevice::WriteOnly);
+        for(int i = 0; i < ranks.size(); i++) {
+            QString s = QString("%1 %2 %3").arg(PokemonInfo::Name(ranks[i].first)).arg(float(ranks[i].second*6*100)/total).arg(ranks[i].second);
+            out.write(s.toUtf8() + "\n");
+        }
+    }
+
+    QFile index(outDir.absoluteFilePath("index.html"));
+    index.open(QIODevice::WriteOnly);
+    index.write(tierSk.generate().toUtf8());
+    index.close();
+
+    it.toBack();
+
+    while (it.hasPrevious()) {
+        it.previous();
+
+        int pokemon = it.value();
+
+        int normalUsage = it.key() - leadUsage[pokemon];
+
+        log << "Doing Pokemon " << PokemonInfo::Name(pokemon) << "\n";
+
+        PokemonStats &stats = tier.pokemons[pokemon];
+        AbilityGroup defAb = stats.defAb;
+        GlobalThings &globals = stats.globals;
+
+        Skeleton s(templates + "/pokemon_page.template");
+        s.addDefaultValue("pokemon", PokemonInfo::Name(pokemon));
+        s.addDefaultValue("tier", dir);
+        s.addDefaultValue("imagelink", getImageLink(pokemon));
+        s.addDefaultValue("percentage", QString::number(double(100*it.key())/totalBattles,'f',2));
+        s.addDefaultValue("battles", it.key());
+        s.addDefaultValue("nonleadpercentage", QString::number(double(100*normalUsage)/totalBattles,'f',2));
+        s.addDefaultValue("nonleadbattles", normalUsage);
+        s.addDefaultValue("leadpercentage", QString::number(double(100*leadUsage[pokemon])/totalBattles,'f',2));
+        s.addDefaultValue("leadbattles", leadUsage[pokemon]);
+
+        parseMovesets(s, stats.movesets, "moveset", normalUsage);
+        parseMovesets(s, stats.leadsets, "leadmoveset", leadUsage[pokemon]);
+        parseGlobals(s, globals.moves, globals.totalMoves, "globalmove", "move", &MoveInfo::Name);
+        parseGlobals(s, globals.items, globals.totalItems, "globalitem", "item", &ItemInfo::Name);
+        QHash<int, int> abilities;
+        abilities[defAb.ab(0)] = globals.abilities[0];
+        int totAbilities = globals.abilities[0];
+        for (int i = 1; i < 3; i++) {
+            if (globals.abilities[i] > 0 && PokemonInfo::Abilities(pokemon, GenInfo::GenMax()).ab(i) != 0) {
+                abilities[defAb.ab(i)] = globals.abilities[i];
+                totAbilities += globals.abilities[i];
+            }
+        }
+
+        if (totAbilities > 0) {
+            parseGlobals(s, abilities, totAbilities, "globalability", "ability", &AbilityInfo::Name);
+        }
+
+        QFile pokef(outDir.absoluteFilePath("%1.html").arg(pokemon));
+        pokef.open(QIODevice::WriteOnly);
+        pokef.write(s.generate().toUtf8());
+
+        /* Not needed anymore */
+        tier.pokemons.remove(pokemon);
+    }
+
+    tier.mostUsed = reverseUsage.size() > 0 ? (--reverseUsage.end()).value() : 0;
+    tier.writeTime = timer.elapsed();
+}
+
+class TierTask : public QRunnable
+{
+public:
+    TierTask(Tier &tier, const QString &rawDir, const QString &output, const QString &templates)
+        : tier(tier), rawDir(rawDir), output(output), templates(templates) {
+    }
+
+    void run() {
+        QString text;
+        QTextStream log(&text);
+
+        processTier(tier, rawDir, output, templates, log);
+
+        log << QString("Tier %1: %2 records, %3 pokemon, read in %4 ms, written in %5 ms\n").arg(tier.name)
+               .arg(tier.records).arg(tier.usage.size()).arg(tier.readTime).arg(tier.writeTime);
+        log.flush();
+
+        /* The messages of a tier are written together */
+        static QMutex stdoutMutex;
+        QMutexLocker l(&stdoutMutex);
+        fputs(text.toUtf8().constData(), stdout);
+        fflush(stdout);
+    }
+private:
+    Tier &tier;
+    QString rawDir, output, templates;
+};
+
 int main(int argc, char *argv[])
 {
     (void) argc;
@@ -596,6 +849,7 @@ int main(int argc, char *argv[])
     QString input("usage_stats/raw");
     QString output("usage_stats/formatted");
     QString templates("usage_stats/templates");
+    int threads = 0;
 
     //parse commandline arguments
     for(int i = 0; i < argc; i++){
@@ -618,6 +872,7 @@ int main(int argc, char *argv[])
             PRINTOPT("-i, --input", "Path to the dir that contains binary stats. (default usage_stats/raw)");
             PRINTOPT("-o, --output", "Path to the dir to output stats. (default usage_stats/formatted)");
             PRINTOPT("-p, --templates", "Path to the template files. (default usage_stats/templates)");
+            PRINTOPT("-j, --threads [N]", "Number of tiers processed at the same time. (default: one per core)");
             fprintf(stdout, "\n");
             return 0;   //exit app
         } else if(strcmp( argv[i], "-t") == 0 || strcmp( argv[i], "--tier") == 0){
@@ -644,6 +899,12 @@ int main(int argc, char *argv[])
                 return 1;
             }
             output = argv[i];
+        } else if(strcmp( argv[i], "-j") == 0 || strcmp (argv[i], "--threads") == 0){
+            if (++i == argc){
+                fprintf(stderr, "No number of threads provided.\n");
+                return 1;
+            }
+            threads = atoi(argv[i]);
         }
     }
 
@@ -770,176 +1031,30 @@ int main(int argc, char *argv[])
         dirs = tiers;
     }
 
-    QList<QPair<QString, int> > mostUsedPokemon;
-
-    foreach(QString dir, dirs) {
-        d.cd(dir);
-
-        QStringList files = d.entryList(QDir::Files);
-
-        /* First we get the usage of each pokemon */
-        QHash<int, int> usage;
-        QHash<int, int> leadUsage;
-        qint32 totalusage(0);
-
-        QHash<int, QList<Bcc> > buffers;
-
-        QList<QPair<Pokemon::uniqueId, qint32> > ranks;
-
-        fprintf(stdout, "\nDoing Tier %s\n", dir.toUtf8().data());
-
-        foreach(QString file, files) {
-            if (! (file.length() == 3 || file.indexOf(".stat") != -1)){
-                if (file == "ranks.rnk") {
-                    loadRanks(ranks, d.absoluteFilePath(file));
-                }
-                continue;
-            }
-
-
-            FILE *f = fopen(d.absoluteFilePath(file).toLocal8Bit().data(), "rb");
+    QElapsedTimer timer;
+    timer.start();
 
-            char buffer[32];
+    /* Created before, so that the tiers don't all try to */
+    QDir().mkpath(output);
 
-            while (fread(buffer, sizeof(char), 32/sizeof(char), f) == 32) {
-                qint32 iusage(0), ileadusage(0);
-
-                fread(&iusage, sizeof(qint32), 1, f);
-                fread(&ileadusage, sizeof(qint32), 1, f);
-
-                int pokenum = *((qint32*) buffer);
-
-                if (pokenum != 0 && PokemonInfo::Exists(pokenum)) {
-                    usage[pokenum] += iusage;
-                    if (ileadusage > 0) {
-                        leadUsage[pokenum] += ileadusage;
-                    }
-                    buffers[pokenum].append(Bcc(QByteArray(buffer, 32), iusage, ileadusage));
-                }
-                /* Avoid corrupted data , partially */
-                if (PokemonInfo::Exists(pokenum)) {
-                    totalusage += iusage;
-                }
-            }
-
-            fclose(f);
-        }
-
-        QDir outDir;
-        outDir.mkpath(output + "/" + dir);
-        outDir.cd(output + "/" + dir);
-
-        int totalBattles = totalusage/6;
-
-        Skeleton tierSk(templates + "/tier_page.template");
-        tierSk.addDefaultValue("tier", dir);
-        tierSk.addDefaultValue("battles", totalBattles/2);
-
-        QHashIterator<int, int> hit(usage);
-        QMultiMap<int, int> reverseUsage;
-
-        while (hit.hasNext()) {
-            hit.next();
-            reverseUsage.insert(hit.value(), hit.key());
-        }
-
-        int i = 0;
-
-        QMapIterator<int, int> it(reverseUsage);
-        it.toBack();
-
-        while (it.hasPrevious()) {
-            i += 1;
-            it.previous();
-            Skeleton &childSk = tierSk.appendChild(i <= 5 ? "toppokemon" : "lowpokemon");
-            childSk.addDefaultValue("rank", i);
-            childSk.addDefaultValue("imagelink", getImageLink(it.value()));
-            childSk.addDefaultValue("iconlink", getIconLink(it.value()));
-            childSk.addDefaultValue("pokemonlink", QString("%1.html").arg(it.value()));
-            childSk.addDefaultValue("percentage", QString::number(double(100*it.key())/totalBattles,'f',2));
-            childSk.addDefaultValue("pokemon", PokemonInfo::Name(it.value()));
-        }
-
-        if (ranks.size() > 0) {
-            int total = 0;
-
-            for(int i = 0; i < ranks.size(); i++) {
-                total += ranks[i].second;
-            }
-
-            QFile out(outDir.absoluteFilePath("ranked_stats.txt"));
-            out.open(QIODevice::WriteOnly);
-            for(int i = 0; i < ranks.size(); i++) {
-                QString s = QString("%1 %2 %3").arg(PokemonInfo::Name(ranks[i].first)).arg(float(ranks[i].second*6*100)/total).arg(ranks[i].second);
-                out.write(s.toUtf8() + "\n");
-            }
-        }
-
-        QFile index(outDir.absoluteFilePath("index.html"));
-        index.open(QIODevice::WriteOnly);
-        index.write(tierSk.generate().toUtf8());
-        index.close();
-
-        it.toBack();
-
-        while (it.hasPrevious()) {
-            it.previous();
-
-            int pokemon = it.value();
-
-            int normalUsage = it.key() - leadUsage[pokemon];
-
-            fprintf(stdout, "Doing Pokemon %s\n", PokemonInfo::Name(pokemon).toUtf8().data());
-
-            QMap<RawSet, MoveSet> movesets;
-            QMap<RawSet, MoveSet> leadsets;
-            GlobalThings globals;
-
-            AbilityGroup defAb = PokemonInfo::Abilities(pokemon, GenInfo::GenMax());
-
-            foreach(Bcc b, buffers[pokemon]) {
-                char *buffer = b.buffer.data();
-
-                addMoveset(movesets, buffer, b.usage-b.leadUsage, defAb, globals);
-                addMoveset(leadsets, buffer, b.leadUsage, defAb, globals);
-            }
+    if (threads > 0) {
+        QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    }
 
-            Skeleton s(templates + "/pokemon_page.template");
-            s.addDefaultValue("pokemon", PokemonInfo::Name(pokemon));
-            s.addDefaultValue("tier", dir);
-            s.addDefaultValue("imagelink", getImageLink(pokemon));
-            s.addDefaultValue("percentage", QString::number(double(100*it.key())/totalBattles,'f',2));
-            s.addDefaultValue("battles", it.key());
-            s.addDefaultValue("nonleadpercentage", QString::number(double(100*normalUsage)/totalBattles,'f',2));
-            s.addDefaultValue("nonleadbattles", normalUsage);
-            s.addDefaultValue("leadpercentage", QString::number(double(100*leadUsage[pokemon])/totalBattles,'f',2));
-            s.addDefaultValue("leadbattles", leadUsage[pokemon]);
-
-            parseMovesets(s, movesets, "moveset", normalUsage);
-            parseMovesets(s, leadsets, "leadmoveset", leadUsage[pokemon]);
-            parseGlobals(s, globals.moves, globals.totalMoves, "globalmove", "move", &MoveInfo::Name);
-            parseGlobals(s, globals.items, globals.totalItems, "globalitem", "item", &ItemInfo::Name);
-            QHash<int, int> abilities;
-            abilities[defAb.ab(0)] = globals.abilities[0];
-            int totAbilities = globals.abilities[0];
-            for (int i = 1; i < 3; i++) {
-                if (globals.abilities[i] > 0 && PokemonInfo::Abilities(pokemon, GenInfo::GenMax()).ab(i) != 0) {
-                    abilities[defAb.ab(i)] = globals.abilities[i];
-                    totAbilities += globals.abilities[i];
-                }
-            }
+    QVector<Tier> results(dirs.size());
 
-            if (totAbilities > 0) {
-                parseGlobals(s, abilities, totAbilities, "globalability", "ability", &AbilityInfo::Name);
-            }
+    for (int i = 0; i < dirs.size(); i++) {
+        results[i].name = dirs[i];
+        QThreadPool::globalInstance()->start(new TierTask(results[i], d.absolutePath(), output, templates));
+    }
+    QThreadPool::globalInstance()->waitForDone();
 
-            QFile pokef(outDir.absoluteFilePath("%1.html").arg(pokemon));
-            pokef.open(QIODevice::WriteOnly);
-            pokef.write(s.generate().toUtf8());
-        }
+    fprintf(stdout, "\nAll %d tiers done in %d ms with %d threads\n", dirs.size(), int(timer.elapsed()),
+            QThreadPool::globalInstance()->maxThreadCount());
 
-        mostUsedPokemon.push_back(QPair<QString, int> (dir, reverseUsage.size() > 0 ? (--reverseUsage.end()).value() : 0));
-        d.cdUp();
+    QList<QPair<QString, int> > mostUsedPokemon;
+    foreach(const Tier &tier, results) {
+        mostUsedPokemon.push_back(QPair<QString, int> (tier.name, tier.mostUsed));
     }
 
     typedef QPair<QString, int> pair;
@@ -4,6 +4,7 @@
 #include <PokemonInfo/teamholder.h>
 
 #include <Utilities/functions.h>
+#include <Utilities/zipcache.h>
 #include <TeambuilderLibrary/poketablemodel.h>
 
 #include "Teambuilder/teambuilder.h"
@@ -278,6 +279,8 @@ void TeamBuilder::installMod()
     //First remove the mod file if existing
     if (modDir.exists(modName)) {
         qDebug() << "Removing old mod with same name.";
+        /* Its archives may be open */
+        ZipCache::obj()->clear();
         removeFolder(modDir.absoluteFilePath(modName));
     }
 
@@ -388,6 +391,7 @@ void TeamBuilder::removeMod()
 
         if (modsDir.exists()) {
             if (modsDir.exists(selected)) {
+                ZipCache::obj()->clear();
                 removeFolder(modsDir.absoluteFilePath(selected));
                 modsList->takeItem(modsList->currentIndex().row());
                 reloadMenuBar();
@@ -11,7 +11,7 @@
 
 using namespace NetworkCli;
 
-Analyzer::Analyzer(bool reg_connection) : registry_socket(reg_connection), mysocket(new QTcpSocket()), commandCount(0)
+Analyzer::Analyzer(bool reg_connection) : registry_socket(reg_connection), lazyPlayerInfo(false), mysocket(new QTcpSocket()), commandCount(0)
 {
     connect(&socket(), SIGNAL(connected()), SIGNAL(connected()));
     connect(&socket(), SIGNAL(connected()), this, SLOT(wasConnected()));
@@ -72,12 +72,18 @@ void Analyzer::login(const TeamHolder &team, bool ladder, bool away, const QColo
     data.setFlag(PlayerFlags::Idle, away);
     data.setFlag(PlayerFlags::HasRegisterCheck, true);
     data.setFlag(PlayerFlags::WantsHTML, true);
+    data.setFlag(PlayerFlags::SupportsStreamCompression, true);
+    data.setFlag(PlayerFlags::SupportsPlayerDelta, true);
+    data.setFlag(PlayerFlags::LazyPlayerInfo, lazyPlayerInfo);
     //                  SupportsZipCompression,
     //                  LadderEnabled,
     //                  IdsWithMessage,
     //                  Idle,
     //                  HasRegisterCheck,
-    //                  WantsHTML
+    //                  WantsHTML,
+    //                  SupportsStreamCompression,
+    //                  SupportsPlayerDelta,
+    //                  LazyPlayerInfo
 
     out << uchar(Login) << ownVersion << network;
 
@@ -252,6 +258,16 @@ void Analyzer::getRanking(const QString &tier, int page)
     notify(ShowRankings, tier, true, qint32(page));
 }
 
+void Analyzer::requestServerList(quint32 version)
+{
+    notify(ServerListVersion, version, true);
+}
+
+void Analyzer::requestPlayers(const QVector<qint32> &ids)
+{
+    notify(PlayersList, Expander<QVector<qint32> >(ids));
+}
+
 void Analyzer::connectTo(const QString &host, quint16 port)
 {
     if (mysocket.isConnected()) {
@@ -269,6 +285,9 @@ void Analyzer::wasConnected()
 {
     /* At least makes client use full bandwith, even if the server doesn't */
     socket().setLowDelay(true);
+
+    /* The server starts a new stream for each connection */
+    inflater.reset();
 }
 
 /*{
@@ -305,7 +324,7 @@ void Analyzer::commandReceived(const QByteArray &commandline)
 
         in >> contentType;
 
-        if (contentType > 1) {
+        if (contentType > 2) {
             return;
         }
 
@@ -314,6 +333,24 @@ void Analyzer::commandReceived(const QByteArray &commandline)
         if (length <= 0) {
             return;
         }
+
+        if (contentType == 2) {
+            bool ok;
+            QByteArray info = inflater.decompress(commandline.mid(2), &ok);
+
+            if (!ok) {
+                socket().close();
+                return;
+            }
+
+            DataStream in2(info);
+            QByteArray packet;
+            while (!in2.atEnd()) {
+                in2 >> packet;
+                commandReceived(packet);
+            }
+            break;
+        }
         char data[length];
 
         in.readRawData(data, length);
@@ -383,6 +420,7 @@ void Analyzer::commandReceived(const QByteArray &commandline)
             in >> s;
 
             emit serverReceived(s);
+            break;
         }
     }
     case Login: {
@@ -735,6 +773,30 @@ void Analyzer::commandReceived(const QByteArray &commandline)
         emit minHTMLGiven(auth);
         break;
     }
+    case ServerListEnd: {
+        /* Older registries send no version */
+        quint32 version = 0;
+        bool full = true;
+        if (!in.atEnd()) {
+            in >> version >> full;
+        }
+        emit serverListEnd(version, full);
+        break;
+    }
+    case ServerRemoved: {
+        QString name;
+        in >> name;
+        emit serverRemoved(name);
+        break;
+    }
+    case PlayerDelta: {
+        while (!in.atEnd()) {
+            PlayerInfoDelta d;
+            in >> d;
+            emit playerChanged(d);
+        }
+        break;
+    }
     default: {
         emit protocolError(UnknownCommand, tr("Protocol error: unknown command received -- maybe an update for the program is available"));
     }
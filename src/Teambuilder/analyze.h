@@ -8,6 +8,7 @@
 #include <QtCore>
 #include <Utilities/network.h>
 #include <Utilities/coreclasses.h>
+#include <Utilities/compressionstream.h>
 #include <PokemonInfo/networkstructs.h>
 
 class Client;
@@ -44,6 +45,18 @@ public:
     void logout();
     Q_INVOKABLE void sendChanMessage(int channelid, const QString &message);
     void connectTo(const QString &host, quint16 port);
+    /* Registry only: what changed in the server list since that version */
+    void requestServerList(quint32 version);
+    /* The info of those players, the server answers at most MaxPlayersRequest */
+    void requestPlayers(const QVector<qint32> &ids);
+    /* Before login: channels then only send the ids of their players */
+    void setLazyPlayerInfo(bool lazy) {
+        lazyPlayerInfo = lazy;
+    }
+
+    enum {
+        MaxPlayersRequest = 200
+    };
     void sendTeam(const TeamHolder & team);
     void sendBattleResult(int id, int result);
     void reconnect(int id, const QByteArray &pass, int ccount = -1);
@@ -83,6 +96,8 @@ signals:
     void channelCommandReceived(int command, int channel, DataStream *stream);
     /* player from the players list */
     void playerReceived(const PlayerInfo &p);
+    /* what changed for a player already known */
+    void playerChanged(const PlayerInfoDelta &d);
     /* login of a player */
     void playerLogin(const PlayerInfo &p, const QStringList& tiers);
     void teamApproved(const QStringList &tiers);
@@ -107,6 +122,8 @@ signals:
     void playerTempBanned(int p, int src, int time);
     void regAnnouncementReceived(const QString &announcement);
     void serverReceived(const ServerInfo &info);
+    void serverRemoved(const QString &name);
+    void serverListEnd(quint32 version, bool full);
     void PMReceived(int id, const QString &mess);
     void awayChanged(int id, bool away);
     void ladderChanged(int id, bool ladder);
@@ -166,12 +183,16 @@ private:
     const network_type &socket() const;
     /* To tell if its the registry we're connected to*/
     bool registry_socket;
+    bool lazyPlayerInfo;
 
     QList<QByteArray> storedCommands;
     QSet<int> channelCommands;
 
     network_type mysocket;
 
+    /* For ZipCommand with content type 2, one for each connection */
+    InflateStream inflater;
+
 public:
     quint32 commandCount;
 
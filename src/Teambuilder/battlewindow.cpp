@@ -98,6 +98,16 @@ BattleWindow::BattleWindow(int battleId, const PlayerInfo &me, const PlayerInfo
 
     info().gen = conf().gen;
 
+    /* The back sprites of our team can be decoded while the window is built */
+    QList<PokemonInfo::PictureRequest> pictures;
+    for (int i = 0; i < 6; i++) {
+        const PokeBattle &p = team.poke(i);
+        if (p.num() != Pokemon::NoPoke) {
+            pictures << PokemonInfo::PictureRequest(p.num(), conf().gen, p.gender(), p.shiny(), true);
+        }
+    }
+    PokemonInfo::PrefetchPictures(pictures);
+
     BaseBattleWindow::init();
 
     QSettings s;
@@ -383,6 +383,7 @@ void Channel::changeName(int id, const QString &name)
 void Channel::insertNewPlayer(int playerid)
 {
     ownPlayers.insert(playerid);
+    client->needPlayerInfo(playerid);
 
     insertPlayerItems(playerid);
 }
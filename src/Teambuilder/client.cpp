@@ -35,6 +35,7 @@ Client::Client(ClientPluginManager *p, TeamHolder *t, const QString &url , const
 {
     exitWarning = globals.value("Client/ShowExitWarning").toBool(); // initiate, to show exit warning or not
     flashingToggled = !globals.contains("Client/Flashing") ? true : globals.value("Client/Flashing").toBool();
+    lazyPlayerInfo = globals.value("Client/LazyPlayerInfo").toBool();
     failedBefore = false;
     waitingOnSecond = false;
     top = NULL;
@@ -203,6 +204,7 @@ void Client::initRelay()
     connect(relay, SIGNAL(htmlMessageReceived(QString)), SLOT(printHtml(QString)));
     connect(relay, SIGNAL(channelMessageReceived(QString,int,bool)), SLOT(printChannelMessage(QString, int, bool)));
     connect(relay, SIGNAL(playerReceived(PlayerInfo)), SLOT(playerReceived(PlayerInfo)));
+    connect(relay, SIGNAL(playerChanged(PlayerInfoDelta)), SLOT(playerChanged(PlayerInfoDelta)));
     connect(relay, SIGNAL(playerLogin(PlayerInfo, QStringList)), SLOT(playerLogin(PlayerInfo, QStringList)));
     connect(relay, SIGNAL(playerLogout(int)), SLOT(playerLogout(int)));
     connect(relay, SIGNAL(challengeStuff(ChallengeInfo)), SLOT(challengeStuff(ChallengeInfo)));
@@ -2314,6 +2316,28 @@ void Client::awayChanged(int id, bool away)
     updateState(id);
 }
 
+void Client::playerChanged(const PlayerInfoDelta &d)
+{
+    if (!myplayersinfo.contains(d.id)) {
+        return;
+    }
+
+    /* Like an OptionsChange, for the messages */
+    if (d.has(PlayerInfoDelta::FlagsField)) {
+        awayChanged(d.id, d.values.away());
+        ladderChanged(d.id, d.values.ladder());
+    }
+
+    PlayerInfoDelta others = d;
+    others.fields.setFlag(PlayerInfoDelta::FlagsField, false);
+
+    if (!others.empty()) {
+        PlayerInfo p = player(d.id);
+        d.apply(p);
+        playerReceived(p);
+    }
+}
+
 void Client::ladderChanged(int id, bool ladder)
 {
     if (player(id).flags[PlayerInfo::LadderEnabled] == ladder) {
@@ -2369,6 +2393,8 @@ void Client::connected()
         relay().disconnectFromHost();
     s.endGroup();
 
+    relay().setLazyPlayerInfo(lazyPlayerInfo);
+
     if (reconnectPass.isEmpty()) {
         if (channelsIWasOn.isEmpty()) {
             //qDebug() << "isempty";
@@ -2520,7 +2546,15 @@ bool Client::hasKnowledgeOf(int id) {
 
 void Client::removePlayer(int id)
 {
+    missingInfo.remove(id);
+    requestedInfo.remove(id);
+
     if (!playerExist(id)) {
+        /* In lazy mode, a player can be in the channels without us having the info */
+        foreach(Channel *c, mychannels) {
+            c->removePlayer(id);
+        }
+        requestPlayersInfo();
         return;
     }
 
@@ -2621,8 +2655,50 @@ void Client::ownPlayerReceived()
     }
 }
 
+void Client::needPlayerInfo(int id)
+{
+    if (!lazyPlayerInfo || hasPlayerInfo(id) || requestedInfo.contains(id)) {
+        return;
+    }
+
+    if (missingInfo.empty()) {
+        QTimer::singleShot(0, this, SLOT(requestPlayersInfo()));
+    }
+    missingInfo.insert(id);
+}
+
+/* One page at a time, the next one is asked when all the players of the
+   current one are received (or logged out) */
+void Client::requestPlayersInfo()
+{
+    if (!requestedInfo.empty() || missingInfo.empty()) {
+        return;
+    }
+
+    QVector<qint32> ids;
+    QMutableSetIterator<int> it(missingInfo);
+    while (it.hasNext() && ids.size() < Analyzer::MaxPlayersRequest) {
+        int id = it.next();
+        it.remove();
+
+        if (!hasPlayerInfo(id)) {
+            ids.push_back(id);
+            requestedInfo.insert(id);
+        }
+    }
+
+    if (!ids.empty()) {
+        relay().requestPlayers(ids);
+    }
+}
+
 void Client::playerReceived(const PlayerInfo &p)
 {
+    if (requestedInfo.remove(p.id) && requestedInfo.empty()) {
+        QTimer::singleShot(0, this, SLOT(requestPlayersInfo()));
+    }
+    missingInfo.remove(p.id);
+
     bool newPlayer = false;
 
     if (name(p.id) != p.name) {
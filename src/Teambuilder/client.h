@@ -123,6 +123,9 @@ public:
 
     Q_INVOKABLE PlayerInfo player(int id) const;
     void removePlayer(int id);
+    /* In lazy mode, asks the server for the info of that player, with the
+       other players missing */
+    void needPlayerInfo(int id);
 
     void removeBattleWindow(int id);
     void disableBattleWindow(int id);
@@ -186,6 +189,7 @@ public slots:
     void changeName(const QString&);
     void playerLogin(const PlayerInfo &p, const QStringList &tiers, bool ignore=false);
     void playerReceived(const PlayerInfo &p);
+    void requestPlayersInfo();
     void announcementReceived(const QString &);
     void toggleAnnouncementOption(bool hide);
     void tiersReceived(const QStringList &tiers);
@@ -275,6 +279,8 @@ public slots:
     /* Away... */
     void awayChanged(int id, bool away);
     void ladderChanged(int id, bool away);
+    /* Only what changed for a player */
+    void playerChanged(const PlayerInfoDelta &d);
     void goAway(int away);
     void goAwayB(bool away) {
         goAway(away);
@@ -432,6 +438,14 @@ private:
     QPointer<RankingDialog> myRanking;
 
     QHash<int, PlayerInfo> myplayersinfo;
+    /* Lazy mode (Client/LazyPlayerInfo): the channels only send ids, the info
+       is asked page by page. Every member of the channels is still fetched,
+       the player list sorts them by name and so needs all of them: this only
+       spreads the transfer over time, fetching just the rows on screen is
+       not done */
+    bool lazyPlayerInfo;
+    QSet<int> missingInfo;
+    QSet<int> requestedInfo;
     /* Players scheduled for deletion are put here */
     QHash<int, int> fade;
     /* Players which we have PMed are supposed to be kept in memory until they
@@ -9,12 +9,12 @@
 #include <Utilities/otherwidgets.h>
 
 ServerChoice::ServerChoice(TeamHolder* team) :
-    ui(new Ui::ServerChoice), wasConnected(false), team(team)
+    ui(new Ui::ServerChoice), serverListVersion(0), wasConnected(false), team(team)
 {
     ui->setupUi(this);
     ui->announcement->hide();
 
-    ServerChoiceModel *model = new ServerChoiceModel();
+    model = new ServerChoiceModel();
     model->setParent(ui->serverList);
     filter = new QSortFilterProxyModel(ui->serverList);
     filter->setSourceModel(model);
@@ -42,7 +42,14 @@ ServerChoice::ServerChoice(TeamHolder* team) :
     connect(&manager, SIGNAL(finished(QNetworkReply*)), SLOT(announcementReceived(QNetworkReply*)));
     connect(registry_connection, SIGNAL(serverReceived(ServerInfo)), model, SLOT(addServer(ServerInfo)));
     connect(this, SIGNAL(clearList()), model, SLOT(clear()));
-    connect(registry_connection, SIGNAL(serverReceived(ServerInfo)), SLOT(serverAdded()));
+    connect(registry_connection, SIGNAL(serverReceived(ServerInfo)), SLOT(serverAdded(ServerInfo)));
+    connect(registry_connection, SIGNAL(serverRemoved(QString)), model, SLOT(removeServer(QString)));
+    connect(registry_connection, SIGNAL(serverListEnd(quint32,bool)), SLOT(serverListEnd(quint32,bool)));
+
+    /* Only what changed is sent back, if anything */
+    QTimer *refresh = new QTimer(this);
+    refresh->start(60*1000);
+    connect(refresh, SIGNAL(timeout()), SLOT(refreshServerList()));
 
     //TO-DO: Make  the item 0 un-resizable and unselectable - Latios
 
@@ -174,11 +181,28 @@ void ServerChoice::loadAll(const TeamHolder &t)
     ui->nameEdit->setText(t.name());
 }
 
-void ServerChoice::serverAdded()
+void ServerChoice::serverAdded(const ServerInfo &info)
 {
+    serverNames.insert(info.name);
     ui->serverList->sortByColumn(filter->sortColumn(), filter->sortOrder());
 }
 
+void ServerChoice::serverListEnd(quint32 version, bool full)
+{
+    if (full) {
+        model->keepServers(serverNames);
+    }
+    serverNames.clear();
+    serverListVersion = version;
+}
+
+void ServerChoice::refreshServerList()
+{
+    if (registry_connection->isConnected() && serverListVersion != 0) {
+        registry_connection->requestServerList(serverListVersion);
+    }
+}
+
 void ServerChoice::anchorClicked(const QUrl &url)
 {
     if (wasConnected) {
@@ -194,6 +218,8 @@ void ServerChoice::anchorClicked(const QUrl &url)
 void ServerChoice::on_switchPort_clicked()
 {
     emit clearList();
+    serverNames.clear();
+    serverListVersion = 0;
 
     ui->serverList->model()->removeRows(0, ui->serverList->model()->rowCount());
 
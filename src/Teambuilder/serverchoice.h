@@ -7,6 +7,7 @@
 struct ServerInfo;
 class TeamHolder;
 class Analyzer;
+class ServerChoiceModel;
 
 namespace Ui {
 class ServerChoice;
@@ -33,7 +34,9 @@ public slots:
     void loadTeam();
     void loadAll(const TeamHolder&);
 private slots:
-    void serverAdded();
+    void serverAdded(const ServerInfo &info);
+    void serverListEnd(quint32 version, bool full);
+    void refreshServerList();
     void showDetails(const QModelIndex&);
     void regServerChosen(const QModelIndex&);
     void advServerChosen();
@@ -48,8 +51,14 @@ private:
     Ui::ServerChoice *ui;
 
     Analyzer *registry_connection;
+    ServerChoiceModel *model;
     QSortFilterProxyModel *filter;
 
+    /* Version of the server list we have, 0 if the registry doesn't send one.
+       The names are of the servers received since the last ServerListEnd */
+    quint32 serverListVersion;
+    QSet<QString> serverNames;
+
     QList<QStringList> savedServers;
 
     bool wasConnected;
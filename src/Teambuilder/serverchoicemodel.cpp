@@ -125,11 +125,42 @@ QVariant ServerChoiceModel::headerData(int section, Qt::Orientation orientation,
 
 void ServerChoiceModel::addServer(const ServerInfo &info)
 {
+    for (int i = 0; i < infos.count(); i++) {
+        if (infos[i].name == info.name) {
+            infos[i] = info;
+            emit dataChanged(index(i, 0), index(i, columnCount(QModelIndex())-1));
+            return;
+        }
+    }
+
     beginInsertRows(QModelIndex(), infos.count(), infos.count());
     infos.push_back(info);
     endInsertRows();
 }
 
+void ServerChoiceModel::removeServer(const QString &name)
+{
+    for (int i = 0; i < infos.count(); i++) {
+        if (infos[i].name == name) {
+            beginRemoveRows(QModelIndex(), i, i);
+            infos.removeAt(i);
+            endRemoveRows();
+            return;
+        }
+    }
+}
+
+void ServerChoiceModel::keepServers(const QSet<QString> &names)
+{
+    for (int i = infos.count() - 1; i >= 0; i--) {
+        if (!names.contains(infos[i].name)) {
+            beginRemoveRows(QModelIndex(), i, i);
+            infos.removeAt(i);
+            endRemoveRows();
+        }
+    }
+}
+
 void ServerChoiceModel::clear()
 {
     beginRemoveRows(QModelIndex(), 0, rowCount()-1);
@@ -2,6 +2,7 @@
 #define SERVERCHOICEMODEL_H
 
 #include <QAbstractTableModel>
+#include <QSet>
 
 #include <PokemonInfo/networkstructs.h>
 
@@ -27,7 +28,11 @@ public:
     };
 
 public slots:
+    /* Replaces the server with the same name if there's one */
     void addServer(const ServerInfo &info);
+    void removeServer(const QString &name);
+    /* Removes the servers not in names */
+    void keepServers(const QSet<QString> &names);
     void clear();
 private:
     QList<ServerInfo> infos;
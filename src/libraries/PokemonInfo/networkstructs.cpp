@@ -49,6 +49,119 @@ DataStream & operator << (DataStream &out, const PlayerInfo &p)
     return out;
 }
 
+PlayerInfoDelta::PlayerInfoDelta(const PlayerInfo &before, const PlayerInfo &after) : id(after.id), values(after)
+{
+    fields.setFlag(FlagsField, before.flags.data != after.flags.data);
+    fields.setFlag(NameField, before.name != after.name);
+    fields.setFlag(ColorField, before.color != after.color);
+    fields.setFlag(AvatarField, before.avatar != after.avatar);
+    fields.setFlag(InfoField, before.info != after.info);
+    fields.setFlag(AuthField, before.auth != after.auth);
+    fields.setFlag(RatingsField, before.ratings != after.ratings);
+}
+
+void PlayerInfoDelta::apply(PlayerInfo &p) const
+{
+    if (has(FlagsField)) {
+        p.flags = values.flags;
+    }
+    if (has(NameField)) {
+        p.name = values.name;
+    }
+    if (has(ColorField)) {
+        p.color = values.color;
+    }
+    if (has(AvatarField)) {
+        p.avatar = values.avatar;
+    }
+    if (has(InfoField)) {
+        p.info = values.info;
+    }
+    if (has(AuthField)) {
+        p.auth = values.auth;
+    }
+    if (has(RatingsField)) {
+        p.ratings = values.ratings;
+    }
+}
+
+DataStream & operator >> (DataStream &in, PlayerInfoDelta &d)
+{
+    in >> d.id >> d.fields;
+
+    if (d.has(PlayerInfoDelta::FlagsField)) {
+        in >> d.values.flags;
+    }
+    if (d.has(PlayerInfoDelta::NameField)) {
+        in >> d.values.name;
+    }
+    if (d.has(PlayerInfoDelta::ColorField)) {
+        in >> d.values.color;
+    }
+    if (d.has(PlayerInfoDelta::AvatarField)) {
+        in >> d.values.avatar;
+    }
+    if (d.has(PlayerInfoDelta::InfoField)) {
+        in >> d.values.info;
+    }
+    if (d.has(PlayerInfoDelta::AuthField)) {
+        in >> d.values.auth;
+    }
+    if (d.has(PlayerInfoDelta::RatingsField)) {
+        qint8 numTiers;
+        in >> numTiers;
+
+        d.values.ratings.clear();
+        for (int i = 0; i < numTiers; i++) {
+            QString tier;
+            quint16 rating;
+            in >> tier >> rating;
+
+            d.values.ratings.insert(tier, rating);
+        }
+    }
+
+    d.values.id = d.id;
+
+    return in;
+}
+
+DataStream & operator << (DataStream &out, const PlayerInfoDelta &d)
+{
+    out << d.id << d.fields;
+
+    if (d.has(PlayerInfoDelta::FlagsField)) {
+        out << d.values.flags;
+    }
+    if (d.has(PlayerInfoDelta::NameField)) {
+        out << d.values.name;
+    }
+    if (d.has(PlayerInfoDelta::ColorField)) {
+        out << d.values.color;
+    }
+    if (d.has(PlayerInfoDelta::AvatarField)) {
+        out << d.values.avatar;
+    }
+    if (d.has(PlayerInfoDelta::InfoField)) {
+        out << d.values.info;
+    }
+    if (d.has(PlayerInfoDelta::AuthField)) {
+        out << d.values.auth;
+    }
+    if (d.has(PlayerInfoDelta::RatingsField)) {
+        out << qint8(d.values.ratings.size());
+
+        QHashIterator<QString, quint16> it(d.values.ratings);
+
+        while (it.hasNext()) {
+            it.next();
+            out << it.key() << it.value();
+        }
+    }
+
+    return out;
+}
+
 Battle::Battle(int id1, int id2, int mode, const QString &tier) : id1(id1), id2(id2), mode(mode), tier(tier)
 {
 
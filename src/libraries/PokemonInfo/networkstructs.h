@@ -52,7 +52,10 @@ namespace PlayerFlags {
         IdsWithMessage,
         Idle,
         HasRegisterCheck,
-        WantsHTML
+        WantsHTML,
+        SupportsStreamCompression, /* ZipCommand with content type 2 */
+        SupportsPlayerDelta, /* PlayerDelta instead of PlayersList for the players already known */
+        LazyPlayerInfo /* Channels only send ids, the client asks for the info it needs */
     };
     enum {
         NoReconnectData,
@@ -105,6 +108,42 @@ public:
 DataStream & operator >> (DataStream &in, PlayerInfo &p);
 DataStream & operator << (DataStream &out, const PlayerInfo &p);
 
+/* What changed in the info of a player, for the clients that already have
+   it. Only the fields set in the mask are sent, with their new value. */
+struct PlayerInfoDelta
+{
+    enum Field {
+        FlagsField = 0,
+        NameField,
+        ColorField,
+        AvatarField,
+        InfoField,
+        AuthField,
+        RatingsField
+    };
+
+    qint32 id;
+    Flags fields;
+    /* Only the fields in the mask mean something */
+    PlayerInfo values;
+
+    PlayerInfoDelta() : id(0) {}
+    PlayerInfoDelta(const PlayerInfo &before, const PlayerInfo &after);
+
+    bool empty() const {
+        return fields.data == 0;
+    }
+
+    bool has(int field) const {
+        return fields[field];
+    }
+
+    void apply(PlayerInfo &p) const;
+};
+
+DataStream & operator >> (DataStream &in, PlayerInfoDelta &d);
+DataStream & operator << (DataStream &out, const PlayerInfoDelta &d);
+
 struct Battle
 {
     qint32 id1, id2;
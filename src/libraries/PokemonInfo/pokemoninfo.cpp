@@ -1,18 +1,15 @@
 #include "pokemon.h"
 
 #include <QPixmapCache>
+#include <QThreadPool>
 #include <stdexcept>
 
 #include "pokemoninfo.h"
 #include "pokemonstructs.h"
 
-#ifdef _WIN32
-#include "../../SpecialIncludes/zip.h"
-#else
-#include <zip.h>
-#endif
 #include <Utilities/functions.h>
 #include <Utilities/coreclasses.h>
+#include <Utilities/zipcache.h>
 
 /*initialising static variables */
 QString PokemonInfo::m_Directory;
@@ -105,46 +102,70 @@ int GenInfo::genMin, GenInfo::genMax;
 
 namespace {
 
-QByteArray readZipFile(const char *archiveName, const char *fileName)
+/* Allows to read standard files too */
+QByteArray readZipFile(const QString &archive, const QString &file)
 {
-    /* Allows to read standard files too */
-    QString archiveS(archiveName);
-    if (!archiveS.endsWith(".zip")) {
-        return getFileContent(archiveS + "/" + fileName);
-    }
-
-    int error = 0;
-    char buffer[1024];
-    int readsize = 0;
-    QByteArray ret;
+    return ZipCache::obj()->read(archive, file);
+}
 
-    zip * archive = zip_open(archiveName, 0, &error);
+/* Pictures decoded by PrefetchPictures(), by archive + file, waiting for
+   Picture() to make them pixmaps on the GUI thread. Bounded in case they're
+   never asked for, the oldest make room for the new ones. */
+QMutex prefetchMutex;
+QHash<QString, QImage> prefetched;
+/* The keys of prefetched, the oldest first */
+QList<QString> prefetchOrder;
+const int maxPrefetched = 96;
 
-    if (!archive)
-    {
-        return ret;
+QImage takePrefetched(const QString &key)
+{
+    QMutexLocker l(&prefetchMutex);
+    if (!prefetched.contains(key)) {
+        return QImage();
     }
+    prefetchOrder.removeOne(key);
+    return prefetched.take(key);
+}
 
-    zip_file *file = zip_fopen(archive, fileName, 0);
-
-    if (!file)
-    {
-        zip_close(archive);
-        return ret;
+class PrefetchTask : public QRunnable
+{
+public:
+    PrefetchTask(const QList<PokemonInfo::PictureRequest> &pictures) : pictures(pictures) {
     }
 
-    do
-    {
-        ret.append(buffer, readsize);
+    void run() {
+        foreach(const PokemonInfo::PictureRequest &p, pictures) {
+            QString archive, file;
+            if (!PokemonInfo::FindPicture(p.num, p.gen, p.gender, p.shiny, p.back, true, archive, file)) {
+                continue;
+            }
 
-        readsize = zip_fread(file, buffer, 1024);
-    } while (readsize > 0) ;
+            {
+                QMutexLocker l(&prefetchMutex);
+                if (prefetched.contains(archive+file)) {
+                    continue;
+                }
+            }
 
-    zip_fclose(file);
-    zip_close(archive);
+            QImage img;
+            img.loadFromData(readZipFile(archive, file), file.section(".", -1).toLatin1().data());
 
-    return ret;
-}
+            if (!img.isNull()) {
+                QMutexLocker l(&prefetchMutex);
+                if (prefetched.contains(archive+file)) {
+                    continue;
+                }
+                if (prefetched.size() >= maxPrefetched) {
+                    prefetched.remove(prefetchOrder.takeFirst());
+                }
+                prefetched.insert(archive+file, img);
+                prefetchOrder.push_back(archive+file);
+            }
+        }
+    }
+private:
+    QList<PokemonInfo::PictureRequest> pictures;
+};
 
 }
 
@@ -190,6 +211,9 @@ void changeMod(const QString &mod)
             modPath.clear();
         }
     }
+
+    /* The mod may have been installed or updated in the meantime */
+    ZipCache::obj()->clear();
 }
 
 QString m_dataRepo = "./";
@@ -1164,12 +1188,11 @@ QPixmap PokemonInfo::Picture(const QString &url)
     return ret;
 }
 
-QPixmap PokemonInfo::Picture(const Pokemon::uniqueId &pokeid, Pokemon::gen gen, int gender, bool shiny, bool back, bool mod)
+bool PokemonInfo::FindPicture(const Pokemon::uniqueId &pokeid, Pokemon::gen gen, int gender, bool shiny, bool back, bool mod,
+                              QString &archive, QString &file)
 {
     QString archives[] = {path("%1G/sprites").arg(gen.num), path("%1G/sprites.zip").arg(gen.num)};
-    QString archive = getArchive(archives, mod);
-
-    QString file;
+    archive = getArchive(archives, mod);
 
     if (gen.num == 1)
         file = QString("yellow/%2%1.png").arg(pokeid.toString(), back?"back/":"");
@@ -1184,43 +1207,65 @@ QPixmap PokemonInfo::Picture(const Pokemon::uniqueId &pokeid, Pokemon::gen gen,
     else
         file = QString("x-y/%2%4%3%1.png").arg(pokeid.toString(), back?"back/":"", (gender==Pokemon::Female)?"female/":"", shiny?"shiny/":"");
 
+    /* The archives are indexed, the variants missing are only hash lookups */
+    if (ZipCache::obj()->exists(archive, file)) {
+        return true;
+    }
+
+    if (gender == Pokemon::Female) {
+        return FindPicture(pokeid, gen, Pokemon::Male, shiny, back, true, archive, file);
+    }
+    if (mod) {
+        return FindPicture(pokeid, gen, gender, shiny, back, false, archive, file);
+    }
+    if (shiny) {
+        return FindPicture(pokeid, gen, gender, false, back, true, archive, file);
+    }
+    if (gen.num == 1) {
+        return FindPicture(pokeid, 2, gender, shiny, back, true, archive, file);
+    } else if (gen.num == 2) {
+        return FindPicture(pokeid, 3, gender, shiny, back, true, archive, file);
+    } else if (gen.num == 3) {
+        return FindPicture(pokeid, 4, gender, shiny, back, true, archive, file);
+    } else if (gen.num == 4 || gen.num == 6) {
+        return FindPicture(pokeid, 5, gender, shiny, back, true, archive, file);
+    }
+    return false;
+}
+
+QPixmap PokemonInfo::Picture(const Pokemon::uniqueId &pokeid, Pokemon::gen gen, int gender, bool shiny, bool back, bool mod)
+{
     QPixmap ret;
+    QString archive, file;
 
-    if (QPixmapCache::find(archive+file, &ret)) {
+    if (!FindPicture(pokeid, gen, gender, shiny, back, mod, archive, file)) {
         return ret;
     }
 
-    QByteArray data = readZipFile(archive.toUtf8(),file.toUtf8());
+    /* A prefetched copy is no use anymore either way */
+    QImage img = takePrefetched(archive+file);
 
-    if (data.length()==0)
-    {
-        if (gender == Pokemon::Female) {
-            return PokemonInfo::Picture(pokeid, gen, Pokemon::Male, shiny, back);
-        }
-        if (mod) {
-            return PokemonInfo::Picture(pokeid, gen, gender, shiny, back, false);
-        }
-        if (shiny) {
-            return PokemonInfo::Picture(pokeid, gen, gender, false, back);
-        }
-        if (gen.num == 1) {
-            return PokemonInfo::Picture(pokeid, 2, gender, shiny, back);
-        } else if (gen.num == 2) {
-            return PokemonInfo::Picture(pokeid, 3, gender, shiny, back);
-        } else if (gen.num == 3) {
-            return PokemonInfo::Picture(pokeid, 4, gender, shiny, back);
-        } else if (gen.num == 4 || gen.num == 6) {
-            return PokemonInfo::Picture(pokeid, 5, gender, shiny, back);
-        }
+    if (QPixmapCache::find(archive+file, &ret)) {
         return ret;
     }
 
-    ret.loadFromData(data, file.section(".", -1).toLatin1().data());
+    if (!img.isNull()) {
+        ret = QPixmap::fromImage(img);
+    } else {
+        ret.loadFromData(readZipFile(archive, file), file.section(".", -1).toLatin1().data());
+    }
     QPixmapCache::insert(archive+file, ret);
 
     return ret;
 }
 
+void PokemonInfo::PrefetchPictures(const QList<PictureRequest> &pictures)
+{
+    if (!pictures.empty()) {
+        QThreadPool::globalInstance()->start(new PrefetchTask(pictures));
+    }
+}
+
 QPixmap PokemonInfo::Sub(Pokemon::gen gen, bool back)
 {
     QString archive = path("%1G/sprites.zip").arg(gen.num);
@@ -1243,7 +1288,7 @@ QPixmap PokemonInfo::Sub(Pokemon::gen gen, bool back)
         return ret;
     }
 
-    QByteArray data = readZipFile(archive.toUtf8(),file.toUtf8());
+    QByteArray data = readZipFile(archive, file);
 
     if (data.length()==0) {
         if (gen.num < GenInfo::GenMax()) {
@@ -1274,7 +1319,7 @@ QPixmap PokemonInfo::Icon(const Pokemon::uniqueId &pokeid, int gender, bool mod)
         return p;
     }
 
-    QByteArray data = readZipFile(archive.toUtf8(),file.toUtf8());
+    QByteArray data = readZipFile(archive, file);
     if(data.length() == 0)
     {
         if (mod) {
@@ -1307,7 +1352,7 @@ QByteArray PokemonInfo::Cry(const Pokemon::uniqueId &pokeid, bool mod)
 
     QString file = QString("%1.wav").arg(num).rightJustified(7, '0');
 
-    QByteArray data = readZipFile(archive.toUtf8(),file.toUtf8());
+    QByteArray data = readZipFile(archive, file);
     if(data.length() == 0)
     {
         if (mod) {
@@ -2486,7 +2531,7 @@ QPixmap ItemInfo::Icon(int itemnum, bool mod)
         return ret;
     }
 
-    QByteArray data = readZipFile(archive.toUtf8(),file.toUtf8());
+    QByteArray data = readZipFile(archive, file);
     if(data.length() == 0)
     {
         qDebug() << "error loading icon";
@@ -2510,7 +2555,7 @@ QPixmap ItemInfo::HeldItem()
         return ret;
     }
 
-    QByteArray data = readZipFile(archive.toUtf8(),file.toUtf8());
+    QByteArray data = readZipFile(archive, file);
     if(data.length() == 0)
     {
         qDebug() << "error loading held item icon";
@@ -3164,7 +3209,7 @@ int AbilityInfo::Number(const QString &ability)
 
 QString AbilityInfo::Name(int abnum)
 {
-    return m_Names[abnum];
+    return m_Names.value(abnum);
 }
 
 QStringList AbilityInfo::Names(Pokemon::gen gen)
@@ -87,6 +87,24 @@ public:
     static QPixmap Picture(const Pokemon::uniqueId &pokeid, Pokemon::gen gen = GenInfo::GenMax(), int gender = Pokemon::Male, bool shiny = false, bool backimage = false, bool mod=true);
     static QPixmap Picture(const QString &url);
 
+    /* A picture about to be shown */
+    struct PictureRequest {
+        Pokemon::uniqueId num;
+        Pokemon::gen gen;
+        int gender;
+        bool shiny;
+        bool back;
+
+        PictureRequest(const Pokemon::uniqueId &num = Pokemon::NoPoke, Pokemon::gen gen = GenInfo::GenMax(), int gender = Pokemon::Male,
+                       bool shiny = false, bool back = false) : num(num), gen(gen), gender(gender), shiny(shiny), back(back) {}
+    };
+    /* Reads and decodes the pictures in another thread, so that Picture() only
+       has to make pixmaps of them when they're shown. Returns at once */
+    static void PrefetchPictures(const QList<PictureRequest> &pictures);
+    /* Where the picture Picture() shows is, false if there's none */
+    static bool FindPicture(const Pokemon::uniqueId &pokeid, Pokemon::gen gen, int gender, bool shiny, bool back, bool mod,
+                            QString &archive, QString &file);
+
     static QPixmap Sub(Pokemon::gen gen=5, bool back = false);
     static QPixmap Icon(const Pokemon::uniqueId &pokeid, int gender = 0, bool mod = true);
     static bool HasMoveInGen(const Pokemon::uniqueId &pokeid, int move, Pokemon::gen gen);
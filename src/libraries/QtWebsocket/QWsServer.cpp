@@ -188,6 +188,13 @@ void QWsServer::dataReceived()
 	regExp.setPattern( QWsServer::regExpExtensionsStr );
 	regExp.indexIn(request);
 	QString extensions = regExp.cap(1);
+
+	// permessage-deflate
+	QString acceptedExtensions;
+	bool deflateNoContextTakeover = false;
+	int deflateWindowBits = 15;
+	if ( version >= WS_V13 )
+		acceptedExtensions = QWsSocket::negotiateDeflate( extensions, &deflateNoContextTakeover, &deflateWindowBits );
 	
 	////////////////////////////////////////////////////////////////////
 	
@@ -197,7 +204,7 @@ void QWsServer::dataReceived()
 	if ( version >= WS_V6 )
 	{
 		QString accept = computeAcceptV4( key );
-		response = QWsServer::composeOpeningHandshakeResponseV6( accept, protocol );
+		response = QWsServer::composeOpeningHandshakeResponseV6( accept, protocol, acceptedExtensions );
 	}
 	else if ( version >= WS_V4 )
 	{
@@ -230,6 +237,8 @@ void QWsServer::dataReceived()
 	wsSocket->setProtocol( protocol );
 	wsSocket->setExtensions( extensions );
 	wsSocket->serverSideSocket = true;
+	if ( ! acceptedExtensions.isEmpty() )
+		wsSocket->enableDeflate( deflateNoContextTakeover, deflateWindowBits );
 	
 	// ORIGINAL CODE
 	//int socketDescriptor = tcpSocket->socketDescriptor();
@@ -2,10 +2,24 @@
 
 #include <QCryptographicHash>
 #include <QtEndian>
+#include <QStringList>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define QWS_SSE2
+#endif
+
+#ifdef __WIN32
+#include "../../SpecialIncludes/zlib.h"
+#else
+#include <zlib.h>
+#endif
 
 #include "QWsServer.h"
 
 int QWsSocket::maxBytesPerFrame = 1400;
+int QWsSocket::maxMessageSize = 4 * 1024 * 1024;
 const QString QWsSocket::regExpAcceptStr(QLatin1String("Sec-WebSocket-Accept:\\s(.{28})\r\n"));
 const QString QWsSocket::regExpUpgradeStr(QLatin1String("Upgrade:\\s(.+)\r\n"));
 const QString QWsSocket::regExpConnectionStr(QLatin1String("Connection:\\s(.+)\r\n"));
@@ -13,16 +27,18 @@ const QString QWsSocket::regExpConnectionStr(QLatin1String("Connection:\\s(.+)\r
 QWsSocket::QWsSocket( QObject * parent, QTcpSocket * socket, EWebsocketVersion ws_v ) :
 	QAbstractSocket( QAbstractSocket::UnknownSocketType, parent ),
     tcpSocket( socket ? socket : new QTcpSocket(this) ),
+	parsing( false ),
 	_version( ws_v ),
     _hostPort( -1 ),
     serverSideSocket( false ),
 	closingHandshakeSent( false ),
 	closingHandshakeReceived( false ),
-	readingState( HeaderPending ),
-	isFinalFragment( false ),
-	hasMask( false ),
-	payloadLength( 0 ),
-    maskingKey( 4, 0 )
+	opcode( OpText ),
+	closeStatusCode( NoCloseStatusCode ),
+	deflater( 0 ),
+	inflater( 0 ),
+	deflateNoContextTakeover( false ),
+	messageCompressed( false )
 {
 	tcpSocket->setParent( this );
 
@@ -53,6 +69,14 @@ QWsSocket::~QWsSocket()
 		QAbstractSocket::stateChanged( QAbstractSocket::UnconnectedState );
 		emit QAbstractSocket::disconnected();
 	}
+
+	if ( deflater )
+	{
+		deflateEnd( deflater );
+		delete deflater;
+		inflateEnd( inflater );
+		delete inflater;
+	}
 }
 
 void QWsSocket::connectToHost( const QString & hostName, quint16 port, OpenMode mode )
@@ -176,8 +200,12 @@ qint64 QWsSocket::write( const QString & string )
 		return QWsSocket::write( string.toUtf8() );
 	}
 
-    const QList<QByteArray>& framesList = QWsSocket::composeFrames( string.toUtf8(), false, maxBytesPerFrame );
-	return writeFrames( framesList );
+	if ( deflater )
+	{
+		return writeFrame( QWsSocket::composeFrame( deflateMessage( string.toUtf8() ), false, true ) );
+	}
+
+	return writeFrame( QWsSocket::composeFrame( string.toUtf8(), false ) );
 }
 
 qint64 QWsSocket::write( const QByteArray & byteArray )
@@ -191,14 +219,26 @@ qint64 QWsSocket::write( const QByteArray & byteArray )
 		return writeFrame( BA );
 	}
 
-    const QList<QByteArray>& framesList = QWsSocket::composeFrames( byteArray, true, maxBytesPerFrame );
-
-	qint64 nbBytesWritten = writeFrames( framesList );
+	qint64 nbBytesWritten = writeFrame( deflater ? QWsSocket::composeFrame( deflateMessage( byteArray ), true, true )
+	                                             : QWsSocket::composeFrame( byteArray, true ) );
 	emit bytesWritten( nbBytesWritten );
 
 	return nbBytesWritten;
 }
 
+qint64 QWsSocket::writePrepared( const QByteArray & frame )
+{
+	if ( _version == WS_V0 )
+		return 0;
+
+	return writeFrame( frame );
+}
+
+qint64 QWsSocket::bytesPending()
+{
+	return tcpSocket->bytesToWrite();
+}
+
 void QWsSocket::processHandshake()
 {
     //copy from QWsServer::dataReceived();
@@ -339,7 +379,9 @@ void QWsSocket::processDataV0()
 
 	if ( currentFrame.size() > 0 )
 	{
-		emit frameReceived( QString::fromUtf8(currentFrame) );
+		emit textFrameReceived( currentFrame );
+		if ( receivers( SIGNAL(frameReceived(QString)) ) > 0 )
+			emit frameReceived( QString::fromUtf8(currentFrame) );
 		currentFrame.clear();
 	}
 
@@ -349,136 +391,180 @@ void QWsSocket::processDataV0()
 
 void QWsSocket::processDataV4()
 {
-    if( state() == QAbstractSocket::ConnectingState ) {
-        processHandshake();
-    } else {
-        while (true) {
-            switch ( readingState ) {
-            case HeaderPending: {
-                if (tcpSocket->bytesAvailable() < 2)
-                    return;
-
-                // END, RSV1-3, Opcode
-                char header[2];
-                tcpSocket->read(header, 2); // XXX: Handle return value
-                isFinalFragment = (header[0] & 0x80) != 0;
-                opcode = static_cast<EOpcode>(header[0] & 0x0F);
-
-                // Mask, PayloadLength
-                hasMask = (header[1] & 0x80) != 0;
-                quint8 length = (header[1] & 0x7F);
-
-                switch (length)
-                {
-                    case 126:
-                        readingState = PayloadLengthPending;
-                        break;
-                    case 127:
-                        readingState = BigPayloadLenghPending;
-                        break;
-                    default:
-                        payloadLength = length;
-                        readingState = MaskPending;
-                        break;
-                }
-            }; break;
-            case PayloadLengthPending: {
-                if (tcpSocket->bytesAvailable() < 2)
-                    return;
-
-                uchar length[2];
-                tcpSocket->read(reinterpret_cast<char *>(length), 2); // XXX: Handle return value
-                payloadLength = qFromBigEndian<quint16>(reinterpret_cast<const uchar *>(length));
-                readingState = MaskPending;
-            }; break;
-            case BigPayloadLenghPending: {
-                if (tcpSocket->bytesAvailable() < 8)
-                    return;
-
-                uchar length[8];
-                tcpSocket->read(reinterpret_cast<char *>(length), 8); // XXX: Handle return value
-                // Most significant bit must be set to 0 as per http://tools.ietf.org/html/rfc6455#section-5.2
-                // XXX: Check for that?
-                payloadLength = qFromBigEndian<quint64>(length) & ~(1LL << 63);
-                readingState = MaskPending;
-            }; break;
-            case MaskPending: {
-                if (!hasMask) {
-                    readingState = PayloadBodyPending;
-                    break;
-                }
-
-                if (tcpSocket->bytesAvailable() < 4)
-                    return;
-
-                tcpSocket->read(maskingKey.data(), 4); // XXX: Handle return value
-
-                if ( opcode == OpClose )
-                {
-                    readingState = CloseDataPending;
-                }
-                else
-                {
-                    readingState = PayloadBodyPending;
-                }
-            }; /* Intentional fall-through */
-            case PayloadBodyPending: {
-                // TODO: Handle large payloads
-                if (tcpSocket->bytesAvailable() < static_cast<qint32>(payloadLength))
-                    return;
-
-                if ( opcode == OpClose )
-                {
-                    if ( payloadLength >= 2 && tcpSocket->bytesAvailable() >= 2 )
-                    {
-                        uchar bytes[2];
-                        tcpSocket->read( reinterpret_cast<char *>(bytes), 2 );
-                        closeStatusCode = (ECloseStatusCode)qFromBigEndian<quint16>( reinterpret_cast<const uchar *>(bytes) );
-                    }
-                    else
-                    {
-                        closeStatusCode = NoCloseStatusCode;
-                    }
-                }
-
-                QByteArray ApplicationData = tcpSocket->read( payloadLength );
-                if ( hasMask )
-                    ApplicationData = QWsSocket::mask( ApplicationData, maskingKey );
-                currentFrame.append( ApplicationData );
-
-                readingState = HeaderPending;
-
-                if ( !isFinalFragment )
-                    break;
-
-                switch ( opcode )
-                {
-                    case OpBinary:
-                        emit frameReceived( currentFrame );
-                        break;
-                    case OpText:
-                        emit frameReceived( QString::fromUtf8(currentFrame) );
-                        break;
-                    case OpPing:
-                        write( QWsSocket::composeHeader( true, OpPong, 0 ) );
-                        break;
-                    case OpPong:
-                        emit pong( pingTimer.elapsed() );
-                        break;
-                    case OpClose:
-                        closingHandshakeReceived = true;
-                        close( closeStatusCode );
-                        break;
-                    default:
-                        // DO NOTHING
-                        break;
-                }
-
-                currentFrame.clear();
-            }; break;
-            }
-        }
-    } /* while (true) switch */
+	if ( state() == QAbstractSocket::ConnectingState )
+	{
+		processHandshake();
+		return;
+	}
+
+	// A slot called from here could run the event loop
+	if ( parsing )
+		return;
+	parsing = true;
+
+	do
+	{
+		if ( readBuffer.isEmpty() )
+			readBuffer = tcpSocket->readAll();
+		else
+			readBuffer.append( tcpSocket->readAll() );
+
+		// The frames are parsed where they are, what is left is kept for the next time
+		qint64 pos = 0;
+		while ( pos < readBuffer.size() )
+		{
+			qint64 frameSize = processFrame( readBuffer.data() + pos, readBuffer.size() - pos );
+			if ( frameSize <= 0 )
+				break;
+			pos += frameSize;
+		}
+
+		if ( pos == readBuffer.size() )
+			readBuffer.clear();
+		else if ( pos > 0 )
+			readBuffer.remove( 0, pos );
+	} while ( tcpSocket->bytesAvailable() > 0 && QAbstractSocket::state() != QAbstractSocket::UnconnectedState );
+
+	parsing = false;
+}
+
+qint64 QWsSocket::processFrame( char * data, qint64 size )
+{
+	if ( size < 2 )
+		return 0;
+
+	const uchar * header = reinterpret_cast<const uchar *>( data );
+
+	// END, RSV1-3, Opcode
+	bool isFinalFragment = ( header[0] & 0x80 ) != 0;
+	bool rsv1 = ( header[0] & 0x40 ) != 0;
+	EOpcode frameOpcode = static_cast<EOpcode>( header[0] & 0x0F );
+
+	// Mask, PayloadLength
+	bool hasMask = ( header[1] & 0x80 ) != 0;
+	quint64 payloadLength = header[1] & 0x7F;
+	qint64 headerSize = 2;
+
+	if ( payloadLength == 126 )
+	{
+		if ( size < 4 )
+			return 0;
+		payloadLength = qFromBigEndian<quint16>( header + 2 );
+		headerSize = 4;
+	}
+	else if ( payloadLength == 127 )
+	{
+		if ( size < 10 )
+			return 0;
+		// Most significant bit must be set to 0 as per http://tools.ietf.org/html/rfc6455#section-5.2
+		payloadLength = qFromBigEndian<quint64>( header + 2 ) & ~(1ULL << 63);
+		headerSize = 10;
+	}
+
+	// Checked before waiting for the payload, so that nothing past the limit is
+	// buffered, for a single frame or for all the fragments of a message
+	if ( payloadLength > quint64( maxMessageSize ) - quint64( currentFrame.size() ) )
+	{
+		close( CloseTooMuchData );
+		tcpSocket->abort();
+		return 0;
+	}
+
+	const char * maskingKey = data + headerSize;
+	if ( hasMask )
+		headerSize += 4;
+
+	if ( size < headerSize + qint64( payloadLength ) )
+		return 0;
+
+	char * payload = data + headerSize;
+	int length = int( payloadLength );
+
+	if ( hasMask )
+		QWsSocket::mask( payload, length, maskingKey );
+
+	// Control frames can come between the fragments of a message, they don't change it
+	switch ( frameOpcode )
+	{
+		case OpPing:
+			writeFrame( QWsSocket::composeHeader( true, OpPong, 0 ) );
+			return headerSize + length;
+		case OpPong:
+			emit pong( pingTimer.elapsed() );
+			return headerSize + length;
+		case OpClose:
+			if ( length >= 2 )
+				closeStatusCode = (ECloseStatusCode)qFromBigEndian<quint16>( reinterpret_cast<const uchar *>( payload ) );
+			else
+				closeStatusCode = NoCloseStatusCode;
+			closingHandshakeReceived = true;
+			close( closeStatusCode );
+			return headerSize + length;
+		case OpText:
+		case OpBinary:
+			opcode = frameOpcode;
+			// RSV1 is set on the first frame of a compressed message
+			messageCompressed = deflater && rsv1;
+			break;
+		case OpContinue:
+			break;
+		default:
+			// DO NOTHING
+			return headerSize + length;
+	}
+
+	if ( !isFinalFragment )
+	{
+		currentFrame.append( payload, length );
+	}
+	else if ( currentFrame.isEmpty() )
+	{
+		// Message in a single frame, the only copy out of the buffer
+		processMessage( QByteArray( payload, length ) );
+	}
+	else
+	{
+		currentFrame.append( payload, length );
+		QByteArray message = currentFrame;
+		currentFrame.clear();
+		processMessage( message );
+	}
+
+	return headerSize + length;
+}
+
+void QWsSocket::processMessage( const QByteArray & message )
+{
+	QByteArray data = message;
+
+	if ( messageCompressed )
+	{
+		ECloseStatusCode error;
+		data = inflateMessage( message, &error );
+		messageCompressed = false;
+
+		if ( error == CloseTooMuchData )
+		{
+			close( CloseTooMuchData );
+			return;
+		}
+		if ( error != NoCloseStatusCode )
+		{
+			close( CloseProtocolError, QLatin1String("Invalid compressed data") );
+			return;
+		}
+	}
+
+	if ( opcode == OpBinary )
+	{
+		emit frameReceived( data );
+	}
+	else
+	{
+		emit textFrameReceived( data );
+		if ( receivers( SIGNAL(frameReceived(QString)) ) > 0 )
+			emit frameReceived( QString::fromUtf8( data ) );
+	}
 }
 
 qint64 QWsSocket::writeFrame ( const QByteArray & byteArray )
@@ -572,18 +658,56 @@ QByteArray QWsSocket::generateMaskingKeyV4( QString key, QString nonce )
 
 QByteArray QWsSocket::mask( const QByteArray & data, const QByteArray & maskingKey )
 {
-	QByteArray result;
-	result.reserve( data.size() );
+	QByteArray result = data;
+	QWsSocket::mask( result.data(), result.size(), maskingKey.constData() );
 
-	for ( int i=0 ; i<data.size() ; i++ )
+	return result;
+}
+
+void QWsSocket::mask( char * data, qint64 size, const char * maskingKey )
+{
+	quint32 key32;
+	memcpy( &key32, maskingKey, 4 );
+
+	// The steps are multiples of 4 bytes, so the key stays in phase
+	qint64 i = 0;
+#ifdef QWS_SSE2
+	const __m128i key128 = _mm_set1_epi32( key32 );
+	for ( ; i + 32 <= size ; i += 32 )
+	{
+		__m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i *>( data + i ) );
+		__m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i *>( data + i + 16 ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( data + i ), _mm_xor_si128( a, key128 ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( data + i + 16 ), _mm_xor_si128( b, key128 ) );
+	}
+#endif
+	const quint64 key64 = ( quint64( key32 ) << 32 ) | key32;
+	for ( ; i + 8 <= size ; i += 8 )
+	{
+		quint64 word;
+		memcpy( &word, data + i, 8 );
+		word ^= key64;
+		memcpy( data + i, &word, 8 );
+	}
+	for ( ; i < size ; i++ )
 	{
-		result[i] = ( data[i] ^ maskingKey[ i % 4 ] );
+		data[i] ^= maskingKey[ i % 4 ];
 	}
+}
 
-	return result;
+QByteArray QWsSocket::composeFrame( const QByteArray & byteArray, bool asBinary, bool compressed )
+{
+	QByteArray header = QWsSocket::composeHeader( true, asBinary ? OpBinary : OpText, byteArray.size(), QByteArray(), compressed );
+
+	QByteArray frame;
+	frame.reserve( header.size() + byteArray.size() );
+	frame.append( header );
+	frame.append( byteArray );
+
+	return frame;
 }
 
-QList<QByteArray> QWsSocket::composeFrames( QByteArray byteArray, bool asBinary, int maxFrameBytes )
+QList<QByteArray> QWsSocket::composeFrames( QByteArray byteArray, bool asBinary, int maxFrameBytes, bool compressed )
 {
 	if ( maxFrameBytes == 0 )
 		maxFrameBytes = maxBytesPerFrame;
@@ -616,7 +740,7 @@ QList<QByteArray> QWsSocket::composeFrames( QByteArray byteArray, bool asBinary,
 		}
 		
 		// Header
-		BA.append( QWsSocket::composeHeader( end, opcode, size, maskingKey ) );
+		BA.append( QWsSocket::composeHeader( end, opcode, size, maskingKey, compressed && i == 0 ) );
 		
 		// Application Data
 		QByteArray dataForThisFrame = byteArray.left( size );
@@ -631,7 +755,7 @@ QList<QByteArray> QWsSocket::composeFrames( QByteArray byteArray, bool asBinary,
 	return framesList;
 }
 
-QByteArray QWsSocket::composeHeader( bool end, EOpcode opcode, quint64 payloadLength, QByteArray maskingKey )
+QByteArray QWsSocket::composeHeader( bool end, EOpcode opcode, quint64 payloadLength, QByteArray maskingKey, bool compressed )
 {
 	QByteArray BA;
 	quint8 byte;
@@ -641,6 +765,9 @@ QByteArray QWsSocket::composeHeader( bool end, EOpcode opcode, quint64 payloadLe
 	// end
 	if ( end )
 		byte = (byte | 0x80);
+	// RSV1: permessage-deflate
+	if ( compressed )
+		byte = (byte | 0x40);
 	// Opcode
 	byte = (byte | opcode);
 	BA.append( byte );
@@ -791,3 +918,155 @@ QString QWsSocket::composeOpeningHandShake( QString resourceName, QString host,
 	hs.append(QLatin1String("\r\n"));
 	return hs;
 }
+
+QString QWsSocket::negotiateDeflate( const QString & offers, bool * noContextTakeover, int * windowBits )
+{
+	foreach ( const QString & offer, offers.split( QLatin1Char(',') ) )
+	{
+		QStringList params = offer.split( QLatin1Char(';') );
+		if ( params.takeFirst().trimmed() != QLatin1String("permessage-deflate") )
+			continue;
+
+		QStringList accepted;
+		accepted << QLatin1String("permessage-deflate");
+		*noContextTakeover = false;
+		*windowBits = 15;
+		bool valid = true;
+
+		foreach ( const QString & param, params )
+		{
+			QString name = param.section( QLatin1Char('='), 0, 0 ).trimmed();
+			QString value = param.section( QLatin1Char('='), 1 ).trimmed().remove( QLatin1Char('"') );
+
+			if ( name == QLatin1String("server_no_context_takeover") )
+			{
+				*noContextTakeover = true;
+				accepted << name;
+			}
+			else if ( name == QLatin1String("server_max_window_bits") )
+			{
+				// zlib can't make raw deflate streams with a window of 8 bits
+				*windowBits = value.toInt();
+				if ( *windowBits < 9 || *windowBits > 15 )
+					valid = false;
+				accepted << name + QLatin1Char('=') + QString::number( *windowBits );
+			}
+			else if ( name != QLatin1String("client_no_context_takeover") && name != QLatin1String("client_max_window_bits") )
+			{
+				// The inflater takes any client window, the other parameters are unknown
+				valid = false;
+			}
+		}
+
+		if ( valid )
+			return accepted.join( QLatin1String("; ") );
+	}
+
+	return QString();
+}
+
+void QWsSocket::enableDeflate( bool noContextTakeover, int windowBits )
+{
+	if ( deflater || _version < WS_V13 )
+		return;
+
+	// A smaller window than the one negotiated is always fine for the client. With the
+	// zlib defaults the deflater costs 256KB for each connection, here 16KB, which is
+	// plenty for the messages sent
+	deflater = new z_stream();
+	deflateInit2( deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -qMin( windowBits, 11 ), 4, Z_DEFAULT_STRATEGY );
+	inflater = new z_stream();
+	inflateInit2( inflater, -15 );
+	deflateNoContextTakeover = noContextTakeover;
+}
+
+bool QWsSocket::deflateEnabled()
+{
+	return deflater != 0;
+}
+
+// A sync flush ends with 00 00 FF FF, which the messages leave out
+QByteArray QWsSocket::deflateMessage( const QByteArray & data )
+{
+	QByteArray result;
+
+	deflater->next_in = (Bytef *) data.constData();
+	deflater->avail_in = data.size();
+
+	do
+	{
+		int done = result.size();
+		int space = qMax( 1024, int( deflateBound( deflater, deflater->avail_in ) ) );
+		result.resize( done + space );
+
+		deflater->next_out = (Bytef *) result.data() + done;
+		deflater->avail_out = space;
+
+		deflate( deflater, Z_SYNC_FLUSH );
+
+		result.resize( done + space - deflater->avail_out );
+	} while ( deflater->avail_out == 0 );
+
+	result.chop( 4 );
+
+	if ( deflateNoContextTakeover )
+		deflateReset( deflater );
+
+	return result;
+}
+
+QByteArray QWsSocket::inflateMessage( const QByteArray & data, ECloseStatusCode * error )
+{
+	static const char tail[4] = { 0x00, 0x00, (char) 0xFF, (char) 0xFF };
+
+	QByteArray input = data;
+	input.append( tail, 4 );
+
+	QByteArray result;
+
+	inflater->next_in = (Bytef *) input.constData();
+	inflater->avail_in = input.size();
+
+	*error = NoCloseStatusCode;
+
+	while ( true )
+	{
+		// Never more than one byte past the limit, so a small message can't make a huge one
+		int done = result.size();
+		int space = int( qMin( qMax( qint64( 1024 ), input.size() * qint64( 4 ) ), qint64( maxMessageSize ) + 1 - done ) );
+		result.resize( done + space );
+
+		inflater->next_out = (Bytef *) result.data() + done;
+		inflater->avail_out = space;
+
+		int ret = inflate( inflater, Z_SYNC_FLUSH );
+
+		result.resize( done + space - inflater->avail_out );
+
+		if ( result.size() > maxMessageSize )
+		{
+			*error = CloseTooMuchData;
+			return QByteArray();
+		}
+
+		if ( ret == Z_STREAM_END )
+		{
+			// The client ended its stream with a final block, what follows starts a new one
+			inflateReset( inflater );
+			if ( inflater->avail_in == 0 )
+				break;
+			continue;
+		}
+
+		if ( ret != Z_OK && ret != Z_BUF_ERROR )
+		{
+			*error = CloseProtocolError;
+			return QByteArray();
+		}
+
+		if ( inflater->avail_out != 0 )
+			break;
+	}
+
+	return result;
+}
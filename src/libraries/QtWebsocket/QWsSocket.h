@@ -5,6 +5,8 @@
 #include <QHostAddress>
 #include <QTime>
 
+struct z_stream_s;
+
 enum EWebsocketVersion
 {
 	WS_VUnknow = -1,
@@ -88,6 +90,15 @@ public:
 
 	qint64 write( const QString & string ); // write data as text
 	qint64 write( const QByteArray & byteArray ); // write data as binary
+	// A frame from composeFrame(), sent as is, so that the same frame can go to many
+	// sockets. Never compressed, permessage-deflate allows uncompressed messages
+	qint64 writePrepared( const QByteArray & frame );
+	// Written but not sent yet
+	qint64 bytesPending();
+
+	// Compresses messages with permessage-deflate (RFC 7692), once negotiated
+	void enableDeflate( bool noContextTakeover = false, int windowBits = 15 );
+	bool deflateEnabled();
 
 public slots:
 	void connectToHost( const QString & hostName, quint16 port, OpenMode mode = ReadWrite );
@@ -98,6 +109,9 @@ public slots:
     virtual void close( ECloseStatusCode closeStatusCode = NoCloseStatusCode, QString reason = QString() );
 
 signals:
+	// Text messages as received, in UTF-8
+	void textFrameReceived(QByteArray frame);
+	// Same, converted. Only emitted when something is connected to it
 	void frameReceived(QString frame);
 	void frameReceived(QByteArray frame);
 	void pong(quint64 elapsedTime);
@@ -113,18 +127,12 @@ protected slots:
 	void processTcpStateChanged( QAbstractSocket::SocketState socketState );
 
 private:
-	enum EReadingState
-    {
-		HeaderPending,
-		PayloadLengthPending,
-		BigPayloadLenghPending,
-		MaskPending,
-		PayloadBodyPending,
-		CloseDataPending
-	};
-
 	// private vars
 	QTcpSocket * tcpSocket;
+	// What was read and not parsed yet, frames are parsed and unmasked in it
+	QByteArray readBuffer;
+	bool parsing;
+	// Payload of the fragments of the current message, when there are several
 	QByteArray currentFrame;
 	QTime pingTimer;
 
@@ -141,12 +149,8 @@ private:
 	bool closingHandshakeSent;
 	bool closingHandshakeReceived;
 
-	EReadingState readingState;
+	// Opcode of the message being received
 	EOpcode opcode;
-	bool isFinalFragment;
-	bool hasMask;
-	quint64 payloadLength;
-	QByteArray maskingKey;
 	ECloseStatusCode closeStatusCode;
 
     static const QString regExpAcceptStr;
@@ -155,17 +159,41 @@ private:
     QString handshakeResponse;
     QString key;
 
+	// permessage-deflate, one stream each way for the whole connection
+	z_stream_s * deflater;
+	z_stream_s * inflater;
+	bool deflateNoContextTakeover;
+	bool messageCompressed;
+
+	QByteArray deflateMessage( const QByteArray & data );
+	// Fails with CloseProtocolError on invalid data, CloseTooMuchData past maxMessageSize
+	QByteArray inflateMessage( const QByteArray & data, ECloseStatusCode * error );
+
+	// Parses the frame at the start of data, returns its size or 0 if it's not all there yet
+	qint64 processFrame( char * data, qint64 size );
+	void processMessage( const QByteArray & message );
+
 public:
 	// Static functions
 	static QByteArray generateMaskingKey();
 	static QByteArray generateMaskingKeyV4( QString key, QString nonce );
     static QByteArray mask(const QByteArray & data, const QByteArray & maskingKey );
-	static QList<QByteArray> composeFrames( QByteArray byteArray, bool asBinary = false, int maxFrameBytes = 0 );
-	static QByteArray composeHeader( bool end, EOpcode opcode, quint64 payloadLength, QByteArray maskingKey = QByteArray() );
+	// In place, 32 bytes at a time. Masking and unmasking are the same
+	static void mask( char * data, qint64 size, const char * maskingKey );
+	// The whole message in one frame, header and payload in one buffer
+	static QByteArray composeFrame( const QByteArray & byteArray, bool asBinary = false, bool compressed = false );
+	static QList<QByteArray> composeFrames( QByteArray byteArray, bool asBinary = false, int maxFrameBytes = 0, bool compressed = false );
+	static QByteArray composeHeader( bool end, EOpcode opcode, quint64 payloadLength, QByteArray maskingKey = QByteArray(), bool compressed = false );
+	// Answer to the permessage-deflate offers of a client, empty if none can be accepted
+	static QString negotiateDeflate( const QString & offers, bool * noContextTakeover, int * windowBits );
 	static QString composeOpeningHandShake( QString resourceName, QString host, QString origin, QString extensions, QString key );
 
 	// static vars
+	// Only for composeFrames, write() sends each message in a single frame
 	static int maxBytesPerFrame;
+	// Biggest message received, compressed or not. Past it, the connection is
+	// closed with CloseTooMuchData
+	static int maxMessageSize;
 };
 
 #endif // QWSSOCKET_H
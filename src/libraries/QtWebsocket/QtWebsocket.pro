@@ -20,3 +20,6 @@ HEADERS += QWsServer.h \
     QWsSocket.h
 
 include(../../Shared/Common.pri)
+
+windows: { LIBS += -L$$bin -lzlib1 }
+!windows: { LIBS += -lz }
@@ -11,11 +11,17 @@ SOURCES += otherwidgets.cpp \
     CrossDynamicLib.cpp \
     contextswitch.cpp \
     coreclasses.cpp \
+    packetbuilder.cpp \
+    compressionstream.cpp \
+    arena.cpp \
+    asynclog.cpp \
+    connectiontable.cpp \
     qimagebuttonlr.cpp \
     confighelper.cpp \
     qtableplus.cpp \
     qclicklabel.cpp \
     ziputils.cpp \
+    zipcache.cpp \
     qclosedockwidget.cpp \
     backtrace.cpp \
     qverticalscrollarea.cpp \
@@ -33,11 +39,18 @@ HEADERS += otherwidgets.h \
     coro.h \
     contextswitch.h \
     coreclasses.h \
+    packetbuilder.h \
+    compressionstream.h \
+    arena.h \
+    asynclog.h \
+    connectiontable.h \
+    idallocator.h \
     qimagebuttonlr.h \
     confighelper.h \
     qtableplus.h \
     qclicklabel.h \
     ziputils.h \
+    zipcache.h \
     qclosedockwidget.h \
     backtrace.h \
     qverticalscrollarea.h \
@@ -49,6 +62,7 @@ HEADERS += otherwidgets.h \
     asiosocket.h \
     network.h \
     rankingtree.h \
+    ladderindex.h \
     baseanalyzer.h \
     keypresseater.h \
     exesuffix.h \
@@ -95,8 +109,8 @@ contains(QT_VERSION, ^5\\.[0-9]\\..*) {
 
 include(../../Shared/Common.pri)
 
-windows: { LIBS += -L$$bin -lzip-2 }
-!windows: { LIBS += -lzip }
+windows: { LIBS += -L$$bin -lzip-2 -lzlib1 }
+!windows: { LIBS += -lzip -lz }
 
 FORMS += \
     pluginmanagerdialog.ui
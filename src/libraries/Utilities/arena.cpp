@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include "arena.h"
+
+/* Bigger than that, the memory isn't kept between resets */
+static const size_t maxKeptBlock = 64*1024;
+
+Arena::Arena(size_t blockSize) : head(0), pos(0), end(0), blockSize(blockSize), m_used(0), m_blocks(0)
+{
+}
+
+Arena::~Arena()
+{
+    while (head) {
+        Block *next = head->next;
+        free(head);
+        head = next;
+    }
+}
+
+void Arena::addBlock(size_t size)
+{
+    Block *b = static_cast<Block*>(malloc(sizeof(Block) + size));
+    if (!b) {
+        throw std::bad_alloc();
+    }
+    b->next = head;
+    b->size = size;
+    head = b;
+
+    pos = reinterpret_cast<char*>(b + 1);
+    end = pos + size;
+
+    m_blocks += 1;
+}
+
+void *Arena::allocate(size_t size, size_t align)
+{
+    size_t padding = (align - reinterpret_cast<size_t>(pos) % align) % align;
+
+    if (!head || size + padding > size_t(end - pos)) {
+        addBlock(std::max(blockSize, size + align));
+        padding = (align - reinterpret_cast<size_t>(pos) % align) % align;
+    }
+
+    char *ret = pos + padding;
+    pos = ret + size;
+    m_used += size;
+
+    return ret;
+}
+
+void Arena::reset()
+{
+    if (!head) {
+        return;
+    }
+
+    if (!head->next) {
+        pos = reinterpret_cast<char*>(head + 1);
+        return;
+    }
+
+    /* One block for what was used, so it doesn't take several next time */
+    size_t total = 0;
+    while (head) {
+        Block *next = head->next;
+        total += head->size;
+        free(head);
+        head = next;
+    }
+
+    blockSize = std::max(blockSize, std::min(total, maxKeptBlock));
+    addBlock(blockSize);
+}
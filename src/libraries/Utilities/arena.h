@@ -0,0 +1,98 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+#include <QtGlobal>
+
+/* Memory for data that doesn't outlive a step of work (a turn of battle, ...),
+   handed out from big blocks and given back all at once with reset(). Nothing
+   is freed before that.
+
+   After a reset, the blocks used are merged into one big enough for all of
+   them (up to 64 KB), so that the same work done again doesn't allocate
+   anything.
+
+   Not thread-safe, use one for each thread of work.
+
+    Arena arena;
+    std::vector<int, ArenaAllocator<int> > v(&arena);
+    ...
+    arena.reset(); // v must not be used anymore */
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 2048);
+    ~Arena();
+
+    void *allocate(size_t size, size_t align);
+    void reset();
+
+    /* Counters, since the arena was created */
+    /* Bytes handed out */
+    qint64 used() const {
+        return m_used;
+    }
+    /* Blocks allocated on the heap */
+    int blocks() const {
+        return m_blocks;
+    }
+private:
+    struct Block {
+        Block *next;
+        size_t size;
+    };
+
+    Block *head;
+    char *pos, *end;
+    size_t blockSize;
+
+    qint64 m_used;
+    int m_blocks;
+
+    void addBlock(size_t size);
+
+    Arena(const Arena&);
+    Arena &operator=(const Arena&);
+};
+
+/* To use an arena with the standard containers. Deallocating does nothing,
+   the memory comes back when the arena is reset.
+
+   No alias template for the vectors, the Qt 4 builds are still on -std=c++0x */
+template <class T>
+struct ArenaAllocator
+{
+    typedef T value_type;
+
+    template <class U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+
+    ArenaAllocator(Arena *arena) : arena(arena) {}
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), std::alignment_of<T>::value));
+    }
+
+    void deallocate(T *, size_t) {}
+
+    Arena *arena;
+};
+
+template <class T, class U>
+bool operator == (const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+    return a.arena == b.arena;
+}
+
+template <class T, class U>
+bool operator != (const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+    return a.arena != b.arena;
+}
+
+#endif // ARENA_H
@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <QDateTime>
+#include <QMutexLocker>
+#include "asynclog.h"
+
+static const char *levelNames[] = {"debug", "info", "warning", "critical", "fatal"};
+
+QByteArray LogRecord::format() const
+{
+    QString line = QDateTime::fromMSecsSinceEpoch(time).toString("yyyy-MM-dd hh:mm:ss.zzz");
+    line += '\t';
+    line += levelNames[level];
+    line += '\t';
+    line += channel == -1 ? QString("-") : QString::number(channel);
+    line += '\t';
+    line += player == -1 ? QString("-") : QString::number(player);
+    line += '\t';
+    /* One record per line */
+    line += QString(text).replace('\n', "\\n");
+
+    return line.toUtf8();
+}
+
+QByteArray LogRecord::formatConsole() const
+{
+    switch (level) {
+    case Warning:
+        return "Warning: " + text.toLocal8Bit();
+    case Critical:
+        return "Critical: " + text.toLocal8Bit();
+    case Fatal:
+        return "Fatal: " + text.toLocal8Bit();
+    default:
+        return text.toLocal8Bit();
+    }
+}
+
+/* Each cell has a sequence number telling whose turn it is: equal to the
+   position of the next write in the cell when it's free, that + 1 when it
+   holds a record not read yet */
+LogRing::LogRing(int capacity) : dequeuePos(0)
+{
+    int size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    cells = new Slot[size];
+    mask = size - 1;
+
+    for (int i = 0; i < size; i++) {
+        cells[i].seq.fetchAndStoreRelaxed(i);
+    }
+}
+
+LogRing::~LogRing()
+{
+    delete [] cells;
+}
+
+bool LogRing::push(const LogRecord &r)
+{
+    int pos = enqueuePos.fetchAndAddRelaxed(0);
+
+    forever {
+        Slot &cell = cells[pos & mask];
+        int diff = int(quint32(cell.seq.fetchAndAddAcquire(0)) - quint32(pos));
+
+        if (diff == 0) {
+            int next = int(quint32(pos) + 1);
+            if (enqueuePos.testAndSetRelaxed(pos, next)) {
+                cell.record = r;
+                cell.seq.fetchAndStoreRelease(next);
+                return true;
+            }
+            pos = enqueuePos.fetchAndAddRelaxed(0);
+        } else if (diff < 0) {
+            /* The reader is a whole ring behind */
+            m_dropped.fetchAndAddRelaxed(1);
+            return false;
+        } else {
+            /* Another thread took that position */
+            pos = enqueuePos.fetchAndAddRelaxed(0);
+        }
+    }
+}
+
+bool LogRing::pop(LogRecord &r)
+{
+    Slot &cell = cells[dequeuePos & mask];
+
+    if (quint32(cell.seq.fetchAndAddAcquire(0)) != dequeuePos + 1) {
+        return false;
+    }
+
+    r = cell.record;
+    /* So the strings are freed now rather than one ring later */
+    cell.record = LogRecord();
+    cell.seq.fetchAndStoreRelease(int(dequeuePos + mask + 1));
+    dequeuePos += 1;
+
+    return true;
+}
+
+bool LogRing::empty() const
+{
+    Slot &cell = cells[dequeuePos & mask];
+    return quint32(cell.seq.fetchAndAddOrdered(0)) != dequeuePos + 1;
+}
+
+int LogRing::pushed() const
+{
+    return const_cast<QAtomicInt&>(enqueuePos).fetchAndAddRelaxed(0);
+}
+
+int LogRing::dropped() const
+{
+    return const_cast<QAtomicInt&>(m_dropped).fetchAndAddRelaxed(0);
+}
+
+AsyncLog *AsyncLog::obj()
+{
+    static AsyncLog log;
+    return &log;
+}
+
+AsyncLog::AsyncLog() : fileIndex(0), fileSize(0), writtenCount(0)
+{
+}
+
+AsyncLog::~AsyncLog()
+{
+    stop();
+}
+
+void AsyncLog::start(const Options &options)
+{
+    if (isRunning()) {
+        return;
+    }
+
+    this->options = options;
+    openFile(0);
+
+    finishing.fetchAndStoreOrdered(0);
+    QThread::start(LowPriority);
+}
+
+void AsyncLog::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    finishing.fetchAndStoreOrdered(1);
+    {
+        QMutexLocker l(&mutex);
+        wake.wakeOne();
+    }
+    wait();
+
+    file.close();
+}
+
+bool AsyncLog::write(LogRecord::Level level, const QString &text, int channel, int player)
+{
+    LogRecord r;
+    r.time = QDateTime::currentMSecsSinceEpoch();
+    r.level = level;
+    r.channel = channel;
+    r.player = player;
+    r.text = text;
+
+    if (!ring.push(r)) {
+        return false;
+    }
+
+    if (idle.fetchAndAddOrdered(0)) {
+        QMutexLocker l(&mutex);
+        wake.wakeOne();
+    }
+
+    return true;
+}
+
+void AsyncLog::flush()
+{
+    if (!isRunning() || currentThread() == this) {
+        return;
+    }
+
+    int target = ring.pushed();
+
+    QMutexLocker l(&mutex);
+    wake.wakeOne();
+    while (int(quint32(writtenCount) - quint32(target)) < 0 && isRunning()) {
+        written.wait(&mutex, 100);
+    }
+}
+
+void AsyncLog::run()
+{
+    forever {
+        LogRecord r;
+        int count = 0;
+
+        while (ring.pop(r)) {
+            writeRecord(r);
+            count += 1;
+        }
+
+        if (count > 0) {
+            if (options.console) {
+                fflush(stdout);
+            }
+            file.flush();
+
+            QMutexLocker l(&mutex);
+            writtenCount += count;
+            written.wakeAll();
+            continue;
+        }
+
+        if (finishing.fetchAndAddOrdered(0)) {
+            break;
+        }
+
+        QMutexLocker l(&mutex);
+        idle.fetchAndStoreOrdered(1);
+        /* A record may have come between the last pop and being marked idle,
+           its writer didn't wake us up then */
+        if (ring.empty()) {
+            wake.wait(&mutex, 1000);
+        }
+        idle.fetchAndStoreOrdered(0);
+    }
+}
+
+void AsyncLog::writeRecord(const LogRecord &r)
+{
+    if (options.console) {
+        QByteArray line = r.formatConsole();
+        fwrite(line.constData(), 1, line.length(), stdout);
+        fputc('\n', stdout);
+    }
+
+    if (!file.isOpen()) {
+        return;
+    }
+
+    QByteArray line = r.format() + '\n';
+    file.write(line);
+    fileSize += line.length();
+
+    if (options.maxSize > 0 && fileSize >= options.maxSize) {
+        openFile((fileIndex + 1) % std::max(options.files, 1));
+    }
+}
+
+void AsyncLog::openFile(int index)
+{
+    /* Only the first file is kept when starting, the others are replaced */
+    QIODevice::OpenMode mode = QIODevice::WriteOnly;
+    mode |= options.append && !file.isOpen() ? QIODevice::Append : QIODevice::Truncate;
+
+    file.close();
+
+    fileIndex = index;
+    QString name = options.pattern.contains("%1") ? options.pattern.arg(index) : options.pattern;
+    file.setFileName(name);
+
+    if (!file.open(mode)) {
+        fprintf(stderr, "Can't open log file %s\n", name.toLocal8Bit().constData());
+        return;
+    }
+    fileSize = file.size();
+
+    if (!options.lastFile.isEmpty()) {
+        QFile last(options.lastFile);
+        if (last.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            last.write(name.toUtf8() + '\n');
+        }
+    }
+}
+
+#ifdef QT5
+static void messageHandler(QtMsgType type, const QMessageLogContext&, const QString &msg)
+#else
+static void messageHandler(QtMsgType type, const char *msg)
+#endif
+{
+    LogRecord::Level level;
+
+    switch (type) {
+    case QtDebugMsg:
+        level = LogRecord::Debug;
+        break;
+    case QtWarningMsg:
+        level = LogRecord::Warning;
+        break;
+    case QtCriticalMsg:
+        level = LogRecord::Critical;
+        break;
+    case QtFatalMsg:
+        level = LogRecord::Fatal;
+        break;
+    default:
+        level = LogRecord::Info;
+        break;
+    }
+
+    AsyncLog *log = AsyncLog::obj();
+
+    if (level != LogRecord::Fatal) {
+        log->write(level, msg);
+        return;
+    }
+
+    /* Whatever was logged before the crash is useful */
+    if (log->isRunning()) {
+        log->write(level, msg);
+        log->flush();
+    } else {
+        LogRecord r;
+        r.level = level;
+        r.text = msg;
+        fprintf(stderr, "%s\n", r.formatConsole().constData());
+    }
+    abort();
+}
+
+void AsyncLog::install()
+{
+#ifdef QT5
+    qInstallMessageHandler(messageHandler);
+#else
+    qInstallMsgHandler(messageHandler);
+#endif
+}
@@ -0,0 +1,141 @@
+#ifndef ASYNCLOG_H
+#define ASYNCLOG_H
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+/* A line of log, with what it's about when it's known */
+struct LogRecord
+{
+    enum Level {
+        Debug,
+        Info,
+        Warning,
+        Critical,
+        Fatal
+    };
+
+    qint64 time;
+    Level level;
+    /* -1 when not about a channel / a player */
+    int channel;
+    int player;
+    QString text;
+
+    LogRecord() : time(0), level(Info), channel(-1), player(-1) {}
+
+    /* time level channel player text, separated by tabs, for the files */
+    QByteArray format() const;
+    /* Only the text, like it was before, for the console */
+    QByteArray formatConsole() const;
+};
+
+/* Fixed size queue of log records. Any thread can push without taking a lock,
+   only one thread must pop (the writer). When it's full, the record is dropped
+   instead of waiting: a slow disk mustn't stop the server. */
+class LogRing
+{
+public:
+    /* Rounded up to a power of 2 */
+    explicit LogRing(int capacity = 8192);
+    ~LogRing();
+
+    bool push(const LogRecord &r);
+    /* From the reading thread only */
+    bool pop(LogRecord &r);
+    bool empty() const;
+
+    /* Records pushed so far, dropped ones not included. Wraps around */
+    int pushed() const;
+    int dropped() const;
+private:
+    struct Slot {
+        QAtomicInt seq;
+        LogRecord record;
+    };
+
+    Slot *cells;
+    int mask;
+
+    QAtomicInt enqueuePos;
+    quint32 dequeuePos;
+    QAtomicInt m_dropped;
+
+    LogRing(const LogRing&);
+    LogRing &operator=(const LogRing&);
+};
+
+/* The log of the process: records go in a LogRing, and a thread writes them
+   to the console and to the log files. Writing a line of log is just a copy
+   in memory for the thread doing it.
+
+   The files are logs0.txt, logs1.txt, ... (with the default pattern): when one
+   gets bigger than maxSize, the next one is started, and its name is written
+   in last_log_file.txt.
+
+   install() makes qDebug() and co go through it. */
+class AsyncLog : public QThread
+{
+public:
+    struct Options {
+        /* %1 is the number of the file, when there are several */
+        QString pattern;
+        int files;
+        /* 0 to never rotate */
+        qint64 maxSize;
+        bool append;
+        bool console;
+        /* Where the name of the current file is written, can be empty */
+        QString lastFile;
+
+        Options() : pattern("logs%1.txt"), files(25), maxSize(4*1024*1024), append(false),
+            console(true), lastFile("last_log_file.txt") {}
+    };
+
+    static AsyncLog *obj();
+
+    void start(const Options &options = Options());
+    /* Writes everything already pushed and stops the thread */
+    void stop();
+
+    /* Doesn't block. Returns false if the record was dropped */
+    bool write(LogRecord::Level level, const QString &text, int channel = -1, int player = -1);
+    /* Waits until everything pushed before is written */
+    void flush();
+
+    /* Routes qDebug(), qWarning(), ... here */
+    static void install();
+
+    int dropped() const {
+        return ring.dropped();
+    }
+
+    AsyncLog();
+    ~AsyncLog();
+protected:
+    void run();
+private:
+    LogRing ring;
+    Options options;
+
+    QFile file;
+    int fileIndex;
+    qint64 fileSize;
+
+    /* The writer thread sleeps on wake when there's nothing to write, and
+       marks itself idle so that writers know to wake it up */
+    QMutex mutex;
+    QWaitCondition wake, written;
+    QAtomicInt idle;
+    QAtomicInt finishing;
+    int writtenCount;
+
+    void openFile(int index);
+    void writeRecord(const LogRecord &r);
+};
+
+#endif // ASYNCLOG_H
@@ -9,6 +9,7 @@ BaseAnalyzer::~BaseAnalyzer()
     /* Very important feature. If you don't do this it might crash.
         this makes the stillValid of Network redundant, but still.*/
     close();
+    delete deflater;
 }
 
 void BaseAnalyzer::connectTo(const QString &host, quint16 port)
@@ -19,6 +20,8 @@ void BaseAnalyzer::connectTo(const QString &host, quint16 port)
 
 void BaseAnalyzer::close() {
     if (dummy) {return;}
+    /* Sends what was said last, like a kick message */
+    flushStream();
     socket().close();
 }
 
@@ -105,7 +108,142 @@ void BaseAnalyzer::setVersion(const ProtocolVersion &v)
 
 void BaseAnalyzer::sendPacket(const QByteArray &packet)
 {
-    emit packetToSend(packet);
+    if (bundleDepth > 0 || deflater) {
+        queuePacket(packet);
+    } else {
+        emit packetToSend(packet);
+    }
+}
+
+void BaseAnalyzer::startBundle()
+{
+    bundleDepth += 1;
+}
+
+/* The packets queued are each a length followed by the command, which is how
+   a QByteArray is serialized: the client reads them back with a DataStream */
+void BaseAnalyzer::queueCommand(const QByteArray &command)
+{
+    QByteArray &queue = bundleDepth > 0 ? bundle : streamBuffer;
+
+    int l = command.length();
+    char length[4] = {char(l >> (3*8)), char(l >> (2*8)), char(l >> 8), char(l)};
+
+    queue.append(length, 4);
+    queue.append(command);
+    queued();
+}
+
+void BaseAnalyzer::queuePacket(const QByteArray &packet)
+{
+    (bundleDepth > 0 ? bundle : streamBuffer).append(packet);
+    queued();
+}
+
+/* Big enough to not wait for the event loop to send it */
+static const int maxStreamBuffer = 64*1024;
+
+void BaseAnalyzer::queued()
+{
+    if (bundleDepth > 0) {
+        bundleCount += 1;
+    } else if (streamBuffer.length() >= maxStreamBuffer) {
+        flushStream();
+    } else if (!flushScheduled) {
+        flushScheduled = true;
+        QTimer::singleShot(0, this, SLOT(flushStream()));
+    }
+}
+
+void BaseAnalyzer::endBundle()
+{
+    if (bundleDepth == 0 || --bundleDepth > 0) {
+        return;
+    }
+
+    QByteArray packets;
+    packets.swap(bundle);
+
+    int count = bundleCount;
+    bundleCount = 0;
+
+    if (count == 0) {
+        return;
+    }
+
+    /* The stream compresses it anyway */
+    if (deflater) {
+        queuePacket(packets);
+        return;
+    }
+
+    /* Already a packet, not worth compressing again */
+    if (count == 1) {
+        emit packetToSend(packets);
+        return;
+    }
+
+    QByteArray cp = qCompress(packets);
+
+    QByteArray ret(6+cp.length(), Qt::Uninitialized);
+
+    const int l = ret.length()-4;
+    ret[0] = l >> (3*8);
+    ret[1] = l >> (2*8);
+    ret[2] = l >> 8;
+    ret[3] = l;
+    ret[4] = ZipCommand;
+    ret[5] = 1; /* Multiple packets */
+
+    ret.replace(6, cp.length(), cp);
+
+    emit packetToSend(ret);
+}
+
+void BaseAnalyzer::setStreamCompression(bool enabled)
+{
+    if (enabled == (deflater != NULL)) {
+        return;
+    }
+
+    if (enabled) {
+        deflater = new DeflateStream();
+    } else {
+        flushStream();
+        delete deflater;
+        deflater = NULL;
+    }
+}
+
+bool BaseAnalyzer::streamCompression() const
+{
+    return deflater != NULL;
+}
+
+void BaseAnalyzer::flushStream()
+{
+    flushScheduled = false;
+
+    if (!deflater || streamBuffer.isEmpty()) {
+        return;
+    }
+
+    QByteArray cp = deflater->compress(streamBuffer);
+    streamBuffer.resize(0);
+
+    QByteArray ret(6, Qt::Uninitialized);
+
+    const int l = 2+cp.length();
+    ret[0] = l >> (3*8);
+    ret[1] = l >> (2*8);
+    ret[2] = l >> 8;
+    ret[3] = l;
+    ret[4] = ZipCommand;
+    ret[5] = 2; /* Part of the connection's stream */
+
+    ret.append(cp);
+
+    emit packetToSend(ret);
 }
 
 void BaseAnalyzer::undelay()
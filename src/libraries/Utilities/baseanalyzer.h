@@ -1,8 +1,11 @@
 #ifndef BASEANALYZER_H
 #define BASEANALYZER_H
 
+#include <QPointer>
 #include <Utilities/network.h>
 #include <Utilities/coreclasses.h>
+#include <Utilities/packetbuilder.h>
+#include <Utilities/compressionstream.h>
 /* for ProtocolVersion */
 #include <PokemonInfo/networkstructs.h>
 
@@ -38,23 +41,34 @@ public:
     /* Delays all commands to be sent */
     void delay();
 
+    /* What is sent between the two is kept and sent at the end in one
+       compressed packet (ZipCommand with content type 1, multiple packets).
+       Only for clients supporting compression. Can be nested. */
+    void startBundle();
+    void endBundle();
+
+    /* From then on, everything sent goes through one zlib stream kept for the
+       connection (ZipCommand with content type 2), flushed once the event
+       loop is back. Only for clients supporting it. */
+    void setStreamCompression(bool enabled);
+    bool streamCompression() const;
+
     void swapIds(BaseAnalyzer *other);
     void setId(int id);
     void setVersion(const ProtocolVersion &version);
 
     /* Convenience functions to avoid writing a new one every time */
     inline void emitCommand(const QByteArray &command) {
-        emit sendCommand(command);
+        if (bundleDepth > 0 || deflater) {
+            queueCommand(command);
+        } else {
+            emit sendCommand(command);
+        }
     }
 
     template <typename ...Params>
     void notify(int command, Params&&... params) {
-        QByteArray tosend;
-        DataStream out(&tosend, QIODevice::WriteOnly, version.version);
-
-        out.pack(uchar(command), std::forward<Params>(params)...);
-
-        emitCommand(tosend);
+        emitCommand(PacketBuilder::pack(version.version, uchar(command), std::forward<Params>(params)...));
     }
     template<class T>
     void notify_expand(int command, const T &paramList);
@@ -76,6 +90,8 @@ public slots:
 
     void undelay();
     void keepAlive(){}//do something
+
+    void flushStream();
 protected:
     GenericNetwork &socket();
     const GenericNetwork &socket() const;
@@ -85,6 +101,18 @@ protected:
     QLinkedList<QByteArray> delayedCommands;
     int delayCount;
 
+    /* Bundled or compressed, packets wait before being sent */
+    void queueCommand(const QByteArray &command);
+    void queuePacket(const QByteArray &packet);
+    void queued();
+    QByteArray bundle;
+    int bundleDepth;
+    int bundleCount;
+
+    DeflateStream *deflater;
+    QByteArray streamBuffer;
+    bool flushScheduled;
+
     GenericNetwork *mysocket;
 
     /* Is it a dummy analyzer ?*/
@@ -93,11 +121,38 @@ protected:
     ProtocolVersion version;
 };
 
+/* Bundles what an analyzer sends while in scope, see BaseAnalyzer::startBundle().
+   Does nothing with a null analyzer. */
+class BundleGuard
+{
+public:
+    BundleGuard(BaseAnalyzer *analyzer) : analyzer(analyzer) {
+        if (analyzer) {
+            analyzer->startBundle();
+        }
+    }
+
+    ~BundleGuard() {
+        if (analyzer) {
+            analyzer->endBundle();
+        }
+    }
+private:
+    QPointer<BaseAnalyzer> analyzer;
+
+    BundleGuard(const BundleGuard&);
+    BundleGuard &operator=(const BundleGuard&);
+};
+
 template<class SocketClass>
 BaseAnalyzer::BaseAnalyzer(const SocketClass &sock, int id, bool dummy) : mysocket(new Network<SocketClass>(sock, id)), dummy(dummy)
 {
     socket().setParent(this);
     delayCount = 0;
+    bundleDepth = 0;
+    bundleCount = 0;
+    deflater = NULL;
+    flushScheduled = false;
 
     if (dummy) {
         return;
@@ -136,7 +191,7 @@ void BaseAnalyzer::notify_expand(int command, const T& paramList)
         ++it;
     }
 
-    emit sendCommand(tosend);
+    emitCommand(tosend);
 }
 
 #endif // BASEANALYZER_H
@@ -0,0 +1,103 @@
+#ifdef __WIN32
+#include "../../SpecialIncludes/zlib.h"
+#else
+#include <zlib.h>
+#endif
+
+#include <algorithm>
+
+#include "compressionstream.h"
+
+/* Output grows by that much at a time */
+static const int chunkSize = 4096;
+
+DeflateStream::DeflateStream(int level) : stream(new z_stream())
+{
+    deflateInit(stream, level);
+}
+
+DeflateStream::~DeflateStream()
+{
+    deflateEnd(stream);
+    delete stream;
+}
+
+QByteArray DeflateStream::compress(const QByteArray &chunk)
+{
+    QByteArray ret;
+
+    stream->next_in = (Bytef*) chunk.constData();
+    stream->avail_in = chunk.length();
+
+    /* With a sync flush, all the input is done once some output space is left */
+    do {
+        int done = ret.length();
+        int space = std::max(chunkSize, int(deflateBound(stream, stream->avail_in)));
+        ret.resize(done + space);
+
+        stream->next_out = (Bytef*) ret.data() + done;
+        stream->avail_out = space;
+
+        deflate(stream, Z_SYNC_FLUSH);
+
+        ret.resize(done + space - stream->avail_out);
+    } while (stream->avail_out == 0);
+
+    return ret;
+}
+
+InflateStream::InflateStream() : stream(new z_stream()), broken(false)
+{
+    inflateInit(stream);
+}
+
+InflateStream::~InflateStream()
+{
+    inflateEnd(stream);
+    delete stream;
+}
+
+void InflateStream::reset()
+{
+    inflateReset(stream);
+    broken = false;
+}
+
+QByteArray InflateStream::decompress(const QByteArray &chunk, bool *ok)
+{
+    QByteArray ret;
+
+    if (broken) {
+        if (ok) {
+            *ok = false;
+        }
+        return ret;
+    }
+
+    stream->next_in = (Bytef*) chunk.constData();
+    stream->avail_in = chunk.length();
+
+    do {
+        int done = ret.length();
+        int space = std::max(chunkSize, chunk.length() * 4);
+        ret.resize(done + space);
+
+        stream->next_out = (Bytef*) ret.data() + done;
+        stream->avail_out = space;
+
+        int result = inflate(stream, Z_SYNC_FLUSH);
+
+        ret.resize(done + space - stream->avail_out);
+
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            broken = true;
+            break;
+        }
+    } while (stream->avail_out == 0);
+
+    if (ok) {
+        *ok = !broken;
+    }
+
+    return broken ? QByteArray() : ret;
+}
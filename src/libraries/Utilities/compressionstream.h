@@ -0,0 +1,48 @@
+#ifndef COMPRESSIONSTREAM_H
+#define COMPRESSIONSTREAM_H
+
+#include <QByteArray>
+
+struct z_stream_s;
+
+/* A zlib stream kept for the whole life of a connection. Each chunk is
+   compressed with what was sent before as dictionary, and ends with a sync
+   flush so that the other side can read it right away: repeated commands
+   (chat, player updates, battle commands) end up costing a few bytes.
+
+   Chunks must be inflated in the order they were deflated, by the same
+   InflateStream. */
+class DeflateStream
+{
+public:
+    DeflateStream(int level = 6);
+    ~DeflateStream();
+
+    QByteArray compress(const QByteArray &chunk);
+private:
+    z_stream_s *stream;
+
+    DeflateStream(const DeflateStream&);
+    DeflateStream &operator=(const DeflateStream&);
+};
+
+class InflateStream
+{
+public:
+    InflateStream();
+    ~InflateStream();
+
+    /* Sets ok to false if the data is corrupted, the stream can't be used
+       until reset */
+    QByteArray decompress(const QByteArray &chunk, bool *ok = 0);
+    /* For a new connection */
+    void reset();
+private:
+    z_stream_s *stream;
+    bool broken;
+
+    InflateStream(const InflateStream&);
+    InflateStream &operator=(const InflateStream&);
+};
+
+#endif // COMPRESSIONSTREAM_H
@@ -0,0 +1,44 @@
+#include <QObject>
+#include "connectiontable.h"
+
+ConnectionTable::ConnectionTable(const QMetaObject *sender, const QMetaObject *receiver)
+    : sender(sender), receiver(receiver)
+{
+}
+
+ConnectionTable &ConnectionTable::add(const char *signal, const char *method, Qt::ConnectionType type)
+{
+    /* SIGNAL() and SLOT() put a code before the signature (2 for a signal,
+       1 for a slot). The receiving method can be a signal too. */
+    QByteArray signalSignature = QMetaObject::normalizedSignature(signal + 1);
+    QByteArray methodSignature = QMetaObject::normalizedSignature(method + 1);
+
+    int signalIndex = sender->indexOfSignal(signalSignature.constData());
+    if (signalIndex == -1) {
+        qFatal("ConnectionTable: no signal %s in %s", signalSignature.constData(), sender->className());
+    }
+
+    int methodIndex = receiver->indexOfMethod(methodSignature.constData());
+    if (methodIndex == -1) {
+        qFatal("ConnectionTable: no method %s in %s", methodSignature.constData(), receiver->className());
+    }
+
+    if (!QMetaObject::checkConnectArgs(signalSignature.constData(), methodSignature.constData())) {
+        qFatal("ConnectionTable: %s and %s don't match", signalSignature.constData(), methodSignature.constData());
+    }
+
+    Connection c;
+    c.signal = sender->method(signalIndex);
+    c.method = receiver->method(methodIndex);
+    c.type = type;
+    connections.push_back(c);
+
+    return *this;
+}
+
+void ConnectionTable::connect(const QObject *sender, const QObject *receiver) const
+{
+    foreach(const Connection &c, connections) {
+        QObject::connect(sender, c.signal, receiver, c.method, c.type);
+    }
+}
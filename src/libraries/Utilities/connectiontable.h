@@ -0,0 +1,44 @@
+#ifndef CONNECTIONTABLE_H
+#define CONNECTIONTABLE_H
+
+#include <QMetaMethod>
+#include <QVector>
+
+/* Connections made the same way between many pairs of objects (each player
+   and the server, ...). The SIGNAL() and SLOT() are looked up in the meta
+   objects once, when the table is built, instead of being parsed and looked
+   up again by QObject::connect for each pair.
+
+   A signal or slot that doesn't exist, or arguments that don't match, are a
+   fatal error when the table is built instead of a warning in the logs each
+   time the connection is made.
+
+    static ConnectionTable table = ConnectionTable(&Player::staticMetaObject, &Server::staticMetaObject)
+        .add(SIGNAL(loggedIn(int,QString)), SLOT(loggedIn(int,QString)))
+        ...;
+    table.connect(player, server); */
+class ConnectionTable
+{
+public:
+    ConnectionTable(const QMetaObject *sender, const QMetaObject *receiver);
+
+    ConnectionTable &add(const char *signal, const char *method, Qt::ConnectionType type = Qt::AutoConnection);
+
+    void connect(const QObject *sender, const QObject *receiver) const;
+
+    int size() const {
+        return connections.size();
+    }
+private:
+    struct Connection {
+        QMetaMethod signal;
+        QMetaMethod method;
+        Qt::ConnectionType type;
+    };
+
+    const QMetaObject *sender;
+    const QMetaObject *receiver;
+    QVector<Connection> connections;
+};
+
+#endif // CONNECTIONTABLE_H
@@ -0,0 +1,45 @@
+#ifndef IDALLOCATOR_H
+#define IDALLOCATOR_H
+
+#include <climits>
+#include <QQueue>
+
+/* Ids for players and such, from 1 up, in O(1).
+
+   A released id isn't reused right away: a client or a script may still
+   refer to the one who had it. Released ids wait in a queue, and are only
+   taken again once reuseDelay other ids were released after them. Until
+   then, new ids are used. */
+class IdAllocator
+{
+public:
+    explicit IdAllocator(int reuseDelay = 4096) : counter(0), reuseDelay(reuseDelay) {
+
+    }
+
+    /* -1 if there are none left */
+    int take() {
+        if (released.size() > reuseDelay || (counter == INT_MAX && !released.empty())) {
+            return released.dequeue();
+        }
+        if (counter == INT_MAX) {
+            return -1;
+        }
+        return ++counter;
+    }
+
+    void release(int id) {
+        released.enqueue(id);
+    }
+
+    /* Ids waiting to be reused */
+    int waiting() const {
+        return released.size();
+    }
+private:
+    int counter;
+    int reuseDelay;
+    QQueue<int> released;
+};
+
+#endif // IDALLOCATOR_H
@@ -0,0 +1,265 @@
+#ifndef LADDERINDEX_H
+#define LADDERINDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <QtGlobal>
+
+/* Order statistics over a ladder: rank of a member and member at a given rank,
+   both in O(log n).
+
+   Ratings are small integers, so instead of a tree the index keeps one bucket per
+   rating and a Fenwick tree counting the members in each bucket. Buckets are
+   ordered from the highest rating to the lowest, and members with the same
+   rating are sorted by data in their bucket. Small data (like an id) keeps
+   the buckets cheap to shift around.
+
+   Buckets only go from MinKey to MaxKey: members with a key beyond (a script
+   can set any rating) share the bucket at the edge, sorted by key then data,
+   so the ranks stay right and the memory used stays bounded.
+
+   Nothing is allocated per member, a member is identified by its (key, data) pair. */
+template <class T>
+class LadderIndex
+{
+public:
+    enum {
+        MinKey = -16384,
+        MaxKey = 16383
+    };
+
+    LadderIndex() : high(-1), total(0) {
+
+    }
+
+    int count() const {
+        return total;
+    }
+
+    void clear() {
+        buckets.clear();
+        tree.clear();
+        high = -1;
+        total = 0;
+    }
+
+    void insert(int key, const T &data) {
+        reserve(key);
+
+        Bucket &b = buckets[index(key)];
+        Entry e(key, data);
+        b.insert(std::lower_bound(b.begin(), b.end(), e, before), e);
+        add(index(key), 1);
+        total += 1;
+    }
+
+    /* Returns false if the pair wasn't in the index */
+    bool remove(int key, const T &data) {
+        if (!inRange(key)) {
+            return false;
+        }
+
+        Bucket &b = buckets[index(key)];
+        auto it = find(b, key, data);
+        if (it == b.end()) {
+            return false;
+        }
+        b.erase(it);
+        add(index(key), -1);
+        total -= 1;
+
+        return true;
+    }
+
+    void changeKey(const T &data, int oldKey, int newKey) {
+        if (oldKey == newKey) {
+            return;
+        }
+        remove(oldKey, data);
+        insert(newKey, data);
+    }
+
+    /* 1 for the best, 0 if the pair isn't in the index */
+    int ranking(int key, const T &data) const {
+        if (!inRange(key)) {
+            return 0;
+        }
+
+        const Bucket &b = buckets[index(key)];
+        auto it = find(b, key, data);
+        if (it == b.end()) {
+            return 0;
+        }
+
+        return prefix(index(key)) + (it - b.begin()) + 1;
+    }
+
+    class iterator {
+    public:
+        iterator(const LadderIndex *ladder = nullptr, int bucket = 0, int pos = 0) : ladder(ladder), bucket(bucket), pos(pos) {
+
+        }
+
+        bool valid() const {
+            return ladder != nullptr;
+        }
+
+        int key() const {
+            return ladder->buckets[bucket][pos].first;
+        }
+
+        const T &data() const {
+            return ladder->buckets[bucket][pos].second;
+        }
+
+        /* Goes to the next rank */
+        iterator &operator ++ () {
+            if (!ladder) {
+                return *this;
+            }
+            if (++pos < int(ladder->buckets[bucket].size())) {
+                return *this;
+            }
+            pos = 0;
+            while (++bucket < int(ladder->buckets.size())) {
+                if (!ladder->buckets[bucket].empty()) {
+                    return *this;
+                }
+            }
+            ladder = nullptr;
+            return *this;
+        }
+
+    private:
+        const LadderIndex *ladder;
+        int bucket;
+        int pos;
+    };
+
+    /* Invalid iterator if there's no such ranking */
+    iterator getByRanking(int ranking) const {
+        if (ranking < 1 || ranking > total) {
+            return iterator();
+        }
+
+        /* Binary lifting in the fenwick tree: finds the last bucket having
+           less than 'ranking' members before it */
+        int pos = 0;
+        int remaining = ranking;
+        for (int step = int(tree.size()) - 1; step > 0; step >>= 1) {
+            if (pos + step < int(tree.size()) && tree[pos + step] < remaining) {
+                pos += step;
+                remaining -= tree[pos];
+            }
+        }
+
+        return iterator(this, pos, remaining - 1);
+    }
+
+private:
+    /* The key is only different from the bucket's at the edges */
+    typedef std::pair<int, T> Entry;
+    typedef std::vector<Entry> Bucket;
+
+    /* Highest key first, then lowest data */
+    static bool before(const Entry &a, const Entry &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    }
+
+    static typename Bucket::const_iterator find(const Bucket &b, int key, const T &data) {
+        Entry e(key, data);
+        auto it = std::lower_bound(b.begin(), b.end(), e, before);
+        return it != b.end() && !before(e, *it) ? it : b.end();
+    }
+
+    static typename Bucket::iterator find(Bucket &b, int key, const T &data) {
+        Entry e(key, data);
+        auto it = std::lower_bound(b.begin(), b.end(), e, before);
+        return it != b.end() && !before(e, *it) ? it : b.end();
+    }
+
+    static int clamp(int key) {
+        return std::max(int(MinKey), std::min(int(MaxKey), key));
+    }
+
+    /* Buckets from the highest key (index 0) to the lowest */
+    std::vector<Bucket> buckets;
+    /* Fenwick tree on the bucket sizes, 1-based, size is a power of 2 + 1 */
+    std::vector<int> tree;
+    int high;
+    int total;
+
+    bool inRange(int key) const {
+        key = clamp(key);
+        return key <= high && high - key < int(buckets.size());
+    }
+
+    int index(int key) const {
+        return high - clamp(key);
+    }
+
+    /* Number of members in the buckets before i */
+    int prefix(int i) const {
+        int ret = 0;
+        for (; i > 0; i -= i & (-i)) {
+            ret += tree[i];
+        }
+        return ret;
+    }
+
+    void add(int i, int diff) {
+        for (i += 1; i < int(tree.size()); i += i & (-i)) {
+            tree[i] += diff;
+        }
+    }
+
+    /* Makes room for the key, ratings usually stay in a small range
+       so that seldom happens */
+    void reserve(int key) {
+        if (inRange(key)) {
+            return;
+        }
+        key = clamp(key);
+
+        qint64 newHigh, newLow;
+        if (buckets.empty()) {
+            newHigh = qint64(key) + 1024;
+            newLow = qint64(key) - 1024;
+        } else {
+            newHigh = std::max(high, key);
+            newLow = std::min(high - int(buckets.size()) + 1, key);
+            /* Leave some space in the direction it grew */
+            if (key > high) {
+                newHigh += newHigh - newLow;
+            } else {
+                newLow -= newHigh - newLow;
+            }
+        }
+        newHigh = std::min(newHigh, qint64(MaxKey));
+        newLow = std::max(newLow, qint64(MinKey));
+
+        int size = 1;
+        while (size < newHigh - newLow + 1) {
+            size *= 2;
+        }
+
+        std::vector<Bucket> newBuckets(size);
+        for (int i = 0; i < int(buckets.size()); i++) {
+            newBuckets[newHigh - (high - i)].swap(buckets[i]);
+        }
+        buckets.swap(newBuckets);
+        high = int(newHigh);
+
+        /* Linear time fenwick construction */
+        tree.assign(size + 1, 0);
+        for (int i = 1; i <= size; i++) {
+            tree[i] += buckets[i-1].size();
+            int parent = i + (i & (-i));
+            if (parent <= size) {
+                tree[parent] += tree[i];
+            }
+        }
+    }
+};
+
+#endif // LADDERINDEX_H
@@ -65,6 +65,8 @@ public:
   void seed(const unsigned long*, int size); // seed with array
 // overload operator() to make this a generator (functor)
   int operator()() { return rand_int32(); }
+// makes the generator continue where the other one is, used by battle snapshots
+  void copyState(const MTRand_int32 &other) { memcpy(state, other.state, sizeof(state)); p = other.p; }
 // 2007-02-11: made the destructor virtual; thanks "double more" for pointing this out
   virtual ~MTRand_int32() {} // destructor
 protected: // used by derived classes, otherwise not accessible; use the ()-operator
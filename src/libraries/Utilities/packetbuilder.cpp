@@ -0,0 +1,109 @@
+#include <QThreadStorage>
+#include <QAtomicInt>
+#include "packetbuilder.h"
+
+namespace {
+/* Most packets are a few dozen bytes, player lists and such are bigger */
+const int initialCapacity = 1024;
+/* A thread that made a big packet once doesn't keep a big buffer */
+const int maxCapacity = 64*1024;
+
+QThreadStorage<PacketBuilder*> builders;
+
+QAtomicInt packetCount;
+QAtomicInt growthCount;
+QAtomicInt fallbackCount;
+}
+
+PacketBuilder::PacketBuilder() : out(&device), busy(false)
+{
+    buffer.reserve(initialCapacity);
+    capacity = buffer.capacity();
+
+    device.setBuffer(&buffer);
+    device.open(QIODevice::WriteOnly);
+}
+
+PacketBuilder *PacketBuilder::local()
+{
+    if (!builders.hasLocalData()) {
+        builders.setLocalData(new PacketBuilder());
+    }
+
+    PacketBuilder *b = builders.localData();
+
+    if (b->busy) {
+        fallbackCount.fetchAndAddRelaxed(1);
+        return NULL;
+    }
+
+    return b;
+}
+
+void PacketBuilder::setLength(char *header, int length)
+{
+    header[0] = length >> (3*8);
+    header[1] = length >> (2*8);
+    header[2] = length >> 8;
+    header[3] = length;
+}
+
+void PacketBuilder::begin(bool framed, quint16 version)
+{
+    busy = true;
+
+    device.seek(0);
+    out.resetStatus();
+    out.version = version;
+
+    if (framed) {
+        /* Length, set at the end */
+        out << qint32(0);
+    }
+}
+
+QByteArray PacketBuilder::end(bool framed)
+{
+    /* The buffer isn't emptied between packets, so only what was written
+       for this one counts */
+    int length = device.pos();
+
+    QByteArray ret(buffer.constData(), length);
+    if (framed) {
+        setLength(ret.data(), length - 4);
+    }
+
+    packetCount.fetchAndAddRelaxed(1);
+
+    if (buffer.capacity() != capacity) {
+        growthCount.fetchAndAddRelaxed(1);
+
+        if (buffer.capacity() > maxCapacity) {
+            device.close();
+            buffer = QByteArray();
+            buffer.reserve(initialCapacity);
+            device.setBuffer(&buffer);
+            device.open(QIODevice::WriteOnly);
+        }
+        capacity = buffer.capacity();
+    }
+
+    busy = false;
+
+    return ret;
+}
+
+int PacketBuilder::packets()
+{
+    return packetCount.fetchAndAddRelaxed(0);
+}
+
+int PacketBuilder::growths()
+{
+    return growthCount.fetchAndAddRelaxed(0);
+}
+
+int PacketBuilder::fallbacks()
+{
+    return fallbackCount.fetchAndAddRelaxed(0);
+}
@@ -0,0 +1,72 @@
+#ifndef PACKETBUILDER_H
+#define PACKETBUILDER_H
+
+#include <QBuffer>
+#include "coreclasses.h"
+
+/* Serializes packets in a buffer kept by each thread, instead of a new
+   QByteArray growing bit by bit, a new QBuffer and a new DataStream for each
+   packet. Only the packet returned is allocated.
+
+   It writes with a DataStream, so the packets are the same as before.
+
+    QByteArray command = PacketBuilder::pack(version, uchar(command), params...);
+    QByteArray packet = PacketBuilder::packFramed(version, uchar(command), params...);
+
+   packFramed adds the length of the packet in front, like makePacket. */
+class PacketBuilder
+{
+public:
+    template <typename ...Params>
+    static QByteArray pack(quint16 version, Params&&... params) {
+        return build(false, version, std::forward<Params>(params)...);
+    }
+
+    template <typename ...Params>
+    static QByteArray packFramed(quint16 version, Params&&... params) {
+        return build(true, version, std::forward<Params>(params)...);
+    }
+
+    /* Counters, for all threads */
+    static int packets();
+    /* Packets that didn't fit in the buffer of their thread */
+    static int growths();
+    /* Packets made while the buffer of the thread was in use */
+    static int fallbacks();
+private:
+    PacketBuilder();
+
+    template <typename ...Params>
+    static QByteArray build(bool framed, quint16 version, Params&&... params) {
+        PacketBuilder *b = local();
+
+        /* A parameter packing itself with a PacketBuilder */
+        if (!b) {
+            QByteArray ret(framed ? 4 : 0, Qt::Uninitialized);
+            DataStream out(&ret, QIODevice::Append, version);
+            out.pack(std::forward<Params>(params)...);
+            if (framed) {
+                setLength(ret.data(), ret.length() - 4);
+            }
+            return ret;
+        }
+
+        b->begin(framed, version);
+        b->out.pack(std::forward<Params>(params)...);
+        return b->end(framed);
+    }
+
+    static PacketBuilder *local();
+    static void setLength(char *header, int length);
+
+    void begin(bool framed, quint16 version);
+    QByteArray end(bool framed);
+
+    QByteArray buffer;
+    QBuffer device;
+    DataStream out;
+    bool busy;
+    int capacity;
+};
+
+#endif // PACKETBUILDER_H
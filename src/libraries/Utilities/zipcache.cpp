@@ -0,0 +1,127 @@
+#include <QFile>
+#include <QMutexLocker>
+
+#ifdef _WIN32
+#include "../../SpecialIncludes/zip.h"
+#else
+#include <zip.h>
+#endif
+
+#include "functions.h"
+#include "zipcache.h"
+
+ZipCache *ZipCache::obj()
+{
+    static ZipCache cache;
+    return &cache;
+}
+
+ZipCache::ZipCache()
+{
+}
+
+ZipCache::~ZipCache()
+{
+    clear();
+}
+
+ZipCache::Archive::~Archive()
+{
+    zip_close(handle);
+}
+
+void ZipCache::clear()
+{
+    QMutexLocker l(&mutex);
+
+    /* The archives being read are closed when their reads are done */
+    archives.clear();
+    files.clear();
+}
+
+/* The mutex of the cache must be locked */
+QSharedPointer<ZipCache::Archive> ZipCache::archive(const QString &path)
+{
+    if (archives.contains(path)) {
+        return archives.value(path);
+    }
+
+    int error = 0;
+    zip *handle = zip_open(path.toUtf8().constData(), 0, &error);
+
+    if (!handle) {
+        archives.insert(path, QSharedPointer<Archive>());
+        return QSharedPointer<Archive>();
+    }
+
+    QSharedPointer<Archive> a(new Archive());
+    a->handle = handle;
+
+    int count = zip_get_num_files(handle);
+    a->index.reserve(count);
+    for (int i = 0; i < count; i++) {
+        const char *name = zip_get_name(handle, i, 0);
+        if (name) {
+            a->index.insert(QString::fromUtf8(name), i);
+        }
+    }
+
+    archives.insert(path, a);
+    return a;
+}
+
+bool ZipCache::exists(const QString &archivePath, const QString &file)
+{
+    QMutexLocker l(&mutex);
+
+    if (!archivePath.endsWith(".zip")) {
+        QString path = archivePath + "/" + file;
+        if (!files.contains(path)) {
+            files.insert(path, QFile::exists(path));
+        }
+        return files.value(path);
+    }
+
+    QSharedPointer<Archive> a = archive(archivePath);
+    return a && a->index.contains(file);
+}
+
+QByteArray ZipCache::read(const QString &archivePath, const QString &file)
+{
+    QByteArray ret;
+
+    if (!archivePath.endsWith(".zip")) {
+        if (exists(archivePath, file)) {
+            ret = getFileContent(archivePath + "/" + file);
+        }
+        return ret;
+    }
+
+    QSharedPointer<Archive> a;
+    int index;
+    {
+        QMutexLocker l(&mutex);
+        a = archive(archivePath);
+        if (!a || !a->index.contains(file)) {
+            return ret;
+        }
+        index = a->index.value(file);
+    }
+
+    /* Not under the mutex of the cache, reads in other archives would wait for this one */
+    QMutexLocker l(&a->mutex);
+
+    zip_file *f = zip_fopen_index(a->handle, index, 0);
+
+    if (f) {
+        char buffer[4096];
+        int readsize;
+        while ((readsize = zip_fread(f, buffer, sizeof(buffer))) > 0) {
+            ret.append(buffer, readsize);
+        }
+
+        zip_fclose(f);
+    }
+
+    return ret;
+}
@@ -0,0 +1,60 @@
+#ifndef ZIPCACHE_H
+#define ZIPCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+struct zip;
+
+/* Archives opened once for the whole process and kept open, with the names
+   of their files in a hash: reading a file is a lookup and the decompression
+   of that file, instead of parsing the directory of the whole archive each
+   time. Asking for a file the archive doesn't have costs nothing.
+
+   Folders work too (any path not ending with .zip), whether their files
+   exist is remembered.
+
+   Thread-safe, reads in different archives don't wait for each other.
+
+    QByteArray data = ZipCache::obj()->read("db/pokes/5G/sprites.zip", "black-white/25.png"); */
+class ZipCache
+{
+public:
+    static ZipCache *obj();
+
+    /* Empty if the archive or the file doesn't exist */
+    QByteArray read(const QString &archive, const QString &file);
+    bool exists(const QString &archive, const QString &file);
+
+    /* Closes everything, for when files changed on disk (a mod installed, ...) */
+    void clear();
+
+    ZipCache();
+    ~ZipCache();
+private:
+    /* Closed when the last read in it is done, a read keeps its own
+       reference so that clear() doesn't pull it away */
+    struct Archive {
+        zip *handle;
+        QHash<QString, int> index;
+        /* libzip can only read one file at a time in an archive */
+        QMutex mutex;
+
+        ~Archive();
+    };
+
+    QMutex mutex;
+    /* Null for the archives that couldn't be opened */
+    QHash<QString, QSharedPointer<Archive> > archives;
+    /* Folder + file, for folders */
+    QHash<QString, bool> files;
+
+    QSharedPointer<Archive> archive(const QString &path);
+
+    ZipCache(const ZipCache&);
+    ZipCache &operator=(const ZipCache&);
+};
+
+#endif // ZIPCACHE_H
@@ -9,6 +9,13 @@ ServerPlugin * createServerPlugin(ServerInterface* server) {
     return new WebServerPlugin(server);
 }
 
+/* Events kept for one iteration of the event loop, during a flood the others
+   are only counted */
+static const int maxEvents = 500;
+/* Past that many bytes waiting to be sent to a client, it doesn't get events
+   until it catches up */
+static const qint64 maxBacklog = 256*1024;
+
 WebServerPlugin::WebServerPlugin(ServerInterface* server) : server(server)
 {
 }
@@ -46,6 +53,8 @@ void WebServerPlugin::init()
     connect(webserver, SIGNAL(newConnection()), SLOT(dealWithNewConnection()));
     connect(srv, SIGNAL(chatMessage(QString)), SLOT(onChatMessage(QString)));
     connect(srv, SIGNAL(serverMessage(QString)), SLOT(onServerMessage(QString)));
+    connect(srv, SIGNAL(player_authchange(int,QString)), SLOT(onPlayerChange(int,QString)));
+    connect(srv, SIGNAL(player_logout(int)), SLOT(onPlayerLogout(int)));
 
     connect(this, SIGNAL(sendMessage(QString)), srv, SLOT(sendServerMessage(QString)));
     connect(this, SIGNAL(scriptsChanged(QString)), srv, SLOT(changeScript(QString)));
@@ -76,12 +85,22 @@ QWidget *WebServerPlugin::getConfigurationWidget()
 
 void WebServerPlugin::onChatMessage(const QString &message)
 {
-    broadcast("chat|"+message);
+    broadcast(ChatEvents, "chat|"+message);
 }
 
 void WebServerPlugin::onServerMessage(const QString &message)
 {
-    broadcast("msg|"+message);
+    broadcast(ServerEvents, "msg|"+message);
+}
+
+void WebServerPlugin::onPlayerChange(int id, const QString &name)
+{
+    broadcast(PlayerEvents, "player|" + QString::number(id) + "|" + name);
+}
+
+void WebServerPlugin::onPlayerLogout(int id)
+{
+    broadcast(PlayerEvents, "logout|" + QString::number(id));
 }
 
 void WebServerPlugin::dealWithNewConnection()
@@ -95,7 +114,7 @@ void WebServerPlugin::dealWithNewConnection()
     QString ip = s->ip();
 
     /* Only one websocket per IP */
-    foreach(QWsSocket *socket, clients) {
+    foreach(QWsSocket *socket, clients.keys()) {
         if (socket->ip() == ip) {
             s->deleteLater();
             return;
@@ -120,9 +139,9 @@ void WebServerPlugin::dealWithNewConnection()
     s->setParent(this);
     connect(s, SIGNAL(disconnected()), s, SLOT(deleteLater()));
     connect(s, SIGNAL(disconnected()), SLOT(removeSocket()));
-    connect(s, SIGNAL(frameReceived(QString)), SLOT(dealWithFrame(QString)));
+    connect(s, SIGNAL(textFrameReceived(QByteArray)), SLOT(dealWithFrame(QByteArray)));
 
-    clients.insert(s);
+    clients.insert(s, Client());
 
     QString challenge;
     for (int i = 0; i < 20; i++) {
@@ -132,12 +151,13 @@ void WebServerPlugin::dealWithNewConnection()
     s->write("challenge|"+challenge);
 }
 
-void WebServerPlugin::dealWithFrame(const QString &f)
+void WebServerPlugin::dealWithFrame(const QByteArray &f)
 {
     QWsSocket *s = qobject_cast<QWsSocket*>(sender());
 
-    QString command = f.section("|",0,0);
-    QString data = f.section("|", 1);
+    int separator = f.indexOf('|');
+    QByteArray command = separator == -1 ? f : f.left(separator);
+    QString data = separator == -1 ? QString() : QString::fromUtf8(f.mid(separator + 1));
 
     if (!s->property("loggedIn").toBool()) {
         if (command == "auth") {
@@ -155,6 +175,18 @@ void WebServerPlugin::dealWithFrame(const QString &f)
     } else {
         if (command == "msg") {
             emit sendMessage(data);
+        } else if (command == "subscribe") {
+            Client &c = clients[s];
+            c.events = 0;
+            foreach(const QString &kind, data.split(",", QString::SkipEmptyParts)) {
+                if (kind == "chat") {
+                    c.events |= ChatEvents;
+                } else if (kind == "msg") {
+                    c.events |= ServerEvents;
+                } else if (kind == "players") {
+                    c.events |= PlayerEvents;
+                }
+            }
         } else if (command == "getscripts") {
             s->write("scripts|"+QString::fromUtf8(getFileContent("scripts.js")));
         } else if (command == "changescripts") {
@@ -283,11 +315,80 @@ void WebServerPlugin::removeSocket()
     clients.remove(qobject_cast<QWsSocket*>(sender()));
 }
 
-void WebServerPlugin::broadcast(const QString &message)
+void WebServerPlugin::broadcast(int kind, const QString &message)
 {
-    foreach(QWsSocket *s, clients) {
-        if (s->property("loggedIn").toBool()) {
-            s->write(message);
+    if (clients.empty()) {
+        return;
+    }
+
+    if (events.empty()) {
+        QTimer::singleShot(0, this, SLOT(sendEvents()));
+    }
+
+    if (events.size() >= maxEvents) {
+        overflow[kind] += 1;
+        return;
+    }
+
+    Event e;
+    e.kind = kind;
+    e.text = message.toUtf8();
+    e.frame = QWsSocket::composeFrame(e.text);
+    events.push_back(e);
+}
+
+/* Each client gets the events it subscribed to. A client which has too much
+   waiting to be sent gets nothing, and is told how many events it missed
+   once it caught up */
+void WebServerPlugin::sendEvents()
+{
+    QList<Event> sent = events;
+    events.clear();
+    QHash<int, int> missed = overflow;
+    overflow.clear();
+
+    QMutableHashIterator<QWsSocket*, Client> it(clients);
+    while (it.hasNext()) {
+        it.next();
+
+        QWsSocket *s = it.key();
+        Client &c = it.value();
+
+        if (!s->property("loggedIn").toBool()) {
+            continue;
+        }
+
+        QHashIterator<int, int> mit(missed);
+        while (mit.hasNext()) {
+            mit.next();
+            if (c.events & mit.key()) {
+                c.dropped += mit.value();
+            }
+        }
+
+        if (s->bytesPending() > maxBacklog) {
+            foreach(const Event &e, sent) {
+                if (c.events & e.kind) {
+                    c.dropped += 1;
+                }
+            }
+            continue;
+        }
+
+        if (c.dropped > 0) {
+            s->write("dropped|" + QString::number(c.dropped));
+            c.dropped = 0;
+        }
+
+        bool prepared = s->version() != WS_V0;
+        foreach(const Event &e, sent) {
+            if (c.events & e.kind) {
+                if (prepared) {
+                    s->writePrepared(e.frame);
+                } else {
+                    s->write(QString::fromUtf8(e.text));
+                }
+            }
         }
     }
 }
@@ -34,9 +34,12 @@ public:
 public slots:
     void onChatMessage(const QString& message);
     void onServerMessage(const QString& message);
+    void onPlayerChange(int id, const QString &name);
+    void onPlayerLogout(int id);
     void dealWithNewConnection();
-    void dealWithFrame(const QString& );
+    void dealWithFrame(const QByteArray& );
     void removeSocket();
+    void sendEvents();
 
 signals:
     void sendMessage(const QString &msg);
@@ -50,19 +53,48 @@ signals:
     void announcementChanged(QString);
     void antiDosChanged(QSettings&);
 private:
+    /* What a client can subscribe to, with "subscribe|chat,msg,players" */
+    enum EventKind {
+        ChatEvents = 1,
+        ServerEvents = 2,
+        PlayerEvents = 4
+    };
+
+    struct Client {
+        int events;
+        /* Events not sent because the client was behind, it gets their
+           count when it catches up */
+        int dropped;
+
+        Client() : events(ChatEvents | ServerEvents), dropped(0) {}
+    };
+
+    /* An event is framed once, and the frame is written to each client */
+    struct Event {
+        int kind;
+        QByteArray text;
+        QByteArray frame;
+    };
+
     ServerInterface *server;
     QWsServer *webserver;
 
-    QSet<QWsSocket*> clients;
+    QHash<QWsSocket*, Client> clients;
     QHash<QString, QVector<int> > attemptsPerIp;
 
+    /* The events of this iteration of the event loop, sent together at
+       the end of it */
+    QList<Event> events;
+    /* Events past the limit of an iteration, by kind */
+    QHash<int, int> overflow;
+
     int port;
     QString pass;
 
     QJson::Parser jparser;
     QJson::Serializer jserial;
 
-    void broadcast(const QString &);
+    void broadcast(int kind, const QString &);
 };
 
 #endif // WEBSERVERPLUGIN_H
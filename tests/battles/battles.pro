@@ -0,0 +1,65 @@
+CONFIG   += console
+CONFIG   -= app_bundle
+
+EXTRAS = test
+
+TEMPLATE = app
+
+INCLUDEPATH += ../../src/
+INCLUDEPATH += ../common/
+INCLUDEPATH += ../benchmarks/battles/
+
+include(../../src/Shared/Common.pri)
+
+LIBS += $$pokemoninfo
+
+TARGET = test-battles
+
+# The battle engine is compiled in directly, like in the battle benchmark, whose
+# driver plays the battles here too
+engine = ../../src/BattleServer
+bench = ../benchmarks/battles
+
+SOURCES += main.cpp \
+    testsnapshotreplay.cpp \
+    ../common/test.cpp \
+    ../common/testrunner.cpp \
+    $$bench/allocationcounter.cpp \
+    $$bench/battledriver.cpp \
+    $$bench/battlesetup.cpp \
+    $$engine/rbymoves.cpp \
+    $$engine/mechanicsbase.cpp \
+    $$engine/mechanics.cpp \
+    $$engine/genmechanics.cpp \
+    $$engine/berries.cpp \
+    $$engine/battlerby.cpp \
+    $$engine/battlepluginstruct.cpp \
+    $$engine/battlecounters.cpp \
+    $$engine/battlebase.cpp \
+    $$engine/battle.cpp \
+    $$engine/abilities.cpp \
+    $$engine/items.cpp \
+    $$engine/pluginmanager.cpp \
+    $$engine/moves.cpp
+
+HEADERS += \
+    testsnapshotreplay.h \
+    ../common/test.h \
+    ../common/testrunner.h \
+    $$bench/allocationcounter.h \
+    $$bench/battledriver.h \
+    $$bench/battlesetup.h \
+    $$engine/rbymoves.h \
+    $$engine/mechanicsbase.h \
+    $$engine/mechanics.h \
+    $$engine/genmechanics.h \
+    $$engine/berries.h \
+    $$engine/battlerby.h \
+    $$engine/battlepluginstruct.h \
+    $$engine/battlebase.h \
+    $$engine/battlesnapshot.h \
+    $$engine/battle.h \
+    $$engine/abilities.h \
+    $$engine/items.h \
+    $$engine/pluginmanager.h \
+    $$engine/moves.h
@@ -0,0 +1,18 @@
+#include <QCoreApplication>
+#include "testrunner.h"
+#include "battlesetup.h"
+#include "testsnapshotreplay.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    loadBattleDatabase();
+
+    TestRunner runner;
+    runner.setName("battles");
+    runner.addTest(new TestSnapshotReplay());
+    runner.start();
+
+    return a.exec();
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <random>
+#include <Utilities/contextswitch.h>
+#include <PokemonInfo/pokemoninfo.h>
+#include <BattleServer/battle.h>
+#include <BattleServer/battlerby.h>
+#include <BattleServer/pluginmanager.h>
+#include "battledriver.h"
+#include "battlesetup.h"
+#include "testsnapshotreplay.h"
+
+static bool modeExists(int mode, Pokemon::gen gen)
+{
+    if (mode == ChallengeInfo::Doubles) {
+        return gen >= 3;
+    }
+    if (mode == ChallengeInfo::Triples) {
+        return gen >= 5;
+    }
+    return true;
+}
+
+void TestSnapshotReplay::run()
+{
+    BattleServerPluginManager plugins;
+    ContextSwitcher ctx;
+    ctx.start();
+
+    int replayed = 0;
+    int failed = 0;
+
+    for (int g = GenInfo::GenMin(); g <= GenInfo::GenMax(); g++) {
+        Pokemon::gen gen(g, GenInfo::NumberOfSubgens(g) - 1);
+
+        for (int mode = ChallengeInfo::Singles; mode <= ChallengeInfo::Triples; mode++) {
+            if (!modeExists(mode, gen)) {
+                continue;
+            }
+
+            /* Restored at different points: the first turns, and later when more
+               effects are running */
+            for (int i = 0; i < 4; i++) {
+                quint32 seed = 1 + 7919 * (i + 100 * (g * ChallengeInfo::numberOfModes + mode));
+                std::mt19937 random(seed);
+
+                TeamBattle t1 = randomTeam(gen, random);
+                TeamBattle t2 = randomTeam(gen, random);
+                t1.name = "Moogle";
+                t2.name = "Mystra";
+
+                ChallengeInfo c(0, 0, ChallengeInfo::SleepClause | ChallengeInfo::FreezeClause | ChallengeInfo::NoTimeOut, mode);
+                c.gen = gen;
+
+                BattlePlayer p1(t1.name, 1), p2(t2.name, 2);
+
+                BattleBase *battle;
+                if (gen <= 1) {
+                    battle = new BattleRBY(p1, p2, c, i + 1, t1, t2, &plugins);
+                } else {
+                    battle = new BattleSituation(p1, p2, c, i + 1, t1, t2, &plugins);
+                }
+
+                BattleDriver driver(battle, seed);
+                BattleDriver::ReplayResult result = driver.checkReplay(ctx, 1 + 4 * i, 5);
+
+                if (result == BattleDriver::Replayed) {
+                    replayed += 1;
+                } else if (result != BattleDriver::TooShort) {
+                    failed += 1;
+                    std::cerr << (result == BattleDriver::Stuck ? "Battle stuck" : "Battle diverged after the restore")
+                              << ": gen " << g << ", " << ChallengeInfo::modeName(mode).toStdString()
+                              << ", seed " << seed << std::endl;
+                }
+
+                delete battle;
+            }
+        }
+    }
+
+    ctx.finish();
+    ctx.wait();
+
+    if (failed > 0 || replayed == 0) {
+        reject();
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef TESTSNAPSHOTREPLAY_H
+#define TESTSNAPSHOTREPLAY_H
+
+#include "test.h"
+
+/* Snapshots battles of each generation and mode, plays a few turns, restores
+   the snapshot and plays the same choices again: the battle must send exactly
+   the same things the second time. */
+class TestSnapshotReplay : public Test
+{
+public:
+    void run();
+};
+
+#endif // TESTSNAPSHOTREPLAY_H
@@ -0,0 +1,58 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocationcounter.h"
+
+/* Constant initialized, allocations can happen before any constructor is run */
+static std::atomic<long long> allocations(0);
+
+long long allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
+
+#else
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *ret = std::malloc(size ? size : 1);
+    if (!ret) {
+        throw std::bad_alloc();
+    }
+    return ret;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+/* Number of heap allocations made by the process so far, all threads included.
+
+   With glibc malloc itself is counted, so the allocations of Qt containers are
+   seen too. Elsewhere only operator new is. */
+long long allocationCount();
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,320 @@
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <Utilities/coreclasses.h>
+#include <BattleServer/battlebase.h>
+#include "../../../src/Shared/battlecommands.h"
+#include "../../../src/Shared/battlestream.h"
+
+#include "allocationcounter.h"
+#include "battledriver.h"
+
+using namespace BattleCommands;
+
+/* The battle is considered stuck after that long without asking for choices */
+static const int stallTimeout = 10000;
+/* Rounds of choices refused in a row before giving up */
+static const int maxAttempts = 20;
+/* One choice in that many is a switch, when both are possible */
+static const int switchOdds = 8;
+
+BattleDriver::BattleDriver(BattleBase *battle, quint32 seed, bool snapshots) : battle(battle), random(seed), cancelled(false), m_ended(false),
+    recording(false), takeSnapshots(snapshots), m_snapshotTime(0), m_restoreTime(0), m_snapshotAllocations(0), m_snapshots(0)
+{
+    rearrange[0] = rearrange[1] = false;
+
+    connect(battle, SIGNAL(battleStream(int,int,int,QByteArray)), SLOT(onStream(int,int,int,QByteArray)), Qt::DirectConnection);
+    connect(battle, SIGNAL(battleFinished(int,int,int,int)), SLOT(onFinished(int,int,int,int)), Qt::DirectConnection);
+}
+
+bool BattleDriver::play(ContextSwitcher &ctx, int maxTurns)
+{
+    battle->start(ctx);
+
+    if (!waitForBattle()) {
+        return false;
+    }
+
+    QElapsedTimer clock;
+
+    forever {
+        if (m_ended || battle->turn() > maxTurns) {
+            return true;
+        }
+        if (takeSnapshots) {
+            snapshotAndRestore();
+        }
+        if (!sendChoices()) {
+            return false;
+        }
+
+        clock.start();
+        if (!waitForBattle()) {
+            return false;
+        }
+        m_latencies.push_back(clock.nsecsElapsed());
+    }
+}
+
+BattleDriver::ReplayResult BattleDriver::checkReplay(ContextSwitcher &ctx, int from, int turns)
+{
+    battle->start(ctx);
+
+    if (!waitForBattle()) {
+        return Stuck;
+    }
+
+    while (!m_ended && battle->turn() < from) {
+        if (!sendChoices() || !waitForBattle()) {
+            return Stuck;
+        }
+    }
+
+    BattleSnapshot snapshot = battle->snapshot();
+    if (m_ended || snapshot.isNull()) {
+        return TooShort;
+    }
+
+    mutex.lock();
+    QHash<int, BattleChoices> snapshotOffers = offers;
+    recording = true;
+    mutex.unlock();
+
+    for (int i = 0; i < turns; i++) {
+        rounds.push_back(QVector<QPair<int, BattleChoice> >());
+        if (!sendChoices() || !waitForBattle()) {
+            return Stuck;
+        }
+        /* A battle over can't be restored */
+        if (m_ended) {
+            return TooShort;
+        }
+    }
+
+    QByteArray first;
+    int lastTurn = battle->turn();
+
+    mutex.lock();
+    first.swap(sent);
+    offers = snapshotOffers;
+    recording = false;
+    mutex.unlock();
+
+    if (!battle->restore(snapshot)) {
+        return Diverged;
+    }
+
+    mutex.lock();
+    recording = true;
+    mutex.unlock();
+
+    QVector<QVector<QPair<int, BattleChoice> > > played;
+    played.swap(rounds);
+
+    foreach(const auto &round, played) {
+        typedef QPair<int, BattleChoice> Choice;
+        foreach(const Choice &c, round) {
+            battle->battleChoiceReceived(c.first, c.second);
+        }
+        if (!waitForBattle()) {
+            return Stuck;
+        }
+    }
+
+    QMutexLocker l(&mutex);
+    recording = false;
+
+    return sent == first && battle->turn() == lastTurn ? Replayed : Diverged;
+}
+
+void BattleDriver::sendChoice(int id, const BattleChoice &choice)
+{
+    if (recording && !rounds.empty()) {
+        rounds.back().push_back(QPair<int, BattleChoice>(id, choice));
+    }
+    battle->battleChoiceReceived(id, choice);
+}
+
+bool BattleDriver::waitForBattle()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    /* Spinning rather than sleeping, to not add the scheduler's delay to the latency */
+    while (!battle->blocked() && !m_ended) {
+        if (timer.elapsed() > stallTimeout) {
+            return false;
+        }
+        QThread::yieldCurrentThread();
+    }
+
+    return true;
+}
+
+/* The battle goes on from the restored snapshot, so the copies made when it
+   changes shared memories are counted in the turn */
+void BattleDriver::snapshotAndRestore()
+{
+    long long allocations = allocationCount();
+    QElapsedTimer timer;
+    timer.start();
+
+    BattleSnapshot snapshot = battle->snapshot();
+    if (snapshot.isNull()) {
+        m_snapshotAllocations += allocationCount() - allocations;
+        return;
+    }
+    m_snapshotTime += timer.nsecsElapsed();
+
+    timer.restart();
+    battle->restore(snapshot);
+    m_restoreTime += timer.nsecsElapsed();
+
+    m_snapshotAllocations += allocationCount() - allocations;
+    m_snapshots += 1;
+}
+
+bool BattleDriver::sendChoices()
+{
+    for (int attempt = 0; attempt < maxAttempts; attempt++) {
+        QHash<int, BattleChoices> choices;
+        bool rearranging[2];
+
+        mutex.lock();
+        choices.swap(offers);
+        rearranging[0] = rearrange[0];
+        rearranging[1] = rearrange[1];
+        rearrange[0] = rearrange[1] = false;
+        cancelled = false;
+        mutex.unlock();
+
+        for (auto it = choices.begin(); it != choices.end(); ++it) {
+            lastOffers[it.key()] = it.value();
+        }
+
+        /* In slot order, so the same seed gives the same battle */
+        QList<int> slots = choices.keys();
+        qSort(slots);
+
+        QVector<int> switched[2];
+        foreach(int slot, slots) {
+            int player = battle->player(slot);
+            sendChoice(battle->id(player), pick(slot, choices[slot], switched[player]));
+        }
+
+        for (int player = 0; player < 2; player++) {
+            if (rearranging[player]) {
+                RearrangeChoice r;
+                for (int i = 0; i < 6; i++) {
+                    r.pokeIndexes[i] = i;
+                }
+                sendChoice(battle->id(player), BattleChoice(battle->slot(player), r));
+            }
+        }
+
+        /* The battle answers a refused choice right away, from this thread */
+        QMutexLocker l(&mutex);
+        if (!cancelled) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+BattleChoice BattleDriver::pick(int slot, const BattleChoices &options, QVector<int> &switched)
+{
+    int player = battle->player(slot);
+
+    QVector<int> pokes;
+    if (options.switchAllowed) {
+        for (int i = 0; i < 6; i++) {
+            const PokeBattle &p = battle->poke(player, i);
+            if (p.num() != Pokemon::NoPoke && !p.ko() && !battle->isOut(player, i) && !switched.contains(i)) {
+                pokes.push_back(i);
+            }
+        }
+    }
+
+    if (!pokes.empty() && (!options.attacksAllowed || random() % switchOdds == 0)) {
+        SwitchChoice s;
+        s.pokeSlot = pokes[random() % pokes.size()];
+        switched.push_back(s.pokeSlot);
+
+        return BattleChoice(slot, s);
+    }
+
+    QVector<int> moves;
+    for (int i = 0; i < 4; i++) {
+        if (options.attackAllowed[i]) {
+            moves.push_back(i);
+        }
+    }
+
+    AttackChoice a;
+    /* -1 is struggle */
+    a.attackSlot = moves.empty() ? -1 : moves[random() % moves.size()];
+    a.attackTarget = randomTarget(slot);
+    a.mega = false;
+
+    return BattleChoice(slot, a);
+}
+
+int BattleDriver::randomTarget(int slot)
+{
+    int opponent = 1 - battle->player(slot);
+
+    QVector<int> targets;
+    for (int i = 0; i < battle->numberOfSlots()/2; i++) {
+        int target = battle->slot(opponent, i);
+        if (!battle->koed(target)) {
+            targets.push_back(target);
+        }
+    }
+
+    if (targets.empty()) {
+        return battle->slot(opponent);
+    }
+    return targets[random() % targets.size()];
+}
+
+void BattleDriver::onStream(int, int audience, int id, const QByteArray &data)
+{
+    QMutexLocker l(&mutex);
+
+    if (recording) {
+        sent += char(audience);
+        sent += data;
+    }
+
+    if (audience != StreamAudience::Player) {
+        return;
+    }
+
+    DataStream in(data);
+    uchar command;
+    qint8 who;
+    in >> command >> who;
+
+    int player = id == battle->id(0) ? 0 : 1;
+
+    if (command == OfferChoice) {
+        BattleChoices options;
+        in >> options;
+        offers[who] = options;
+    } else if (command == RearrangeTeam) {
+        rearrange[player] = true;
+    } else if (command == CancelMove) {
+        cancelled = true;
+        for (auto it = lastOffers.begin(); it != lastOffers.end(); ++it) {
+            if (battle->player(it.key()) == player) {
+                offers[it.key()] = it.value();
+            }
+        }
+    }
+}
+
+void BattleDriver::onFinished(int, int, int, int)
+{
+    m_ended = true;
+}
@@ -0,0 +1,110 @@
+#ifndef BATTLEDRIVER_H
+#define BATTLEDRIVER_H
+
+#include <random>
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+
+#include <PokemonInfo/battlestructs.h>
+
+class BattleBase;
+class ContextSwitcher;
+
+/* Plays both sides of a battle with random legal choices, in place of the
+   server and the clients. Everything the battle sends is thrown away except
+   what asks for a choice.
+
+   The battle runs in the thread of the ContextSwitcher, the driver sends the
+   choices from the calling thread whenever the battle is blocked waiting
+   for them, just like the battle server does when they come from the network. */
+class BattleDriver : public QObject
+{
+    Q_OBJECT
+public:
+    /* With snapshots, the battle is snapshotted and restored before each turn */
+    BattleDriver(BattleBase *battle, quint32 seed, bool snapshots = false);
+
+    /* Plays until the end of the battle or until maxTurns is passed. Returns
+       false if the battle got stuck refusing the choices. */
+    bool play(ContextSwitcher &ctx, int maxTurns);
+
+    enum ReplayResult {
+        Replayed,
+        /* The battle went another way after the restore */
+        Diverged,
+        /* Over before the end of the turns to replay, nothing to check */
+        TooShort,
+        Stuck
+    };
+
+    /* Plays until the turn 'from', takes a snapshot, plays 'turns' more turns,
+       restores the snapshot and sends the same choices again: everything
+       the battle sends must be the same the second time. */
+    ReplayResult checkReplay(ContextSwitcher &ctx, int from, int turns);
+
+    /* Time between the last choice of a round and the battle being ready
+       for the next one (or over), in ns */
+    const QVector<qint64> &latencies() const {
+        return m_latencies;
+    }
+    bool ended() const {
+        return m_ended;
+    }
+
+    /* Time spent taking a snapshot of the battle at each turn and restoring it, in ns,
+       and the allocations made meanwhile */
+    qint64 snapshotTime() const {
+        return m_snapshotTime;
+    }
+    qint64 restoreTime() const {
+        return m_restoreTime;
+    }
+    qint64 snapshotAllocations() const {
+        return m_snapshotAllocations;
+    }
+    int snapshots() const {
+        return m_snapshots;
+    }
+public slots:
+    void onStream(int publicId, int audience, int id, const QByteArray &data);
+    void onFinished(int battleid, int result, int winner, int loser);
+private:
+    BattleBase *battle;
+    std::mt19937 random;
+
+    /* Written from the battle thread */
+    QMutex mutex;
+    QHash<int, BattleChoices> offers;
+    bool rearrange[2];
+    /* Set when the battle cancels the choices of a player because one was refused */
+    bool cancelled;
+    volatile bool m_ended;
+
+    /* The choices given last round, sent again if the battle cancels them */
+    QHash<int, BattleChoices> lastOffers;
+
+    QVector<qint64> m_latencies;
+
+    /* For checkReplay(): what the battle sent, and the choices sent at each
+       round, when recording */
+    bool recording;
+    QByteArray sent;
+    QVector<QVector<QPair<int, BattleChoice> > > rounds;
+    void sendChoice(int id, const BattleChoice &choice);
+
+    bool takeSnapshots;
+    qint64 m_snapshotTime, m_restoreTime;
+    qint64 m_snapshotAllocations;
+    int m_snapshots;
+
+    /* Returns false if the battle doesn't get anywhere */
+    bool waitForBattle();
+    void snapshotAndRestore();
+    bool sendChoices();
+    BattleChoice pick(int slot, const BattleChoices &options, QVector<int> &switched);
+    int randomTarget(int slot);
+};
+
+#endif // BATTLEDRIVER_H
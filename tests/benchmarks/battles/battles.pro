@@ -0,0 +1,57 @@
+QT       += network
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+EXTRAS = test
+
+TEMPLATE = app
+
+INCLUDEPATH += ../../../src/
+
+include(../../../src/Shared/Common.pri)
+
+LIBS += $$pokemoninfo
+
+TARGET = bench-battles
+
+# The battle engine is compiled in directly, without the networking part of the battle server
+engine = ../../../src/BattleServer
+
+SOURCES += main.cpp \
+    allocationcounter.cpp \
+    battledriver.cpp \
+    battlesetup.cpp \
+    $$engine/rbymoves.cpp \
+    $$engine/mechanicsbase.cpp \
+    $$engine/mechanics.cpp \
+    $$engine/genmechanics.cpp \
+    $$engine/berries.cpp \
+    $$engine/battlerby.cpp \
+    $$engine/battlepluginstruct.cpp \
+    $$engine/battlecounters.cpp \
+    $$engine/battlebase.cpp \
+    $$engine/battle.cpp \
+    $$engine/abilities.cpp \
+    $$engine/items.cpp \
+    $$engine/pluginmanager.cpp \
+    $$engine/moves.cpp
+
+HEADERS += \
+    allocationcounter.h \
+    battledriver.h \
+    battlesetup.h \
+    $$engine/rbymoves.h \
+    $$engine/mechanicsbase.h \
+    $$engine/mechanics.h \
+    $$engine/genmechanics.h \
+    $$engine/berries.h \
+    $$engine/battlerby.h \
+    $$engine/battlepluginstruct.h \
+    $$engine/battlebase.h \
+    $$engine/battlesnapshot.h \
+    $$engine/battle.h \
+    $$engine/abilities.h \
+    $$engine/items.h \
+    $$engine/pluginmanager.h \
+    $$engine/moves.h
@@ -0,0 +1,90 @@
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+
+#include <PokemonInfo/pokemoninfo.h>
+#include <PokemonInfo/movesetchecker.h>
+#include <BattleServer/moves.h>
+#include <BattleServer/rbymoves.h>
+#include <BattleServer/items.h>
+#include <BattleServer/abilities.h>
+#include <BattleServer/genmechanics.h>
+
+#include "battlesetup.h"
+
+int loadBattleDatabase()
+{
+    PokemonInfoConfig::setFillMode(FillMode::Server);
+
+    GenInfo::init("db/gens/");
+    PokemonInfo::init("db/pokes/");
+    MoveSetChecker::init("db/pokes/");
+    ItemInfo::init("db/items/");
+    MoveInfo::init("db/moves/");
+    TypeInfo::init("db/types/");
+    NatureInfo::init("db/natures/");
+    CategoryInfo::init("db/categories/");
+    AbilityInfo::init("db/abilities/");
+    HiddenPowerInfo::init("db/types/");
+    StatInfo::init("db/status/");
+    GenderInfo::init("db/genders/");
+
+    PokemonInfo::loadStadiumTradebacks();
+
+    MoveEffect::init();
+    RBYMoveEffect::init();
+    ItemEffect::init();
+    AbilityEffect::init();
+
+    QElapsedTimer timer;
+    timer.start();
+    GenMechanics::build();
+    return timer.elapsed();
+}
+
+TeamBattle randomTeam(Pokemon::gen gen, std::mt19937 &random)
+{
+    static QHash<quint32, QVector<Pokemon::uniqueId> > pokesByGen;
+
+    QVector<Pokemon::uniqueId> &pokes = pokesByGen[gen.num];
+    if (pokes.empty()) {
+        foreach(Pokemon::uniqueId id, PokemonInfo::AllIds()) {
+            if (id != Pokemon::NoPoke && !PokemonInfo::IsForme(id) && PokemonInfo::Exists(id, gen) && PokemonInfo::Released(id, gen)) {
+                pokes.push_back(id);
+            }
+        }
+    }
+
+    Team team;
+    team.setGen(gen);
+
+    QSet<Pokemon::uniqueId> taken;
+    for (int i = 0; i < 6; i++) {
+        Pokemon::uniqueId num;
+        do {
+            num = pokes[random() % pokes.size()];
+        } while (taken.contains(num));
+        taken.insert(num);
+
+        PokeTeam &p = team.poke(i);
+        p.setNum(num);
+        p.load();
+        p.nature() = random() % NatureInfo::NumberOfNatures();
+
+        QList<int> moves = PokemonInfo::Moves(num, gen).toList();
+        qSort(moves);
+        for (int j = 0; j < 4 && !moves.empty(); j++) {
+            p.setMove(moves.takeAt(random() % moves.size()), j, false);
+        }
+
+        if (gen >= 2) {
+            int item;
+            do {
+                item = random() % ItemInfo::NumberOfItems();
+            } while (!ItemInfo::Exists(item, gen));
+            p.item() = item;
+        }
+    }
+
+    return TeamBattle(team);
+}
@@ -0,0 +1,19 @@
+#ifndef BATTLESETUP_H
+#define BATTLESETUP_H
+
+#include <random>
+
+#include <PokemonInfo/battlestructs.h>
+
+/* What playing battles without a server needs, shared by the benchmark and the
+   battle tests. Both must be run from a folder containing db/, like bin/. */
+
+/* Loads the database and binds the mechanics of all generations. Returns the
+   time taken by the binding, in ms */
+int loadBattleDatabase();
+
+/* Six different pokemon of the generation with moves they can learn, and
+   a held item from gen 2 on */
+TeamBattle randomTeam(Pokemon::gen gen, std::mt19937 &random);
+
+#endif // BATTLESETUP_H
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <cstdlib>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <Utilities/contextswitch.h>
+#include <Utilities/packetbuilder.h>
+#include <PokemonInfo/pokemoninfo.h>
+#include <PokemonInfo/battlestructs.h>
+#include <BattleServer/battle.h>
+#include <BattleServer/battlerby.h>
+#include <BattleServer/pluginmanager.h>
+
+#include "allocationcounter.h"
+#include "battledriver.h"
+#include "battlesetup.h"
+
+using namespace std;
+
+/* Plays battles between random teams with random choices for each generation
+   and each battle mode, without any network, and reports how fast the engine
+   goes. Everything is seeded, so two runs play the same battles.
+
+   With -S, the battle is also snapshotted and restored at each turn, to time both.
+   Their time and allocations are left out of the turn figures and reported apart,
+   but the turns still pay for the copies made after a restore.
+
+   Must be run from a folder containing db/, like bin/.
+
+   Options:
+     -b <n>  battles for each generation and mode (default 20)
+     -s <n>  seed (default 42)
+     -t <n>  turns after which a battle is stopped (default 500)
+     -g <n>  only that generation
+     -S      snapshot and restore the battles at each turn
+
+   Exits with 1 if a battle got stuck, so it can be used to catch regressions. */
+
+struct Options {
+    int battles;
+    quint32 seed;
+    int maxTurns;
+    int gen;
+    bool snapshots;
+
+    Options() : battles(20), seed(42), maxTurns(500), gen(0), snapshots(false) {
+
+    }
+};
+
+struct Results {
+    int battles;
+    int capped;
+    int stuck;
+    qint64 turns;
+    qint64 elapsed;
+    qint64 allocations;
+    qint64 packets;
+    qint64 arenaBytes;
+    qint64 arenaBlocks;
+    QVector<qint64> latencies;
+    int snapshots;
+    qint64 snapshotTime, restoreTime, snapshotAllocations;
+
+    Results() : battles(0), capped(0), stuck(0), turns(0), elapsed(0), allocations(0), packets(0),
+        arenaBytes(0), arenaBlocks(0), snapshots(0), snapshotTime(0), restoreTime(0), snapshotAllocations(0) {
+
+    }
+};
+
+static Options parseOptions(const QStringList &args)
+{
+    Options ret;
+
+    for (int i = 1; i < args.size(); i++) {
+        if (args[i] == "-S") {
+            ret.snapshots = true;
+            continue;
+        }
+        if (i + 1 >= args.size()) {
+            break;
+        }
+
+        QString option = args[i];
+        int value = args[++i].toInt();
+
+        if (option == "-b") {
+            ret.battles = value;
+        } else if (option == "-s") {
+            ret.seed = value;
+        } else if (option == "-t") {
+            ret.maxTurns = value;
+        } else if (option == "-g") {
+            ret.gen = value;
+        }
+    }
+
+    return ret;
+}
+
+static bool modeExists(int mode, Pokemon::gen gen)
+{
+    if (mode == ChallengeInfo::Doubles) {
+        return gen >= 3;
+    }
+    if (mode == ChallengeInfo::Triples) {
+        return gen >= 5;
+    }
+    return true;
+}
+
+static Results run(const Options &o, Pokemon::gen gen, int mode, ContextSwitcher &ctx, BattleServerPluginManager &plugins)
+{
+    Results ret;
+
+    for (int i = 0; i < o.battles; i++) {
+        quint32 seed = o.seed + 7919 * (i + 1000 * (gen.num * ChallengeInfo::numberOfModes + mode));
+        mt19937 random(seed);
+
+        TeamBattle t1 = randomTeam(gen, random);
+        TeamBattle t2 = randomTeam(gen, random);
+        t1.name = "Moogle";
+        t2.name = "Mystra";
+
+        ChallengeInfo c(0, 0, ChallengeInfo::SleepClause | ChallengeInfo::FreezeClause | ChallengeInfo::NoTimeOut, mode);
+        c.gen = gen;
+
+        BattlePlayer p1(t1.name, 1), p2(t2.name, 2);
+
+        BattleBase *battle;
+        if (gen <= 1) {
+            battle = new BattleRBY(p1, p2, c, i + 1, t1, t2, &plugins);
+        } else {
+            battle = new BattleSituation(p1, p2, c, i + 1, t1, t2, &plugins);
+        }
+
+        /* The battle thread's random generator is seeded from rand() */
+        srand(seed);
+
+        BattleDriver driver(battle, seed, o.snapshots);
+
+        long long allocations = allocationCount();
+        int packets = PacketBuilder::packets();
+        QElapsedTimer timer;
+        timer.start();
+
+        bool ok = driver.play(ctx, o.maxTurns);
+
+        /* Without the snapshots, so the figures compare with a plain run */
+        ret.elapsed += timer.nsecsElapsed() - driver.snapshotTime() - driver.restoreTime();
+        ret.allocations += allocationCount() - allocations - driver.snapshotAllocations();
+        ret.packets += PacketBuilder::packets() - packets;
+        ret.arenaBytes += battle->arena().used();
+        ret.arenaBlocks += battle->arena().blocks();
+        ret.turns += battle->turn();
+        ret.latencies += driver.latencies();
+        ret.snapshots += driver.snapshots();
+        ret.snapshotTime += driver.snapshotTime();
+        ret.restoreTime += driver.restoreTime();
+        ret.snapshotAllocations += driver.snapshotAllocations();
+        ret.battles += 1;
+
+        if (!ok) {
+            ret.stuck += 1;
+            cout << "Battle stuck: gen " << int(gen.num) << ", " << ChallengeInfo::modeName(mode).toStdString()
+                 << ", seed " << seed << ", turn " << battle->turn() << endl;
+        } else if (!driver.ended()) {
+            ret.capped += 1;
+        }
+
+        delete battle;
+    }
+
+    return ret;
+}
+
+static qint64 percentile(const QVector<qint64> &sorted, int p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[(sorted.size() - 1) * p / 100];
+}
+
+static void report(Pokemon::gen gen, int mode, Results &r)
+{
+    std::sort(r.latencies.begin(), r.latencies.end());
+
+    double seconds = r.elapsed / 1e9;
+    qint64 turns = std::max<qint64>(r.turns, 1);
+
+    cout << "gen " << int(gen.num) << "\t" << ChallengeInfo::modeName(mode).toStdString()
+         << "\t" << r.battles << " battles (" << r.capped << " capped, " << r.stuck << " stuck)"
+         << "\t" << r.turns << " turns"
+         << "\t" << int(r.turns / std::max(seconds, 1e-9)) << " turns/s"
+         << "\t" << r.allocations / turns << " allocs/turn"
+         << "\t" << r.packets / turns << " commands/turn"
+         << "\tarena " << r.arenaBytes / turns << " B/turn in " << r.arenaBlocks << " blocks"
+         << "\tlatency p50 " << percentile(r.latencies, 50) / 1000
+         << " us, p90 " << percentile(r.latencies, 90) / 1000
+         << " us, p99 " << percentile(r.latencies, 99) / 1000 << " us";
+    if (r.snapshots > 0) {
+        cout << "\tsnapshot " << r.snapshotTime / r.snapshots / 1000.0
+             << " us, restore " << r.restoreTime / r.snapshots / 1000.0 << " us"
+             << ", " << r.snapshotAllocations / r.snapshots << " allocs";
+    }
+    cout << endl;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    Options o = parseOptions(app.arguments());
+
+    int mechanics = loadBattleDatabase();
+    cout << "Mechanics of all generations bound in " << mechanics << " ms" << endl;
+
+    BattleServerPluginManager plugins;
+    ContextSwitcher ctx;
+    ctx.start();
+
+    int stuck = 0;
+
+    for (int g = GenInfo::GenMin(); g <= GenInfo::GenMax(); g++) {
+        if (o.gen != 0 && o.gen != g) {
+            continue;
+        }
+
+        Pokemon::gen gen(g, GenInfo::NumberOfSubgens(g) - 1);
+
+        for (int mode = ChallengeInfo::Singles; mode <= ChallengeInfo::Triples; mode++) {
+            if (!modeExists(mode, gen)) {
+                continue;
+            }
+
+            Results r = run(o, gen, mode, ctx, plugins);
+            report(gen, mode, r);
+            stuck += r.stuck;
+        }
+    }
+
+    ctx.finish();
+    ctx.wait();
+
+    return stuck > 0 ? 1 : 0;
+}
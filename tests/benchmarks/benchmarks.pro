@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+SUBDIRS = ladderindex \
+    battles \
+    packets \
+    logins
@@ -0,0 +1,15 @@
+CONFIG   += console
+CONFIG   -= app_bundle
+QT       -= gui
+
+EXTRAS = test
+
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+INCLUDEPATH += ../../../src/
+
+include(../../../src/Shared/Common.pri)
+
+TARGET = bench-ladderindex
@@ -0,0 +1,166 @@
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+#include <iostream>
+#include <random>
+
+#include <Utilities/rankingtree.h>
+#include <Utilities/ladderindex.h>
+
+using namespace std;
+
+/* Runs the scenarios of tests/utilities/testrankingtree.cpp at ladder size:
+   inserting members, changing their ratings after battles, asking for
+   their ranking and fetching ranking pages.
+
+   The LadderIndex is used like Tier does, with member ids as data and
+   names looked up when building a page. */
+
+static const int members = 1000000;
+static const int battles = 1000000;
+static const int queries = 1000000;
+static const int pageFetches = 10000;
+static const int playersByPage = 40;
+
+struct Scenario {
+    QVector<QString> names;
+    QVector<int> ratings;
+    /* (member, new rating) for each battle */
+    QVector<QPair<int, int> > changes;
+    QVector<int> asked;
+    QVector<int> pageNumbers;
+
+    Scenario() {
+        mt19937 gen(42);
+        normal_distribution<double> rating(1200, 250);
+        uniform_int_distribution<int> member(0, members-1);
+        uniform_int_distribution<int> change(-32, 32);
+        uniform_int_distribution<int> page(1, members/playersByPage);
+
+        for (int i = 0; i < members; i++) {
+            names.push_back(QString("player%1").arg(i));
+            ratings.push_back(std::max(0, int(rating(gen))));
+        }
+        QVector<int> current = ratings;
+        for (int i = 0; i < battles; i++) {
+            int m = member(gen);
+            current[m] = std::max(0, current[m] + change(gen));
+            changes.push_back(QPair<int, int>(m, current[m]));
+        }
+        for (int i = 0; i < queries; i++) {
+            asked.push_back(member(gen));
+        }
+        for (int i = 0; i < pageFetches; i++) {
+            pageNumbers.push_back(page(gen));
+        }
+    }
+};
+
+/* Keeps the compiler from optimizing the ranking queries away */
+static volatile int sink = 0;
+
+static void report(const char *name, const char *step, QElapsedTimer &t, int count)
+{
+    qint64 ns = t.nsecsElapsed();
+    cout << name << "\t" << step << "\t" << ns / 1000000 << " ms\t" << double(ns) / count << " ns/op" << endl;
+    t.restart();
+}
+
+static int benchRankingTree(const Scenario &s)
+{
+    RankingTree<QString> *tree = new RankingTree<QString>();
+    QVector<RankingTree<QString>::Node*> nodes(members);
+    int checksum = 0;
+
+    QElapsedTimer t;
+    t.start();
+
+    for (int i = 0; i < members; i++) {
+        nodes[i] = tree->insert(s.ratings[i], s.names[i]);
+    }
+    report("RankingTree", "insert", t, members);
+
+    for (int i = 0; i < battles; i++) {
+        int m = s.changes[i].first;
+        nodes[m] = tree->changeKey(nodes[m], s.changes[i].second);
+    }
+    report("RankingTree", "changeKey", t, battles);
+
+    for (int i = 0; i < queries; i++) {
+        sink += nodes[s.asked[i]]->ranking();
+    }
+    report("RankingTree", "ranking", t, queries);
+
+    for (int i = 0; i < pageFetches; i++) {
+        auto it = tree->getByRanking((s.pageNumbers[i]-1) * playersByPage + 1);
+        for (int j = 0; j < playersByPage && it.p != NULL; j++, --it) {
+            sink += it->data.length();
+            checksum += it->key;
+        }
+    }
+    report("RankingTree", "page", t, pageFetches);
+
+    delete tree;
+    report("RankingTree", "destroy", t, members);
+
+    return checksum;
+}
+
+static int benchLadderIndex(const Scenario &s)
+{
+    LadderIndex<int> *index = new LadderIndex<int>();
+    QVector<int> current = s.ratings;
+    int checksum = 0;
+
+    QElapsedTimer t;
+    t.start();
+
+    for (int i = 0; i < members; i++) {
+        index->insert(s.ratings[i], i);
+    }
+    report("LadderIndex", "insert", t, members);
+
+    for (int i = 0; i < battles; i++) {
+        int m = s.changes[i].first;
+        index->changeKey(m, current[m], s.changes[i].second);
+        current[m] = s.changes[i].second;
+    }
+    report("LadderIndex", "changeKey", t, battles);
+
+    for (int i = 0; i < queries; i++) {
+        int m = s.asked[i];
+        sink += index->ranking(current[m], m);
+    }
+    report("LadderIndex", "ranking", t, queries);
+
+    for (int i = 0; i < pageFetches; i++) {
+        auto it = index->getByRanking((s.pageNumbers[i]-1) * playersByPage + 1);
+        for (int j = 0; j < playersByPage && it.valid(); j++, ++it) {
+            sink += s.names[it.data()].length();
+            checksum += it.key();
+        }
+    }
+    report("LadderIndex", "page", t, pageFetches);
+
+    delete index;
+    report("LadderIndex", "destroy", t, members);
+
+    return checksum;
+}
+
+int main()
+{
+    cout << "Generating " << members << " members..." << endl;
+    Scenario s;
+
+    int c1 = benchRankingTree(s);
+    int c2 = benchLadderIndex(s);
+
+    /* The ratings found on the pages must be the same */
+    if (c1 != c2) {
+        cout << "Checksums differ: " << c1 << " " << c2 << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <iostream>
+#include <PokemonInfo/teamholder.h>
+#include <Teambuilder/analyze.h>
+
+#include "loginbench.h"
+
+using namespace std;
+
+LoginBench::LoginBench(const QString &host, quint16 port, int logins, int concurrency)
+    : host(host), port(port), logins(logins), concurrency(concurrency), started(0), done(0), m_failures(0)
+{
+}
+
+void LoginBench::start()
+{
+    timer.start();
+
+    for (int i = 0; i < concurrency && started < logins; i++) {
+        connectOne();
+    }
+}
+
+void LoginBench::connectOne()
+{
+    Analyzer *a = new Analyzer();
+
+    connect(a, SIGNAL(connected()), SLOT(onConnected()));
+    connect(a, SIGNAL(playerLogin(PlayerInfo,QStringList)), SLOT(onLogin(PlayerInfo,QStringList)));
+    connect(a, SIGNAL(disconnected()), SLOT(onDisconnected()));
+
+    startTimes.insert(a, timer.nsecsElapsed());
+    numbers.insert(a, started);
+    started += 1;
+
+    a->connectTo(host, port);
+}
+
+void LoginBench::onConnected()
+{
+    Analyzer *a = dynamic_cast<Analyzer*>(sender());
+    /* A different name each time, the players logged out before may be
+       kept for a while by the server, for reconnection */
+    a->login(TeamHolder(QString("Bench%1").arg(numbers.value(a))), false);
+}
+
+void LoginBench::onLogin(const PlayerInfo &, const QStringList &)
+{
+    finish(dynamic_cast<Analyzer*>(sender()), true);
+}
+
+void LoginBench::onDisconnected()
+{
+    /* Before the login was accepted */
+    finish(dynamic_cast<Analyzer*>(sender()), false);
+}
+
+void LoginBench::finish(Analyzer *a, bool ok)
+{
+    if (!startTimes.contains(a)) {
+        return;
+    }
+
+    if (ok) {
+        latencies.push_back(timer.nsecsElapsed() - startTimes.value(a));
+    } else {
+        m_failures += 1;
+    }
+    startTimes.remove(a);
+    numbers.remove(a);
+    done += 1;
+
+    a->blockSignals(true);
+    a->disconnectFromHost();
+    a->deleteLater();
+
+    if (started < logins) {
+        connectOne();
+    } else if (done == logins) {
+        report();
+        emit finished();
+    }
+}
+
+static qint64 percentile(const QVector<qint64> &sorted, int p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[(sorted.size() - 1) * p / 100];
+}
+
+void LoginBench::report()
+{
+    double seconds = timer.nsecsElapsed() / 1e9;
+    std::sort(latencies.begin(), latencies.end());
+
+    cout << logins << " logins, " << concurrency << " at a time, " << m_failures << " failed"
+         << "\t" << int(latencies.size() / std::max(seconds, 1e-9)) << " logins/s"
+         << "\tlatency p50 " << percentile(latencies, 50) / 1000
+         << " us, p90 " << percentile(latencies, 90) / 1000
+         << " us, p99 " << percentile(latencies, 99) / 1000 << " us" << endl;
+}
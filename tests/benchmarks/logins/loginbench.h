@@ -0,0 +1,49 @@
+#ifndef LOGINBENCH_H
+#define LOGINBENCH_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+
+class Analyzer;
+class PlayerInfo;
+
+/* Connects players to a server and logs them in, a few at a time, and
+   measures how long it takes from the connection to the login being
+   accepted */
+class LoginBench : public QObject
+{
+    Q_OBJECT
+public:
+    LoginBench(const QString &host, quint16 port, int logins, int concurrency);
+
+    void start();
+
+    int failures() const {
+        return m_failures;
+    }
+signals:
+    void finished();
+private slots:
+    void onConnected();
+    void onLogin(const PlayerInfo &info, const QStringList &tiers);
+    void onDisconnected();
+private:
+    QString host;
+    quint16 port;
+    int logins, concurrency;
+
+    int started, done, m_failures;
+    QElapsedTimer timer;
+    /* Connections not logged in yet, with when they started */
+    QHash<Analyzer*, qint64> startTimes;
+    QHash<Analyzer*, int> numbers;
+    QVector<qint64> latencies;
+
+    void connectOne();
+    void finish(Analyzer *a, bool ok);
+    void report();
+};
+
+#endif // LOGINBENCH_H
@@ -0,0 +1,23 @@
+QT       += core network
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+EXTRAS = test
+
+TEMPLATE = app
+
+INCLUDEPATH += ../../../src/
+
+include(../../../src/Shared/Common.pri)
+
+LIBS += $$battlemanager
+
+TARGET = bench-logins
+
+SOURCES += main.cpp \
+    loginbench.cpp \
+    ../../../src/Teambuilder/analyze.cpp
+
+HEADERS += loginbench.h \
+    ../../../src/Teambuilder/analyze.h
@@ -0,0 +1,52 @@
+#include <QCoreApplication>
+#include <QStringList>
+
+#include <PokemonInfo/pokemoninfo.h>
+#include "loginbench.h"
+
+/* Logs players in on a running server as fast as it accepts them, and reports
+   the logins per second and the time from connecting to the login being
+   accepted.
+
+   Run a server locally first (with 127.0.0.1 among the trusted ips of the
+   anti DoS, like by default), from a folder containing db/, like bin/.
+
+   Options:
+     -h <host>  server (default localhost)
+     -p <n>     port (default 5080)
+     -n <n>     logins (default 2000)
+     -c <n>     connections at the same time (default 50)
+
+   Exits with 1 if a login failed. */
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    QString host = "localhost";
+    int port = 5080, logins = 2000, concurrency = 50;
+
+    for (int i = 1; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-h") {
+            host = args[i+1];
+        } else if (args[i] == "-p") {
+            port = args[i+1].toInt();
+        } else if (args[i] == "-n") {
+            logins = args[i+1].toInt();
+        } else if (args[i] == "-c") {
+            concurrency = args[i+1].toInt();
+        }
+    }
+
+    GenInfo::init("db/gens/");
+    PokemonInfo::init("db/pokes/");
+
+    LoginBench bench(host, port, logins, concurrency);
+    QObject::connect(&bench, SIGNAL(finished()), &app, SLOT(quit()));
+    bench.start();
+
+    app.exec();
+
+    return bench.failures() > 0 ? 1 : 0;
+}
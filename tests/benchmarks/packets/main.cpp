@@ -0,0 +1,93 @@
+#include <QElapsedTimer>
+#include <QStringList>
+#include <iostream>
+
+#include <Utilities/packetbuilder.h>
+#include "../battles/allocationcounter.h"
+
+using namespace std;
+
+/* Makes the packets the servers make the most, a battle command and a chat
+   line, the way they were made before (a new DataStream over a new QByteArray
+   each time) and with PacketBuilder, and reports the time and heap allocations
+   per packet of both. */
+
+static const int packets = 1000000;
+
+template <typename ...Params>
+static QByteArray withDataStream(Params&&... params) {
+    QByteArray ret;
+    DataStream out(&ret, QIODevice::WriteOnly);
+    out.pack(std::forward<Params>(params)...);
+    return ret;
+}
+
+template <typename ...Params>
+static QByteArray framedWithDataStream(Params&&... params) {
+    QByteArray ret(4, Qt::Uninitialized);
+    DataStream out(&ret, QIODevice::Append);
+    out.pack(std::forward<Params>(params)...);
+
+    const int l = ret.length()-4;
+    ret[0] = l >> (3*8);
+    ret[1] = l >> (2*8);
+    ret[2] = l >> 8;
+    ret[3] = l;
+
+    return ret;
+}
+
+template <class F>
+static void measure(const char *name, F make)
+{
+    qint64 bytes = 0;
+
+    long long allocations = allocationCount();
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < packets; i++) {
+        bytes += make(i).length();
+    }
+
+    qint64 elapsed = timer.nsecsElapsed();
+    allocations = allocationCount() - allocations;
+
+    cout << name << "\t" << elapsed / packets << " ns/packet\t"
+         << double(allocations) / packets << " allocs/packet\t"
+         << bytes / packets << " bytes/packet" << endl;
+}
+
+int main()
+{
+    QString message = QString::fromUtf8("Crystal Moogle: gg, that Scizor came out of nowhere");
+    QStringList names = QStringList() << "Moogle" << "Mystra" << "Darkness";
+
+    /* Like BattleBase::notify(All, ChangeHp, ...) */
+    measure("battle command, DataStream", [](int i) {
+        return withDataStream(uchar(6), qint8(i & 1), quint16(i % 400));
+    });
+    measure("battle command, PacketBuilder", [](int i) {
+        return PacketBuilder::pack(0, uchar(6), qint8(i & 1), quint16(i % 400));
+    });
+
+    /* Like makePacket(NetworkServ::SendMessage, ...) for a chat line */
+    measure("chat line, DataStream", [&](int i) {
+        return framedWithDataStream(uchar(51), qint32(i), message);
+    });
+    measure("chat line, PacketBuilder", [&](int i) {
+        return PacketBuilder::packFramed(0, uchar(51), qint32(i), message);
+    });
+
+    measure("name list, DataStream", [&](int i) {
+        return framedWithDataStream(uchar(10), qint32(i), names);
+    });
+    measure("name list, PacketBuilder", [&](int i) {
+        return PacketBuilder::packFramed(0, uchar(10), qint32(i), names);
+    });
+
+    cout << PacketBuilder::packets() << " packets built, " << PacketBuilder::growths() << " buffer growths, "
+         << PacketBuilder::fallbacks() << " fallbacks" << endl;
+
+    return 0;
+}
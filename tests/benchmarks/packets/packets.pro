@@ -0,0 +1,20 @@
+CONFIG   += console
+CONFIG   -= app_bundle
+QT       -= gui
+
+EXTRAS = test
+
+TEMPLATE = app
+
+INCLUDEPATH += ../../../src/
+
+include(../../../src/Shared/Common.pri)
+
+LIBS += $$utilities
+
+TARGET = bench-packets
+
+SOURCES += main.cpp \
+    ../battles/allocationcounter.cpp
+
+HEADERS += ../battles/allocationcounter.h
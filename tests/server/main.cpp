@@ -1,6 +1,7 @@
 #include <QCoreApplication>
 #include "pokemontestrunner.h"
 #include "testchat.h"
+#include "testchatflood.h"
 #include "testdisconnection.h"
 #include "testvariation.h"
 #include "testregister.h"
@@ -25,6 +26,7 @@ int main(int argc, char *argv[])
     runner.addTest(new TestSession());
     runner.addTest(new TestReconnect());
     runner.addTest(new TestColor());
+    runner.addTest(new TestChatFlood());
     /* Always last test */
     runner.addTest(new TestShutdown());
 
@@ -28,6 +28,7 @@ SOURCES += main.cpp \
     testplayer.cpp \
     ../../src/Teambuilder/analyze.cpp \
     testchat.cpp \
+    testchatflood.cpp \
     testdisconnection.cpp \
     testvariation.cpp \
     ../common/pokemontestrunner.cpp \
@@ -44,6 +45,7 @@ HEADERS += \
     testplayer.h \
     ../../src/Teambuilder/analyze.h \
     testchat.h \
+    testchatflood.h \
     testdisconnection.h \
     testvariation.h \
     ../common/pokemontestrunner.h \
@@ -0,0 +1,33 @@
+#include <PokemonInfo/teamholder.h>
+#include <Teambuilder/analyze.h>
+
+#include "testchatflood.h"
+
+static const int lines = 30;
+
+void TestChatFlood::onPlayerConnected()
+{
+    sender()->login(TeamHolder("Raider"), false);
+    sender()->sendChanMessage(0, "eval: sys.setMaxChatLines(10)");
+
+    for (int i = 0; i < lines; i++) {
+        sender()->sendChanMessage(0, QString("Line %1").arg(i));
+    }
+}
+
+void TestChatFlood::onChannelMessage(const QString &message, int, bool)
+{
+    if (message.startsWith("Raider: Line ")) {
+        received += 1;
+        return;
+    }
+
+    QRegExp summary("^(\\d+) messages suppressed$");
+    if (summary.indexIn(message) != -1) {
+        assert(received > 0 && received < lines);
+        assert(received + summary.cap(1).toInt() == lines);
+        /* A second went by since the flood, this line is let through */
+        sender()->sendChanMessage(0, "eval: sys.setMaxChatLines(0)");
+        accept();
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef TESTCHATFLOOD_H
+#define TESTCHATFLOOD_H
+
+#include "testplayer.h"
+
+/* Caps the lines per second through the scripts, for this test only, then sends more
+   lines at once: those past the cap never arrive, and the channel is told how many
+   were suppressed */
+class TestChatFlood : public TestPlayer
+{
+    Q_OBJECT
+public:
+    TestChatFlood() : received(0) {}
+public slots:
+    void onPlayerConnected();
+    void onChannelMessage(const QString &message, int chanid, bool html);
+private:
+    int received;
+};
+
+#endif // TESTCHATFLOOD_H
@@ -3,6 +3,13 @@
 #include "testfunctions.h"
 #include "testinsensitivemap.h"
 #include "testrankingtree.h"
+#include "testladderindex.h"
+#include "testpacketbuilder.h"
+#include "testcompressionstream.h"
+#include "testarena.h"
+#include "testasynclog.h"
+#include "testidallocator.h"
+#include "testzipcache.h"
 
 int main(int argc, char *argv[])
 {
@@ -13,6 +20,13 @@ int main(int argc, char *argv[])
     runner.addTest(new TestInsensitiveMap());
     runner.addTest(new TestFunctions());
     runner.addTest(new TestRankingTree());
+    runner.addTest(new TestLadderIndex());
+    runner.addTest(new TestPacketBuilder());
+    runner.addTest(new TestCompressionStream());
+    runner.addTest(new TestArena());
+    runner.addTest(new TestAsyncLog());
+    runner.addTest(new TestIdAllocator());
+    runner.addTest(new TestZipCache());
     runner.start();
 
     return a.exec();
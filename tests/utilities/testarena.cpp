@@ -0,0 +1,40 @@
+#include <Utilities/arena.h>
+#include "testarena.h"
+
+typedef std::vector<int, ArenaAllocator<int> > IntVector;
+
+void TestArena::run()
+{
+    Arena arena(256);
+
+    {
+        IntVector v(&arena);
+        for (int i = 0; i < 1000; i++) {
+            v.push_back(i);
+        }
+        assert(v.size() == 1000 && v[999] == 999);
+
+        std::vector<double, ArenaAllocator<double> > d(&arena);
+        d.push_back(1.5);
+        assert(reinterpret_cast<size_t>(&d[0]) % std::alignment_of<double>::value == 0);
+
+        /* Copies use the same arena */
+        IntVector copy = v;
+        assert(copy.get_allocator() == v.get_allocator());
+        assert(copy == v);
+    }
+
+    assert(arena.blocks() > 1);
+    assert(arena.used() >= 1000 * int(sizeof(int)));
+
+    /* The same work after a reset fits in the block kept */
+    arena.reset();
+    int blocks = arena.blocks();
+    {
+        IntVector v(&arena);
+        for (int i = 0; i < 1000; i++) {
+            v.push_back(i);
+        }
+    }
+    assert(arena.blocks() == blocks);
+}
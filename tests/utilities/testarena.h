@@ -0,0 +1,12 @@
+#ifndef TESTARENA_H
+#define TESTARENA_H
+
+#include "test.h"
+
+class TestArena : public Test
+{
+public:
+    void run();
+};
+
+#endif // TESTARENA_H
@@ -0,0 +1,121 @@
+#include <QDir>
+#include <QFile>
+#include <QThread>
+#include <Utilities/asynclog.h>
+#include "testasynclog.h"
+
+namespace {
+class Pusher : public QThread
+{
+public:
+    Pusher(LogRing *ring, int player) : ring(ring), player(player) {}
+
+    void run() {
+        for (int i = 0; i < 5000; i++) {
+            LogRecord r;
+            r.player = player;
+            r.channel = i;
+            ring->push(r);
+        }
+    }
+private:
+    LogRing *ring;
+    int player;
+};
+}
+
+void TestAsyncLog::run()
+{
+    /* In order, and dropped when full instead of waiting */
+    {
+        LogRing ring(3);
+        for (int i = 0; i < 5; i++) {
+            LogRecord r;
+            r.text = QString::number(i);
+            assert(ring.push(r) == (i < 4));
+        }
+        assert(ring.dropped() == 1);
+        assert(ring.pushed() == 4);
+
+        LogRecord r;
+        for (int i = 0; i < 4; i++) {
+            assert(ring.pop(r) && r.text == QString::number(i));
+        }
+        assert(!ring.pop(r) && ring.empty());
+
+        /* The freed cells are used again */
+        r.text = "again";
+        assert(ring.push(r));
+        assert(ring.pop(r) && r.text == "again");
+    }
+
+    /* Several threads at once: nothing lost, each thread's records in order */
+    {
+        LogRing ring(32768);
+        QList<Pusher*> pushers;
+        for (int i = 0; i < 4; i++) {
+            pushers.push_back(new Pusher(&ring, i));
+            pushers.back()->start();
+        }
+        foreach(Pusher *p, pushers) {
+            p->wait();
+            delete p;
+        }
+
+        QVector<int> next(4, 0);
+        LogRecord r;
+        int count = 0;
+        while (ring.pop(r)) {
+            assert(r.channel == next[r.player]);
+            next[r.player] += 1;
+            count += 1;
+        }
+        assert(count == 20000 && ring.dropped() == 0);
+    }
+
+    /* Rotation on size */
+    {
+        QDir dir = QDir::temp();
+        dir.mkpath("po-test-asynclog");
+        dir.cd("po-test-asynclog");
+
+        AsyncLog::Options options;
+        options.pattern = dir.absoluteFilePath("logs%1.txt");
+        options.files = 3;
+        options.maxSize = 1000;
+        options.console = false;
+        options.lastFile = dir.absoluteFilePath("last_log_file.txt");
+
+        AsyncLog log;
+        log.start(options);
+        for (int i = 0; i < 100; i++) {
+            assert(log.write(LogRecord::Info, QString("Moogle joined the channel, number %1").arg(i), 2, i));
+        }
+        log.flush();
+        log.stop();
+
+        /* 100 lines of 70 bytes: 15 lines in each file, the seventh one
+           replaces the first one */
+        QFile last(options.lastFile);
+        assert(last.open(QIODevice::ReadOnly));
+        QString current = QString::fromUtf8(last.readAll()).trimmed();
+        assert(current == options.pattern.arg(0));
+
+        QFile f(current);
+        assert(f.open(QIODevice::ReadOnly));
+        QList<QByteArray> lines = f.readAll().split('\n');
+        assert(f.size() < 1000);
+        /* Last line is written completely, with its fields */
+        lines.removeAll(QByteArray());
+        QList<QByteArray> fields = lines.back().split('\t');
+        assert(fields.size() == 5);
+        assert(fields[1] == "info" && fields[2] == "2" && fields[3] == "99");
+        assert(fields[4] == "Moogle joined the channel, number 99");
+
+        for (int i = 0; i < 3; i++) {
+            QFile::remove(options.pattern.arg(i));
+        }
+        QFile::remove(options.lastFile);
+        dir.rmdir(dir.absolutePath());
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef TESTASYNCLOG_H
+#define TESTASYNCLOG_H
+
+#include "test.h"
+
+class TestAsyncLog : public Test
+{
+public:
+    void run();
+};
+
+#endif // TESTASYNCLOG_H
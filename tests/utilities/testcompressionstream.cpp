@@ -0,0 +1,40 @@
+#include <Utilities/compressionstream.h>
+#include "testcompressionstream.h"
+
+void TestCompressionStream::run()
+{
+    DeflateStream deflater;
+    InflateStream inflater;
+
+    QByteArray chat = "Moogle: the battle is about to start, place your bets";
+
+    /* Each chunk can be read as soon as it arrives */
+    QByteArray first = deflater.compress(chat);
+    bool ok = false;
+    assert(inflater.decompress(first, &ok) == chat);
+    assert(ok);
+
+    /* The same message again only costs a few bytes */
+    QByteArray second = deflater.compress(chat);
+    assert(second.length() < first.length() / 2);
+    assert(inflater.decompress(second, &ok) == chat);
+    assert(ok);
+
+    /* Big chunk */
+    QByteArray big;
+    for (int i = 0; i < 20000; i++) {
+        big += QByteArray::number(i * 7919 % 1000);
+    }
+    assert(inflater.decompress(deflater.compress(big), &ok) == big);
+    assert(ok);
+
+    /* Garbage breaks the stream until reset */
+    InflateStream broken;
+    broken.decompress(QByteArray(64, char(0xff)), &ok);
+    assert(!ok);
+    broken.decompress(first, &ok);
+    assert(!ok);
+    broken.reset();
+    assert(broken.decompress(first, &ok) == chat);
+    assert(ok);
+}
@@ -0,0 +1,12 @@
+#ifndef TESTCOMPRESSIONSTREAM_H
+#define TESTCOMPRESSIONSTREAM_H
+
+#include "test.h"
+
+class TestCompressionStream : public Test
+{
+public:
+    void run();
+};
+
+#endif // TESTCOMPRESSIONSTREAM_H
@@ -0,0 +1,41 @@
+#include <QSet>
+#include <Utilities/idallocator.h>
+#include "testidallocator.h"
+
+void TestIdAllocator::run()
+{
+    IdAllocator ids(3);
+
+    assert(ids.take() == 1);
+    assert(ids.take() == 2);
+
+    /* Not reused before 3 other ids are released */
+    ids.release(1);
+    ids.release(2);
+    assert(ids.take() == 3);
+    ids.release(3);
+    assert(ids.take() == 4);
+    ids.release(4);
+    assert(ids.waiting() == 4);
+
+    /* Then in the order they were released */
+    assert(ids.take() == 1);
+    assert(ids.take() == 5);
+    ids.release(5);
+    assert(ids.take() == 2);
+
+    /* Never twice at the same time */
+    IdAllocator many;
+    QSet<int> taken;
+    for (int i = 0; i < 20000; i++) {
+        int id = many.take();
+        assert(id > 0 && !taken.contains(id));
+        taken.insert(id);
+
+        if (i % 3 == 0) {
+            int old = *taken.begin();
+            taken.remove(old);
+            many.release(old);
+        }
+    }
+}
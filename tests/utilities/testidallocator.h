@@ -0,0 +1,12 @@
+#ifndef TESTIDALLOCATOR_H
+#define TESTIDALLOCATOR_H
+
+#include "test.h"
+
+class TestIdAllocator : public Test
+{
+public:
+    void run();
+};
+
+#endif // TESTIDALLOCATOR_H
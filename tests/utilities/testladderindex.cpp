@@ -0,0 +1,66 @@
+#include <climits>
+#include <QString>
+#include <Utilities/ladderindex.h>
+#include "testladderindex.h"
+
+void TestLadderIndex::run()
+{
+    LadderIndex<QString> rankings;
+
+    rankings.insert(1600, "Crystal Moogle");
+    rankings.insert(9000, "Mystra");
+    rankings.insert(666, "SkarmPiss");
+    rankings.insert(8008, "Scott TM");
+    rankings.insert(1337, "Darkness");
+
+    rankings.changeKey("Scott TM", 8008, 999);
+
+    assert(rankings.ranking(1600, "Crystal Moogle") == 2);
+    assert(rankings.ranking(9000, "Mystra") == 1);
+    assert(rankings.ranking(666, "SkarmPiss") == rankings.count());
+    assert(rankings.ranking(1337, "Darkness") == 3);
+    assert(rankings.ranking(999, "Scott TM") == 4);
+    assert(rankings.count() == 5);
+    assert(rankings.getByRanking(2).data() == "Crystal Moogle");
+
+    /* Same rating: sorted by name */
+    rankings.insert(1337, "Arceus");
+    assert(rankings.ranking(1337, "Arceus") == 3);
+    assert(rankings.ranking(1337, "Darkness") == 4);
+
+    /* Walking the ladder from a given rank */
+    auto it = rankings.getByRanking(3);
+    assert(it.data() == "Arceus" && it.key() == 1337);
+    ++it;
+    assert(it.data() == "Darkness");
+    ++it; ++it;
+    assert(it.valid() && it.data() == "SkarmPiss");
+    ++it;
+    assert(!it.valid());
+
+    assert(rankings.remove(1337, "Darkness"));
+    assert(!rankings.remove(1337, "Darkness"));
+    assert(rankings.ranking(1337, "Darkness") == 0);
+    assert(rankings.count() == 5);
+
+    /* Ratings far off the initial range */
+    rankings.insert(100000, "Cheater");
+    rankings.insert(-50000, "Loser");
+    assert(rankings.ranking(100000, "Cheater") == 1);
+    assert(rankings.ranking(9000, "Mystra") == 2);
+    assert(rankings.ranking(-50000, "Loser") == rankings.count());
+    assert(!rankings.getByRanking(rankings.count() + 1).valid());
+
+    /* Past the buckets, members share the edge one but keep their order and keys */
+    rankings.insert(INT_MAX, "Overflow");
+    rankings.insert(200000, "Script");
+    rankings.insert(INT_MIN, "Underflow");
+    assert(rankings.ranking(INT_MAX, "Overflow") == 1);
+    assert(rankings.ranking(200000, "Script") == 2);
+    assert(rankings.ranking(100000, "Cheater") == 3);
+    assert(rankings.getByRanking(2).key() == 200000);
+    assert(rankings.ranking(INT_MIN, "Underflow") == rankings.count());
+    assert(rankings.getByRanking(rankings.count()).key() == INT_MIN);
+    assert(rankings.remove(200000, "Script"));
+    assert(rankings.ranking(100000, "Cheater") == 2);
+}
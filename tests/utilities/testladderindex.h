@@ -0,0 +1,12 @@
+#ifndef TESTLADDERINDEX_H
+#define TESTLADDERINDEX_H
+
+#include "test.h"
+
+class TestLadderIndex : public Test
+{
+public:
+    void run();
+};
+
+#endif // TESTLADDERINDEX_H
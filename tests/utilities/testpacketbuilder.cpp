@@ -0,0 +1,60 @@
+#include <QStringList>
+#include <Utilities/packetbuilder.h>
+#include "testpacketbuilder.h"
+
+namespace {
+template <typename ...Params>
+QByteArray withDataStream(quint16 version, Params&&... params) {
+    QByteArray ret;
+    DataStream out(&ret, QIODevice::WriteOnly, version);
+    out.pack(std::forward<Params>(params)...);
+    return ret;
+}
+
+/* Packs itself with a PacketBuilder while being packed */
+struct Nested {
+    QString name;
+};
+
+DataStream &operator << (DataStream &out, const Nested &n)
+{
+    out << PacketBuilder::pack(0, n.name);
+    return out;
+}
+}
+
+void TestPacketBuilder::run()
+{
+    QString name = QString::fromUtf8("Crystal Moogle \xc3\xa9");
+    QStringList channels = QStringList() << "Tohjo Falls" << "Indigo Plateau";
+
+    /* Same bytes as a DataStream */
+    assert(PacketBuilder::pack(0, uchar(12), qint8(1), name) == withDataStream(0, uchar(12), qint8(1), name));
+    assert(PacketBuilder::pack(2, uchar(3), qint32(-5), true, channels) == withDataStream(2, uchar(3), qint32(-5), true, channels));
+
+    /* A smaller packet after a bigger one only gets its own bytes */
+    assert(PacketBuilder::pack(0, uchar(7)) == QByteArray(1, 7));
+
+    /* Framed: length in front */
+    QByteArray framed = PacketBuilder::packFramed(0, uchar(12), name);
+    QByteArray content = withDataStream(0, uchar(12), name);
+    assert(framed.length() == content.length() + 4);
+    assert(framed.mid(4) == content);
+    assert(framed[0] == 0 && framed[1] == 0 && framed[2] == 0 && uchar(framed[3]) == content.length());
+
+    /* Packing while packing */
+    int fallbacks = PacketBuilder::fallbacks();
+    Nested n;
+    n.name = name;
+    QByteArray nested = PacketBuilder::pack(0, uchar(1), n);
+    assert(nested == withDataStream(0, uchar(1), withDataStream(0, name)));
+    assert(PacketBuilder::fallbacks() == fallbacks + 1);
+
+    /* Big packet: the buffer grows, and goes back to a small one after */
+    int growths = PacketBuilder::growths();
+    QByteArray big(200*1024, 'x');
+    assert(PacketBuilder::packFramed(0, uchar(2), big).mid(4) == withDataStream(0, uchar(2), big));
+    assert(PacketBuilder::growths() == growths + 1);
+    assert(PacketBuilder::pack(0, uchar(12), name) == withDataStream(0, uchar(12), name));
+    assert(PacketBuilder::growths() == growths + 1);
+}
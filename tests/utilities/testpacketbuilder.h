@@ -0,0 +1,12 @@
+#ifndef TESTPACKETBUILDER_H
+#define TESTPACKETBUILDER_H
+
+#include "test.h"
+
+class TestPacketBuilder : public Test
+{
+public:
+    void run();
+};
+
+#endif // TESTPACKETBUILDER_H
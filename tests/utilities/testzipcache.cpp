@@ -0,0 +1,57 @@
+#include <QDir>
+#include <Utilities/functions.h>
+#include <Utilities/ziputils.h>
+#include <Utilities/zipcache.h>
+#include "testzipcache.h"
+
+void TestZipCache::run()
+{
+    QDir dir = QDir::temp();
+    dir.mkpath("po-test-zipcache/sprites");
+    dir.cd("po-test-zipcache");
+
+    QString path = dir.absoluteFilePath("sprites.zip");
+    QFile::remove(path);
+
+    QByteArray pikachu(5000, 'p');
+    {
+        Zip zip;
+        zip.create(path);
+        zip.addMemoryFile(pikachu, "black-white/25.png");
+        zip.addMemoryFile("moogle", "black-white/female/25.png");
+        zip.writeArchive();
+    }
+
+    ZipCache cache;
+
+    assert(cache.read(path, "black-white/25.png") == pikachu);
+    assert(cache.read(path, "black-white/female/25.png") == "moogle");
+    /* Several times from the same handle */
+    assert(cache.read(path, "black-white/25.png") == pikachu);
+
+    assert(cache.exists(path, "black-white/25.png"));
+    assert(!cache.exists(path, "black-white/shiny/25.png"));
+    assert(cache.read(path, "black-white/shiny/25.png").isEmpty());
+
+    assert(!cache.exists(dir.absoluteFilePath("missing.zip"), "black-white/25.png"));
+    assert(cache.read(dir.absoluteFilePath("missing.zip"), "black-white/25.png").isEmpty());
+
+    /* Folders */
+    QString folder = dir.absoluteFilePath("sprites");
+    writeFileContent(folder + "/26.png", "raichu");
+    assert(cache.read(folder, "26.png") == "raichu");
+    assert(!cache.exists(folder, "27.png"));
+
+    /* What's missing is remembered until cleared */
+    writeFileContent(folder + "/27.png", "sandshrew");
+    assert(!cache.exists(folder, "27.png"));
+    cache.clear();
+    assert(cache.read(folder, "27.png") == "sandshrew");
+
+    QFile::remove(folder + "/26.png");
+    QFile::remove(folder + "/27.png");
+    dir.rmdir(folder);
+    cache.clear();
+    QFile::remove(path);
+    dir.rmdir(dir.absolutePath());
+}
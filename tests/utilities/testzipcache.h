@@ -0,0 +1,12 @@
+#ifndef TESTZIPCACHE_H
+#define TESTZIPCACHE_H
+
+#include "test.h"
+
+class TestZipCache : public Test
+{
+public:
+    void run();
+};
+
+#endif // TESTZIPCACHE_H
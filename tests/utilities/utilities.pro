@@ -15,6 +15,13 @@ SOURCES += main.cpp \
     testinsensitivemap.cpp \
     testfunctions.cpp \
     testrankingtree.cpp \
+    testladderindex.cpp \
+    testpacketbuilder.cpp \
+    testcompressionstream.cpp \
+    testarena.cpp \
+    testasynclog.cpp \
+    testidallocator.cpp \
+    testzipcache.cpp \
     ../common/test.cpp \
     ../common/testrunner.cpp
 
@@ -31,6 +38,13 @@ HEADERS += \
     testinsensitivemap.h \
     testfunctions.h \
     testrankingtree.h \
+    testladderindex.h \
+    testpacketbuilder.h \
+    testcompressionstream.h \
+    testarena.h \
+    testasynclog.h \
+    testidallocator.h \
+    testzipcache.h \
     ../common/test.h \
     ../common/testrunner.h
 